@@ -0,0 +1,213 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Sparse Region Iterator
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef __itkImageSparseRegionConstIterator_h
+#define __itkImageSparseRegionConstIterator_h
+
+#include "itkImageRegion.h"
+#include <vector>
+
+namespace itk
+{
+
+/** \class ImageSparseRegionConstIterator
+ * \brief Iterate over the stored voxels of a region of a SparseVectorImage.
+ *
+ * ImageRegionConstIterator visits every voxel of a region, and looks up
+ * each of them in the container even though most are not stored. This
+ * iterator only visits the voxels stored in the container, so that
+ * algorithms which skip the empty voxels, e.g. conversions to a dense
+ * image already filled with the fill value, or sums over the non-zero
+ * values, run in time proportional to the number of stored voxels.
+ *
+ * The stored voxels inside the region are collected with the
+ * VisitElements() method of the container when the iterator is
+ * constructed, and visited in increasing offset order, i.e. in the
+ * same order as ImageRegionConstIterator. The voxels which are not
+ * stored have the fill value of the image.
+ *
+ * At each position, GetIndex() and GetOffset() give the location of the
+ * voxel, and GetComponents() a pointer to its GetVectorLength()
+ * components. Get() returns them as a pixel.
+ *
+ * The iterator is not updated when pixels are added to the image after
+ * its construction.
+ *
+ * \code
+ * itk::ImageSparseRegionConstIterator< ImageType > it( image, region );
+ * for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+ *   {
+ *   const ImageType::InternalPixelType *components = it.GetComponents();
+ *   ...
+ *   }
+ * \endcode
+ *
+ * \sa ImageSparseRegionIterator
+ *
+ * \ingroup ImageIterators
+ * \ingroup ITKSparseVectorImage
+ *
+ */
+template< class TImage >
+class ITK_EXPORT ImageSparseRegionConstIterator
+{
+public:
+  /** Standard class typedefs. */
+  typedef ImageSparseRegionConstIterator Self;
+
+  /** Dimension of the image the iterator walks. */
+  itkStaticConstMacro(ImageIteratorDimension, unsigned int, TImage::ImageDimension);
+
+  /** Image typedefs. */
+  typedef TImage                                 ImageType;
+  typedef typename ImageType::PixelType          PixelType;
+  typedef typename ImageType::PixelTraits        PixelTraits;
+  typedef typename ImageType::InternalPixelType  InternalPixelType;
+  typedef typename ImageType::IndexType          IndexType;
+  typedef typename ImageType::RegionType         RegionType;
+  typedef typename ImageType::OffsetValueType    OffsetValueType;
+  typedef typename ImageType::PixelContainer     PixelContainerType;
+  typedef typename ImageType::VectorLengthType   VectorLengthType;
+
+  /** Offsets of the stored voxels inside the region, in increasing order. */
+  typedef std::vector< OffsetValueType > OffsetArrayType;
+
+  /** Default constructor. The iterator needs an image and a region to
+   *  be usable. */
+  ImageSparseRegionConstIterator();
+
+  /** Constructor establishes an iterator to walk the stored voxels of
+   *  a particular region of an image. */
+  ImageSparseRegionConstIterator(const ImageType *image, const RegionType & region);
+
+  virtual ~ImageSparseRegionConstIterator() {}
+
+  /** Get the region the iterator walks. */
+  const RegionType & GetRegion() const
+    { return m_Region; }
+
+  /** Get the number of stored voxels inside the region. */
+  SizeValueType GetNumberOfPixels() const
+    { return m_Offsets.size(); }
+
+  /** Move the iterator to the first stored voxel of the region. */
+  void GoToBegin()
+    { this->SetPosition( 0 ); }
+
+  /** Is the iterator past the last stored voxel of the region? */
+  bool IsAtEnd() const
+    { return m_Position == m_Offsets.size(); }
+
+  /** Move to the next stored voxel. */
+  Self & operator++()
+    {
+    this->SetPosition( m_Position + 1 );
+    return *this;
+    }
+
+  /** Get the offset of the current voxel in the image. */
+  OffsetValueType GetOffset() const
+    { return m_Offsets[m_Position]; }
+
+  /** Get the index of the current voxel. */
+  IndexType GetIndex() const
+    { return ComputeIndex( m_Image, m_Offsets[m_Position] ); }
+
+  /** Get a pointer to the GetVectorLength() components of the current
+   *  voxel. The pointer is valid until the iterator is moved. */
+  const InternalPixelType * GetComponents() const;
+
+  /** Get the number of components of each voxel. */
+  VectorLengthType GetVectorLength() const
+    { return m_VectorLength; }
+
+  /** Get the value of the current voxel. */
+  PixelType Get() const;
+
+protected:
+  /** Move to the given stored voxel. */
+  void SetPosition(SizeValueType position)
+    {
+    m_Position = position;
+    m_Loaded = false;
+    }
+
+  /** The inverse of SparseVectorImage::ComputeOffset(), whose offsets
+   *  do not depend on the start index of the buffered region. */
+  static IndexType ComputeIndex(const ImageType *image, OffsetValueType offset)
+    {
+    const OffsetValueType *offsetTable = image->GetOffsetTable();
+    IndexType index;
+    for ( unsigned int d = ImageIteratorDimension - 1; d > 0; d-- )
+      {
+      index[d] = offset / offsetTable[d];
+      offset -= index[d] * offsetTable[d];
+      }
+    index[0] = offset;
+    return index;
+    }
+
+  /** Collect the offsets of the stored voxels inside a region from the
+   *  keys visited by VisitElements(). The components of a voxel are
+   *  usually visited one after the other, so that most duplicates are
+   *  skipped here; the others are removed after sorting. */
+  struct OffsetCollector
+    {
+    OffsetCollector(const ImageType *image, const RegionType & region,
+                    OffsetArrayType & offsets)
+      : m_Image( image ), m_Region( region ), m_Offsets( offsets ),
+        m_VectorLength( image->GetVectorLength() ), m_Last( -1 ),
+        m_WholeImage( region == image->GetLargestPossibleRegion() ) {}
+
+    template< class TKey, class TValue >
+    void operator()(TKey key, const TValue &)
+      {
+      const OffsetValueType offset = static_cast< OffsetValueType >( key / m_VectorLength );
+      if ( offset == m_Last )
+        {
+        return;
+        }
+      m_Last = offset;
+      if ( m_WholeImage || m_Region.IsInside( ComputeIndex( m_Image, offset ) ) )
+        {
+        m_Offsets.push_back( offset );
+        }
+      }
+
+    const ImageType *    m_Image;
+    const RegionType &   m_Region;
+    OffsetArrayType &    m_Offsets;
+    const SizeValueType  m_VectorLength;
+    OffsetValueType      m_Last;
+    const bool           m_WholeImage;
+    };
+
+  typename ImageType::ConstWeakPointer m_Image;
+  RegionType                           m_Region;
+  OffsetArrayType                      m_Offsets;
+  SizeValueType                        m_Position;
+  VectorLengthType                     m_VectorLength;
+
+  /** Components of the current voxel, copied from the container the
+   *  first time they are accessed. */
+  mutable std::vector< InternalPixelType > m_Components;
+  mutable bool                             m_Loaded;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkImageSparseRegionConstIterator.hxx"
+#endif
+
+#endif
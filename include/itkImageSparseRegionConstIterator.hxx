@@ -0,0 +1,92 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Sparse Region Iterator
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef _itkImageSparseRegionConstIterator_hxx
+#define _itkImageSparseRegionConstIterator_hxx
+
+#include "itkImageSparseRegionConstIterator.h"
+#include <algorithm>
+
+namespace itk
+{
+
+template< class TImage >
+ImageSparseRegionConstIterator< TImage >
+::ImageSparseRegionConstIterator()
+{
+  m_Image = NULL;
+  m_Position = 0;
+  m_VectorLength = 0;
+  m_Loaded = false;
+}
+
+
+template< class TImage >
+ImageSparseRegionConstIterator< TImage >
+::ImageSparseRegionConstIterator(const ImageType *image, const RegionType & region)
+{
+  m_Image = image;
+  m_Region = region;
+  m_Position = 0;
+  m_VectorLength = image->GetVectorLength();
+  m_Components.resize( m_VectorLength );
+  m_Loaded = false;
+
+  if ( m_VectorLength == 0 )
+    {
+    return;
+    }
+
+  OffsetCollector collector( image, m_Region, m_Offsets );
+  image->GetPixelContainer()->VisitElements( collector );
+
+  std::sort( m_Offsets.begin(), m_Offsets.end() );
+  m_Offsets.erase( std::unique( m_Offsets.begin(), m_Offsets.end() ), m_Offsets.end() );
+}
+
+
+template< class TImage >
+const typename ImageSparseRegionConstIterator< TImage >::InternalPixelType *
+ImageSparseRegionConstIterator< TImage >
+::GetComponents() const
+{
+  if ( !m_Loaded )
+    {
+    m_Image->GetPixelContainer()->GetPixel( m_Offsets[m_Position],
+                                            m_Image->GetFillBufferValue().GetDataPointer(),
+                                            &m_Components[0] );
+    m_Loaded = true;
+    }
+  return &m_Components[0];
+}
+
+
+template< class TImage >
+typename ImageSparseRegionConstIterator< TImage >::PixelType
+ImageSparseRegionConstIterator< TImage >
+::Get() const
+{
+  const InternalPixelType *components = this->GetComponents();
+
+  PixelType pixel;
+  PixelTraits::SetLength( pixel, m_VectorLength );
+  for ( VectorLengthType k = 0; k < m_VectorLength; k++ )
+    {
+    pixel[k] = components[k];
+    }
+  return pixel;
+}
+
+} // end namespace itk
+
+#endif
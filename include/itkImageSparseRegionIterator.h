@@ -0,0 +1,72 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Sparse Region Iterator
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef __itkImageSparseRegionIterator_h
+#define __itkImageSparseRegionIterator_h
+
+#include "itkImageSparseRegionConstIterator.h"
+
+namespace itk
+{
+
+/** \class ImageSparseRegionIterator
+ * \brief Iterate over the stored voxels of a region of a SparseVectorImage
+ * and modify them.
+ *
+ * This iterator visits the same voxels as ImageSparseRegionConstIterator
+ * and can also write their value, e.g. to rescale the non-zero values of
+ * an image without visiting its empty voxels.
+ *
+ * \sa ImageSparseRegionConstIterator
+ *
+ * \ingroup ImageIterators
+ * \ingroup ITKSparseVectorImage
+ *
+ */
+template< class TImage >
+class ITK_EXPORT ImageSparseRegionIterator : public ImageSparseRegionConstIterator< TImage >
+{
+public:
+  /** Standard class typedefs. */
+  typedef ImageSparseRegionIterator                 Self;
+  typedef ImageSparseRegionConstIterator< TImage >  Superclass;
+
+  typedef typename Superclass::ImageType          ImageType;
+  typedef typename Superclass::PixelType          PixelType;
+  typedef typename Superclass::InternalPixelType  InternalPixelType;
+  typedef typename Superclass::RegionType         RegionType;
+
+  /** Default constructor. The iterator needs an image and a region to
+   *  be usable. */
+  ImageSparseRegionIterator() {}
+
+  /** Constructor establishes an iterator to walk the stored voxels of
+   *  a particular region of an image. */
+  ImageSparseRegionIterator(ImageType *image, const RegionType & region)
+    : Superclass( image, region ) {}
+
+  /** Set the value of the current voxel. */
+  void Set(const PixelType & value) const
+    { this->SetComponents( value.GetDataPointer() ); }
+
+  /** Set the GetVectorLength() components of the current voxel. */
+  void SetComponents(const InternalPixelType *components) const;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkImageSparseRegionIterator.hxx"
+#endif
+
+#endif
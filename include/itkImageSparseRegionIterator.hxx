@@ -0,0 +1,37 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Sparse Region Iterator
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef _itkImageSparseRegionIterator_hxx
+#define _itkImageSparseRegionIterator_hxx
+
+#include "itkImageSparseRegionIterator.h"
+
+namespace itk
+{
+
+template< class TImage >
+void
+ImageSparseRegionIterator< TImage >
+::SetComponents(const InternalPixelType *components) const
+{
+  // The image is only accessed through a const pointer by the superclass
+  ImageType *image = const_cast< ImageType * >( this->m_Image.GetPointer() );
+  ImageType::AccessorType::SetComponents( image->GetPixelContainer(),
+                                          this->m_Offsets[this->m_Position], components,
+                                          image->GetVectorLength(), image->GetZeroThreshold() );
+  this->m_Loaded = false;
+}
+
+} // end namespace itk
+
+#endif
@@ -25,6 +25,9 @@
 #include "itkSparseVectorImageLinearInterpolateImageFunction.h"
 #include "itkSize.h"
 #include "itkDefaultConvertPixelTraits.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
 
 namespace itk
 {
@@ -56,10 +59,52 @@ namespace itk
  * in ProcessObject in order to properly manage the pipeline execution model.
  * In particular, this filter overrides
  * ProcessObject::GenerateInputRequestedRegion() and
- * ProcessObject::GenerateOutputInformation().
+ * ProcessObject::GenerateOutputInformation(). For linear transforms,
+ * the input requested region is the bounding box of the input pixels
+ * read for the output requested region, so that the filter can be
+ * streamed, e.g. by a StreamingImageFilter computing the output slab by
+ * slab. Other transforms request the whole input.
  *
  * This filter is implemented as a multithreaded filter.  It provides a
- * ThreadedGenerateData() method for its implementation.
+ * ThreadedGenerateData() method for its implementation. Since the
+ * containers of sparse images cannot be written by several threads at
+ * once, each thread appends the offsets and components of the non-zero
+ * pixels of its region to a buffer of its own, and
+ * AfterThreadedGenerateData() inserts the buffers into the output
+ * container, presized for the number of pixels found. The work done
+ * after the threads is thus proportional to the number of non-zero
+ * output pixels rather than to the size of the output.
+ *
+ * When the transform is linear (Transform::IsLinear()), e.g. an identity,
+ * rigid or affine transform, a scanline of the output maps to a line of
+ * the input: the continuous input index is computed at the start of each
+ * scanline and advanced by a constant step along it, instead of mapping
+ * every output pixel through the transform. UseLinearFastPathOff()
+ * forces the per-pixel path, e.g. for comparisons.
+ *
+ * Most output pixels of a sparse image usually map to empty input and
+ * are zero. When the default pixel value and the fill value of the input
+ * are zero, the transform is linear and the interpolator is the linear or
+ * nearest neighbor interpolator of sparse images, the filter marks the
+ * bricks of SupportBrickSize voxels of the input holding stored pixels,
+ * and skips the output scanlines, and the parts of scanlines, whose
+ * bricks cannot map to them. An output brick is tested by mapping its
+ * corners through the transform, which bounds its image exactly.
+ * UseInputSupportOff() evaluates every output pixel. Other transforms
+ * evaluate every output pixel unless UseNonlinearInputSupportOn() is
+ * set, see there.
+ *
+ * When the transform maps every output pixel exactly onto an input
+ * pixel through an axis permutation and flips, e.g. an identity or an
+ * integer translation, or the re-gridding of an image to a canonical
+ * orientation with the same spacing, the interpolators return the stored
+ * components as is. The filter then moves the stored components to
+ * their output keys instead of interpolating, in time proportional to
+ * the number of stored components, with the same output. The mapping is
+ * checked exactly as the scanline path computes it, so this only
+ * applies with the linear and nearest neighbor interpolators of sparse
+ * images, zero default and fill values, and UseLinearFastPathOn().
+ * UseKeyRemappingOff() interpolates instead.
  * \warning For multithreading, the TransformPoint method of the
  * user-designated coordinate transform must be threadsafe.
  *
@@ -146,6 +191,9 @@ public:
   typedef typename TOutputImage::PixelType PixelType;
   typedef typename TInputImage::PixelType  InputPixelType;
 
+  /** Type of the components stored in the output container. */
+  typedef typename TOutputImage::InternalPixelType OutputInternalPixelType;
+
   typedef DefaultConvertPixelTraits<PixelType> PixelConvertType;
 
   typedef typename PixelConvertType::ComponentType PixelComponentType;
@@ -217,6 +265,41 @@ public:
   itkSetMacro(OutputDirection, DirectionType);
   itkGetConstReferenceMacro(OutputDirection, DirectionType);
 
+  /** Set/Get whether linear transforms are resampled scanline by
+   *  scanline. On by default. */
+  itkSetMacro(UseLinearFastPath, bool);
+  itkGetConstMacro(UseLinearFastPath, bool);
+  itkBooleanMacro(UseLinearFastPath);
+
+  /** Set/Get whether the output pixels which cannot map to stored input
+   *  pixels are skipped, for linear transforms and the linear and
+   *  nearest neighbor interpolators of sparse images. On by default. */
+  itkSetMacro(UseInputSupport, bool);
+  itkGetConstMacro(UseInputSupport, bool);
+  itkBooleanMacro(UseInputSupport);
+
+  /** Set/Get whether output pixels are also skipped for transforms which
+   *  are not linear. Off by default, since the test is not conservative:
+   *  an output brick is mapped at its corners, the middles of its edges
+   *  and faces and its center, and the bounding box of these points is
+   *  dilated by a brick. A transform folding a brick over a larger
+   *  distance, e.g. a B-spline or displacement field transform with
+   *  large local deformations, silently loses non-zero output pixels.
+   *  Only applies when UseInputSupport is on. */
+  itkSetMacro(UseNonlinearInputSupport, bool);
+  itkGetConstMacro(UseNonlinearInputSupport, bool);
+  itkBooleanMacro(UseNonlinearInputSupport);
+
+  /** Set/Get whether the stored components are moved to their output
+   *  keys when the transform maps output pixels exactly onto input
+   *  pixels. On by default. */
+  itkSetMacro(UseKeyRemapping, bool);
+  itkGetConstMacro(UseKeyRemapping, bool);
+  itkBooleanMacro(UseKeyRemapping);
+
+  /** Side of the bricks of the input and output supports. */
+  itkStaticConstMacro(SupportBrickSize, unsigned int, 8);
+
   /** Set the start index of the output largest possible region.
    * The default is an index of all zeros. */
   itkSetMacro(OutputStartIndex, IndexType);
@@ -234,7 +317,10 @@ public:
   /** ResampleSparseVectorImageFilter needs a different input requested region than
    * the output requested region.  As such, ResampleSparseVectorImageFilter needs
    * to provide an implementation for GenerateInputRequestedRegion()
-   * in order to inform the pipeline execution model.
+   * in order to inform the pipeline execution model. For linear
+   * transforms with the sparse linear or nearest neighbor interpolator,
+   * the region is computed from the output requested region; the
+   * largest possible region is requested otherwise.
    * \sa ProcessObject::GenerateInputRequestedRegion() */
   virtual void GenerateInputRequestedRegion();
 
@@ -269,6 +355,10 @@ protected:
    */
   virtual void VerifyInputInformation() {}
 
+  /** Remap the keys of the input when the transform permits it, and
+   *  run the threads of the superclass otherwise. */
+  virtual void GenerateData();
+
   /** ResampleSparseVectorImageFilter can be implemented as a multithreaded filter.
    * Therefore, this implementation provides a ThreadedGenerateData()
    * routine which is called for each processing thread. The output
@@ -287,10 +377,252 @@ protected:
                                      outputRegionForThread,
                                      ThreadIdType threadId);
 
+  /** Faster implementation for resampling that works for linear
+   *  transforms, walking the output region scanline by scanline. */
+  virtual void LinearThreadedGenerateData(const OutputImageRegionType &
+                                          outputRegionForThread,
+                                          ThreadIdType threadId);
+
   virtual PixelType CastPixelWithBoundsChecking( const InterpolatorOutputType value,
                                                  const ComponentType minComponent,
                                                  const ComponentType maxComponent) const;
 
+  /** Compute the bounding box of the input pixels read by the
+   *  interpolator for the pixels of an output region, cropped by the
+   *  input largest possible region, when the transform is linear and
+   *  the interpolator is a sparse linear or nearest neighbor one.
+   *  Return false if the region cannot be computed. */
+  bool ComputeInputRequestedRegion(const OutputImageRegionType & outputRegion,
+                                   InputImageRegionType & inputRegion) const;
+
+  /** Bricks of an output region which may map to stored input pixels,
+   *  see ComputeOutputSupport(). */
+  struct OutputSupport
+    {
+    std::vector< unsigned char > m_Hits;
+    SizeType                     m_Bricks;
+    IndexType                    m_Start;
+    };
+
+  /** Return true if the interpolator is the linear or nearest neighbor
+   *  interpolator of sparse images, which only read the pixels at the
+   *  floor of the continuous index and the next one. */
+  bool HasSparseInterpolator() const;
+
+  /** Mark the input bricks holding stored pixels, in a summed-area table
+   *  over the bricks. */
+  void ComputeInputSupport();
+
+  /** Return true if some pixel of the output region may map to a brick
+   *  of the input support. */
+  bool IsInputSupportHit(const OutputImageRegionType & region) const;
+
+  /** Test the output bricks of a region, aligned on its start index. */
+  void ComputeOutputSupport(const OutputImageRegionType & region,
+                            OutputSupport & support) const;
+
+  /** Get the flags of the bricks crossed by the output scanline starting
+   *  at index, or NULL if none of them is hit. */
+  const unsigned char * GetOutputSupportRow(const OutputSupport & support,
+                                            const IndexType & index) const;
+
+  /** Return true if all the components of a pixel are zero. */
+  template< class TPixel >
+  static bool IsZeroPixel(const TPixel & pixel)
+    {
+    typedef DefaultConvertPixelTraits< TPixel > ConvertType;
+    for ( unsigned int n = 0; n < ConvertType::GetNumberOfComponents( pixel ); n++ )
+      {
+      if ( ConvertType::GetNthComponent( n, pixel ) != 0 )
+        {
+        return false;
+        }
+      }
+    return true;
+    }
+
+  /** Visitor marking the input bricks of the stored elements. */
+  struct SupportMarker
+    {
+    template< class TKey, class TValue >
+    void operator()( TKey key, const TValue & )
+      {
+      SizeValueType offset = static_cast< SizeValueType >( key ) / m_VectorLength;
+      SizeValueType cell = 0;
+      for ( unsigned int d = 0; d < ImageDimension; d++ )
+        {
+        cell += ( offset % m_Size[d] / SupportBrickSize + 1 ) * m_Strides[d];
+        offset /= m_Size[d];
+        }
+      m_Table[cell] = 1;
+      }
+
+    SizeValueType * m_Table;
+    SizeValueType   m_VectorLength;
+    SizeValueType   m_Size[ImageDimension];
+    SizeValueType   m_Strides[ImageDimension];
+    };
+
+  /** Mapping of the integer indices of an output region onto the input:
+   *  the input index along the axis m_Axes[d] is m_InputStart[m_Axes[d]]
+   *  plus m_Signs[d] times the distance along the axis d to the start of
+   *  the output region. */
+  struct KeyRemapping
+    {
+    unsigned int                       m_Axes[ImageDimension];
+    IndexValueType                     m_Signs[ImageDimension];
+    typename TInputImage::IndexType    m_InputStart;
+    };
+
+  /** Detect a transform mapping the output region exactly onto input
+   *  pixels, as computed by LinearThreadedGenerateData(), and return
+   *  false if the keys cannot be remapped. */
+  bool ComputeKeyRemapping(const OutputImageRegionType & region,
+                           KeyRemapping & remapping) const;
+
+  /** Map an output index to the continuous input index, as the scanline
+   *  path does at the start of a scanline. */
+  void TransformOutputIndex(const IndexType & index,
+                            ContinuousInputIndexType & inputIndex) const;
+
+  /** Return true if the scanline path maps the output index exactly to
+   *  the input index of the remapping, and the next pixel of the
+   *  scanline to the next pixel along the input axis of the scanline. */
+  bool IsExactlyRemapped(const OutputImageRegionType & region,
+                         const KeyRemapping & remapping,
+                         const IndexType & index) const;
+
+  /** Move the stored components of the input to their output keys. */
+  void RemapKeys(const KeyRemapping & remapping);
+
+  typedef typename TInputImage::PixelContainer::ElementIdentifier   InputKeyType;
+  typedef typename TInputImage::InternalPixelType                   InputInternalPixelType;
+  typedef typename TOutputImage::PixelContainer::ElementIdentifier  OutputKeyType;
+
+  /** Visitor collecting the stored elements of the input. */
+  struct ElementCollector
+    {
+    template< class TKey, class TValue >
+    void operator()( TKey key, const TValue & value )
+      {
+      m_Keys.push_back( static_cast< InputKeyType >( key ) );
+      m_Values.push_back( static_cast< InputInternalPixelType >( value ) );
+      }
+
+    std::vector< InputKeyType >            m_Keys;
+    std::vector< InputInternalPixelType >  m_Values;
+    };
+
+  /** Functor computing the output keys and values of a range of the
+   *  collected elements, for SparseVectorImageParallelFor. The elements
+   *  mapped outside of the output region, and the components written as
+   *  zero by the interpolated path, are not kept. */
+  struct KeyRemapper
+    {
+    void operator()( SizeValueType begin, SizeValueType end )
+      {
+      for ( SizeValueType n = begin; n < end; n++ )
+        {
+        m_Keep[n] = 0;
+        const unsigned int component = static_cast< unsigned int >( m_InputKeys[n] % m_InputLength );
+        if ( component >= m_OutputLength )
+          {
+          continue;
+          }
+
+        // The inverse of SparseVectorImage::ComputeOffset()
+        OffsetValueType offset = static_cast< OffsetValueType >( m_InputKeys[n] / m_InputLength );
+        typename TInputImage::IndexType inputIndex;
+        for ( unsigned int d = ImageDimension - 1; d > 0; d-- )
+          {
+          inputIndex[d] = offset / m_InputOffsetTable[d];
+          offset -= inputIndex[d] * m_InputOffsetTable[d];
+          }
+        inputIndex[0] = offset;
+
+        IndexType outputIndex;
+        bool inside = true;
+        for ( unsigned int d = 0; d < ImageDimension; d++ )
+          {
+          const unsigned int axis = m_Remapping->m_Axes[d];
+          outputIndex[d] = m_Region.GetIndex()[d]
+            + m_Remapping->m_Signs[d] * ( inputIndex[axis] - m_Remapping->m_InputStart[axis] );
+          inside = inside && outputIndex[d] >= m_Region.GetIndex()[d]
+            && outputIndex[d] < m_Region.GetIndex()[d] + static_cast< IndexValueType >( m_Region.GetSize()[d] );
+          }
+        if ( !inside )
+          {
+          continue;
+          }
+
+        // The conversions of the interpolated path, at a weight of one
+        ComponentType value = static_cast< ComponentType >( m_InputValues[n] );
+        value = std::min( std::max( value, m_MinValue ), m_MaxValue );
+        const OutputInternalPixelType outputValue =
+          static_cast< OutputInternalPixelType >( static_cast< PixelComponentType >( value ) );
+        if ( m_ZeroThreshold > 0 ?
+             std::fabs( static_cast< double >( outputValue ) ) <= m_ZeroThreshold : outputValue == 0 )
+          {
+          continue;
+          }
+
+        m_OutputKeys[n] = static_cast< OutputKeyType >( m_Output->ComputeOffset( outputIndex ) )
+          * m_OutputLength + component;
+        m_OutputValues[n] = outputValue;
+        m_Keep[n] = 1;
+        }
+      }
+
+    const KeyRemapping *            m_Remapping;
+    const TOutputImage *            m_Output;
+    OutputImageRegionType           m_Region;
+    const OffsetValueType *         m_InputOffsetTable;
+    SizeValueType                   m_InputLength;
+    SizeValueType                   m_OutputLength;
+    ComponentType                   m_MinValue;
+    ComponentType                   m_MaxValue;
+    double                          m_ZeroThreshold;
+    const InputKeyType *            m_InputKeys;
+    const InputInternalPixelType *  m_InputValues;
+    OutputKeyType *                 m_OutputKeys;
+    OutputInternalPixelType *       m_OutputValues;
+    unsigned char *                 m_Keep;
+    };
+
+  /** Output pixels computed by a thread: the offsets of the non-zero
+   *  pixels and their components, VectorLength per offset. */
+  struct ThreadBuffer
+    {
+    std::vector< OffsetValueType >          m_Offsets;
+    std::vector< OutputInternalPixelType >  m_Values;
+    };
+
+  /** Append a pixel to the buffer of a thread, unless all its components
+   *  are zero: the output container does not store these pixels. */
+  void AppendPixel(ThreadBuffer & buffer, OffsetValueType offset,
+                   const PixelType & pixel, unsigned int length) const
+    {
+    const unsigned int nComponents =
+      std::min( length, PixelConvertType::GetNumberOfComponents( pixel ) );
+    unsigned int n = 0;
+    while ( n < nComponents && PixelConvertType::GetNthComponent( n, pixel ) == 0 )
+      {
+      ++n;
+      }
+    if ( n == nComponents )
+      {
+      return;
+      }
+
+    buffer.m_Offsets.push_back( offset );
+    for ( n = 0; n < length; n++ )
+      {
+      buffer.m_Values.push_back( n < nComponents ?
+        static_cast< OutputInternalPixelType >( PixelConvertType::GetNthComponent( n, pixel ) ) :
+        NumericTraits< OutputInternalPixelType >::Zero );
+      }
+    }
+
 private:
   ResampleSparseVectorImageFilter(const Self &); //purposely not implemented
   void operator=(const Self &);      //purposely not implemented
@@ -306,10 +638,22 @@ private:
   OriginPointType m_OutputOrigin;              // output image origin
   DirectionType   m_OutputDirection;           // output image direction cosines
   IndexType       m_OutputStartIndex;          // output image start index
-
-  std::vector<OutputImagePointer> m_IntermediateImages;
-                                               // Store intermediate result
-  std::vector<OutputImageRegionType> m_SplitRegions;
+  bool            m_UseLinearFastPath;         // scanline path for
+                                               // linear transforms
+  bool            m_UseInputSupport;           // skip empty input
+  bool            m_UseNonlinearInputSupport;  // also for nonlinear
+                                               // transforms
+  bool            m_UseKeyRemapping;           // move the stored
+                                               // components when possible
+
+  bool                        m_HasInputSupport;  // support used by this run
+  std::vector<SizeValueType>  m_InputSupport;     // summed-area table of
+                                                  // the input bricks
+  SizeValueType   m_InputSupportSize[ImageDimension];
+                                               // table size, bricks + 1
+
+  std::vector<ThreadBuffer> m_ThreadBuffers;   // Pixels computed by
+                                               // each thread
 
 };
 } // end namespace itk
@@ -22,10 +22,14 @@
 #include "itkObjectFactory.h"
 #include "itkIdentityTransform.h"
 #include "itkProgressReporter.h"
-#include "itkImageRegionIteratorWithIndex.h"
-#include "itkImageLinearIteratorWithIndex.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkImageLinearConstIteratorWithIndex.h"
 #include "itkSpecialCoordinatesImage.h"
 #include "itkDefaultConvertPixelTraits.h"
+#include "itkSparseVectorImageNearestNeighborInterpolateImageFunction.h"
+#include "itkSparseVectorImageParallelFor.h"
+#include <algorithm>
+#include <cmath>
 
 namespace itk
 {
@@ -44,6 +48,11 @@ ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisi
 
   m_Size.Fill(0);
   m_OutputStartIndex.Fill(0);
+  m_UseLinearFastPath = true;
+  m_UseInputSupport = true;
+  m_UseNonlinearInputSupport = false;
+  m_UseKeyRemapping = true;
+  m_HasInputSupport = false;
 
   m_Transform =
     IdentityTransform< TInterpolatorPrecisionType, ImageDimension >::New();
@@ -78,6 +87,10 @@ ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisi
   os << indent << "OutputSpacing: " << m_OutputSpacing << std::endl;
   os << indent << "OutputOrigin: " << m_OutputOrigin << std::endl;
   os << indent << "OutputDirection: " << m_OutputDirection << std::endl;
+  os << indent << "UseLinearFastPath: " << m_UseLinearFastPath << std::endl;
+  os << indent << "UseInputSupport: " << m_UseInputSupport << std::endl;
+  os << indent << "UseNonlinearInputSupport: " << m_UseNonlinearInputSupport << std::endl;
+  os << indent << "UseKeyRemapping: " << m_UseKeyRemapping << std::endl;
   os << indent << "Transform: " << m_Transform.GetPointer() << std::endl;
   os << indent << "Interpolator: " << m_Interpolator.GetPointer() << std::endl;
   return;
@@ -155,16 +168,22 @@ ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisi
       }
     }
 
-  unsigned int nbOfThreads = this->GetNumberOfThreads();
-  if ( !m_IntermediateImages.empty() )
-    m_IntermediateImages.clear();
-  m_IntermediateImages.resize( nbOfThreads );
-  for ( unsigned int i = 0; i < nbOfThreads; ++i )
-    m_IntermediateImages[i] = NULL;
+  m_ThreadBuffers.clear();
+  m_ThreadBuffers.resize( this->GetNumberOfThreads() );
 
-  if ( !m_SplitRegions.empty() )
-    m_SplitRegions.clear();
-  m_SplitRegions.resize( nbOfThreads );
+  // The output pixels mapping to empty input are zero, and not stored,
+  // only if both the default value and the fill value of the input are.
+  // The bricks tested are only conservative for linear transforms and
+  // for the footprint of the sparse interpolators.
+  m_HasInputSupport = m_UseInputSupport
+    && ( m_Transform->IsLinear() || m_UseNonlinearInputSupport )
+    && this->HasSparseInterpolator()
+    && IsZeroPixel( m_DefaultPixelValue )
+    && IsZeroPixel( this->GetInput()->GetFillBufferValue() );
+  if ( m_HasInputSupport )
+    {
+    this->ComputeInputSupport();
+    }
 }
 
 /**
@@ -182,24 +201,281 @@ ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisi
 
   // Get output pointer
   OutputImagePointer outputPtr = this->GetOutput();
+  typename TOutputImage::PixelContainer *container = outputPtr->GetPixelContainer();
+  const unsigned int length = outputPtr->GetNumberOfComponentsPerPixel();
+  const double zeroThreshold = outputPtr->GetZeroThreshold();
+
+  // Presize the container for the pixels of all the threads
+  SizeValueType numberOfPixels = 0;
+  for ( unsigned int threadId = 0; threadId < m_ThreadBuffers.size(); ++threadId )
+    {
+    numberOfPixels += m_ThreadBuffers[threadId].m_Offsets.size();
+    }
+  container->Reserve( numberOfPixels * length );
+
+  // Insert the pixels of each thread and release its buffer
+  for ( unsigned int threadId = 0; threadId < m_ThreadBuffers.size(); ++threadId )
+    {
+    ThreadBuffer & buffer = m_ThreadBuffers[threadId];
+    for ( SizeValueType n = 0; n < buffer.m_Offsets.size(); n++ )
+      {
+      TOutputImage::AccessorType::SetComponents( container, buffer.m_Offsets[n],
+                                                 &buffer.m_Values[n * length],
+                                                 length, zeroThreshold );
+      }
+    std::vector< OffsetValueType >().swap( buffer.m_Offsets );
+    std::vector< OutputInternalPixelType >().swap( buffer.m_Values );
+    }
+  m_ThreadBuffers.clear();
+  std::vector< SizeValueType >().swap( m_InputSupport );
+}
+
+/**
+ * GenerateData
+ */
+template< class TInputImage,
+          class TOutputImage,
+          class TInterpolatorPrecisionType >
+void
+ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::GenerateData()
+{
+  // Checked here as well, since the remapping uses the transform before
+  // BeforeThreadedGenerateData() is called
+  if ( !m_Transform )
+    {
+    itkExceptionMacro(<< "Transform not set");
+    }
+
+  if ( !m_Interpolator )
+    {
+    itkExceptionMacro(<< "Interpolator not set");
+    }
+
+  KeyRemapping remapping;
+  if ( !this->ComputeKeyRemapping( this->GetOutput()->GetRequestedRegion(), remapping ) )
+    {
+    Superclass::GenerateData();
+    return;
+    }
+
+  this->AllocateOutputs();
+  this->RemapKeys( remapping );
+}
+
+/**
+ * Map an output index to the input
+ */
+template< class TInputImage,
+          class TOutputImage,
+          class TInterpolatorPrecisionType >
+void
+ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::TransformOutputIndex(const IndexType & index,
+                       ContinuousInputIndexType & inputIndex) const
+{
+  PointType outputPoint;
+  this->GetOutput()->TransformIndexToPhysicalPoint( index, outputPoint );
+  const PointType inputPoint = m_Transform->TransformPoint( outputPoint );
+  this->GetInput()->TransformPhysicalPointToContinuousIndex( inputPoint, inputIndex );
+}
 
-  // Stack the intermediate images to form the output image
-  for ( unsigned int threadId = 0; threadId < m_IntermediateImages.size(); ++threadId )
+/**
+ * Detect transforms mapping output pixels exactly onto input pixels
+ */
+template< class TInputImage,
+          class TOutputImage,
+          class TInterpolatorPrecisionType >
+bool
+ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::ComputeKeyRemapping(const OutputImageRegionType & region,
+                      KeyRemapping & remapping) const
+{
+  // The interpolators of sparse images return the stored components as
+  // is at integer indices, and the pixels which are not stored must be
+  // zero, as the pixels mapped outside of the input
+  if ( !m_UseKeyRemapping || !m_UseLinearFastPath || !m_Transform->IsLinear()
+       || region.GetNumberOfPixels() == 0
+       || !this->HasSparseInterpolator()
+       || !IsZeroPixel( m_DefaultPixelValue )
+       || !IsZeroPixel( this->GetInput()->GetFillBufferValue() ) )
+    {
+    return false;
+    }
+
+  // The start of the region must map to an input pixel
+  IndexType index = region.GetIndex();
+  ContinuousInputIndexType start;
+  this->TransformOutputIndex( index, start );
+  for ( unsigned int j = 0; j < ImageDimension; j++ )
     {
-    if ( m_IntermediateImages[threadId] )
+    if ( !( std::fabs( start[j] ) < 1e15 ) || start[j] != std::floor( start[j] ) )
       {
-      typedef ImageRegionIteratorWithIndex< TOutputImage > OutputIterator;
+      return false;
+      }
+    remapping.m_InputStart[j] = static_cast< IndexValueType >( start[j] );
+    }
 
-      OutputIterator tmpIt(m_IntermediateImages[threadId], m_SplitRegions[threadId]);
-      OutputIterator outIt(outputPtr, m_SplitRegions[threadId]);
+  // A step along each output axis must be a step along a distinct input
+  // axis
+  bool used[ImageDimension];
+  std::fill( used, used + ImageDimension, false );
+  ContinuousInputIndexType next;
+  for ( unsigned int d = 0; d < ImageDimension; d++ )
+    {
+    index = region.GetIndex();
+    ++index[d];
+    this->TransformOutputIndex( index, next );
 
-      while( !outIt.IsAtEnd() )
+    unsigned int steps = 0;
+    for ( unsigned int j = 0; j < ImageDimension; j++ )
+      {
+      const double step = next[j] - start[j];
+      if ( step == 1 || step == -1 )
+        {
+        remapping.m_Axes[d] = j;
+        remapping.m_Signs[d] = step > 0 ? 1 : -1;
+        ++steps;
+        }
+      else if ( step != 0 )
         {
-        outIt.Set( tmpIt.Get() );
-        ++tmpIt;
-        ++outIt;
+        return false;
         }
       }
+    if ( steps != 1 || used[remapping.m_Axes[d]] )
+      {
+      return false;
+      }
+    used[remapping.m_Axes[d]] = true;
+    }
+
+  // Every scanline must start exactly on its input pixel, with an exact
+  // step, since the scanline path maps the start of each scanline
+  index = region.GetIndex();
+  while ( true )
+    {
+    if ( !this->IsExactlyRemapped( region, remapping, index ) )
+      {
+      return false;
+      }
+
+    unsigned int d = 1;
+    for ( ; d < ImageDimension; d++ )
+      {
+      if ( ++index[d] < region.GetIndex()[d] + static_cast< IndexValueType >( region.GetSize()[d] ) )
+        {
+        break;
+        }
+      index[d] = region.GetIndex()[d];
+      }
+    if ( d == ImageDimension )
+      {
+      break;
+      }
+    }
+
+  return true;
+}
+
+/**
+ * Check the mapping of a scanline
+ */
+template< class TInputImage,
+          class TOutputImage,
+          class TInterpolatorPrecisionType >
+bool
+ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::IsExactlyRemapped(const OutputImageRegionType & region,
+                    const KeyRemapping & remapping,
+                    const IndexType & index) const
+{
+  typename TInputImage::IndexType expected = remapping.m_InputStart;
+  for ( unsigned int d = 0; d < ImageDimension; d++ )
+    {
+    expected[remapping.m_Axes[d]] += remapping.m_Signs[d] * ( index[d] - region.GetIndex()[d] );
+    }
+
+  ContinuousInputIndexType inputIndex;
+  this->TransformOutputIndex( index, inputIndex );
+  for ( unsigned int j = 0; j < ImageDimension; j++ )
+    {
+    if ( inputIndex[j] != static_cast< double >( expected[j] ) )
+      {
+      return false;
+      }
+    }
+
+  IndexType next = index;
+  ++next[0];
+  expected[remapping.m_Axes[0]] += remapping.m_Signs[0];
+  this->TransformOutputIndex( next, inputIndex );
+  for ( unsigned int j = 0; j < ImageDimension; j++ )
+    {
+    if ( inputIndex[j] != static_cast< double >( expected[j] ) )
+      {
+      return false;
+      }
+    }
+
+  return true;
+}
+
+/**
+ * Move the stored components to their output keys
+ */
+template< class TInputImage,
+          class TOutputImage,
+          class TInterpolatorPrecisionType >
+void
+ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::RemapKeys(const KeyRemapping & remapping)
+{
+  const TInputImage *inputPtr = this->GetInput();
+  OutputImagePointer outputPtr = this->GetOutput();
+
+  // Collect the stored elements of the input
+  ElementCollector collector;
+  collector.m_Keys.reserve( inputPtr->GetPixelContainer()->Size() );
+  collector.m_Values.reserve( inputPtr->GetPixelContainer()->Size() );
+  inputPtr->GetPixelContainer()->VisitElements( collector );
+
+  const SizeValueType numberOfElements = collector.m_Keys.size();
+  if ( numberOfElements == 0 )
+    {
+    return;
+    }
+
+  // Compute their output keys and values in parallel
+  std::vector< OutputKeyType >            outputKeys( numberOfElements );
+  std::vector< OutputInternalPixelType >  outputValues( numberOfElements );
+  std::vector< unsigned char >            keep( numberOfElements );
+
+  KeyRemapper remapper;
+  remapper.m_Remapping = &remapping;
+  remapper.m_Output = outputPtr;
+  remapper.m_Region = outputPtr->GetRequestedRegion();
+  remapper.m_InputOffsetTable = inputPtr->GetOffsetTable();
+  remapper.m_InputLength = std::max( inputPtr->GetNumberOfComponentsPerPixel(), 1u );
+  remapper.m_OutputLength = outputPtr->GetNumberOfComponentsPerPixel();
+  remapper.m_MinValue = static_cast< ComponentType >( NumericTraits< PixelComponentType >::NonpositiveMin() );
+  remapper.m_MaxValue = static_cast< ComponentType >( NumericTraits< PixelComponentType >::max() );
+  remapper.m_ZeroThreshold = outputPtr->GetZeroThreshold();
+  remapper.m_InputKeys = &collector.m_Keys[0];
+  remapper.m_InputValues = &collector.m_Values[0];
+  remapper.m_OutputKeys = &outputKeys[0];
+  remapper.m_OutputValues = &outputValues[0];
+  remapper.m_Keep = &keep[0];
+  SparseVectorImageParallelFor< KeyRemapper >::Run( numberOfElements, remapper );
+
+  // Insert them into the presized output container
+  typename TOutputImage::PixelContainer *container = outputPtr->GetPixelContainer();
+  container->Reserve( static_cast< SizeValueType >( std::count( keep.begin(), keep.end(), 1 ) ) );
+  for ( SizeValueType n = 0; n < numberOfElements; n++ )
+    {
+    if ( keep[n] )
+      {
+      container->SetElement( outputKeys[n], outputValues[n] );
+      }
     }
 }
 
@@ -214,16 +490,13 @@ ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisi
 ::ThreadedGenerateData(const OutputImageRegionType & outputRegionForThread,
                        ThreadIdType threadId)
 {
-  m_SplitRegions[threadId] = outputRegionForThread;
-
-  // Clone the output image
-  OutputImagePointer outputPtr = this->GetOutput();
-
-  m_IntermediateImages[threadId] = OutputImageType::New();
-  m_IntermediateImages[threadId]->CopyInformation( outputPtr );
-  m_IntermediateImages[threadId]->SetRequestedRegion( outputPtr->GetRequestedRegion() );
-  m_IntermediateImages[threadId]->SetBufferedRegion( outputPtr->GetBufferedRegion() );
-  m_IntermediateImages[threadId]->Allocate();
+  // Check whether we can use the scanline path, which requires the
+  // transform to be linear
+  if ( m_UseLinearFastPath && m_Transform->IsLinear() )
+    {
+    this->LinearThreadedGenerateData(outputRegionForThread, threadId);
+    return;
+    }
 
   this->NonlinearThreadedGenerateData(outputRegionForThread, threadId);
 }
@@ -279,15 +552,130 @@ ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisi
                                 outputRegionForThread,
                                 ThreadIdType threadId)
 {
-  // Get the intermediate image pointers
-  OutputImagePointer outputPtr = m_IntermediateImages[threadId];
+  // Get the output pointers, only used to compute indices and offsets
+  OutputImagePointer outputPtr = this->GetOutput();
+  ThreadBuffer & buffer = m_ThreadBuffers[threadId];
+  const unsigned int length = outputPtr->GetNumberOfComponentsPerPixel();
+
+  // Get this input pointers
+  InputImageConstPointer inputPtr = this->GetInput();
+
+  // Create an iterator that will walk the output region for this thread
+  // scanline by scanline.
+  typedef ImageLinearConstIteratorWithIndex< TOutputImage > OutputIterator;
+  OutputIterator outIt(outputPtr, outputRegionForThread);
+  outIt.SetDirection(0);
+
+  // Define a few indices that will be used to translate from an input pixel
+  // to an output pixel
+  PointType outputPoint;         // Coordinates of current output pixel
+  PointType inputPoint;          // Coordinates of current input pixel
+
+  ContinuousInputIndexType inputIndex;
+
+  // Bricks of the output which may map to stored input pixels
+  OutputSupport outputSupport;
+  if ( m_HasInputSupport )
+    {
+    this->ComputeOutputSupport( outputRegionForThread, outputSupport );
+    }
+
+  // Support for progress methods/callbacks
+  ProgressReporter progress( this,
+                             threadId,
+                             outputRegionForThread.GetNumberOfPixels() );
+
+  // Min/max values of the output pixel type AND these values
+  // represented as the output type of the interpolator
+  const PixelComponentType minValue =  NumericTraits< PixelComponentType >::NonpositiveMin();
+  const PixelComponentType maxValue =  NumericTraits< PixelComponentType >::max();
+
+  typedef typename InterpolatorType::OutputType OutputType;
+  const ComponentType minOutputValue = static_cast< ComponentType >( minValue );
+  const ComponentType maxOutputValue = static_cast< ComponentType >( maxValue );
+
+  // Walk the output region
+  outIt.GoToBegin();
+
+  while ( !outIt.IsAtEnd() )
+    {
+    // Skip the scanlines crossing empty bricks only
+    const unsigned char *support = NULL;
+    if ( m_HasInputSupport )
+      {
+      support = this->GetOutputSupportRow( outputSupport, outIt.GetIndex() );
+      if ( !support )
+        {
+        outIt.NextLine();
+        continue;
+        }
+      }
+
+    for ( SizeValueType k = 0; !outIt.IsAtEndOfLine(); ++k, ++outIt )
+      {
+      if ( support && !support[k / SupportBrickSize] )
+        {
+        progress.CompletedPixel();
+        continue;
+        }
+
+      // Determine the index of the current output pixel
+      outputPtr->TransformIndexToPhysicalPoint(outIt.GetIndex(), outputPoint);
+
+      // Compute corresponding input pixel position
+      inputPoint = this->m_Transform->TransformPoint(outputPoint);
+      inputPtr->TransformPhysicalPointToContinuousIndex(inputPoint, inputIndex);
+
+      PixelType        pixval;
+      OutputType       value;
+      // Evaluate input at right position and copy to the output
+      if ( m_Interpolator->IsInsideBuffer(inputIndex) )
+        {
+        value = m_Interpolator ->EvaluateAtContinuousIndex(inputIndex);
+        pixval = this->CastPixelWithBoundsChecking( value, minOutputValue, maxOutputValue );
+        this->AppendPixel( buffer, outputPtr->ComputeOffset( outIt.GetIndex() ), pixval, length );
+        }
+      else
+        {
+        // default background value
+        this->AppendPixel( buffer, outputPtr->ComputeOffset( outIt.GetIndex() ),
+                           m_DefaultPixelValue, length );
+        }
+
+      progress.CompletedPixel();
+      }
+
+    outIt.NextLine();
+    }
+
+  return;
+}
+
+/**
+ * LinearThreadedGenerateData
+ */
+template< class TInputImage,
+          class TOutputImage,
+          class TInterpolatorPrecisionType >
+void
+ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::LinearThreadedGenerateData(const OutputImageRegionType &
+                             outputRegionForThread,
+                             ThreadIdType threadId)
+{
+  // Get the output pointers, only used to compute indices and offsets
+  OutputImagePointer outputPtr = this->GetOutput();
+  ThreadBuffer & buffer = m_ThreadBuffers[threadId];
+  const unsigned int length = outputPtr->GetNumberOfComponentsPerPixel();
 
   // Get this input pointers
   InputImageConstPointer inputPtr = this->GetInput();
 
-  // Create an iterator that will walk the output region for this thread.
-  typedef ImageRegionIteratorWithIndex< TOutputImage > OutputIterator;
+  // Create an iterator that will walk the output region for this thread
+  // scanline by scanline.
+  typedef ImageLinearConstIteratorWithIndex< TOutputImage > OutputIterator;
   OutputIterator outIt(outputPtr, outputRegionForThread);
+  outIt.SetDirection(0);
 
   // Define a few indices that will be used to translate from an input pixel
   // to an output pixel
@@ -295,6 +683,31 @@ ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisi
   PointType inputPoint;          // Coordinates of current input pixel
 
   ContinuousInputIndexType inputIndex;
+  ContinuousInputIndexType startIndex;
+  ContinuousInputIndexType nextIndex;
+  IndexType                index;
+
+  // As we walk across a scanline of the output, we trace a line of the
+  // input, with a constant step between the continuous indices of
+  // consecutive output pixels since the transform is linear
+  index = outputRegionForThread.GetIndex();
+  outputPtr->TransformIndexToPhysicalPoint(index, outputPoint);
+  inputPoint = this->m_Transform->TransformPoint(outputPoint);
+  inputPtr->TransformPhysicalPointToContinuousIndex(inputPoint, startIndex);
+
+  ++index[0];
+  outputPtr->TransformIndexToPhysicalPoint(index, outputPoint);
+  inputPoint = this->m_Transform->TransformPoint(outputPoint);
+  inputPtr->TransformPhysicalPointToContinuousIndex(inputPoint, nextIndex);
+
+  const typename ContinuousInputIndexType::VectorType delta = nextIndex - startIndex;
+
+  // Bricks of the output which may map to stored input pixels
+  OutputSupport outputSupport;
+  if ( m_HasInputSupport )
+    {
+    this->ComputeOutputSupport( outputRegionForThread, outputSupport );
+    }
 
   // Support for progress methods/callbacks
   ProgressReporter progress( this,
@@ -315,32 +728,299 @@ ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisi
 
   while ( !outIt.IsAtEnd() )
     {
-    // Determine the index of the current output pixel
-    outputPtr->TransformIndexToPhysicalPoint(outIt.GetIndex(), outputPoint);
+    // Skip the scanlines crossing empty bricks only
+    const unsigned char *support = NULL;
+    if ( m_HasInputSupport )
+      {
+      support = this->GetOutputSupportRow( outputSupport, outIt.GetIndex() );
+      if ( !support )
+        {
+        outIt.NextLine();
+        continue;
+        }
+      }
 
-    // Compute corresponding input pixel position
+    // Map the first pixel of the scanline through the transform
+    index = outIt.GetIndex();
+    outputPtr->TransformIndexToPhysicalPoint(index, outputPoint);
     inputPoint = this->m_Transform->TransformPoint(outputPoint);
-    inputPtr->TransformPhysicalPointToContinuousIndex(inputPoint, inputIndex);
+    inputPtr->TransformPhysicalPointToContinuousIndex(inputPoint, startIndex);
+
+    // The pixels of a scanline have consecutive offsets
+    const OffsetValueType startOffset = outputPtr->ComputeOffset(index);
+
+    for ( OffsetValueType k = 0; !outIt.IsAtEndOfLine(); ++k, ++outIt )
+      {
+      if ( support && !support[k / SupportBrickSize] )
+        {
+        progress.CompletedPixel();
+        continue;
+        }
+
+      // The step is multiplied rather than accumulated, so that rounding
+      // errors do not build up along the scanline
+      for ( unsigned int d = 0; d < ImageDimension; d++ )
+        {
+        inputIndex[d] = startIndex[d] + k * delta[d];
+        }
+
+      PixelType        pixval;
+      OutputType       value;
+      // Evaluate input at right position and copy to the output
+      if ( m_Interpolator->IsInsideBuffer(inputIndex) )
+        {
+        value = m_Interpolator ->EvaluateAtContinuousIndex(inputIndex);
+        pixval = this->CastPixelWithBoundsChecking( value, minOutputValue, maxOutputValue );
+        this->AppendPixel( buffer, startOffset + k, pixval, length );
+        }
+      else
+        {
+        // default background value
+        this->AppendPixel( buffer, startOffset + k, m_DefaultPixelValue, length );
+        }
+
+      progress.CompletedPixel();
+      }
+
+    outIt.NextLine();
+    }
+
+  return;
+}
+
+/**
+ * Check the footprint of the interpolator
+ */
+template< class TInputImage,
+          class TOutputImage,
+          class TInterpolatorPrecisionType >
+bool
+ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::HasSparseInterpolator() const
+{
+  typedef SparseVectorImageNearestNeighborInterpolateImageFunction< InputImageType,
+                                                                    TInterpolatorPrecisionType >
+                                                                    NearestNeighborInterpolatorType;
+
+  return dynamic_cast< const LinearInterpolatorType * >( m_Interpolator.GetPointer() )
+         || dynamic_cast< const NearestNeighborInterpolatorType * >( m_Interpolator.GetPointer() );
+}
+
+/**
+ * Mark the input bricks holding stored pixels
+ */
+template< class TInputImage,
+          class TOutputImage,
+          class TInterpolatorPrecisionType >
+void
+ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::ComputeInputSupport()
+{
+  const TInputImage *inputPtr = this->GetInput();
+  const typename TInputImage::SizeType size = inputPtr->GetBufferedRegion().GetSize();
+
+  // The table has a row of zeros before the first brick of every
+  // dimension, so that sums over boxes need no special case
+  SupportMarker marker;
+  SizeValueType numberOfCells = 1;
+  for ( unsigned int d = 0; d < ImageDimension; d++ )
+    {
+    m_InputSupportSize[d] = ( size[d] + SupportBrickSize - 1 ) / SupportBrickSize + 1;
+    marker.m_Size[d] = size[d];
+    marker.m_Strides[d] = numberOfCells;
+    numberOfCells *= m_InputSupportSize[d];
+    }
+  m_InputSupport.assign( numberOfCells, 0 );
+
+  marker.m_Table = &m_InputSupport[0];
+  marker.m_VectorLength = std::max( inputPtr->GetNumberOfComponentsPerPixel(), 1u );
+  inputPtr->GetPixelContainer()->VisitElements( marker );
+
+  // Sum the marks along each dimension in turn
+  for ( unsigned int d = 0; d < ImageDimension; d++ )
+    {
+    const SizeValueType stride = marker.m_Strides[d];
+    for ( SizeValueType n = 0; n < numberOfCells; n++ )
+      {
+      if ( n / stride % m_InputSupportSize[d] != 0 )
+        {
+        m_InputSupport[n] += m_InputSupport[n - stride];
+        }
+      }
+    }
+}
+
+/**
+ * Test whether an output region may map to stored input pixels
+ */
+template< class TInputImage,
+          class TOutputImage,
+          class TInterpolatorPrecisionType >
+bool
+ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::IsInputSupportHit(const OutputImageRegionType & region) const
+{
+  const TInputImage *inputPtr = this->GetInput();
+  const TOutputImage *outputPtr = this->GetOutput();
+  const typename TInputImage::IndexType inputStart = inputPtr->GetBufferedRegion().GetIndex();
+
+  // A linear transform maps the region into the bounding box of its
+  // corners. Other transforms are sampled at the corners, the middles
+  // of the edges and faces and the center, and dilated by a brick.
+  const bool linear = m_Transform->IsLinear();
+  const unsigned int samples = linear ? 2 : 3;
+  unsigned int numberOfSamples = 1;
+  for ( unsigned int d = 0; d < ImageDimension; d++ )
+    {
+    numberOfSamples *= samples;
+    }
+
+  double lower[ImageDimension];
+  double upper[ImageDimension];
+  for ( unsigned int d = 0; d < ImageDimension; d++ )
+    {
+    lower[d] = NumericTraits< double >::max();
+    upper[d] = NumericTraits< double >::NonpositiveMin();
+    }
+
+  IndexType index;
+  PointType outputPoint;
+  ContinuousInputIndexType inputIndex;
+  for ( unsigned int n = 0; n < numberOfSamples; n++ )
+    {
+    unsigned int sample = n;
+    for ( unsigned int d = 0; d < ImageDimension; d++ )
+      {
+      const IndexValueType last = static_cast< IndexValueType >( region.GetSize()[d] ) - 1;
+      index[d] = region.GetIndex()[d] + last * static_cast< IndexValueType >( sample % samples ) / ( samples - 1 );
+      sample /= samples;
+      }
 
-    PixelType        pixval;
-    OutputType       value;
-    // Evaluate input at right position and copy to the output
-    if ( m_Interpolator->IsInsideBuffer(inputIndex) )
+    outputPtr->TransformIndexToPhysicalPoint( index, outputPoint );
+    inputPtr->TransformPhysicalPointToContinuousIndex( m_Transform->TransformPoint( outputPoint ), inputIndex );
+    for ( unsigned int d = 0; d < ImageDimension; d++ )
       {
-      value = m_Interpolator ->EvaluateAtContinuousIndex(inputIndex);
-      pixval = this->CastPixelWithBoundsChecking( value, minOutputValue, maxOutputValue );
-      outIt.Set(pixval);
+      lower[d] = std::min( lower[d], static_cast< double >( inputIndex[d] ) );
+      upper[d] = std::max( upper[d], static_cast< double >( inputIndex[d] ) );
+      }
+    }
+
+  // Bricks of the input pixels read by the interpolator, with a margin
+  // of one pixel
+  const double margin = linear ? 1.0 : 1.0 + SupportBrickSize;
+  SizeValueType low[ImageDimension];
+  SizeValueType high[ImageDimension];
+  for ( unsigned int d = 0; d < ImageDimension; d++ )
+    {
+    const double first = std::floor( lower[d] - margin ) - inputStart[d];
+    const double last = std::floor( upper[d] + margin ) - inputStart[d];
+    const double bricks = static_cast< double >( m_InputSupportSize[d] - 1 );
+    if ( !( last >= 0 ) || !( first < bricks * SupportBrickSize ) )
+      {
+      // Outside of the input, or not a number
+      return false;
+      }
+    low[d] = first < 0 ? 0 : static_cast< SizeValueType >( first ) / SupportBrickSize;
+    high[d] = static_cast< SizeValueType >( std::min( last, bricks * SupportBrickSize - 1 ) ) / SupportBrickSize;
+    }
+
+  // Sum the marks of the box from the summed-area table
+  SizeValueType positive = 0;
+  SizeValueType negative = 0;
+  for ( unsigned int n = 0; n < ( 1u << ImageDimension ); n++ )
+    {
+    SizeValueType cell = 0;
+    SizeValueType stride = 1;
+    unsigned int lowCorners = 0;
+    for ( unsigned int d = 0; d < ImageDimension; d++ )
+      {
+      if ( n & ( 1u << d ) )
+        {
+        cell += ( high[d] + 1 ) * stride;
+        }
+      else
+        {
+        cell += low[d] * stride;
+        ++lowCorners;
+        }
+      stride *= m_InputSupportSize[d];
+      }
+    if ( lowCorners % 2 == 0 )
+      {
+      positive += m_InputSupport[cell];
       }
     else
       {
-      outIt.Set( m_DefaultPixelValue ); // default background value
+      negative += m_InputSupport[cell];
       }
+    }
 
-    progress.CompletedPixel();
-    ++outIt;
+  return positive > negative;
+}
+
+/**
+ * Test the output bricks of a region
+ */
+template< class TInputImage,
+          class TOutputImage,
+          class TInterpolatorPrecisionType >
+void
+ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::ComputeOutputSupport(const OutputImageRegionType & region,
+                       OutputSupport & support) const
+{
+  SizeValueType numberOfBricks = 1;
+  for ( unsigned int d = 0; d < ImageDimension; d++ )
+    {
+    support.m_Bricks[d] = ( region.GetSize()[d] + SupportBrickSize - 1 ) / SupportBrickSize;
+    numberOfBricks *= support.m_Bricks[d];
     }
+  support.m_Start = region.GetIndex();
+  support.m_Hits.assign( numberOfBricks, 0 );
 
-  return;
+  OutputImageRegionType brick;
+  for ( SizeValueType n = 0; n < numberOfBricks; n++ )
+    {
+    SizeValueType position = n;
+    for ( unsigned int d = 0; d < ImageDimension; d++ )
+      {
+      const SizeValueType b = position % support.m_Bricks[d];
+      position /= support.m_Bricks[d];
+      brick.SetIndex( d, region.GetIndex()[d] + static_cast< IndexValueType >( b * SupportBrickSize ) );
+      brick.SetSize( d, std::min( static_cast< SizeValueType >( SupportBrickSize ),
+                                  region.GetSize()[d] - b * SupportBrickSize ) );
+      }
+    support.m_Hits[n] = this->IsInputSupportHit( brick );
+    }
+}
+
+/**
+ * Get the bricks crossed by an output scanline
+ */
+template< class TInputImage,
+          class TOutputImage,
+          class TInterpolatorPrecisionType >
+const unsigned char *
+ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::GetOutputSupportRow(const OutputSupport & support, const IndexType & index) const
+{
+  SizeValueType row = 0;
+  SizeValueType stride = support.m_Bricks[0];
+  for ( unsigned int d = 1; d < ImageDimension; d++ )
+    {
+    row += ( index[d] - support.m_Start[d] ) / SupportBrickSize * stride;
+    stride *= support.m_Bricks[d];
+    }
+
+  const unsigned char *hits = &support.m_Hits[row];
+  for ( SizeValueType b = 0; b < support.m_Bricks[0]; b++ )
+    {
+    if ( hits[b] )
+      {
+      return hits;
+      }
+    }
+  return NULL;
 }
 
 /**
@@ -348,7 +1028,9 @@ ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisi
  *
  * Determining the actual input region is non-trivial, especially
  * when we cannot assume anything about the transform being used.
- * So we do the easy thing and request the entire input image.
+ * For linear transforms and the sparse interpolators, the bounding box
+ * of the pixels read is requested; otherwise we do the easy thing and
+ * request the entire input image.
  */
 template< class TInputImage,
           class TOutputImage,
@@ -369,12 +1051,108 @@ ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisi
   InputImagePointer inputPtr  =
     const_cast< TInputImage * >( this->GetInput() );
 
-  // Request the entire input image
-  inputPtr->SetRequestedRegionToLargestPossibleRegion();
+  // Request the input pixels read for the output requested region if
+  // they can be bounded, and the entire input image otherwise
+  InputImageRegionType inputRequestedRegion;
+  if ( this->ComputeInputRequestedRegion( this->GetOutput()->GetRequestedRegion(),
+                                          inputRequestedRegion ) )
+    {
+    inputPtr->SetRequestedRegion( inputRequestedRegion );
+    }
+  else
+    {
+    inputPtr->SetRequestedRegionToLargestPossibleRegion();
+    }
 
   return;
 }
 
+/**
+ * Compute the input region read for an output region
+ */
+template< class TInputImage,
+          class TOutputImage,
+          class TInterpolatorPrecisionType >
+bool
+ResampleSparseVectorImageFilter< TInputImage, TOutputImage, TInterpolatorPrecisionType >
+::ComputeInputRequestedRegion(const OutputImageRegionType & outputRegion,
+                              InputImageRegionType & inputRegion) const
+{
+  const TInputImage *inputPtr = this->GetInput();
+  const TOutputImage *outputPtr = this->GetOutput();
+  const InputImageRegionType & largestRegion = inputPtr->GetLargestPossibleRegion();
+  // The padding below covers the neighbourhood read by the sparse
+  // linear and nearest neighbor interpolators only
+  if ( !m_Transform || !m_Transform->IsLinear()
+       || !this->HasSparseInterpolator()
+       || outputRegion.GetNumberOfPixels() == 0
+       || largestRegion.GetNumberOfPixels() == 0 )
+    {
+    return false;
+    }
+
+  // A linear transform maps the output region into the bounding box of
+  // the images of its corners
+  double lower[ImageDimension];
+  double upper[ImageDimension];
+  for ( unsigned int d = 0; d < ImageDimension; d++ )
+    {
+    lower[d] = NumericTraits< double >::max();
+    upper[d] = NumericTraits< double >::NonpositiveMin();
+    }
+
+  IndexType index;
+  PointType outputPoint;
+  ContinuousInputIndexType inputIndex;
+  for ( unsigned int n = 0; n < ( 1u << ImageDimension ); n++ )
+    {
+    for ( unsigned int d = 0; d < ImageDimension; d++ )
+      {
+      index[d] = outputRegion.GetIndex()[d];
+      if ( n & ( 1u << d ) )
+        {
+        index[d] += static_cast< IndexValueType >( outputRegion.GetSize()[d] ) - 1;
+        }
+      }
+
+    outputPtr->TransformIndexToPhysicalPoint( index, outputPoint );
+    inputPtr->TransformPhysicalPointToContinuousIndex( m_Transform->TransformPoint( outputPoint ), inputIndex );
+    for ( unsigned int d = 0; d < ImageDimension; d++ )
+      {
+      lower[d] = std::min( lower[d], static_cast< double >( inputIndex[d] ) );
+      upper[d] = std::max( upper[d], static_cast< double >( inputIndex[d] ) );
+      }
+    }
+
+  // The interpolators of sparse images read the pixels at the floor of
+  // the continuous index and the next one. One more pixel on each side
+  // covers the rounding of the indices computed along the scanlines.
+  const typename InputImageRegionType::IndexType & largestIndex = largestRegion.GetIndex();
+  for ( unsigned int d = 0; d < ImageDimension; d++ )
+    {
+    const double first = std::floor( lower[d] ) - 1;
+    const double last = std::floor( upper[d] ) + 2;
+    const double largestFirst = static_cast< double >( largestIndex[d] );
+    const double largestLast = largestFirst + static_cast< double >( largestRegion.GetSize()[d] ) - 1;
+    if ( !( last >= largestFirst ) || !( first <= largestLast ) )
+      {
+      // No output pixel maps into the input: request a single pixel,
+      // so that the input is not generated in vain
+      typename InputImageRegionType::SizeType size;
+      size.Fill( 1 );
+      inputRegion.SetIndex( largestIndex );
+      inputRegion.SetSize( size );
+      return true;
+      }
+    const IndexValueType start = static_cast< IndexValueType >( std::max( first, largestFirst ) );
+    const IndexValueType end = static_cast< IndexValueType >( std::min( last, largestLast ) );
+    inputRegion.SetIndex( d, start );
+    inputRegion.SetSize( d, static_cast< SizeValueType >( end - start + 1 ) );
+    }
+
+  return true;
+}
+
 /**
  * Inform pipeline of required output region
  */
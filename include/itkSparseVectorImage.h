@@ -17,6 +17,7 @@
 #include "itkImageBase.h"
 #include "itkImageRegion.h"
 #include "itkSparseVectorImageContainer.h"
+#include "itkSparseVectorImagePixelTraits.h"
 #include "itkSparseVectorImagePixelAccessor.h"
 #include "itkSparseVectorImagePixelAccessorFunctor.h"
 #include "itkSparseVectorImageNeighborhoodAccessorFunctor.h"
@@ -34,12 +35,31 @@ namespace itk
  *
  * The elements for this image are stored in a hash table,
  * catering for very large images with a small number of relevant pixels.
- * The class is templated over the pixel type and image dimension.
+ * The class is templated over the pixel type, the image dimension and
+ * the container used to store the pixels. By default each component is
+ * stored as a separate entry of the hash table (SparseVectorImageContainer);
+ * SparseVectorImageVoxelContainer stores the components of each voxel
+ * contiguously instead.
+ *
+ * TPixel is usually the component type, and the pixels are then
+ * VariableLengthVector whose length is set with SetVectorLength(). When
+ * the number of components is known at compile time, TPixel can be a
+ * Vector< T, N > or a FixedArray< T, N >: pixels are then returned by
+ * value without heap allocation and the vector length is always N.
+ * \sa SparseVectorImagePixelTraits
+ *
+ * The ElementIdentifier of the container is the type of the component
+ * keys, VectorLength * offset + component. It is unsigned long by
+ * default; a container with uint32_t keys halves the memory used by the
+ * keys of images with less than 2^32 components, and Allocate() throws
+ * an exception if the keys of the image do not fit in it.
  *
  * \ingroup ITKSparseVectorImage
  *
  */
-template <class TPixel, unsigned int VImageDimension>
+template <class TPixel, unsigned int VImageDimension,
+          class TPixelContainer = SparseVectorImageContainer<unsigned long,
+            typename SparseVectorImagePixelTraits<TPixel>::ValueType> >
 class ITK_EXPORT SparseVectorImage :
     public ImageBase< VImageDimension >
 {
@@ -57,15 +77,18 @@ public:
   /** Run-time type information (and related methods). */
   itkTypeMacro(SparseVectorImage, ImageBase);
 
-  /** Pixel typedef support. */
-  //  typedef TPixel PixelType;
-  typedef VariableLengthVector< TPixel > PixelType;
+  /** Traits giving the pixel type and whether its length is fixed. */
+  typedef SparseVectorImagePixelTraits< TPixel > PixelTraits;
+
+  /** Pixel typedef support. VariableLengthVector< TPixel >, or TPixel
+   * itself for fixed length pixels. */
+  typedef typename PixelTraits::PixelType PixelType;
 
   /** This is the actual pixel type contained in the buffer. */
-  typedef TPixel InternalPixelType;
+  typedef typename PixelTraits::ValueType InternalPixelType;
 
-  /** Typedef alias for PixelType */
-  typedef TPixel ValueType;
+  /** Typedef alias for the type of the components */
+  typedef typename PixelTraits::ValueType ValueType;
 
   typedef InternalPixelType IOPixelType;
 
@@ -76,8 +99,7 @@ public:
   itkStaticConstMacro( ImageDimension, unsigned int, VImageDimension );
 
   /** Container used to store pixels in the image. */
-  typedef SparseVectorImageContainer<unsigned long, InternalPixelType>
-    PixelContainer;
+  typedef TPixelContainer PixelContainer;
 
   /** Index typedef support. An index is used to access pixel values. */
   typedef typename Superclass::IndexType IndexType;
@@ -114,7 +136,7 @@ public:
   /** Accessor type that convert data between internal and external
    *  representations. */
   typedef SparseVectorImagePixelAccessor<
-    InternalPixelType, typename PixelContainer::PixelMapType > AccessorType;
+    InternalPixelType, PixelContainer, PixelTraits > AccessorType;
 
   /** Tyepdef for the functor used to access pixels.*/
   typedef SparseVectorImagePixelAccessorFunctor< Self > AccessorFunctorType;
@@ -124,7 +146,9 @@ public:
     NeighborhoodAccessorFunctorType;
 
   /** Allocate the image memory. The size of the image must
-   * already be set, e.g. by calling SetRegions(). */
+   * already be set, e.g. by calling SetRegions(). Throw an exception if
+   * the component keys of the image do not fit in the ElementIdentifier
+   * of the container. */
   void Allocate();
 
   /** Convenience methods to set the LargestPossibleRegion,
@@ -157,6 +181,19 @@ public:
   virtual const RegionType& GetBufferedRegion() const
   { return this->GetLargestPossibleRegion(); }
 
+  /** Since the buffered region is always the largest possible region,
+   * the pipeline would never update a sparse image again once it has
+   * been generated for some requested region. The image instead keeps
+   * the requested region it was allocated for, and a later request
+   * outside of it, e.g. by the next piece of a StreamingImageFilter,
+   * updates the image again. */
+  virtual bool RequestedRegionIsOutsideOfTheBufferedRegion();
+
+  /** Get the requested region the pixels were allocated for by the last
+   * call to Allocate(). */
+  const RegionType & GetAllocatedRegion() const
+    { return m_AllocatedRegion; }
+
   /** Restore the data object to its initial state. This means releasing
    * memory. */
   virtual void Initialize();
@@ -182,6 +219,46 @@ public:
    * first. */
   void FillBuffer(const PixelType& value);
 
+  /** Get the value of the pixels which are not stored in the container. */
+  itkGetConstReferenceMacro(FillBufferValue, PixelType);
+
+  /** Compact the container into a read-only sorted layout once the image
+   * has been constructed. Lookups are then binary searches over
+   * contiguous arrays, and SetPixel() throws an exception until Thaw()
+   * is called. Only available for containers providing Freeze(), such
+   * as SparseVectorImageContainer and SparseVectorImageVoxelContainer. */
+  void Freeze()
+    { m_Container->Freeze(); }
+
+  /** Make a frozen image writable again. */
+  void Thaw()
+    { m_Container->Thaw(); }
+
+  /** Return true if the container is frozen. */
+  bool IsFrozen() const
+    { return m_Container->IsFrozen(); }
+
+  /** Set/Get the magnitude up to which the components written by
+   * SetPixel(), the pixel accessors and the sparse region iterator are
+   * considered zero: they are not stored, and erase the components
+   * already stored. The default, 0, only drops exact zeros. */
+  itkSetMacro(ZeroThreshold, double);
+  itkGetConstMacro(ZeroThreshold, double);
+
+  /** Remove from the container the components whose magnitude is at
+   * most ZeroThreshold, e.g. after the threshold has been raised or after
+   * components have been written with SetElement(), and return the
+   * number of bytes released. Only available for containers providing
+   * Prune(): SparseVectorImageContainer, SparseVectorImageVoxelContainer,
+   * SparseVectorImageShardedContainer and the key encoding and occupancy
+   * wrappers around them. */
+  SizeValueType Prune()
+    {
+    const SizeValueType bytes = m_Container->Prune( m_ZeroThreshold );
+    this->Modified();
+    return bytes;
+    }
+
   /** \brief Set a pixel value.
    *
    * Allocate() needs to have been called first -- for efficiency,
@@ -189,81 +266,70 @@ public:
    * allocated yet. */
    void SetPixel( const IndexType &index, const PixelType& value )
     {
-    typename PixelContainer::PixelMapType *map = m_Container->GetPixelMap();
-    OffsetValueType offset = m_VectorLength * this->ComputeOffset(index);
-    
-    for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
-      {
-      if ( value[i] != 0 )
-        {
-        map->operator[](offset + i) = value[i];
-        }
-      }
+    AccessorType::SetComponents( m_Container.GetPointer(), this->ComputeOffset(index),
+                                 value.GetDataPointer(), m_VectorLength, m_ZeroThreshold );
     }
 
   /** \brief Get a pixel (read only version).
    *
    * For efficiency, this function does not check that the
    * image has actually been allocated yet. Note that the method returns a
-   * pixel on the stack. */
+   * pixel on the stack. The container is never modified, so that several
+   * threads can read the image concurrently while no thread writes to it. */
   const PixelType GetPixel(const IndexType &index) const
     {
-    typename PixelContainer::PixelMapType *map = m_Container->GetPixelMap();
-    OffsetValueType offset = m_VectorLength * this->ComputeOffset(index);
-    
     PixelType pixel;
-    pixel.SetSize(m_VectorLength);
-    
-    for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
-      {
-      typename PixelContainer::PixelMapType::const_iterator it
-        = map->find( offset + i );
-      
-      if ( it == map->end() )
-        {
-        pixel[i] = m_FillBufferValue[i];
-        }
-      else
-        {
-        pixel[i] = map->operator[]( offset + i );
-        }
-      }
-    
+    PixelTraits::SetLength( pixel, m_VectorLength );
+
+    m_Container->GetPixel( this->ComputeOffset(index),
+                           m_FillBufferValue.GetDataPointer(),
+                           pixel.GetDataPointer() );
+
     return pixel;
     }
 
-  /** \brief Get a reference to a pixel (e.g. for editing).
+  /** \brief Get a copy of a pixel.
    *
    * For efficiency, this function does not check that the
-   * image has actually been allocated yet. */
+   * image has actually been allocated yet. As the const version, it does
+   * not modify the container. */
   PixelType GetPixel(const IndexType &index )
     {
-    typename PixelContainer::PixelMapType *map = m_Container->GetPixelMap();
-    OffsetValueType offset = m_VectorLength * this->ComputeOffset(index);
-    
     PixelType pixel;
-    pixel.SetSize(m_VectorLength);
-    
-    for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
-      {
-      typename PixelContainer::PixelMapType::const_iterator it
-        = map->find( offset + i );
-      
-      if ( it == map->end() )
-        {
-        pixel[i] = m_FillBufferValue[i];
-        }
-      else
-        {
-        pixel[i] = map->operator[]( offset + i );
-        }
-      }
-    
+    PixelTraits::SetLength( pixel, m_VectorLength );
+
+    m_Container->GetPixel( this->ComputeOffset(index),
+                           m_FillBufferValue.GetDataPointer(),
+                           pixel.GetDataPointer() );
+
     return pixel;
     }
 
+  /** \brief Copy the components of a pixel into caller-provided memory.
+   *
+   * VectorLength components are written to pixel, without any allocation.
+   * Return true if the pixel is stored in the container, false if the
+   * fill value was copied. */
+  bool GetPixelInto(const IndexType &index, InternalPixelType *pixel) const
+    {
+    return m_Container->GetPixel( this->ComputeOffset(index),
+                                  m_FillBufferValue.GetDataPointer(), pixel );
+    }
+
+  /** \brief Copy the components of several pixels into caller-provided memory.
+   *
+   * The VectorLength components of the pixel at indices[i] are written
+   * contiguously at pixels + i * VectorLength. The lookups are done in
+   * increasing offset order and repeated indices are looked up only once.
+   * If hits is not NULL, hits[i] is set to true if the i-th pixel is
+   * stored in the container. Return the number of stored pixels. Nothing
+   * is allocated, so that this method suits the inner loops of
+   * interpolators and filters. */
+  SizeValueType GetPixels(const IndexType *indices, SizeValueType numberOfPixels,
+                          InternalPixelType *pixels, bool *hits = NULL) const;
+
   /** \brief Access a pixel. This version cannot be an lvalue because the pixel
-   * is converted on the fly to a VariableLengthVector.
+   * is converted on the fly to a PixelType.
    *
    * For efficiency, this function does not check that the
    * image has actually been allocated yet. */
@@ -295,6 +361,15 @@ public:
    * DataObject to be modified. */
   void SetPixelContainer( PixelContainer *container );
 
+  /** Copy the information, the settings and the pixels of another image
+   * into a new container, so that the two images can then be modified
+   * independently, unlike Graft(). The containers copy their arrays or
+   * shards in parallel, see their DeepCopy() method. Only available for
+   * containers providing DeepCopy(): SparseVectorImageContainer,
+   * SparseVectorImageVoxelContainer, SparseVectorImageShardedContainer
+   * and SparseVectorImageCopyOnWriteContainer. */
+  void DeepCopy(const Self *image);
+
   /** Graft the data and information from one image to another. This
    * is a convenient method to setup a second image with all the meta
    * information of another image and use the same pixel
@@ -311,9 +386,10 @@ public:
   AccessorType GetPixelAccessor( void )
     {
       return AccessorType(
-        m_Container->GetPixelMap(),
+        m_Container.GetPointer(),
         m_FillBufferValue,
-        m_VectorLength
+        m_VectorLength,
+        m_ZeroThreshold
       );
     }
 
@@ -321,9 +397,10 @@ public:
   const AccessorType GetPixelAccessor( void ) const
     {
       return AccessorType(
-        m_Container->GetPixelMap(),
+        m_Container.GetPointer(),
         m_FillBufferValue,
-        m_VectorLength
+        m_VectorLength,
+        m_ZeroThreshold
       );
     }
 
@@ -331,9 +408,10 @@ public:
   NeighborhoodAccessorFunctorType GetNeighborhoodAccessor()
     {
       return NeighborhoodAccessorFunctorType(
-        m_Container->GetPixelMap(),
+        m_Container.GetPointer(),
         m_FillBufferValue,
-        m_VectorLength
+        m_VectorLength,
+        m_ZeroThreshold
        );
     }
 
@@ -341,21 +419,33 @@ public:
   const NeighborhoodAccessorFunctorType GetNeighborhoodAccessor() const
     {
       return NeighborhoodAccessorFunctorType(
-        m_Container->GetPixelMap(),
+        m_Container.GetPointer(),
         m_FillBufferValue,
-        m_VectorLength
+        m_VectorLength,
+        m_ZeroThreshold
        );
     }
 
-  /** Set/Get macros for the length of each vector in the vector image */
-  itkSetMacro(VectorLength, VectorLengthType);
+  /** Set/Get macros for the length of each vector in the vector image.
+   * For fixed length pixels, setting another length than the one of the
+   * pixel type throws an exception. */
+  virtual void SetVectorLength(VectorLengthType length);
   itkGetConstReferenceMacro(VectorLength, VectorLengthType);
   
   /** Get/Set the number of components each pixel has, ie the VectorLength */
   virtual unsigned int GetNumberOfComponentsPerPixel() const;
   
   virtual void SetNumberOfComponentsPerPixel(unsigned int n);
-  
+
+  /** Set/Get the expected fraction of non-zero pixel components, between
+   * 0 and 1. When it is positive, Allocate() presizes the container for
+   * ExpectedDensity * VectorLength elements per pixel of the requested
+   * region, so that
+   * filling the image does not repeatedly grow the container. The
+   * default, 0, does not reserve any memory. */
+  itkSetClampMacro(ExpectedDensity, double, 0.0, 1.0);
+  itkGetConstMacro(ExpectedDensity, double);
+
 protected:
   SparseVectorImage();
   void PrintSelf( std::ostream& os, Indent indent ) const;
@@ -371,6 +461,15 @@ private:
   
   /** Length of the "vector pixel" */
   VectorLengthType m_VectorLength;
+
+  /** Fraction of non-zero components used to presize the container */
+  double m_ExpectedDensity;
+
+  /** Requested region at the last call to Allocate() */
+  RegionType m_AllocatedRegion;
+
+  /** Magnitude up to which written components are considered zero */
+  double m_ZeroThreshold;
 };
 
 
@@ -16,32 +16,76 @@
 
 #include "itkSparseVectorImage.h"
 #include "itkProcessObject.h"
+#include "itkNumericTraits.h"
+#include <algorithm>
 
 namespace itk
 {
 
-template<class TPixel, unsigned int VImageDimension>
-SparseVectorImage<TPixel, VImageDimension>
+template<class TPixel, unsigned int VImageDimension, class TPixelContainer>
+SparseVectorImage<TPixel, VImageDimension, TPixelContainer>
 ::SparseVectorImage()
 {
   m_Container = PixelContainer::New();
-  m_FillBufferValue.SetSize(0);
+  m_VectorLength = PixelTraits::Length;
+  PixelTraits::SetLength( m_FillBufferValue, m_VectorLength );
+  m_FillBufferValue.Fill(0);
+  m_ExpectedDensity = 0.0;
+  m_ZeroThreshold = 0.0;
 }
 
 
-template<class TPixel, unsigned int VImageDimension>
+template<class TPixel, unsigned int VImageDimension, class TPixelContainer>
 void
-SparseVectorImage<TPixel, VImageDimension>
+SparseVectorImage<TPixel, VImageDimension, TPixelContainer>
 ::Allocate()
 {
+  // The largest key, VectorLength * NumberOfPixels - 1, must fit in the
+  // element identifier of the container
+  typedef typename PixelContainer::ElementIdentifier ElementIdentifier;
+  const uint64_t numberOfPixels = this->GetLargestPossibleRegion().GetNumberOfPixels();
+  const uint64_t length = m_VectorLength;
+  const uint64_t maximumKey = NumericTraits< ElementIdentifier >::max();
+  if ( numberOfPixels > 0 && length > 0
+       && numberOfPixels - 1 > ( maximumKey - ( length - 1 ) ) / length )
+    {
+    itkExceptionMacro( << "The keys of " << numberOfPixels << " pixels of "
+                       << length << " components do not fit in the "
+                       << 8 * sizeof( ElementIdentifier ) << "-bit keys of the container" );
+    }
+
+  // Keys are offsets in the largest possible region, but the pixels
+  // are only generated over the requested region, e.g. one piece of a
+  // streamed pipeline
+  m_AllocatedRegion = this->GetRequestedRegion();
+  if ( m_AllocatedRegion.GetNumberOfPixels() == 0 )
+    {
+    m_AllocatedRegion = this->GetLargestPossibleRegion();
+    }
+
   this->ComputeOffsetTable();
-  m_Container->Reserve( );
+  m_Container->SetVectorLength( m_VectorLength );
+  m_Container->SetImageSize( ImageDimension,
+                             this->GetLargestPossibleRegion().GetSize().GetSize() );
+  m_Container->Reserve( static_cast< SizeValueType >( m_ExpectedDensity
+    * m_AllocatedRegion.GetNumberOfPixels() * m_VectorLength ) );
 }
 
 
-template<class TPixel, unsigned int VImageDimension>
+template<class TPixel, unsigned int VImageDimension, class TPixelContainer>
+bool
+SparseVectorImage<TPixel, VImageDimension, TPixelContainer>
+::RequestedRegionIsOutsideOfTheBufferedRegion()
+{
+  const RegionType & requestedRegion = this->GetRequestedRegion();
+  return requestedRegion.GetNumberOfPixels() > 0
+         && !m_AllocatedRegion.IsInside( requestedRegion );
+}
+
+
+template<class TPixel, unsigned int VImageDimension, class TPixelContainer>
 void
-SparseVectorImage<TPixel, VImageDimension>
+SparseVectorImage<TPixel, VImageDimension, TPixelContainer>
 ::Initialize()
 {
   //
@@ -52,26 +96,94 @@ SparseVectorImage<TPixel, VImageDimension>
   // Call the superclass which should initialize the BufferedRegion ivar.
   Superclass::Initialize();
 
+  m_AllocatedRegion = RegionType();
+
   // Replace the handle to the container. This is the safest thing to do,
   // since the same container can be shared by multiple images (e.g.
   // Grafted outputs and in place filters).
   m_Container = PixelContainer::New();
+  m_Container->SetVectorLength( m_VectorLength );
 }
 
 
-template<class TPixel, unsigned int VImageDimension>
+template<class TPixel, unsigned int VImageDimension, class TPixelContainer>
 void
-SparseVectorImage<TPixel, VImageDimension>
+SparseVectorImage<TPixel, VImageDimension, TPixelContainer>
 ::FillBuffer(const PixelType& value)
 {
   m_FillBufferValue = value;
-  m_Container->GetPixelMap()->clear();
+  m_Container->Clear();
+}
+
+
+template<class TPixel, unsigned int VImageDimension, class TPixelContainer>
+SizeValueType
+SparseVectorImage<TPixel, VImageDimension, TPixelContainer>
+::GetPixels(const IndexType *indices, SizeValueType numberOfPixels,
+            InternalPixelType *pixels, bool *hits) const
+{
+  // The pixels are processed by chunks, whose offsets are sorted on the
+  // stack, so that neighbouring pixels are looked up one after the other.
+  const SizeValueType chunkSize = 64;
+  OffsetValueType offsets[chunkSize];
+  SizeValueType   order[chunkSize];
+
+  const InternalPixelType *fillValue = m_FillBufferValue.GetDataPointer();
+  SizeValueType numberOfHits = 0;
+
+  for ( SizeValueType first = 0; first < numberOfPixels; first += chunkSize )
+    {
+    const SizeValueType n = std::min( chunkSize, numberOfPixels - first );
+
+    // Insertion sort of the offsets, n is small
+    for ( SizeValueType i = 0; i < n; i++ )
+      {
+      offsets[i] = this->ComputeOffset( indices[first + i] );
+      SizeValueType j = i;
+      while ( j > 0 && offsets[order[j - 1]] > offsets[i] )
+        {
+        order[j] = order[j - 1];
+        --j;
+        }
+      order[j] = i;
+      }
+
+    const InternalPixelType *previous = NULL;
+    bool previousHit = false;
+    for ( SizeValueType k = 0; k < n; k++ )
+      {
+      const SizeValueType i = order[k];
+      InternalPixelType *pixel = pixels + ( first + i ) * m_VectorLength;
+
+      bool hit;
+      if ( previous != NULL && offsets[i] == offsets[order[k - 1]] )
+        {
+        // Repeated index, e.g. the clamped corners of an interpolator
+        std::copy( previous, previous + m_VectorLength, pixel );
+        hit = previousHit;
+        }
+      else
+        {
+        hit = m_Container->GetPixel( offsets[i], fillValue, pixel );
+        }
+
+      if ( hits != NULL )
+        {
+        hits[first + i] = hit;
+        }
+      numberOfHits += hit;
+      previous = pixel;
+      previousHit = hit;
+      }
+    }
+
+  return numberOfHits;
 }
 
 
-template<class TPixel, unsigned int VImageDimension>
+template<class TPixel, unsigned int VImageDimension, class TPixelContainer>
 void
-SparseVectorImage<TPixel, VImageDimension>
+SparseVectorImage<TPixel, VImageDimension, TPixelContainer>
 ::SetPixelContainer(PixelContainer *container)
 {
    if (m_Container != container)
@@ -82,9 +194,36 @@ SparseVectorImage<TPixel, VImageDimension>
 }
 
 
-template<class TPixel, unsigned int VImageDimension>
+template<class TPixel, unsigned int VImageDimension, class TPixelContainer>
+void
+SparseVectorImage<TPixel, VImageDimension, TPixelContainer>
+::DeepCopy(const Self *image)
+{
+  if ( image == this )
+    {
+    return;
+    }
+
+  // The new container is set first, so that a container shared with
+  // another image is not resized
+  PixelContainerPointer container = PixelContainer::New();
+  container->DeepCopy( image->GetPixelContainer() );
+  this->SetPixelContainer( container );
+
+  this->CopyInformation( image );
+  this->SetBufferedRegion( image->GetBufferedRegion() );
+  this->SetRequestedRegion( image->GetRequestedRegion() );
+  m_AllocatedRegion = image->m_AllocatedRegion;
+  this->SetVectorLength( image->GetVectorLength() );
+  m_FillBufferValue = image->m_FillBufferValue;
+  m_ExpectedDensity = image->m_ExpectedDensity;
+  m_ZeroThreshold = image->m_ZeroThreshold;
+}
+
+
+template<class TPixel, unsigned int VImageDimension, class TPixelContainer>
 void
-SparseVectorImage<TPixel, VImageDimension>
+SparseVectorImage<TPixel, VImageDimension, TPixelContainer>
 ::Graft(const DataObject *data)
 {
   // call the superclass' implementation
@@ -121,33 +260,56 @@ SparseVectorImage<TPixel, VImageDimension>
     }
 }
 
-template< class TPixel, unsigned int VImageDimension >
+template<class TPixel, unsigned int VImageDimension, class TPixelContainer>
 unsigned int
-SparseVectorImage< TPixel, VImageDimension >
+SparseVectorImage<TPixel, VImageDimension, TPixelContainer>
 ::GetNumberOfComponentsPerPixel() const
 {
   return this->m_VectorLength;
 }
 
-template< class TPixel, unsigned int VImageDimension >
+template<class TPixel, unsigned int VImageDimension, class TPixelContainer>
 void
-SparseVectorImage< TPixel, VImageDimension >
+SparseVectorImage<TPixel, VImageDimension, TPixelContainer>
 ::SetNumberOfComponentsPerPixel(unsigned int n)
 {
   this->SetVectorLength( static_cast< VectorLengthType >( n ) );
-  if ( m_FillBufferValue.GetNumberOfElements() == 0 )
+}
+
+template<class TPixel, unsigned int VImageDimension, class TPixelContainer>
+void
+SparseVectorImage<TPixel, VImageDimension, TPixelContainer>
+::SetVectorLength(VectorLengthType length)
+{
+  if ( PixelTraits::Length != 0 && length != PixelTraits::Length )
+    {
+    itkExceptionMacro( << "The vector length of this image is fixed to "
+                       << PixelTraits::Length << ", cannot set it to " << length );
+    }
+
+  if ( m_VectorLength != length )
+    {
+    m_VectorLength = length;
+    this->Modified();
+    }
+
+  if ( m_FillBufferValue.Size() != length )
     {
-    m_FillBufferValue.SetSize(n);
+    PixelTraits::SetLength( m_FillBufferValue, length );
     m_FillBufferValue.Fill(0);
     }
+
+  m_Container->SetVectorLength( length );
 }
   
-template<class TPixel, unsigned int VImageDimension>
+template<class TPixel, unsigned int VImageDimension, class TPixelContainer>
 void
-SparseVectorImage<TPixel, VImageDimension>
+SparseVectorImage<TPixel, VImageDimension, TPixelContainer>
 ::PrintSelf(std::ostream& os, Indent indent) const
 {
   Superclass::PrintSelf(os,indent);
+  os << indent << "ExpectedDensity: " << m_ExpectedDensity << std::endl;
+  os << indent << "ZeroThreshold: " << m_ZeroThreshold << std::endl;
   os << indent << "PixelContainer: " << std::endl;
   m_Container->Print(os, indent.GetNextIndent());
 // m_Origin and m_Spacing are printed in the Superclass
@@ -0,0 +1,354 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Brick Container
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef __itkSparseVectorImageBrickContainer_h
+#define __itkSparseVectorImageBrickContainer_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkNumericTraits.h"
+#include "itkIntTypes.h"
+#include <algorithm>
+#include <vector>
+#include <tr1/unordered_map>
+
+namespace itk
+{
+
+/** \class SparseVectorImageBrickContainer
+ *  \brief A brick-based image container for itk::SparseVectorImage.
+ *
+ *  The image is divided into bricks of 2^VBrickBits voxels along each
+ *  dimension, i.e. 8x8x8 voxels by default. A brick is allocated as a
+ *  dense block of VectorLength components per voxel the first time one
+ *  of its voxels is written, and a hash table maps the brick identifiers
+ *  to the allocated blocks. Within a brick, the voxels are laid out in
+ *  raster order, so that neighbouring voxels, e.g. the corners used by
+ *  linear interpolation, are found in contiguous memory after a single
+ *  lookup. This layout suits images that are sparse at the scale of
+ *  whole regions rather than single voxels.
+ *
+ *  The offsets received by GetPixel() and SetPixel() are the raster
+ *  offsets computed by SparseVectorImage::ComputeOffset(); the container
+ *  splits them into a brick identifier and an offset within the brick
+ *  using the image size set by SetImageSize(), which is called by
+ *  SparseVectorImage::Allocate().
+ *
+ *  As for SparseVectorImageVoxelContainer, a pixel is written as a whole
+ *  and pixels whose components are all zero are not stored. A bitmask
+ *  per brick records the stored voxels, so that the other voxels of an
+ *  allocated brick take the fill value.
+ *
+ *  \code
+ *  typedef itk::SparseVectorImage< float, 3,
+ *    itk::SparseVectorImageBrickContainer< unsigned long, float > > ImageType;
+ *  \endcode
+ *
+ *  \sa SparseVectorImageContainer, SparseVectorImageVoxelContainer
+ *
+ *  \ingroup ITKSparseVectorImage
+ *
+ */
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VBrickBits = 3,
+          typename TBrickMap = std::tr1::unordered_map< TElementIdentifier, SizeValueType > >
+class SparseVectorImageBrickContainer:  public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef SparseVectorImageBrickContainer  Self;
+  typedef Object                           Superclass;
+  typedef SmartPointer<Self>               Pointer;
+  typedef SmartPointer<const Self>         ConstPointer;
+
+  /** Save the template parameters. */
+  typedef TElementIdentifier  ElementIdentifier;
+  typedef TElement            Element;
+
+  /** Map from brick identifier to the slot of the brick. */
+  typedef TBrickMap BrickMapType;
+
+  /** Contiguous storage of the bricks, VectorLength components per voxel
+   *  and BrickSize voxels per brick. */
+  typedef std::vector< Element > ValueArrayType;
+
+  /** Bitmask of the stored voxels, MaskWords words per brick. */
+  typedef std::vector< uint64_t > MaskArrayType;
+
+  typedef unsigned int VectorLengthType;
+
+  /** Number of voxels of a brick along each dimension. */
+  itkStaticConstMacro(BrickBits, unsigned int, VBrickBits);
+  itkStaticConstMacro(BrickLength, SizeValueType, 1 << VBrickBits);
+
+  /** Maximum image dimension supported by the container. */
+  itkStaticConstMacro(MaximumDimension, unsigned int, 8);
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Standard part of every itk Object. */
+  itkTypeMacro(SparseVectorImageBrickContainer, Object);
+
+  /** Get the number of elements currently stored in the container,
+   *  i.e. VectorLength times the number of stored voxels. */
+  unsigned long Size(void) const
+    { return (unsigned long) m_NumberOfVoxels * m_VectorLength; };
+
+  /** Get the number of voxels currently stored in the container. */
+  unsigned long GetNumberOfVoxels(void) const
+    { return (unsigned long) m_NumberOfVoxels; };
+
+  /** Get the number of allocated bricks. */
+  unsigned long GetNumberOfBricks(void) const
+    { return (unsigned long) m_BrickIdentifiers.size(); };
+
+  /** Get the number of voxels of a brick. */
+  SizeValueType GetBrickSize(void) const
+    { return m_BrickSize; }
+
+  /** Set the number of components of each pixel. Changing the length
+   *  discards the stored pixels. */
+  void SetVectorLength(VectorLengthType length);
+  itkGetConstMacro(VectorLength, VectorLengthType);
+
+  /** Set the size of the image, used to split the offsets into a brick
+   *  identifier and an offset within the brick. Changing the size
+   *  discards the stored pixels. */
+  void SetImageSize(unsigned int dimension, const SizeValueType *size);
+
+  /** Copy the components of the pixel at the given offset into pixel.
+   *  If the pixel is not stored, fillValue is copied instead. Return
+   *  true if the pixel is stored. */
+  bool GetPixel(ElementIdentifier offset, const Element *fillValue,
+                Element *pixel) const
+    {
+    const Element *values = this->FindVoxel( offset );
+    if ( !values )
+      {
+      std::copy( fillValue, fillValue + m_VectorLength, pixel );
+      return false;
+      }
+
+    std::copy( values, values + m_VectorLength, pixel );
+    return true;
+    }
+
+  /** Store the pixel at the given offset if it has a non-zero component.
+   *  A stored voxel becoming zero is erased, and its brick is released
+   *  once it is empty. */
+  void SetPixel(ElementIdentifier offset, const Element *pixel)
+    {
+    VectorLengthType i = 0;
+    while ( i < m_VectorLength && pixel[i] == 0 )
+      {
+      i++;
+      }
+    if ( i == m_VectorLength )
+      {
+      this->EraseVoxel( offset );
+      return;
+      }
+
+    Element *values = this->GetVoxel( offset );
+    std::copy( pixel, pixel + m_VectorLength, values );
+    }
+
+  /** Store a single component given its key, i.e.
+   *  VectorLength * offset + component. */
+  void SetElement(ElementIdentifier key, const Element & value)
+    {
+    this->GetVoxel( key / m_VectorLength )[key % m_VectorLength] = value;
+    }
+
+  /** Call visitor( key, value ) for every non-zero component of the
+   *  stored voxels. The voxels are visited brick by brick. */
+  template< class TVisitor >
+  void VisitElements(TVisitor & visitor) const
+    {
+    for ( SizeValueType slot = 0; slot < m_BrickIdentifiers.size(); slot++ )
+      {
+      for ( SizeValueType voxel = 0; voxel < m_BrickSize; voxel++ )
+        {
+        if ( !this->IsVoxelStored( slot, voxel ) )
+          {
+          continue;
+          }
+
+        const ElementIdentifier first = m_VectorLength *
+          this->JoinOffset( m_BrickIdentifiers[slot], voxel );
+        const Element *values = this->GetVoxelValues( slot, voxel );
+        for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
+          {
+          if ( values[i] != 0 )
+            {
+            visitor( first + i, values[i] );
+            }
+          }
+        }
+      }
+    }
+
+  /** The number of bricks can not be derived from the number of stored
+   *  elements, since bricks are allocated on demand. This method does
+   *  nothing. */
+  void Reserve(SizeValueType) {}
+
+  /** Release the memory reserved beyond the allocated bricks. */
+  void Squeeze(void);
+
+  /** Remove all the stored pixels. */
+  void Clear(void);
+
+  /** Tell the container to release any of its allocated memory. */
+  void Initialize(void);
+
+  /** See SparseVectorImageContainer::SetContainerManageMemory(). */
+  itkSetMacro(ContainerManageMemory,bool);
+  itkGetMacro(ContainerManageMemory,bool);
+  itkBooleanMacro(ContainerManageMemory);
+
+protected:
+  SparseVectorImageBrickContainer();
+  virtual ~SparseVectorImageBrickContainer();
+
+  void PrintSelf(std::ostream& os, Indent indent) const;
+
+  /** Split a raster offset into the identifier of its brick and its
+   *  raster offset within the brick. */
+  void SplitOffset(ElementIdentifier offset, ElementIdentifier & brick,
+                   SizeValueType & voxel) const
+    {
+    brick = 0;
+    voxel = 0;
+    for ( unsigned int d = m_Dimension - 1; d > 0; d-- )
+      {
+      const ElementIdentifier index = offset / m_OffsetTable[d];
+      offset -= index * m_OffsetTable[d];
+      brick += ( index >> VBrickBits ) * m_BrickOffsetTable[d];
+      voxel |= static_cast< SizeValueType >( index & ( BrickLength - 1 ) ) << ( VBrickBits * d );
+      }
+    brick += offset >> VBrickBits;
+    voxel |= static_cast< SizeValueType >( offset & ( BrickLength - 1 ) );
+    }
+
+  /** Inverse of SplitOffset(). */
+  ElementIdentifier JoinOffset(ElementIdentifier brick, SizeValueType voxel) const
+    {
+    ElementIdentifier offset = 0;
+    for ( unsigned int d = m_Dimension - 1; d > 0; d-- )
+      {
+      const ElementIdentifier brickIndex = brick / m_BrickOffsetTable[d];
+      brick -= brickIndex * m_BrickOffsetTable[d];
+      const ElementIdentifier index = ( brickIndex << VBrickBits )
+        + ( ( voxel >> ( VBrickBits * d ) ) & ( BrickLength - 1 ) );
+      offset += index * m_OffsetTable[d];
+      }
+    offset += ( brick << VBrickBits ) + ( voxel & ( BrickLength - 1 ) );
+    return offset;
+    }
+
+  bool IsVoxelStored(SizeValueType slot, SizeValueType voxel) const
+    {
+    return ( m_MaskArray[slot * m_MaskWords + ( voxel >> 6 )]
+             >> ( voxel & 63 ) ) & 1;
+    }
+
+  const Element * GetVoxelValues(SizeValueType slot, SizeValueType voxel) const
+    {
+    return &m_ValueArray[( slot * m_BrickSize + voxel ) * m_VectorLength];
+    }
+
+  /** Return the components of the voxel at the given offset, or NULL if
+   *  the voxel is not stored. */
+  const Element * FindVoxel(ElementIdentifier offset) const
+    {
+    ElementIdentifier brick;
+    SizeValueType voxel;
+    this->SplitOffset( offset, brick, voxel );
+
+    typename BrickMapType::const_iterator it = m_BrickMap.find( brick );
+
+    if ( it == m_BrickMap.end() || !this->IsVoxelStored( it->second, voxel ) )
+      {
+      return NULL;
+      }
+    return this->GetVoxelValues( it->second, voxel );
+    }
+
+  /** Return the components of the voxel at the given offset, allocating
+   *  a zero-filled brick if the brick of the voxel is not stored yet. */
+  Element * GetVoxel(ElementIdentifier offset)
+    {
+    ElementIdentifier brick;
+    SizeValueType voxel;
+    this->SplitOffset( offset, brick, voxel );
+
+    std::pair< typename BrickMapType::iterator, bool > inserted =
+      m_BrickMap.insert( std::make_pair( brick,
+        static_cast< SizeValueType >( m_BrickIdentifiers.size() ) ) );
+
+    if ( inserted.second )
+      {
+      m_BrickIdentifiers.push_back( brick );
+      m_ValueArray.resize( m_ValueArray.size() + m_BrickSize * m_VectorLength,
+                           NumericTraits< Element >::Zero );
+      m_MaskArray.resize( m_MaskArray.size() + m_MaskWords, 0 );
+      }
+
+    const SizeValueType slot = inserted.first->second;
+    uint64_t & word = m_MaskArray[slot * m_MaskWords + ( voxel >> 6 )];
+    const uint64_t bit = static_cast< uint64_t >( 1 ) << ( voxel & 63 );
+    if ( !( word & bit ) )
+      {
+      word |= bit;
+      ++m_NumberOfVoxels;
+      }
+
+    return &m_ValueArray[( slot * m_BrickSize + voxel ) * m_VectorLength];
+    }
+
+  /** Remove the voxel at the given offset if it is stored. A brick left
+   *  without voxels is released and the last brick is moved into its
+   *  slot. */
+  void EraseVoxel(ElementIdentifier offset);
+
+private:
+  SparseVectorImageBrickContainer(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  BrickMapType                      m_BrickMap;
+  std::vector< ElementIdentifier >  m_BrickIdentifiers;
+  ValueArrayType                    m_ValueArray;
+  MaskArrayType                     m_MaskArray;
+  SizeValueType                     m_NumberOfVoxels;
+  VectorLengthType                  m_VectorLength;
+  bool                              m_ContainerManageMemory;
+
+  /** Geometry of the image and of the grid of bricks. */
+  unsigned int                      m_Dimension;
+  ElementIdentifier                 m_OffsetTable[MaximumDimension];
+  ElementIdentifier                 m_BrickOffsetTable[MaximumDimension];
+  SizeValueType                     m_BrickSize;
+  SizeValueType                     m_MaskWords;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkSparseVectorImageBrickContainer.hxx"
+#endif
+
+#endif
@@ -0,0 +1,242 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Brick Container
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef _itkSparseVectorImageBrickContainer_hxx
+#define _itkSparseVectorImageBrickContainer_hxx
+
+#include "itkSparseVectorImageBrickContainer.h"
+
+namespace itk
+{
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VBrickBits, typename TBrickMap>
+SparseVectorImageBrickContainer< TElementIdentifier , TElement , VBrickBits , TBrickMap >
+::SparseVectorImageBrickContainer()
+{
+  m_NumberOfVoxels = 0;
+  m_VectorLength = 1;
+  m_ContainerManageMemory = true;
+
+  // Until SetImageSize() is called, offsets are split as 1D indices
+  m_Dimension = 1;
+  m_OffsetTable[0] = 1;
+  m_BrickOffsetTable[0] = 1;
+  m_BrickSize = BrickLength;
+  m_MaskWords = ( m_BrickSize + 63 ) / 64;
+}
+
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VBrickBits, typename TBrickMap>
+SparseVectorImageBrickContainer< TElementIdentifier , TElement , VBrickBits , TBrickMap >
+::~SparseVectorImageBrickContainer()
+{
+  if( m_ContainerManageMemory )
+    {
+    this->Clear();
+    }
+}
+
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VBrickBits, typename TBrickMap>
+void
+SparseVectorImageBrickContainer< TElementIdentifier , TElement , VBrickBits , TBrickMap >
+::SetVectorLength(VectorLengthType length)
+{
+  if ( length == m_VectorLength )
+    {
+    return;
+    }
+
+  this->Clear();
+  m_VectorLength = length;
+  this->Modified();
+}
+
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VBrickBits, typename TBrickMap>
+void
+SparseVectorImageBrickContainer< TElementIdentifier , TElement , VBrickBits , TBrickMap >
+::SetImageSize(unsigned int dimension, const SizeValueType *size)
+{
+  if ( dimension == 0 || dimension > MaximumDimension )
+    {
+    itkExceptionMacro( << "Image dimension " << dimension << " is not supported" );
+    }
+  if ( VBrickBits * dimension > 24 )
+    {
+    itkExceptionMacro( << "Bricks of " << BrickLength << " voxels along "
+                       << dimension << " dimensions are too large" );
+    }
+
+  ElementIdentifier offsetTable[MaximumDimension];
+  ElementIdentifier brickOffsetTable[MaximumDimension];
+  offsetTable[0] = 1;
+  brickOffsetTable[0] = 1;
+  for ( unsigned int d = 1; d < dimension; d++ )
+    {
+    offsetTable[d] = offsetTable[d-1] * size[d-1];
+    brickOffsetTable[d] = brickOffsetTable[d-1]
+      * ( ( size[d-1] + BrickLength - 1 ) >> VBrickBits );
+    }
+
+  bool changed = ( dimension != m_Dimension );
+  for ( unsigned int d = 0; d < dimension && !changed; d++ )
+    {
+    changed = ( offsetTable[d] != m_OffsetTable[d]
+                || brickOffsetTable[d] != m_BrickOffsetTable[d] );
+    }
+  if ( !changed )
+    {
+    return;
+    }
+
+  this->Clear();
+  m_Dimension = dimension;
+  std::copy( offsetTable, offsetTable + dimension, m_OffsetTable );
+  std::copy( brickOffsetTable, brickOffsetTable + dimension, m_BrickOffsetTable );
+  m_BrickSize = static_cast< SizeValueType >( 1 ) << ( VBrickBits * dimension );
+  m_MaskWords = ( m_BrickSize + 63 ) / 64;
+  this->Modified();
+}
+
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VBrickBits, typename TBrickMap>
+void
+SparseVectorImageBrickContainer< TElementIdentifier , TElement , VBrickBits , TBrickMap >
+::EraseVoxel(ElementIdentifier offset)
+{
+  ElementIdentifier brick;
+  SizeValueType voxel;
+  this->SplitOffset( offset, brick, voxel );
+
+  typename BrickMapType::iterator it = m_BrickMap.find( brick );
+  if ( it == m_BrickMap.end() || !this->IsVoxelStored( it->second, voxel ) )
+    {
+    return;
+    }
+  const SizeValueType slot = it->second;
+
+  // Voxel: its components are reset, since a voxel stored again in the
+  // brick is expected to start from zero
+  m_MaskArray[slot * m_MaskWords + ( voxel >> 6 )] &= ~( static_cast< uint64_t >( 1 ) << ( voxel & 63 ) );
+  --m_NumberOfVoxels;
+  Element *values = &m_ValueArray[( slot * m_BrickSize + voxel ) * m_VectorLength];
+  std::fill( values, values + m_VectorLength, NumericTraits< Element >::Zero );
+
+  for ( SizeValueType word = 0; word < m_MaskWords; word++ )
+    {
+    if ( m_MaskArray[slot * m_MaskWords + word] != 0 )
+      {
+      return;
+      }
+    }
+
+  // Brick: the last brick takes its slot, and its map entry is updated
+  m_BrickMap.erase( it );
+  const SizeValueType last = m_BrickIdentifiers.size() - 1;
+  if ( slot != last )
+    {
+    m_BrickIdentifiers[slot] = m_BrickIdentifiers[last];
+    m_BrickMap.find( m_BrickIdentifiers[slot] )->second = slot;
+
+    std::copy( &m_MaskArray[last * m_MaskWords], &m_MaskArray[last * m_MaskWords] + m_MaskWords,
+               &m_MaskArray[slot * m_MaskWords] );
+    std::copy( &m_ValueArray[last * m_BrickSize * m_VectorLength],
+               &m_ValueArray[last * m_BrickSize * m_VectorLength] + m_BrickSize * m_VectorLength,
+               &m_ValueArray[slot * m_BrickSize * m_VectorLength] );
+    }
+  m_BrickIdentifiers.pop_back();
+  m_MaskArray.resize( last * m_MaskWords );
+  m_ValueArray.resize( last * m_BrickSize * m_VectorLength );
+}
+
+
+/**
+ * Tell the container to try to minimize its memory usage for storage of
+ * the current number of elements.
+ */
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VBrickBits, typename TBrickMap>
+void
+SparseVectorImageBrickContainer< TElementIdentifier , TElement , VBrickBits , TBrickMap >
+::Squeeze(void)
+{
+  m_BrickMap.rehash( 0 );
+  std::vector< ElementIdentifier >( m_BrickIdentifiers ).swap( m_BrickIdentifiers );
+  std::vector< Element >( m_ValueArray ).swap( m_ValueArray );
+  std::vector< uint64_t >( m_MaskArray ).swap( m_MaskArray );
+}
+
+
+/**
+ * Remove all the stored pixels.
+ */
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VBrickBits, typename TBrickMap>
+void
+SparseVectorImageBrickContainer< TElementIdentifier , TElement , VBrickBits , TBrickMap >
+::Clear(void)
+{
+  m_BrickMap.clear();
+  m_BrickIdentifiers.clear();
+  m_ValueArray.clear();
+  m_MaskArray.clear();
+  m_NumberOfVoxels = 0;
+}
+
+
+/**
+ * Tell the container to release any of its allocated memory.
+ */
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VBrickBits, typename TBrickMap>
+void
+SparseVectorImageBrickContainer< TElementIdentifier , TElement , VBrickBits , TBrickMap >
+::Initialize(void)
+{
+  if ( m_BrickIdentifiers.size() > 0 )
+    {
+    if( m_ContainerManageMemory )
+      {
+      this->Clear();
+      }
+    m_ContainerManageMemory = true;
+    this->Modified();
+    }
+}
+
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VBrickBits, typename TBrickMap>
+void
+SparseVectorImageBrickContainer< TElementIdentifier , TElement , VBrickBits , TBrickMap >
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+
+  os << indent << "VectorLength: " << m_VectorLength << std::endl;
+  os << indent << "Brick size: " << m_BrickSize << " voxels" << std::endl;
+  os << indent << "Number of bricks: " << m_BrickIdentifiers.size() << std::endl;
+  os << indent << "Number of stored voxels: " << m_NumberOfVoxels << std::endl;
+  os << indent << "Container manages memory: "
+     << (m_ContainerManageMemory ? "true" : "false") << std::endl;
+}
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,298 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Codec Container
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef __itkSparseVectorImageCodecContainer_h
+#define __itkSparseVectorImageCodecContainer_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkSparseVectorImageValueCodec.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace itk
+{
+
+/** \class SparseVectorImageCodecContainer
+ *  \brief Store the components of the pixels in another container at a
+ *  reduced precision.
+ *
+ *  The container given as template argument stores the codes of the
+ *  components, of type TCodec::StorageType, e.g. a half float or an 8 or
+ *  16-bit integer, and this container presents them to the image as
+ *  TCodec::ValueType: values are narrowed by SetPixel() and SetElement()
+ *  and widened by GetPixel() and VisitElements().
+ *
+ *  The memory saved depends on the wrapped container: the voxel-keyed
+ *  containers, SparseVectorImageFlatHashMap and frozen containers store
+ *  the values in arrays and shrink accordingly, whereas the padding of
+ *  the nodes of std::tr1::unordered_map absorbs most of the gain.
+ *
+ *  The codec, e.g. the ranges of SparseVectorImageLinearCodec, is set
+ *  through GetCodec() before storing values. The .spr files keep the
+ *  values at full precision and record the codec and its parameters in
+ *  the header; reading the file into an image with the same codec
+ *  restores the parameters, and hence the same codes.
+ *
+ *  The zero components of a stored pixel are returned as zero rather
+ *  than as the fill value.
+ *
+ *  \code
+ *  typedef itk::SparseVectorImageCodecContainer<
+ *    itk::SparseVectorImageVoxelContainer< unsigned long, itk::uint16_t >,
+ *    itk::SparseVectorImageHalfCodec< float > > ContainerType;
+ *  typedef itk::SparseVectorImage< float, 3, ContainerType > ImageType;
+ *  \endcode
+ *
+ *  \sa SparseVectorImageHalfCodec, SparseVectorImageLinearCodec
+ *
+ *  \ingroup ITKSparseVectorImage
+ *
+ */
+
+template <typename TContainer, typename TCodec>
+class SparseVectorImageCodecContainer:  public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef SparseVectorImageCodecContainer  Self;
+  typedef Object                           Superclass;
+  typedef SmartPointer<Self>               Pointer;
+  typedef SmartPointer<const Self>         ConstPointer;
+
+  /** Save the template parameters. */
+  typedef TContainer                                ContainerType;
+  typedef typename ContainerType::Pointer           ContainerPointer;
+  typedef typename ContainerType::ElementIdentifier ElementIdentifier;
+  typedef TCodec                                    CodecType;
+  typedef typename CodecType::ValueType             Element;
+  typedef typename CodecType::StorageType           StorageType;
+
+  typedef unsigned int VectorLengthType;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Standard part of every itk Object. */
+  itkTypeMacro(SparseVectorImageCodecContainer, Object);
+
+  /** Get the container storing the codes. */
+  ContainerType * GetContainer()
+    { return m_Container.GetPointer(); }
+  const ContainerType * GetContainer() const
+    { return m_Container.GetPointer(); }
+
+  /** Get the codec, e.g. to set its parameters. */
+  CodecType & GetCodec()
+    { return m_Codec; }
+  const CodecType & GetCodec() const
+    { return m_Codec; }
+
+  /** Get the number of elements currently stored in the container. */
+  unsigned long Size(void) const
+    { return m_Container->Size(); }
+
+  /** Set the number of components of each pixel. */
+  void SetVectorLength(VectorLengthType length)
+    {
+    m_Container->SetVectorLength( length );
+    m_Codec.SetVectorLength( length );
+    m_ZeroCodes.assign( length, 0 );
+    this->Modified();
+    }
+  VectorLengthType GetVectorLength() const
+    { return m_Container->GetVectorLength(); }
+
+  /** Forwarded to the wrapped container. */
+  void SetImageSize(unsigned int dimension, const SizeValueType *size)
+    { m_Container->SetImageSize( dimension, size ); }
+
+  /** Copy the widened components of the pixel at the given offset into
+   *  pixel. If the pixel is not stored, fillValue is copied instead.
+   *  Return true if the pixel is stored. */
+  bool GetPixel(ElementIdentifier offset, const Element *fillValue,
+                Element *pixel) const
+    {
+    const VectorLengthType length = m_Container->GetVectorLength();
+    StorageType stackCodes[StackLength];
+    std::vector< StorageType > heapCodes;
+    StorageType *codes = stackCodes;
+    if ( length > StackLength )
+      {
+      heapCodes.resize( length );
+      codes = &heapCodes[0];
+      }
+
+    if ( !m_Container->GetPixel( offset, &m_ZeroCodes[0], codes ) )
+      {
+      std::copy( fillValue, fillValue + length, pixel );
+      return false;
+      }
+
+    for ( VectorLengthType i = 0; i < length; i++ )
+      {
+      pixel[i] = m_Codec.Decode( codes[i], i );
+      }
+    return true;
+    }
+
+  /** Store the narrowed components of the pixel at the given offset. */
+  void SetPixel(ElementIdentifier offset, const Element *pixel)
+    {
+    const VectorLengthType length = m_Container->GetVectorLength();
+    StorageType stackCodes[StackLength];
+    std::vector< StorageType > heapCodes;
+    StorageType *codes = stackCodes;
+    if ( length > StackLength )
+      {
+      heapCodes.resize( length );
+      codes = &heapCodes[0];
+      }
+
+    for ( VectorLengthType i = 0; i < length; i++ )
+      {
+      codes[i] = m_Codec.Encode( pixel[i], i );
+      }
+    m_Container->SetPixel( offset, codes );
+    }
+
+  /** Store a single narrowed component given its key, i.e.
+   *  VectorLength * offset + component. */
+  void SetElement(ElementIdentifier key, const Element & value)
+    {
+    const VectorLengthType component =
+      static_cast< VectorLengthType >( key % m_Container->GetVectorLength() );
+    m_Container->SetElement( key, m_Codec.Encode( value, component ) );
+    }
+
+  /** Call visitor( key, value ) for every stored component, with the
+   *  widened value. */
+  template< class TVisitor >
+  void VisitElements(TVisitor & visitor) const
+    {
+    DecodingVisitor< TVisitor > decoder( m_Codec, m_Container->GetVectorLength(), visitor );
+    m_Container->VisitElements( decoder );
+    }
+
+  /** Forwarded to the wrapped container. */
+  void Reserve(SizeValueType size)
+    { m_Container->Reserve( size ); }
+  void Squeeze(void)
+    { m_Container->Squeeze(); }
+  void Clear(void)
+    { m_Container->Clear(); }
+  void Initialize(void)
+    { m_Container->Initialize(); }
+
+  /** Forwarded to the wrapped container, when it supports freezing. */
+  void Freeze(void)
+    { m_Container->Freeze(); }
+  void Thaw(void)
+    { m_Container->Thaw(); }
+  bool IsFrozen(void) const
+    { return m_Container->IsFrozen(); }
+
+  /** See SparseVectorImageContainer::SetContainerManageMemory(). */
+  void SetContainerManageMemory(bool manage)
+    { m_Container->SetContainerManageMemory( manage ); }
+  bool GetContainerManageMemory()
+    { return m_Container->GetContainerManageMemory(); }
+
+protected:
+  SparseVectorImageCodecContainer()
+    {
+    m_Container = ContainerType::New();
+    this->SetVectorLength( m_Container->GetVectorLength() );
+    }
+  virtual ~SparseVectorImageCodecContainer() {}
+
+  void PrintSelf(std::ostream& os, Indent indent) const
+    {
+    Superclass::PrintSelf(os,indent);
+    os << indent << "Codec: " << CodecType::GetName() << std::endl;
+    os << indent << "Codec parameters: " << m_Codec.GetParameters() << std::endl;
+    os << indent << "Container: " << std::endl;
+    m_Container->Print( os, indent.GetNextIndent() );
+    }
+
+  /** Pixels up to this length are converted in a buffer on the stack. */
+  itkStaticConstMacro(StackLength, unsigned int, 64);
+
+  /** Visitor widening the values of the wrapped container. */
+  template< class TVisitor >
+  struct DecodingVisitor
+    {
+    DecodingVisitor( const CodecType & codec, VectorLengthType length,
+                     TVisitor & visitor )
+      : m_Codec( codec ), m_Length( length ), m_Visitor( visitor ) {}
+
+    void operator()( ElementIdentifier key, const StorageType & code )
+      {
+      m_Visitor( key, m_Codec.Decode( code, static_cast< VectorLengthType >( key % m_Length ) ) );
+      }
+
+    const CodecType & m_Codec;
+    ElementIdentifier m_Length;
+    TVisitor &        m_Visitor;
+    };
+
+private:
+  SparseVectorImageCodecContainer(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  ContainerPointer            m_Container;
+  CodecType                   m_Codec;
+  std::vector< StorageType >  m_ZeroCodes;
+};
+
+
+/** Write the codec of a container to the header of a .spr file. Images
+ *  whose container has no codec write nothing. */
+template <typename TContainer>
+void
+WriteSparseVectorImageValueCodec(std::ostream &, const TContainer *)
+{
+}
+
+template <typename TContainer, typename TCodec>
+void
+WriteSparseVectorImageValueCodec(std::ostream & os,
+  const SparseVectorImageCodecContainer< TContainer, TCodec > *container)
+{
+  os << "ValueCodec = " << TCodec::GetName() << std::endl;
+  os << "ValueCodecParameters = " << container->GetCodec().GetParameters() << std::endl;
+}
+
+/** Set the parameters of the codec of a container from the header of a
+ *  .spr file, if the file was written with the same codec. */
+template <typename TContainer>
+void
+ReadSparseVectorImageValueCodec(TContainer *, const std::string &, const std::string &)
+{
+}
+
+template <typename TContainer, typename TCodec>
+void
+ReadSparseVectorImageValueCodec(SparseVectorImageCodecContainer< TContainer, TCodec > *container,
+                                const std::string & codec, const std::string & parameters)
+{
+  if ( codec == TCodec::GetName() )
+    {
+    container->GetCodec().SetParameters( parameters );
+    }
+}
+
+} // end namespace itk
+
+#endif
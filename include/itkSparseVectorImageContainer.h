@@ -16,7 +16,10 @@
 
 #include "itkObject.h"
 #include "itkObjectFactory.h"
+#include <algorithm>
+#include <cmath>
 #include <utility>
+#include <vector>
 #include <tr1/unordered_map>
 
 namespace itk
@@ -25,11 +28,39 @@ namespace itk
 /** \class SparseVectorImageContainer
  *  \brief An image container for itk::SparseVectorImage.
  *
+ *  Each non-zero component of a pixel is stored as a separate entry of a
+ *  hash table, keyed by VectorLength * offset + component. The hash table
+ *  is a std::tr1::unordered_map by default; SparseVectorImageFlatHashMap
+ *  avoids the allocation of one node per entry, and
+ *  SparseVectorImagePoolMap takes the nodes from a slab pool owned by
+ *  the map, which makes bulk loads and Clear() much cheaper.
+ *
+ *  This class also defines the interface that every container usable
+ *  as the TPixelContainer argument of itk::SparseVectorImage provides:
+ *  SetVectorLength(), GetPixel() and SetPixel() operate on whole pixels
+ *  given their offset, SetElement() and VisitElements() operate on
+ *  (key, value) pairs using the component keys of the .spr file format,
+ *  and Clear() removes all the stored pixels. SetImageSize() passes the
+ *  size of the image to containers whose layout depends on it.
+ *
+ *  GetPixel() is the read path of SparseVectorImage, its pixel accessor
+ *  and its neighborhood accessor functor. It is const in every container:
+ *  it performs a single lookup per stored entry (per component here, per
+ *  voxel in the voxel-keyed containers) and never inserts into or
+ *  otherwise modifies the container. Any number of threads may therefore
+ *  read the same image concurrently, e.g. interpolators in a
+ *  multithreaded filter, as long as no thread writes to it.
+ *  SparseVectorImageShardedContainer also supports concurrent writes.
+ *
+ *  \sa SparseVectorImageVoxelContainer, SparseVectorImageFlatHashMap,
+ *  SparseVectorImagePoolAllocator
+ *
  *  \ingroup ITKSparseVectorImage
  *
  */
 
-template <typename TElementIdentifier, typename TElement>
+template <typename TElementIdentifier, typename TElement,
+          typename TPixelMap = std::tr1::unordered_map< TElementIdentifier, TElement > >
 class SparseVectorImageContainer:  public Object
 {
 public:
@@ -43,7 +74,9 @@ public:
   typedef TElementIdentifier  ElementIdentifier;
   typedef TElement            Element;
 //  typedef std::map< ElementIdentifier, Element > PixelMapType;
-  typedef std::tr1::unordered_map< ElementIdentifier, Element > PixelMapType;
+  typedef TPixelMap           PixelMapType;
+
+  typedef unsigned int VectorLengthType;
 
   /** Method for creation through the object factory. */
   itkNewMacro(Self);
@@ -57,16 +90,142 @@ public:
 
   /** Get the number of elements currently stored in the container. */
   unsigned long Size(void) const
-    { return (unsigned long) m_PixelMap.size(); };
+    { return (unsigned long) ( m_Frozen ? m_FrozenKeys.size() : m_PixelMap.size() ); };
+
+  /** Set/Get the number of components of each pixel. */
+  itkSetMacro(VectorLength, VectorLengthType);
+  itkGetConstMacro(VectorLength, VectorLengthType);
+
+  /** The layout of this container does not depend on the image size.
+   *  This method does nothing. */
+  void SetImageSize(unsigned int, const SizeValueType *) {}
+
+  /** Copy the components of the pixel at the given offset into pixel.
+   *  Components that are not stored take the value of the corresponding
+   *  component of fillValue. Return true if at least one component
+   *  of the pixel is stored. */
+  bool GetPixel(ElementIdentifier offset, const Element *fillValue,
+                Element *pixel) const
+    {
+    const ElementIdentifier first = m_VectorLength * offset;
+
+    if ( m_Frozen )
+      {
+      return this->GetFrozenPixel( first, fillValue, pixel );
+      }
+
+    bool found = false;
+
+    for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
+      {
+      typename PixelMapType::const_iterator it = m_PixelMap.find( first + i );
+
+      if ( it == m_PixelMap.end() )
+        {
+        pixel[i] = fillValue[i];
+        }
+      else
+        {
+        pixel[i] = it->second;
+        found = true;
+        }
+      }
+
+    return found;
+    }
+
+  /** Store the non-zero components of the pixel at the given offset.
+   *  The stored components that become zero are erased. */
+  void SetPixel(ElementIdentifier offset, const Element *pixel)
+    {
+    if ( m_Frozen )
+      {
+      itkExceptionMacro( << "Cannot write to a frozen container, call Thaw() first" );
+      }
+
+    const ElementIdentifier first = m_VectorLength * offset;
+
+    for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
+      {
+      if ( pixel[i] != 0 )
+        {
+        m_PixelMap[first + i] = pixel[i];
+        }
+      else if ( !m_PixelMap.empty() )
+        {
+        m_PixelMap.erase( first + i );
+        }
+      }
+    }
 
-  /** Sparse image containers can not reserve memory in advance.
-   *  This method does nothing.
-   */
-  void Reserve(void);
+  /** Store a single component given its key, i.e.
+   *  VectorLength * offset + component. */
+  void SetElement(ElementIdentifier key, const Element & value)
+    {
+    if ( m_Frozen )
+      {
+      itkExceptionMacro( << "Cannot write to a frozen container, call Thaw() first" );
+      }
+    m_PixelMap[key] = value;
+    }
 
-  /** Sparse image containers can not squeeze memory.
-   *  This method does nothing.
-   */
+  /** Call visitor( key, value ) for every stored component. */
+  template< class TVisitor >
+  void VisitElements(TVisitor & visitor) const
+    {
+    if ( m_Frozen )
+      {
+      for ( SizeValueType n = 0; n < m_FrozenKeys.size(); n++ )
+        {
+        visitor( m_FrozenKeys[n], m_FrozenValues[n] );
+        }
+      return;
+      }
+
+    for ( typename PixelMapType::const_iterator it = m_PixelMap.begin();
+          it != m_PixelMap.end(); ++it )
+      {
+      visitor( it->first, it->second );
+      }
+    }
+
+  /** Remove all the stored pixels. This also thaws a frozen container. */
+  void Clear(void);
+
+  /** Compact the pixel map into two arrays of keys and values sorted by
+   *  key, and release the map. A frozen container is read-only: pixels
+   *  are found by binary search, with a single search per pixel, and
+   *  writing throws an exception until Thaw() is called. */
+  void Freeze(void);
+
+  /** Rebuild the pixel map from the sorted arrays of a frozen container. */
+  void Thaw(void);
+
+  /** Return true if the container is frozen. */
+  bool IsFrozen(void) const
+    { return m_Frozen; }
+
+  /** Remove the stored components whose magnitude is at most threshold,
+   *  e.g. values that became zero through SetElement() or were stored
+   *  before the image had a zero threshold. The sorted arrays of a frozen
+   *  container are scanned in parallel and compacted; the pixel map is
+   *  scanned by the calling thread, since its buckets cannot be split
+   *  between threads. Return the number of bytes released, estimated
+   *  from the size of the entries for the pixel map. */
+  SizeValueType Prune(double threshold = 0.0);
+
+  /** Replace the pixels of this container by a copy of the pixels of
+   *  source. The sorted arrays of a frozen source are copied in parallel
+   *  and the copy is frozen as well; the entries of a pixel map are
+   *  inserted by the calling thread, into a map with its own allocator. */
+  void DeepCopy(const Self *source);
+
+  /** Presize the pixel map for the given number of stored elements, so
+   *  that inserting them does not rehash the map. */
+  void Reserve(SizeValueType size);
+
+  /** Shrink the pixel map to the smallest size allowed by its maximum
+   *  load factor for the current number of elements. */
   void Squeeze(void);
 
   /** Tell the container to release any of its allocated memory. */
@@ -94,13 +253,61 @@ protected:
    * call this method but should call Print() instead. */
   void PrintSelf(std::ostream& os, Indent indent) const;
 
+  /** GetPixel() on a frozen container: the components of a pixel have
+   *  consecutive keys, hence they are found after a single binary search. */
+  bool GetFrozenPixel(ElementIdentifier first, const Element *fillValue,
+                      Element *pixel) const
+    {
+    typename std::vector< ElementIdentifier >::const_iterator it =
+      std::lower_bound( m_FrozenKeys.begin(), m_FrozenKeys.end(), first );
+    SizeValueType n = it - m_FrozenKeys.begin();
+    bool found = false;
+
+    for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
+      {
+      if ( n < m_FrozenKeys.size() && m_FrozenKeys[n] == first + i )
+        {
+        pixel[i] = m_FrozenValues[n++];
+        found = true;
+        }
+      else
+        {
+        pixel[i] = fillValue[i];
+        }
+      }
+
+    return found;
+    }
+
+  /** Flag the entries of the sorted arrays to remove, see Prune(). */
+  struct FrozenPruneFunctor
+    {
+    void operator()( SizeValueType begin, SizeValueType end )
+      {
+      for ( SizeValueType n = begin; n < end; n++ )
+        {
+        m_Removed[n] = std::fabs( static_cast< double >( m_Values[n] ) ) <= m_Threshold;
+        }
+      }
+
+    const Element *  m_Values;
+    unsigned char *  m_Removed;
+    double           m_Threshold;
+    };
+
 private:
   SparseVectorImageContainer(const Self&); //purposely not implemented
   void operator=(const Self&); //purposely not implemented
 
   PixelMapType         m_PixelMap;
+  VectorLengthType     m_VectorLength;
   bool                 m_ContainerManageMemory;
 
+  /** Sorted keys and values of a frozen container. */
+  bool                               m_Frozen;
+  std::vector< ElementIdentifier >   m_FrozenKeys;
+  std::vector< Element >             m_FrozenValues;
+
 };
 
 } // end namespace itk
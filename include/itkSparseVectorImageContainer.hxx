@@ -15,25 +15,29 @@
 #define _itkSparseVectorImageContainer_hxx
 
 #include "itkSparseVectorImageContainer.h"
+#include "itkSparseVectorImageParallelFor.h"
+#include <cmath>
 
 namespace itk
 {
 
-template <typename TElementIdentifier, typename TElement>
-SparseVectorImageContainer<TElementIdentifier , TElement>
+template <typename TElementIdentifier, typename TElement, typename TPixelMap>
+SparseVectorImageContainer< TElementIdentifier , TElement , TPixelMap >
 ::SparseVectorImageContainer()
 {
+  m_VectorLength = 1;
   m_ContainerManageMemory = true;
+  m_Frozen = false;
 }
 
 
-template <typename TElementIdentifier, typename TElement>
-SparseVectorImageContainer< TElementIdentifier , TElement >
+template <typename TElementIdentifier, typename TElement, typename TPixelMap>
+SparseVectorImageContainer< TElementIdentifier , TElement , TPixelMap >
 ::~SparseVectorImageContainer()
 {
   if( m_ContainerManageMemory )
     {
-    m_PixelMap.clear();
+    this->Clear();
     }
 }
 
@@ -42,12 +46,17 @@ SparseVectorImageContainer< TElementIdentifier , TElement >
  * Tell the container to allocate enough memory to allow at least
  * as many elements as the size given to be stored.
  */
-template <typename TElementIdentifier, typename TElement>
+template <typename TElementIdentifier, typename TElement, typename TPixelMap>
 void
-SparseVectorImageContainer< TElementIdentifier , TElement >
-::Reserve(void)
+SparseVectorImageContainer< TElementIdentifier , TElement , TPixelMap >
+::Reserve(SizeValueType size)
 {
-  // Nothing to do, a map can not reserve elements
+  if ( m_Frozen || size <= m_PixelMap.size() )
+    {
+    return;
+    }
+  m_PixelMap.rehash( static_cast< SizeValueType >(
+    std::ceil( size / m_PixelMap.max_load_factor() ) ) );
 }
 
 
@@ -55,28 +64,228 @@ SparseVectorImageContainer< TElementIdentifier , TElement >
  * Tell the container to try to minimize its memory usage for storage of
  * the current number of elements.
  */
-template <typename TElementIdentifier, typename TElement>
+template <typename TElementIdentifier, typename TElement, typename TPixelMap>
 void
-SparseVectorImageContainer< TElementIdentifier , TElement >
+SparseVectorImageContainer< TElementIdentifier , TElement , TPixelMap >
 ::Squeeze(void)
 {
-  // Nothing to do, a map can not be squeezed
+  if ( m_Frozen )
+    {
+    return;
+    }
+  // Rehashing to zero buckets gives the smallest table holding the
+  // current elements
+  m_PixelMap.rehash( 0 );
+}
+
+
+/**
+ * Remove the components whose magnitude is at most the threshold.
+ */
+template <typename TElementIdentifier, typename TElement, typename TPixelMap>
+SizeValueType
+SparseVectorImageContainer< TElementIdentifier , TElement , TPixelMap >
+::Prune(double threshold)
+{
+  if ( m_Frozen )
+    {
+    const SizeValueType size = m_FrozenKeys.size();
+    if ( size == 0 )
+      {
+      return 0;
+      }
+
+    std::vector< unsigned char > removed( size );
+    FrozenPruneFunctor functor;
+    functor.m_Values = &m_FrozenValues[0];
+    functor.m_Removed = &removed[0];
+    functor.m_Threshold = threshold;
+    SparseVectorImageParallelFor< FrozenPruneFunctor >::Run( size, functor );
+
+    SizeValueType kept = 0;
+    for ( SizeValueType n = 0; n < size; n++ )
+      {
+      if ( !removed[n] )
+        {
+        m_FrozenKeys[kept] = m_FrozenKeys[n];
+        m_FrozenValues[kept] = m_FrozenValues[n];
+        kept++;
+        }
+      }
+    if ( kept == size )
+      {
+      return 0;
+      }
+
+    const SizeValueType capacity = m_FrozenKeys.capacity() * sizeof( ElementIdentifier )
+      + m_FrozenValues.capacity() * sizeof( Element );
+    m_FrozenKeys.resize( kept );
+    m_FrozenValues.resize( kept );
+    std::vector< ElementIdentifier >( m_FrozenKeys ).swap( m_FrozenKeys );
+    std::vector< Element >( m_FrozenValues ).swap( m_FrozenValues );
+
+    this->Modified();
+    return capacity - m_FrozenKeys.capacity() * sizeof( ElementIdentifier )
+      - m_FrozenValues.capacity() * sizeof( Element );
+    }
+
+  std::vector< ElementIdentifier > keys;
+  for ( typename PixelMapType::const_iterator it = m_PixelMap.begin();
+        it != m_PixelMap.end(); ++it )
+    {
+    if ( std::fabs( static_cast< double >( it->second ) ) <= threshold )
+      {
+      keys.push_back( it->first );
+      }
+    }
+  if ( keys.empty() )
+    {
+    return 0;
+    }
+
+  for ( SizeValueType n = 0; n < keys.size(); n++ )
+    {
+    m_PixelMap.erase( keys[n] );
+    }
+
+  this->Modified();
+  return keys.size() * ( sizeof( typename PixelMapType::value_type ) + sizeof( void * ) );
+}
+
+
+/**
+ * Copy the pixels of another container.
+ */
+template <typename TElementIdentifier, typename TElement, typename TPixelMap>
+void
+SparseVectorImageContainer< TElementIdentifier , TElement , TPixelMap >
+::DeepCopy(const Self *source)
+{
+  if ( source == this )
+    {
+    return;
+    }
+
+  this->Clear();
+  m_VectorLength = source->m_VectorLength;
+
+  if ( source->m_Frozen )
+    {
+    PixelMapType().swap( m_PixelMap );
+    SparseVectorImageParallelCopy( source->m_FrozenKeys, m_FrozenKeys );
+    SparseVectorImageParallelCopy( source->m_FrozenValues, m_FrozenValues );
+    m_Frozen = true;
+    }
+  else
+    {
+    // Inserting the elements rather than assigning the map, so that the
+    // copy does not share the pool of a SparseVectorImagePoolAllocator
+    this->Reserve( source->m_PixelMap.size() );
+    for ( typename PixelMapType::const_iterator it = source->m_PixelMap.begin();
+          it != source->m_PixelMap.end(); ++it )
+      {
+      m_PixelMap.insert( std::make_pair( it->first, it->second ) );
+      }
+    }
+
+  this->Modified();
+}
+
+
+/**
+ * Remove all the stored pixels.
+ */
+template <typename TElementIdentifier, typename TElement, typename TPixelMap>
+void
+SparseVectorImageContainer< TElementIdentifier , TElement , TPixelMap >
+::Clear(void)
+{
+  m_PixelMap.clear();
+  if ( m_Frozen )
+    {
+    std::vector< ElementIdentifier >().swap( m_FrozenKeys );
+    std::vector< Element >().swap( m_FrozenValues );
+    m_Frozen = false;
+    }
+}
+
+
+/**
+ * Compact the pixel map into sorted arrays.
+ */
+template <typename TElementIdentifier, typename TElement, typename TPixelMap>
+void
+SparseVectorImageContainer< TElementIdentifier , TElement , TPixelMap >
+::Freeze(void)
+{
+  if ( m_Frozen )
+    {
+    return;
+    }
+
+  typedef std::pair< ElementIdentifier, Element > ElementType;
+  std::vector< ElementType > elements;
+  elements.reserve( m_PixelMap.size() );
+  for ( typename PixelMapType::const_iterator it = m_PixelMap.begin();
+        it != m_PixelMap.end(); ++it )
+    {
+    elements.push_back( ElementType( it->first, it->second ) );
+    }
+  PixelMapType().swap( m_PixelMap );
+
+  std::sort( elements.begin(), elements.end() );
+
+  m_FrozenKeys.resize( elements.size() );
+  m_FrozenValues.resize( elements.size() );
+  for ( SizeValueType n = 0; n < elements.size(); n++ )
+    {
+    m_FrozenKeys[n] = elements[n].first;
+    m_FrozenValues[n] = elements[n].second;
+    }
+
+  m_Frozen = true;
+  this->Modified();
+}
+
+
+/**
+ * Rebuild the pixel map from the sorted arrays.
+ */
+template <typename TElementIdentifier, typename TElement, typename TPixelMap>
+void
+SparseVectorImageContainer< TElementIdentifier , TElement , TPixelMap >
+::Thaw(void)
+{
+  if ( !m_Frozen )
+    {
+    return;
+    }
+
+  m_Frozen = false;
+  for ( SizeValueType n = 0; n < m_FrozenKeys.size(); n++ )
+    {
+    m_PixelMap[ m_FrozenKeys[n] ] = m_FrozenValues[n];
+    }
+  std::vector< ElementIdentifier >().swap( m_FrozenKeys );
+  std::vector< Element >().swap( m_FrozenValues );
+
+  this->Modified();
 }
 
 
 /**
  * Tell the container to release any of its allocated memory.
  */
-template <typename TElementIdentifier, typename TElement>
+template <typename TElementIdentifier, typename TElement, typename TPixelMap>
 void
-SparseVectorImageContainer< TElementIdentifier , TElement >
+SparseVectorImageContainer< TElementIdentifier , TElement , TPixelMap >
 ::Initialize(void)
 {
-  if ( m_PixelMap.size() > 0 )
+  if ( this->Size() > 0 )
     {
     if( m_ContainerManageMemory )
       {
-      m_PixelMap.clear();
+      this->Clear();
       }
     m_ContainerManageMemory = true;
     this->Modified();
@@ -84,13 +293,16 @@ SparseVectorImageContainer< TElementIdentifier , TElement >
 }
 
 
-template <typename TElementIdentifier, typename TElement>
+template <typename TElementIdentifier, typename TElement, typename TPixelMap>
 void
-SparseVectorImageContainer< TElementIdentifier , TElement >
+SparseVectorImageContainer< TElementIdentifier , TElement , TPixelMap >
 ::PrintSelf(std::ostream& os, Indent indent) const
 {
   Superclass::PrintSelf(os,indent);
 
+  os << indent << "VectorLength: " << m_VectorLength << std::endl;
+  os << indent << "Number of stored elements: " << this->Size() << std::endl;
+  os << indent << "Frozen: " << (m_Frozen ? "true" : "false") << std::endl;
   os << indent << "Container manages memory: "
      << (m_ContainerManageMemory ? "true" : "false") << std::endl;
 }
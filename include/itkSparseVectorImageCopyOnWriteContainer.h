@@ -0,0 +1,309 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Copy On Write Container
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef __itkSparseVectorImageCopyOnWriteContainer_h
+#define __itkSparseVectorImageCopyOnWriteContainer_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkNumericTraits.h"
+#include <algorithm>
+#include <vector>
+#include <tr1/unordered_set>
+
+namespace itk
+{
+
+/** \class SparseVectorImageCopyOnWriteContainer
+ *  \brief Share the pixels of another container and keep the pixels
+ *  written since in a private container.
+ *
+ *  SparseVectorImage::Graft() shares the container of an image, so that
+ *  both images see each other's writes, and DeepCopy() duplicates all
+ *  the pixels. This container sits in between: SetBase() gives it a
+ *  container to share, held by a reference counted pointer and only
+ *  read, and the pixels written afterwards go to a delta container of
+ *  the same type. A filter can then branch off a large input and modify
+ *  a few voxels at the cost of these voxels only:
+ *
+ *  \code
+ *  typedef itk::SparseVectorImageContainer< unsigned long, float > BaseContainerType;
+ *  typedef itk::SparseVectorImage< float, 3, BaseContainerType > InputImageType;
+ *  typedef itk::SparseVectorImage< float, 3,
+ *    itk::SparseVectorImageCopyOnWriteContainer< BaseContainerType > > OutputImageType;
+ *
+ *  output->CopyInformation( input );
+ *  output->SetRegions( input->GetLargestPossibleRegion() );
+ *  output->SetVectorLength( input->GetVectorLength() );
+ *  output->Allocate();
+ *  output->GetPixelContainer()->SetBase( input->GetPixelContainer() );
+ *  \endcode
+ *
+ *  Copying is done per voxel: the first write to a voxel shadows all its
+ *  components in the base, and SetElement() first copies the components
+ *  of the voxel from the base. The base must not be modified while it is
+ *  shared, e.g. it can be frozen.
+ *
+ *  DeepCopy() of this container shares the base as well and copies the
+ *  delta only, so that several branches of the same input stay cheap.
+ *
+ *  \sa SparseVectorImage::DeepCopy()
+ *
+ *  \ingroup ITKSparseVectorImage
+ *
+ */
+
+template <typename TContainer>
+class SparseVectorImageCopyOnWriteContainer:  public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef SparseVectorImageCopyOnWriteContainer  Self;
+  typedef Object                                 Superclass;
+  typedef SmartPointer<Self>                     Pointer;
+  typedef SmartPointer<const Self>               ConstPointer;
+
+  /** Save the template parameters. */
+  typedef TContainer                                ContainerType;
+  typedef typename ContainerType::Pointer           ContainerPointer;
+  typedef typename ContainerType::ConstPointer      ContainerConstPointer;
+  typedef typename ContainerType::ElementIdentifier ElementIdentifier;
+  typedef typename ContainerType::Element           Element;
+
+  /** Offsets of the voxels written since the base was set. */
+  typedef std::tr1::unordered_set< ElementIdentifier > WrittenSetType;
+
+  typedef unsigned int VectorLengthType;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Standard part of every itk Object. */
+  itkTypeMacro(SparseVectorImageCopyOnWriteContainer, Object);
+
+  /** Share the pixels of base, which must have the vector length of
+   *  this container. The pixels written so far are discarded. */
+  void SetBase(const ContainerType *base)
+    {
+    m_Delta->Clear();
+    m_Written.clear();
+    m_Base = base;
+    if ( base )
+      {
+      m_Delta->SetVectorLength( base->GetVectorLength() );
+      }
+    this->Modified();
+    }
+  const ContainerType * GetBase() const
+    { return m_Base.GetPointer(); }
+
+  /** Get the container holding the pixels written since the base was
+   *  set. */
+  ContainerType * GetDelta()
+    { return m_Delta.GetPointer(); }
+  const ContainerType * GetDelta() const
+    { return m_Delta.GetPointer(); }
+
+  /** Get the number of voxels written since the base was set. */
+  SizeValueType GetNumberOfWrittenVoxels(void) const
+    { return static_cast< SizeValueType >( m_Written.size() ); }
+
+  /** Get the number of elements stored in the base and in the delta.
+   *  The elements of the base shadowed by written voxels are counted. */
+  unsigned long Size(void) const
+    { return ( m_Base ? m_Base->Size() : 0 ) + m_Delta->Size(); }
+
+  /** Set the number of components of each pixel. A shared base cannot
+   *  change its length. */
+  void SetVectorLength(VectorLengthType length)
+    {
+    if ( m_Base && length != m_Base->GetVectorLength() )
+      {
+      itkExceptionMacro( << "Cannot set the vector length to " << length
+                         << ", the base container has " << m_Base->GetVectorLength()
+                         << " components per pixel" );
+      }
+    m_Delta->SetVectorLength( length );
+    }
+  VectorLengthType GetVectorLength() const
+    { return m_Delta->GetVectorLength(); }
+
+  /** Forwarded to the delta container. */
+  void SetImageSize(unsigned int dimension, const SizeValueType *size)
+    { m_Delta->SetImageSize( dimension, size ); }
+
+  /** Copy the components of the pixel at the given offset into pixel,
+   *  from the delta if the voxel has been written and from the base
+   *  otherwise. Return true if the pixel is stored. */
+  bool GetPixel(ElementIdentifier offset, const Element *fillValue,
+                Element *pixel) const
+    {
+    if ( !m_Base || ( !m_Written.empty() && m_Written.find( offset ) != m_Written.end() ) )
+      {
+      return m_Delta->GetPixel( offset, fillValue, pixel );
+      }
+    return m_Base->GetPixel( offset, fillValue, pixel );
+    }
+
+  /** Store the pixel at the given offset in the delta, shadowing the
+   *  pixel of the base. */
+  void SetPixel(ElementIdentifier offset, const Element *pixel)
+    {
+    m_Delta->SetPixel( offset, pixel );
+    if ( m_Base )
+      {
+      m_Written.insert( offset );
+      }
+    }
+
+  /** Store a single component given its key, i.e.
+   *  VectorLength * offset + component. The other components of the
+   *  voxel are copied from the base the first time it is written. */
+  void SetElement(ElementIdentifier key, const Element & value)
+    {
+    const VectorLengthType length = m_Delta->GetVectorLength();
+    const ElementIdentifier offset = key / length;
+
+    if ( m_Base && m_Written.insert( offset ).second )
+      {
+      std::vector< Element > zero( length, NumericTraits< Element >::Zero );
+      std::vector< Element > pixel( length );
+      if ( m_Base->GetPixel( offset, &zero[0], &pixel[0] ) )
+        {
+        m_Delta->SetPixel( offset, &pixel[0] );
+        }
+      }
+    m_Delta->SetElement( key, value );
+    }
+
+  /** Call visitor( key, value ) for the stored components of the voxels
+   *  of the base which have not been written, then for the components
+   *  stored in the delta. */
+  template< class TVisitor >
+  void VisitElements(TVisitor & visitor) const
+    {
+    if ( m_Base )
+      {
+      ShadowingVisitor< TVisitor > shadowing( m_Written, m_Delta->GetVectorLength(), visitor );
+      m_Base->VisitElements( shadowing );
+      }
+    m_Delta->VisitElements( visitor );
+    }
+
+  /** Replace the pixels of this container by those of source, sharing
+   *  the base of source and copying its delta. */
+  void DeepCopy(const Self *source)
+    {
+    if ( source == this )
+      {
+      return;
+      }
+    m_Base = source->m_Base;
+    m_Delta->DeepCopy( source->m_Delta );
+    m_Written = source->m_Written;
+    this->Modified();
+    }
+
+  /** Forwarded to the delta container. */
+  void Reserve(SizeValueType size)
+    { m_Delta->Reserve( size ); }
+  void Squeeze(void)
+    {
+    m_Delta->Squeeze();
+    m_Written.rehash( 0 );
+    }
+
+  /** Release the base and remove the written pixels. */
+  void Clear(void)
+    {
+    m_Base = NULL;
+    m_Delta->Clear();
+    m_Written.clear();
+    }
+
+  /** Tell the container to release any of its allocated memory. */
+  void Initialize(void)
+    {
+    if ( this->Size() > 0 )
+      {
+      if( m_ContainerManageMemory )
+        {
+        this->Clear();
+        }
+      m_ContainerManageMemory = true;
+      this->Modified();
+      }
+    }
+
+  /** See SparseVectorImageContainer::SetContainerManageMemory(). */
+  itkSetMacro(ContainerManageMemory,bool);
+  itkGetMacro(ContainerManageMemory,bool);
+  itkBooleanMacro(ContainerManageMemory);
+
+protected:
+  SparseVectorImageCopyOnWriteContainer()
+    {
+    m_Delta = ContainerType::New();
+    m_ContainerManageMemory = true;
+    }
+  virtual ~SparseVectorImageCopyOnWriteContainer() {}
+
+  void PrintSelf(std::ostream& os, Indent indent) const
+    {
+    Superclass::PrintSelf(os,indent);
+    os << indent << "Number of written voxels: " << m_Written.size() << std::endl;
+    os << indent << "Base: " << std::endl;
+    if ( m_Base )
+      {
+      m_Base->Print( os, indent.GetNextIndent() );
+      }
+    os << indent << "Delta: " << std::endl;
+    m_Delta->Print( os, indent.GetNextIndent() );
+    os << indent << "Container manages memory: "
+       << (m_ContainerManageMemory ? "true" : "false") << std::endl;
+    }
+
+  /** Visitor skipping the components of the written voxels. */
+  template< class TVisitor >
+  struct ShadowingVisitor
+    {
+    ShadowingVisitor( const WrittenSetType & written, VectorLengthType length,
+                      TVisitor & visitor )
+      : m_Written( written ), m_Length( length ), m_Visitor( visitor ) {}
+
+    void operator()( ElementIdentifier key, const Element & value )
+      {
+      if ( m_Written.empty() || m_Written.find( key / m_Length ) == m_Written.end() )
+        {
+        m_Visitor( key, value );
+        }
+      }
+
+    const WrittenSetType & m_Written;
+    ElementIdentifier      m_Length;
+    TVisitor &             m_Visitor;
+    };
+
+private:
+  SparseVectorImageCopyOnWriteContainer(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  ContainerConstPointer  m_Base;
+  ContainerPointer       m_Delta;
+  WrittenSetType         m_Written;
+  bool                   m_ContainerManageMemory;
+};
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,212 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Encoded Container
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef __itkSparseVectorImageEncodedContainer_h
+#define __itkSparseVectorImageEncodedContainer_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkSparseVectorImageKeyEncoder.h"
+#include <vector>
+
+namespace itk
+{
+
+/** \class SparseVectorImageEncodedContainer
+ *  \brief Store the voxels of an image in another container under
+ *  encoded keys, e.g. along a Z-order curve.
+ *
+ *  SparseVectorImage and its iterators address voxels by raster offset,
+ *  as computed by ComputeOffset(). This container converts the offsets
+ *  with a key encoding policy, SparseVectorImageMortonKeyEncoder by
+ *  default, before passing them to the container given as template
+ *  argument, so that the ordered containers, e.g. frozen ones, keep
+ *  neighbouring voxels close to each other in every direction.
+ *
+ *  VisitElements() decodes the keys back to raster keys, so that the
+ *  .spr files written from an encoded image can be read into any image.
+ *
+ *  The wrapped container must address whole voxels by offset, as
+ *  SparseVectorImageContainer and SparseVectorImageVoxelContainer do.
+ *  The brick and tree containers compute their own spatial layout from
+ *  the raster offset and do not benefit from an encoding.
+ *
+ *  \code
+ *  typedef itk::SparseVectorImageEncodedContainer<
+ *    itk::SparseVectorImageContainer< unsigned long, float > > ContainerType;
+ *  typedef itk::SparseVectorImage< float, 3, ContainerType > ImageType;
+ *  \endcode
+ *
+ *  \sa SparseVectorImageMortonKeyEncoder
+ *
+ *  \ingroup ITKSparseVectorImage
+ *
+ */
+
+template <typename TContainer,
+          typename TKeyEncoder = SparseVectorImageMortonKeyEncoder >
+class SparseVectorImageEncodedContainer:  public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef SparseVectorImageEncodedContainer  Self;
+  typedef Object                             Superclass;
+  typedef SmartPointer<Self>                 Pointer;
+  typedef SmartPointer<const Self>           ConstPointer;
+
+  /** Save the template parameters. */
+  typedef TContainer                               ContainerType;
+  typedef typename ContainerType::Pointer          ContainerPointer;
+  typedef TKeyEncoder                              KeyEncoderType;
+  typedef typename ContainerType::ElementIdentifier ElementIdentifier;
+  typedef typename ContainerType::Element          Element;
+
+  typedef unsigned int VectorLengthType;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Standard part of every itk Object. */
+  itkTypeMacro(SparseVectorImageEncodedContainer, Object);
+
+  /** Get the container storing the voxels under encoded keys. */
+  ContainerType * GetContainer()
+    { return m_Container.GetPointer(); }
+  const ContainerType * GetContainer() const
+    { return m_Container.GetPointer(); }
+
+  /** Get the key encoder. */
+  const KeyEncoderType & GetKeyEncoder() const
+    { return m_KeyEncoder; }
+
+  /** Get the number of elements currently stored in the container. */
+  unsigned long Size(void) const
+    { return m_Container->Size(); }
+
+  /** Set the number of components of each pixel. */
+  void SetVectorLength(VectorLengthType length)
+    {
+    m_Container->SetVectorLength( length );
+    this->Modified();
+    }
+  VectorLengthType GetVectorLength() const
+    { return m_Container->GetVectorLength(); }
+
+  /** Set the size of the image, which defines the encoding. Changing the
+   *  size discards the stored pixels. */
+  void SetImageSize(unsigned int dimension, const SizeValueType *size);
+
+  /** Copy the components of the pixel at the given raster offset into
+   *  pixel. Return true if the pixel is stored. */
+  bool GetPixel(ElementIdentifier offset, const Element *fillValue,
+                Element *pixel) const
+    {
+    return m_Container->GetPixel( this->Encode( offset ), fillValue, pixel );
+    }
+
+  /** Store the pixel at the given raster offset. */
+  void SetPixel(ElementIdentifier offset, const Element *pixel)
+    {
+    m_Container->SetPixel( this->Encode( offset ), pixel );
+    }
+
+  /** Store a single component given its raster key, i.e.
+   *  VectorLength * offset + component. */
+  void SetElement(ElementIdentifier key, const Element & value)
+    {
+    const VectorLengthType length = m_Container->GetVectorLength();
+    m_Container->SetElement( length * this->Encode( key / length ) + key % length, value );
+    }
+
+  /** Call visitor( key, value ) for every stored component, with the
+   *  raster key of the component. */
+  template< class TVisitor >
+  void VisitElements(TVisitor & visitor) const
+    {
+    DecodingVisitor< TVisitor > decoder( m_KeyEncoder, m_Container->GetVectorLength(), visitor );
+    m_Container->VisitElements( decoder );
+    }
+
+  /** Forwarded to the wrapped container. */
+  void Reserve(SizeValueType size)
+    { m_Container->Reserve( size ); }
+  void Squeeze(void)
+    { m_Container->Squeeze(); }
+  SizeValueType Prune(double threshold = 0.0)
+    { return m_Container->Prune( threshold ); }
+  void Clear(void)
+    { m_Container->Clear(); }
+  void Initialize(void)
+    { m_Container->Initialize(); }
+
+  /** Forwarded to the wrapped container, when it supports freezing.
+   *  A frozen container is sorted by encoded key. */
+  void Freeze(void)
+    { m_Container->Freeze(); }
+  void Thaw(void)
+    { m_Container->Thaw(); }
+  bool IsFrozen(void) const
+    { return m_Container->IsFrozen(); }
+
+  /** See SparseVectorImageContainer::SetContainerManageMemory(). */
+  void SetContainerManageMemory(bool manage)
+    { m_Container->SetContainerManageMemory( manage ); }
+  bool GetContainerManageMemory()
+    { return m_Container->GetContainerManageMemory(); }
+
+protected:
+  SparseVectorImageEncodedContainer();
+  virtual ~SparseVectorImageEncodedContainer() {}
+
+  void PrintSelf(std::ostream& os, Indent indent) const;
+
+  ElementIdentifier Encode(ElementIdentifier offset) const
+    {
+    return static_cast< ElementIdentifier >( m_KeyEncoder.Encode( offset ) );
+    }
+
+  /** Visitor converting the encoded keys back to raster keys. */
+  template< class TVisitor >
+  struct DecodingVisitor
+    {
+    DecodingVisitor( const KeyEncoderType & encoder, VectorLengthType length,
+                     TVisitor & visitor )
+      : m_Encoder( encoder ), m_Length( length ), m_Visitor( visitor ) {}
+
+    void operator()( ElementIdentifier key, const Element & value )
+      {
+      m_Visitor( static_cast< ElementIdentifier >(
+        m_Length * m_Encoder.Decode( key / m_Length ) + key % m_Length ), value );
+      }
+
+    const KeyEncoderType & m_Encoder;
+    ElementIdentifier      m_Length;
+    TVisitor &             m_Visitor;
+    };
+
+private:
+  SparseVectorImageEncodedContainer(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  ContainerPointer             m_Container;
+  KeyEncoderType               m_KeyEncoder;
+  std::vector< SizeValueType > m_ImageSize;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkSparseVectorImageEncodedContainer.hxx"
+#endif
+
+#endif
@@ -0,0 +1,73 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Encoded Container
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef _itkSparseVectorImageEncodedContainer_hxx
+#define _itkSparseVectorImageEncodedContainer_hxx
+
+#include "itkSparseVectorImageEncodedContainer.h"
+#include <algorithm>
+
+namespace itk
+{
+
+template <typename TContainer, typename TKeyEncoder>
+SparseVectorImageEncodedContainer< TContainer, TKeyEncoder >
+::SparseVectorImageEncodedContainer()
+{
+  m_Container = ContainerType::New();
+}
+
+
+template <typename TContainer, typename TKeyEncoder>
+void
+SparseVectorImageEncodedContainer< TContainer, TKeyEncoder >
+::SetImageSize(unsigned int dimension, const SizeValueType *size)
+{
+  if ( m_ImageSize.size() == dimension
+       && std::equal( m_ImageSize.begin(), m_ImageSize.end(), size ) )
+    {
+    return;
+    }
+
+  // The encoded keys, multiplied by the vector length, must fit in an
+  // ElementIdentifier
+  unsigned int lengthBits = 0;
+  while ( ( static_cast< uint64_t >( 1 ) << lengthBits ) < m_Container->GetVectorLength() )
+    {
+    lengthBits++;
+    }
+
+  m_Container->Clear();
+  m_ImageSize.assign( size, size + dimension );
+  m_KeyEncoder.SetImageSize( dimension, size, 8 * sizeof( ElementIdentifier ) - lengthBits );
+  m_Container->SetImageSize( dimension, size );
+  this->Modified();
+}
+
+
+template <typename TContainer, typename TKeyEncoder>
+void
+SparseVectorImageEncodedContainer< TContainer, TKeyEncoder >
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+
+  os << indent << "Key encoding: " << ( m_KeyEncoder.IsRaster() ? "Raster" : KeyEncoderType::GetName() )
+     << std::endl;
+  os << indent << "Container: " << std::endl;
+  m_Container->Print( os, indent.GetNextIndent() );
+}
+
+} // end namespace itk
+
+#endif
@@ -57,6 +57,16 @@ public:
 /** \class SparseVectorImageFileReader
  * \brief Reads sparse image data from key and value files.
  *
+ * The key file is read with 32-bit keys if the KeyElementType field of
+ * the .spr header is MET_UINT, and with 64-bit keys otherwise, e.g. for
+ * the files written before the field existed.
+ *
+ * The keys and values of a single-file .spr, see
+ * SparseVectorImageFileWriter::SetSingleFile(), are read from the .spr
+ * file itself. If the pixel container of the output is a
+ * SparseVectorImageMappedContainer, the file is mapped instead of read,
+ * and the output only holds the pages of the file that are accessed.
+ *
  * \ingroup ITKSparseVectorImage 
  *
  */
@@ -88,8 +98,6 @@ public:
   typedef typename OutputImageType::InternalPixelType             OutputImageInternalPixelType;
   typedef typename OutputImageType::PixelContainer                OutputImagePixelContainerType;
   typedef typename OutputImageType::PixelContainer::Pointer       OutputImagePixelContainerPointerType;  
-  typedef typename OutputImageType::PixelContainer::PixelMapType  OutputImagePixelMapType;
-  typedef typename OutputImagePixelMapType::iterator              OutputImagePixelMapIteratorType;
   
   /** Specify the files to read. This is forwarded to the IO instance. */
   itkSetStringMacro(FileName);
@@ -118,18 +126,24 @@ protected:
     * will be thrown. */
 //  void TestFileExistanceAndReadability();
 
-  typedef Image<unsigned long, 1> KeyImageType;
   typedef Image<OutputImageInternalPixelType, 1> ValueImageType;
       
-  typename KeyImageType::Pointer m_KeyImage;
   typename ValueImageType::Pointer m_ValueImage;
 
-  typedef itk::ImageFileReader<KeyImageType> KeyImageFileReaderType;
   typedef itk::ImageFileReader<ValueImageType> ValueImageFileReaderType;
   
-  typename KeyImageFileReaderType::Pointer m_KeyImageFileReader;
   typename ValueImageFileReaderType::Pointer m_ValueImageFileReader;
 
+  /** Read the key file with keys of type TKey, and store the elements
+   *  given by the keys and m_ValueImage in the output. */
+  template< class TKey >
+  void ReadKeys(const std::string & keyFileName);
+
+  /** Read the keys, of type TKey, and values stored in a single-file
+   *  .spr at the given offsets, and store them in the output. */
+  template< class TKey >
+  void ReadLocalElements(uint64_t keyOffset, uint64_t valueOffset, SizeValueType numberOfElements);
+
   /** Does the real work. */
   virtual void GenerateData();
 
@@ -14,7 +14,14 @@
 #ifndef __itkSparseVectorImageFileReader_hxx
 #define __itkSparseVectorImageFileReader_hxx
 
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <vector>
 #include "itkSparseVectorImageFileReader.h"
+#include "itkSparseVectorImageCodecContainer.h"
+#include "itkSparseVectorImageMappedContainer.h"
+#include "itkByteSwapper.h"
 #include "itkImageRegionIterator.h"
 #include "itksys/SystemTools.hxx"
 
@@ -64,7 +71,6 @@ void SparseVectorImageFileReader<TOutputImage>
 
   std::string keyFileName;
   std::string valueFileName;
-  char tempLine[256];
   
   // Read Header
   std::ifstream infile;
@@ -89,6 +95,17 @@ void SparseVectorImageFileReader<TOutputImage>
 
   unsigned int ndims = 0;
   unsigned int numberOfComponentsPerPixel = 0;
+  bool shortKeys = false;
+  std::string valueCodec;
+  std::string valueCodecParameters;
+
+  // Fields of a single-file .spr
+  bool singleFile = false;
+  SizeValueType numberOfElements = 0;
+  unsigned int valueElementSize = sizeof( OutputImageInternalPixelType );
+  bool bigEndian = ByteSwapper<int>::SystemIsBigEndian();
+  uint64_t keyOffset = 0;
+  uint64_t valueOffset = 0;
   
   // This section should be rewritten to support generic image dimension
   char * pch;
@@ -96,9 +113,9 @@ void SparseVectorImageFileReader<TOutputImage>
   
   while (!infile.eof())
     {
-    if (infile.getline(tempLine, 256))
+    // The codec parameters can be longer than any fixed size buffer
+    if (std::getline(infile, line))
       {
-      line = std::string(tempLine);
 
       if (line.find("NDims") != std::string::npos)
         {
@@ -146,6 +163,52 @@ void SparseVectorImageFileReader<TOutputImage>
           }
         }
 
+      if (line.find("ValueCodecParameters") != std::string::npos)
+        {
+          valueCodecParameters = line.substr(line.find("=") + 1);
+        }
+      else if (line.find("ValueCodec") != std::string::npos)
+        {
+          extractedLine = line.substr(line.find("=") + 1);
+          pch = strtok(const_cast<char*>(extractedLine.c_str())," ");
+          if (pch != NULL)
+          {
+            valueCodec = pch;
+          }
+        }
+
+      if (line.find("KeyElementType") != std::string::npos)
+        {
+          extractedLine = line.substr(line.find("=") + 1);
+          pch = strtok(const_cast<char*>(extractedLine.c_str())," ");
+          shortKeys = ( pch != NULL && std::string(pch) == "MET_UINT" );
+        }
+
+      if (line.find("NumberOfElements") != std::string::npos)
+        {
+          std::istringstream(line.substr(line.find("=") + 1)) >> numberOfElements;
+        }
+
+      if (line.find("ValueElementSize") != std::string::npos)
+        {
+          std::istringstream(line.substr(line.find("=") + 1)) >> valueElementSize;
+        }
+
+      if (line.find("BinaryDataByteOrderMSB") != std::string::npos)
+        {
+          bigEndian = ( line.find("True") != std::string::npos );
+        }
+
+      if (line.find("KeyElementDataOffset") != std::string::npos)
+        {
+          std::istringstream(line.substr(line.find("=") + 1)) >> keyOffset;
+        }
+
+      if (line.find("ValueElementDataOffset") != std::string::npos)
+        {
+          std::istringstream(line.substr(line.find("=") + 1)) >> valueOffset;
+        }
+
       if (line.find("KeyElementDataFile") != std::string::npos)
         {
           extractedLine = line.substr(line.find("=") + 1);
@@ -159,7 +222,11 @@ void SparseVectorImageFileReader<TOutputImage>
           const size_t endStr = extractedLine.find_last_not_of(" \t");
           const size_t range = endStr - beginStr + 1;
           keyFileName = extractedLine.substr(beginStr, range);
-          if ( pathName != "" )
+          if ( keyFileName == "LOCAL" )
+            {
+            singleFile = true;
+            }
+          else if ( pathName != "" )
             {
             keyFileName = pathName + "/" + keyFileName;
             }
@@ -178,6 +245,11 @@ void SparseVectorImageFileReader<TOutputImage>
            const size_t endStr = extractedLine.find_last_not_of(" \t");
            const size_t range = endStr - beginStr + 1;
            valueFileName = extractedLine.substr(beginStr, range);
+           if ( valueFileName == "LOCAL" )
+             {
+             // The arrays of a single-file .spr follow the header
+             break;
+             }
            if ( pathName != "" )
              {
              valueFileName = pathName + "/" + valueFileName;
@@ -207,32 +279,88 @@ void SparseVectorImageFileReader<TOutputImage>
   output->Allocate();
 
   OutputImagePixelType outputPixel;
-  outputPixel.SetSize(numberOfComponentsPerPixel);
+  OutputImageType::PixelTraits::SetLength( outputPixel, numberOfComponentsPerPixel );
   outputPixel.Fill(0);
   
   output->FillBuffer(outputPixel);
 
-  OutputImagePixelContainerType * container = output->GetPixelContainer();
-  OutputImagePixelMapType * pixelMap = container->GetPixelMap();
-  
-  m_KeyImageFileReader = KeyImageFileReaderType::New();
+  // Use the codec parameters the values were stored with
+  ReadSparseVectorImageValueCodec( output->GetPixelContainer(), valueCodec, valueCodecParameters );
+
+  if ( singleFile )
+    {
+    const unsigned int keyWidth = shortKeys ? 32 : 64;
+    if ( bigEndian != ByteSwapper<int>::SystemIsBigEndian() )
+      {
+      itkExceptionMacro( << "The byte order of " << m_FileName << " is not that of this machine" );
+      }
+    if ( valueElementSize != sizeof( OutputImageInternalPixelType ) )
+      {
+      itkExceptionMacro( << "The values of " << m_FileName << " have " << valueElementSize
+                         << " bytes, the pixel components of the image have "
+                         << sizeof( OutputImageInternalPixelType ) );
+      }
+
+    m_ImageIO = 0;
+
+    // Map the file into a container which supports it, without copying
+    if ( MapSparseVectorImageFile( output->GetPixelContainer(), m_FileName, keyOffset, keyWidth,
+                                   valueOffset, numberOfElements ) )
+      {
+      return;
+      }
+
+    if ( shortKeys )
+      {
+      this->template ReadLocalElements<uint32_t>( keyOffset, valueOffset, numberOfElements );
+      }
+    else
+      {
+      this->template ReadLocalElements<uint64_t>( keyOffset, valueOffset, numberOfElements );
+      }
+    return;
+    }
+
   m_ValueImageFileReader = ValueImageFileReaderType::New();
-  
-  m_KeyImageFileReader->SetFileName(keyFileName);
   m_ValueImageFileReader->SetFileName(valueFileName);
-  
-  m_KeyImageFileReader->Update();
   m_ValueImageFileReader->Update();
-  
-  m_KeyImage = m_KeyImageFileReader->GetOutput();
   m_ValueImage = m_ValueImageFileReader->GetOutput();
   
   m_ImageIO = m_ValueImageFileReader->GetImageIO();
+
+  if ( shortKeys )
+    {
+    this->template ReadKeys<uint32_t>( keyFileName );
+    }
+  else
+    {
+    this->template ReadKeys<uint64_t>( keyFileName );
+    }
+}
+
+
+template <class TOutputImage>
+template <class TKey>
+void SparseVectorImageFileReader<TOutputImage>
+::ReadKeys(const std::string & keyFileName)
+{
+  typedef Image<TKey, 1> KeyImageType;
+  typedef itk::ImageFileReader<KeyImageType> KeyImageFileReaderType;
+
+  typename KeyImageFileReaderType::Pointer keyImageFileReader = KeyImageFileReaderType::New();
+  keyImageFileReader->SetFileName(keyFileName);
+  keyImageFileReader->Update();
+  typename KeyImageType::Pointer keyImage = keyImageFileReader->GetOutput();
+
+  OutputImagePixelContainerType * container = this->GetOutput()->GetPixelContainer();
+
+  // The number of stored elements is known from the key image
+  container->Reserve( keyImage->GetRequestedRegion().GetNumberOfPixels() );
   
   typedef ImageRegionIterator< KeyImageType > KeyImageIteratorType;
   typedef ImageRegionIterator< ValueImageType > ValueImageIteratorType;
   
-  KeyImageIteratorType keyImageIterator( m_KeyImage, m_KeyImage->GetRequestedRegion() );
+  KeyImageIteratorType keyImageIterator( keyImage, keyImage->GetRequestedRegion() );
   ValueImageIteratorType valueImageIterator( m_ValueImage, m_ValueImage->GetRequestedRegion() );
   
   keyImageIterator.GoToBegin();
@@ -241,7 +369,7 @@ void SparseVectorImageFileReader<TOutputImage>
   // Populate Data
   while ( !keyImageIterator.IsAtEnd() )
     {
-    pixelMap->operator[](keyImageIterator.Get()) = valueImageIterator.Get();
+    container->SetElement(keyImageIterator.Get(), valueImageIterator.Get());
     ++keyImageIterator;
     ++valueImageIterator;
     }
@@ -249,6 +377,46 @@ void SparseVectorImageFileReader<TOutputImage>
 }
 
 
+template <class TOutputImage>
+template <class TKey>
+void SparseVectorImageFileReader<TOutputImage>
+::ReadLocalElements(uint64_t keyOffset, uint64_t valueOffset, SizeValueType numberOfElements)
+{
+  std::ifstream keyFile( m_FileName.c_str(), std::ios::in | std::ios::binary );
+  std::ifstream valueFile( m_FileName.c_str(), std::ios::in | std::ios::binary );
+  keyFile.seekg( keyOffset );
+  valueFile.seekg( valueOffset );
+
+  OutputImagePixelContainerType * container = this->GetOutput()->GetPixelContainer();
+  container->Reserve( numberOfElements );
+
+  // Read the arrays in blocks
+  const SizeValueType blockSize = 1 << 16;
+  std::vector< TKey > keys;
+  std::vector< OutputImageInternalPixelType > values;
+
+  for ( SizeValueType begin = 0; begin < numberOfElements; begin += blockSize )
+    {
+    const SizeValueType count = std::min( blockSize, numberOfElements - begin );
+    keys.resize( count );
+    values.resize( count );
+    keyFile.read( reinterpret_cast< char * >( &keys[0] ), sizeof( TKey ) * count );
+    valueFile.read( reinterpret_cast< char * >( &values[0] ),
+                    sizeof( OutputImageInternalPixelType ) * count );
+    if ( !keyFile || !valueFile )
+      {
+      itkExceptionMacro( << "The file " << m_FileName << " is shorter than its "
+                         << numberOfElements << " elements" );
+      }
+
+    for ( SizeValueType n = 0; n < count; n++ )
+      {
+      container->SetElement( keys[n], values[n] );
+      }
+    }
+}
+
+
 } //namespace ITK
 
 #endif
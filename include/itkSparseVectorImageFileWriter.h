@@ -18,12 +18,38 @@
 #include "itkExceptionObject.h"
 #include "itkImage.h"
 #include "itkImageFileWriter.h"
+#include <utility>
+#include <vector>
 
 namespace itk
 {
 
 /** \class SparseVectorImageFileWriter
  * \brief Writes sparse vector image data to key and value files.
+ *
+ * The keys are written as 32-bit integers when the largest key of the
+ * image, VectorLength * NumberOfPixels - 1, fits in 32 bits, and as
+ * 64-bit integers otherwise. KeyWidth forces a width, and the width
+ * used is recorded by the KeyElementType field of the .spr header.
+ *
+ * With SingleFileOn(), the keys, sorted, and the values are written
+ * uncompressed after the header of the .spr file instead of in separate
+ * key and value files. The header then ends with the fields
+ *
+ * \code
+ * NumberOfElements = 1234
+ * ValueElementSize = 4
+ * BinaryDataByteOrderMSB = False
+ * KeyElementDataOffset = 00000000000000004096
+ * ValueElementDataOffset = 00000000000000008192
+ * KeyElementDataFile = LOCAL
+ * ValueElementDataFile = LOCAL
+ * \endcode
+ *
+ * giving the offsets in bytes of the key and value arrays from the
+ * beginning of the file, which are multiples of
+ * SparseVectorImageMappedFile::DataAlignment. The arrays can then be
+ * used in place by SparseVectorImageMappedContainer.
  *  
  *  \ingroup ITKSparseVectorImage
  *
@@ -54,8 +80,7 @@ public:
   typedef typename InputImageType::ValueType                     InputImageValueType;
   typedef typename InputImageType::PixelContainer                InputImagePixelContainerType;  
   typedef typename InputImageType::PixelContainer::Pointer       InputImagePixelContainerPointerType;  
-  typedef typename InputImageType::PixelContainer::PixelMapType  InputImagePixelMapType;
-  typedef typename InputImagePixelMapType::iterator              InputImagePixelMapIteratorType;
+  typedef typename InputImagePixelContainerType::ElementIdentifier InputImageElementIdentifierType;
   
   /** Set/Get the image input of this writer.  */
   using Superclass::SetInput;
@@ -83,6 +108,17 @@ public:
     this->Write();
     }
 
+  /** Set/Get the number of bits of the keys written, 32 or 64, or 0
+   *  (the default) to use 32 bits whenever the keys of the image fit. */
+  itkSetMacro(KeyWidth,unsigned int);
+  itkGetConstMacro(KeyWidth,unsigned int);
+
+  /** Set/Get whether the keys and values are written in the .spr file
+   *  itself, for SparseVectorImageMappedContainer. Off by default. */
+  itkSetMacro(SingleFile,bool);
+  itkGetConstMacro(SingleFile,bool);
+  itkBooleanMacro(SingleFile);
+
   /** Set the compression On or Off */
   itkSetMacro(UseCompression,bool);
   itkGetConstReferenceMacro(UseCompression,bool);
@@ -104,20 +140,65 @@ protected:
   ~SparseVectorImageFileWriter();
   void PrintSelf(std::ostream& os, Indent indent) const;
 
-  typedef unsigned long KeyType;
-  typedef Image<KeyType, 1> KeyImageType;
   typedef Image<InputImagePixelType, 1> ValueImageType;
-  typedef typename KeyImageType::Pointer KeyImagePointer;
   typedef typename ValueImageType::Pointer ValueImagePointer;
     
-  KeyImagePointer m_KeyImage;
   ValueImagePointer m_ValueImage;
 
-  typedef itk::ImageFileWriter<KeyImageType> KeyImageFileWriterType;
   typedef itk::ImageFileWriter<ValueImageType> ValueImageFileWriterType;
   
-  typename KeyImageFileWriterType::Pointer m_KeyImageFileWriter;
   typename ValueImageFileWriterType::Pointer m_ValueImageFileWriter;
+
+  /** Copy the keys and values of the input to a key image with keys of
+   *  type TKey and to m_ValueImage, and write the key file. */
+  template< class TKey >
+  void WriteKeys(const std::string & keyPathName, SizeValueType numberOfElements);
+
+  /** Write the fields of the .spr header describing the image. */
+  void WriteHeader(std::ostream & outfile, unsigned int keyWidth);
+
+  /** Write a single-file .spr with keys of type TKey. */
+  template< class TKey >
+  void WriteSingleFile(const std::string & headerPathName, SizeValueType numberOfElements);
+
+  /** Visitor counting the elements stored in the pixel container. */
+  struct ElementCounter
+    {
+    ElementCounter() : m_Count(0) {}
+    void operator()( InputImageElementIdentifierType, const InputImagePixelType & )
+      { ++m_Count; }
+    SizeValueType m_Count;
+    };
+
+  /** Visitor copying the elements stored in the pixel container to
+   *  the key and value buffers. */
+  template< class TKey >
+  struct ElementCopier
+    {
+    ElementCopier( TKey *keys, InputImagePixelType *values )
+      : m_Key(keys), m_Value(values) {}
+    void operator()( InputImageElementIdentifierType key, const InputImagePixelType & value )
+      {
+      *m_Key++ = static_cast<TKey>(key);
+      *m_Value++ = value;
+      }
+    TKey *m_Key;
+    InputImagePixelType *m_Value;
+    };
+
+  /** Visitor copying the elements stored in the pixel container to a
+   *  vector of (key, value) pairs. */
+  template< class TKey >
+  struct ElementCollector
+    {
+    ElementCollector( std::vector< std::pair< TKey, InputImagePixelType > > & elements )
+      : m_Elements(elements) {}
+    void operator()( InputImageElementIdentifierType key, const InputImagePixelType & value )
+      {
+      m_Elements.push_back( std::make_pair( static_cast<TKey>(key), value ) );
+      }
+    std::vector< std::pair< TKey, InputImagePixelType > > & m_Elements;
+    };
   
   /** Does the actual work. */
   void GenerateData(void);
@@ -130,6 +211,8 @@ private:
   std::string        m_FileName;
   
   bool m_UseCompression;
+  unsigned int m_KeyWidth;
+  bool m_SingleFile;
 //  bool m_UseInputMetaDataDictionary;        // whether to use the
                                             // MetaDataDictionary from the
                                             // input or not.  
@@ -14,8 +14,16 @@
 #ifndef __itkSparseVectorImageFileWriter_hxx
 #define __itkSparseVectorImageFileWriter_hxx
 
+#include <algorithm>
 #include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <utility>
+#include <vector>
 #include "itkSparseVectorImageFileWriter.h"
+#include "itkSparseVectorImageCodecContainer.h"
+#include "itkSparseVectorImageMappedFile.h"
+#include "itkByteSwapper.h"
 #include "itksys/SystemTools.hxx"
 
 namespace itk
@@ -28,6 +36,8 @@ SparseVectorImageFileWriter<TInputImage>
 {
   m_FileName = "";
   m_UseCompression = true;
+  m_KeyWidth = 0;
+  m_SingleFile = false;
 //  m_UseInputMetaDataDictionary = true;
 }
 
@@ -110,75 +120,31 @@ SparseVectorImageFileWriter<TInputImage>
 
   // Setup - Input Image
   InputImageType * input = const_cast<InputImageType*>(this->GetInput());
-  InputImagePixelContainerType * container = input->GetPixelContainer();
-  InputImagePixelMapType * pixelMap = container->GetPixelMap();
-  InputImagePixelMapIteratorType iterator = pixelMap->begin();
-//  InputImageSpacingType::SpacingType inputSpacing = input->GetSpacing();
-  
-  // Setup - Output Image
-  m_KeyImage = KeyImageType::New();
-  m_ValueImage = ValueImageType::New();
-    
-  KeyImageType::IndexType startIndex;
-  KeyImageType::RegionType region;
-  KeyImageType::SizeType size;
-  KeyImageType::SpacingType spacing;
-  
-  startIndex.Fill(0);
-  
-  if ( pixelMap->size() > 0 )
-    {
-    size[0] = pixelMap->size();
-    }
-  else
-    {
-    size[0] = 1; // Output at least one voxel.
-    }
-    
-  spacing.Fill(1);
-  
-  region.SetIndex(startIndex);
-  region.SetSize(size);
+  const InputImagePixelContainerType * container = input->GetPixelContainer();
 
-  m_KeyImage->SetSpacing(spacing);
-  m_KeyImage->SetRegions(region);
-  m_ValueImage->SetSpacing(spacing);
-  m_ValueImage->SetRegions(region);
+  ElementCounter counter;
+  container->VisitElements(counter);
+//  InputImageSpacingType::SpacingType inputSpacing = input->GetSpacing();
 
-  m_KeyImage->Allocate();
-  m_ValueImage->Allocate();
-  m_KeyImage->FillBuffer(static_cast<KeyType>(0));
-  m_ValueImage->FillBuffer(static_cast<InputImagePixelType>(0));
+  // Use 32-bit keys if the largest key fits
+  const uint64_t numberOfPixels = input->GetLargestPossibleRegion().GetNumberOfPixels();
+  const uint64_t numberOfKeys = numberOfPixels * input->GetNumberOfComponentsPerPixel();
+  const bool shortKeysFit = numberOfKeys <= static_cast<uint64_t>( NumericTraits<uint32_t>::max() ) + 1;
 
-  typedef itk::ImageRegionIterator< KeyImageType > KeyImageIteratorType;
-  typedef itk::ImageRegionIterator< ValueImageType > ValueImageIteratorType;
-  
-  KeyImageIteratorType keyImageIterator( m_KeyImage, m_KeyImage->GetRequestedRegion() );
-  ValueImageIteratorType valueImageIterator( m_ValueImage, m_ValueImage->GetRequestedRegion() );
-  
-  keyImageIterator.GoToBegin();
-  valueImageIterator.GoToBegin();
-
-  if ( pixelMap->size() > 0 )
+  unsigned int keyWidth = m_KeyWidth;
+  if ( keyWidth == 0 )
     {
-    // Populate Data
-    while ( iterator != pixelMap->end() )
-      {
-  //    std::cout << "first = " << iterator->first << std::endl;
-      keyImageIterator.Set(static_cast<KeyType>(iterator->first));
-  //    std::cout << "second = " << iterator->second << std::endl;
-      valueImageIterator.Set(iterator->second);
-      ++iterator;
-      ++keyImageIterator;
-      ++valueImageIterator;
-      }
+    keyWidth = shortKeysFit ? 32 : 64;
     }
-  else
+  else if ( keyWidth != 32 && keyWidth != 64 )
     {
-    keyImageIterator.Set(static_cast<KeyType>(0));
-    valueImageIterator.Set(0);
+    itkExceptionMacro(<< "Unsupported key width: " << keyWidth);
     }
-  
+  else if ( keyWidth == 32 && !shortKeysFit )
+    {
+    itkExceptionMacro(<< "The " << numberOfKeys << " keys of the image do not fit in 32 bits");
+    }
+
   // Process File Names
   std::string baseFileName = "";
   std::string fileNameExtension;
@@ -203,10 +169,6 @@ SparseVectorImageFileWriter<TInputImage>
   std::string keyFileName = baseFileName + "_key." + dataFileNameExtension;
   std::string valueFileName = baseFileName + "_value." + dataFileNameExtension;
   std::string headerFileName = baseFileName + "." + fileNameExtension;
-  
-  // Write Files
-  m_KeyImageFileWriter = KeyImageFileWriterType::New();
-  m_ValueImageFileWriter = ValueImageFileWriterType::New();
 
   std::string keyPathName = keyFileName;
   std::string valuePathName = valueFileName;
@@ -219,17 +181,66 @@ SparseVectorImageFileWriter<TInputImage>
     headerPathName = pathName + "/" + headerFileName;
     }
 
-  m_KeyImageFileWriter->SetFileName(keyPathName);
-  m_KeyImageFileWriter->SetInput(m_KeyImage);
+  if ( m_SingleFile )
+    {
+    if ( keyWidth == 32 )
+      {
+      this->template WriteSingleFile<uint32_t>( headerPathName, counter.m_Count );
+      }
+    else
+      {
+      this->template WriteSingleFile<uint64_t>( headerPathName, counter.m_Count );
+      }
+    return;
+    }
+
+  // Setup - Output Image
+  m_ValueImage = ValueImageType::New();
+    
+  typename ValueImageType::IndexType startIndex;
+  typename ValueImageType::RegionType region;
+  typename ValueImageType::SizeType size;
+  typename ValueImageType::SpacingType spacing;
+  
+  startIndex.Fill(0);
+  
+  if ( counter.m_Count > 0 )
+    {
+    size[0] = counter.m_Count;
+    }
+  else
+    {
+    size[0] = 1; // Output at least one voxel.
+    }
+    
+  spacing.Fill(1);
+  
+  region.SetIndex(startIndex);
+  region.SetSize(size);
+
+  m_ValueImage->SetSpacing(spacing);
+  m_ValueImage->SetRegions(region);
+  m_ValueImage->Allocate();
+  m_ValueImage->FillBuffer(static_cast<InputImagePixelType>(0));
+  
+  // Write Files
+  m_ValueImageFileWriter = ValueImageFileWriterType::New();
+
+  if ( keyWidth == 32 )
+    {
+    this->template WriteKeys<uint32_t>( keyPathName, counter.m_Count );
+    }
+  else
+    {
+    this->template WriteKeys<uint64_t>( keyPathName, counter.m_Count );
+    }
+
   m_ValueImageFileWriter->SetFileName(valuePathName);
   m_ValueImageFileWriter->SetInput(m_ValueImage);
 
-  m_KeyImageFileWriter->SetUseCompression(this->m_UseCompression);
   m_ValueImageFileWriter->SetUseCompression(this->m_UseCompression);
-//  m_KeyImageFileWriter->SetUseInputMetaDataDictionary(this->m_UseInputMetaDataDictionary);
 //  m_ValueImageFileWriter->SetUseInputMetaDataDictionary(this->m_UseInputMetaDataDictionary);  
   
-  m_KeyImageFileWriter->Update();
   m_ValueImageFileWriter->Update();
 
   // Write Header
@@ -239,6 +250,22 @@ SparseVectorImageFileWriter<TInputImage>
   
   outfile.open(headerPathName.c_str(), std::fstream::out);
 
+  this->WriteHeader( outfile, keyWidth );
+  outfile << "KeyElementDataFile = " << keyFileName << std::endl;
+  outfile << "ValueElementDataFile = " << valueFileName << std::endl;
+  
+  outfile.close();
+}
+
+
+//---------------------------------------------------------
+template <class TInputImage>
+void 
+SparseVectorImageFileWriter<TInputImage>
+::WriteHeader(std::ostream & outfile, unsigned int keyWidth)
+{
+  const InputImageType * input = this->GetInput();
+
   InputImageRegionType outputRegion = input->GetLargestPossibleRegion();
   InputImageSizeType outputSize = outputRegion.GetSize();
   InputImageSpacingType outputSpacing = input->GetSpacing();
@@ -260,13 +287,127 @@ SparseVectorImageFileWriter<TInputImage>
     }
   outfile << std::endl;
 
-  outfile << "KeyElementDataFile = " << keyFileName << std::endl;
-  outfile << "ValueElementDataFile = " << valueFileName << std::endl;
-  
+  WriteSparseVectorImageValueCodec( outfile, input->GetPixelContainer() );
+
+  outfile << "KeyElementType = " << ( keyWidth == 32 ? "MET_UINT" : "MET_ULONG_LONG" ) << std::endl;
+}
+
+
+//---------------------------------------------------------
+template <class TInputImage>
+template <class TKey>
+void 
+SparseVectorImageFileWriter<TInputImage>
+::WriteSingleFile(const std::string & headerPathName, SizeValueType numberOfElements)
+{
+  // The arrays are sorted by key, so that they can be searched in place
+  std::vector< std::pair< TKey, InputImagePixelType > > elements;
+  elements.reserve( numberOfElements );
+  ElementCollector< TKey > collector( elements );
+  this->GetInput()->GetPixelContainer()->VisitElements( collector );
+  std::sort( elements.begin(), elements.end() );
+
+  // The offsets are written with a fixed number of digits, so that the
+  // length of the header does not depend on them. The data file fields
+  // end the header, as in MetaImage files.
+  std::ostringstream header;
+  this->WriteHeader( header, 8 * sizeof( TKey ) );
+  header << "NumberOfElements = " << numberOfElements << std::endl;
+  header << "ValueElementSize = " << sizeof( InputImagePixelType ) << std::endl;
+  header << "BinaryDataByteOrderMSB = "
+         << ( ByteSwapper<int>::SystemIsBigEndian() ? "True" : "False" ) << std::endl;
+
+  const std::string keyOffsetField = "KeyElementDataOffset = ";
+  const std::string valueOffsetField = "ValueElementDataOffset = ";
+  const std::string dataFileFields = "KeyElementDataFile = LOCAL\nValueElementDataFile = LOCAL\n";
+  const unsigned int offsetDigits = 20;
+
+  const uint64_t headerLength = header.str().size() + keyOffsetField.size() + valueOffsetField.size()
+    + 2 * ( offsetDigits + 1 ) + dataFileFields.size();
+  const uint64_t keyOffset = SparseVectorImageMappedFile::AlignOffset( headerLength );
+  const uint64_t valueOffset = SparseVectorImageMappedFile::AlignOffset( keyOffset + sizeof( TKey ) * numberOfElements );
+
+  std::ofstream outfile( headerPathName.c_str(), std::ios::out | std::ios::binary );
+  if ( !outfile.is_open() )
+    {
+    itkExceptionMacro( << "Cannot open file: " << headerPathName );
+    }
+
+  outfile << header.str();
+  outfile << keyOffsetField << std::setw(offsetDigits) << std::setfill('0') << keyOffset << "\n";
+  outfile << valueOffsetField << std::setw(offsetDigits) << std::setfill('0') << valueOffset << "\n";
+  outfile << dataFileFields;
+
+  // Write the arrays in blocks
+  const SizeValueType blockSize = 1 << 16;
+  std::vector< TKey > keys;
+  std::vector< InputImagePixelType > values;
+
+  outfile.seekp( keyOffset );
+  for ( SizeValueType begin = 0; begin < numberOfElements; begin += blockSize )
+    {
+    const SizeValueType end = std::min( begin + blockSize, numberOfElements );
+    keys.resize( end - begin );
+    for ( SizeValueType n = begin; n < end; n++ )
+      {
+      keys[n - begin] = elements[n].first;
+      }
+    outfile.write( reinterpret_cast< const char * >( &keys[0] ), sizeof( TKey ) * keys.size() );
+    }
+
+  outfile.seekp( valueOffset );
+  for ( SizeValueType begin = 0; begin < numberOfElements; begin += blockSize )
+    {
+    const SizeValueType end = std::min( begin + blockSize, numberOfElements );
+    values.resize( end - begin );
+    for ( SizeValueType n = begin; n < end; n++ )
+      {
+      values[n - begin] = elements[n].second;
+      }
+    outfile.write( reinterpret_cast< const char * >( &values[0] ),
+                   sizeof( InputImagePixelType ) * values.size() );
+    }
+
+  if ( !outfile )
+    {
+    itkExceptionMacro( << "Cannot write file: " << headerPathName );
+    }
   outfile.close();
 }
 
 
+//---------------------------------------------------------
+template <class TInputImage>
+template <class TKey>
+void 
+SparseVectorImageFileWriter<TInputImage>
+::WriteKeys(const std::string & keyPathName, SizeValueType numberOfElements)
+{
+  typedef Image<TKey, 1> KeyImageType;
+  typedef itk::ImageFileWriter<KeyImageType> KeyImageFileWriterType;
+
+  typename KeyImageType::Pointer keyImage = KeyImageType::New();
+  keyImage->SetSpacing(m_ValueImage->GetSpacing());
+  keyImage->SetRegions(m_ValueImage->GetLargestPossibleRegion());
+  keyImage->Allocate();
+  keyImage->FillBuffer(static_cast<TKey>(0));
+
+  if ( numberOfElements > 0 )
+    {
+    // Populate Data
+    ElementCopier<TKey> copier( keyImage->GetBufferPointer(),
+                                m_ValueImage->GetBufferPointer() );
+    this->GetInput()->GetPixelContainer()->VisitElements(copier);
+    }
+
+  typename KeyImageFileWriterType::Pointer keyImageFileWriter = KeyImageFileWriterType::New();
+  keyImageFileWriter->SetFileName(keyPathName);
+  keyImageFileWriter->SetInput(keyImage);
+  keyImageFileWriter->SetUseCompression(this->m_UseCompression);
+  keyImageFileWriter->Update();
+}
+
+
 //---------------------------------------------------------
 template <class TInputImage>
 void 
@@ -278,6 +419,9 @@ SparseVectorImageFileWriter<TInputImage>
   os << indent << "File Name: " 
      << (m_FileName.data() ? m_FileName.data() : "(none)") << std::endl;
 
+  os << indent << "Key width: " << m_KeyWidth << std::endl;
+  os << indent << "Single file: " << (m_SingleFile ? "On" : "Off") << std::endl;
+
   if (m_UseCompression)
     {
     os << indent << "Compression: On\n";
@@ -0,0 +1,377 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Flat Hash Map
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef __itkSparseVectorImageFlatHashMap_h
+#define __itkSparseVectorImageFlatHashMap_h
+
+#include "itkMacro.h"
+#include "itkIntTypes.h"
+#include "itkNumericTraits.h"
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace itk
+{
+
+/** \class SparseVectorImageFlatHashMap
+ *  \brief An open-addressing hash table with integral keys.
+ *
+ *  Keys and values are stored in two flat arrays whose size is a power
+ *  of two, and collisions are resolved by linear probing. Inserting an
+ *  element does not allocate memory unless the table has to grow, and a
+ *  lookup touches consecutive memory locations only. Erased elements
+ *  are removed by shifting back the following elements of the probe
+ *  sequence, so the table does not accumulate tombstones.
+ *
+ *  The class provides the subset of the std::tr1::unordered_map
+ *  interface used by the containers of itk::SparseVectorImage
+ *  (find, operator[], insert, erase, iteration over first/second), so
+ *  it can be used as their PixelMapType:
+ *
+ *  \code
+ *  typedef itk::SparseVectorImageContainer< unsigned long, float,
+ *    itk::SparseVectorImageFlatHashMap< unsigned long, float > > ContainerType;
+ *  typedef itk::SparseVectorImage< float, 3, ContainerType > ImageType;
+ *  \endcode
+ *
+ *  \warning The largest value of TKey is used to mark empty slots and
+ *  cannot be stored. Inserting or erasing elements invalidates the
+ *  iterators.
+ *
+ *  \ingroup ITKSparseVectorImage
+ *
+ */
+template <typename TKey, typename TValue>
+class SparseVectorImageFlatHashMap
+{
+public:
+  /** Standard class typedefs. */
+  typedef SparseVectorImageFlatHashMap  Self;
+
+  /** Typedefs following the standard associative containers. */
+  typedef TKey                          key_type;
+  typedef TValue                        mapped_type;
+  typedef std::pair< TKey, TValue >     value_type;
+  typedef SizeValueType                 size_type;
+
+  /** Reference to a stored element. It exposes the first and second
+   *  members of a std::pair, and acts as its own pointer so that
+   *  it->first and it->second can be used on iterators. */
+  template< class TMapped >
+  struct ElementReference
+    {
+    ElementReference( const key_type & key, TMapped & value )
+      : first(key), second(value) {}
+    ElementReference * operator->() { return this; }
+
+    const key_type & first;
+    TMapped &        second;
+    };
+
+  /** Forward iterator over the occupied slots. */
+  template< class TMapped, class TMap >
+  class IteratorTemplate
+    {
+  public:
+    typedef std::forward_iterator_tag        iterator_category;
+    typedef typename Self::value_type        value_type;
+    typedef OffsetValueType                  difference_type;
+    typedef ElementReference< TMapped >      reference;
+    typedef ElementReference< TMapped >      pointer;
+
+    IteratorTemplate() : m_Map(NULL), m_Slot(0) {}
+    IteratorTemplate( TMap *map, size_type slot ) : m_Map(map), m_Slot(slot) {}
+
+    /** Conversion from iterator to const_iterator. */
+    template< class TOtherMapped, class TOtherMap >
+    IteratorTemplate( const IteratorTemplate< TOtherMapped, TOtherMap > & other )
+      : m_Map(other.m_Map), m_Slot(other.m_Slot) {}
+
+    reference operator*() const
+      { return reference( m_Map->m_Keys[m_Slot], m_Map->m_Values[m_Slot] ); }
+    pointer operator->() const
+      { return this->operator*(); }
+
+    IteratorTemplate & operator++()
+      {
+      m_Slot = m_Map->NextOccupiedSlot( m_Slot + 1 );
+      return *this;
+      }
+    IteratorTemplate operator++(int)
+      {
+      IteratorTemplate tmp = *this;
+      ++( *this );
+      return tmp;
+      }
+
+    bool operator==( const IteratorTemplate & other ) const
+      { return m_Slot == other.m_Slot; }
+    bool operator!=( const IteratorTemplate & other ) const
+      { return m_Slot != other.m_Slot; }
+
+    TMap      *m_Map;
+    size_type  m_Slot;
+    };
+
+  typedef IteratorTemplate< TValue, Self >              iterator;
+  typedef IteratorTemplate< const TValue, const Self >  const_iterator;
+
+  SparseVectorImageFlatHashMap()
+    : m_Size(0), m_Mask(0), m_Shift(0), m_MaxLoadFactor(0.7f) {}
+
+  /** Iteration. */
+  iterator begin()
+    { return iterator( this, this->NextOccupiedSlot(0) ); }
+  iterator end()
+    { return iterator( this, m_Keys.size() ); }
+  const_iterator begin() const
+    { return const_iterator( this, this->NextOccupiedSlot(0) ); }
+  const_iterator end() const
+    { return const_iterator( this, m_Keys.size() ); }
+
+  /** Capacity. */
+  size_type size() const { return m_Size; }
+  bool empty() const { return m_Size == 0; }
+  size_type bucket_count() const { return m_Keys.size(); }
+  float load_factor() const
+    { return m_Keys.empty() ? 0.0f : static_cast< float >( m_Size ) / m_Keys.size(); }
+  float max_load_factor() const { return m_MaxLoadFactor; }
+  void max_load_factor( float factor )
+    {
+    m_MaxLoadFactor = factor;
+    this->reserve( m_Size );
+    }
+
+  /** Return the slot of key, or the end iterator if the key is not stored. */
+  iterator find( const key_type & key )
+    { return iterator( this, this->FindSlot(key) ); }
+  const_iterator find( const key_type & key ) const
+    { return const_iterator( this, this->FindSlot(key) ); }
+
+  size_type count( const key_type & key ) const
+    { return this->FindSlot(key) == m_Keys.size() ? 0 : 1; }
+
+  /** Return the value associated with key, inserting a default value
+   *  if the key is not stored. */
+  mapped_type & operator[]( const key_type & key )
+    {
+    return m_Values[ this->InsertSlot( key ).first ];
+    }
+
+  /** Insert an element if its key is not stored yet. */
+  std::pair< iterator, bool > insert( const value_type & element )
+    {
+    std::pair< size_type, bool > slot = this->InsertSlot( element.first );
+    if ( slot.second )
+      {
+      m_Values[slot.first] = element.second;
+      }
+    return std::make_pair( iterator( this, slot.first ), slot.second );
+    }
+
+  /** Erase the element with the given key. Return the number of erased
+   *  elements. */
+  size_type erase( const key_type & key )
+    {
+    size_type slot = this->FindSlot( key );
+    if ( slot == m_Keys.size() )
+      {
+      return 0;
+      }
+    this->EraseSlot( slot );
+    return 1;
+    }
+
+  void erase( iterator it )
+    { this->EraseSlot( it.m_Slot ); }
+
+  /** Remove all the elements, keeping the allocated slots. */
+  void clear()
+    {
+    std::fill( m_Keys.begin(), m_Keys.end(), EmptyKey() );
+    m_Size = 0;
+    }
+
+  /** Make room for at least n elements without exceeding the maximum
+   *  load factor. The table never shrinks below its current size. */
+  void reserve( size_type n )
+    {
+    size_type required = static_cast< size_type >( n / m_MaxLoadFactor ) + 1;
+    if ( required > m_Keys.size() )
+      {
+      this->rehash( required );
+      }
+    }
+
+  /** Resize the table to at least n slots, and at least as many as
+   *  required by the maximum load factor. */
+  void rehash( size_type n )
+    {
+    size_type minimum = static_cast< size_type >( m_Size / m_MaxLoadFactor ) + 1;
+    if ( n < minimum )
+      {
+      n = minimum;
+      }
+
+    unsigned int shift = 4;
+    size_type capacity = 16;
+    while ( capacity < n )
+      {
+      capacity <<= 1;
+      ++shift;
+      }
+    if ( capacity == m_Keys.size() )
+      {
+      return;
+      }
+
+    std::vector< key_type > keys( capacity, EmptyKey() );
+    std::vector< mapped_type > values( capacity );
+    keys.swap( m_Keys );
+    values.swap( m_Values );
+    m_Mask = capacity - 1;
+    m_Shift = 64 - shift;
+
+    for ( size_type i = 0; i < keys.size(); i++ )
+      {
+      if ( keys[i] != EmptyKey() )
+        {
+        size_type slot = this->HomeSlot( keys[i] );
+        while ( m_Keys[slot] != EmptyKey() )
+          {
+          slot = ( slot + 1 ) & m_Mask;
+          }
+        m_Keys[slot] = keys[i];
+        m_Values[slot] = values[i];
+        }
+      }
+    }
+
+  void swap( Self & other )
+    {
+    m_Keys.swap( other.m_Keys );
+    m_Values.swap( other.m_Values );
+    std::swap( m_Size, other.m_Size );
+    std::swap( m_Mask, other.m_Mask );
+    std::swap( m_Shift, other.m_Shift );
+    std::swap( m_MaxLoadFactor, other.m_MaxLoadFactor );
+    }
+
+  /** Key used to mark the empty slots. */
+  static key_type EmptyKey()
+    { return NumericTraits< key_type >::max(); }
+
+private:
+  template< class TMapped, class TMap > friend class IteratorTemplate;
+
+  /** Fibonacci hashing: the high bits of key * 2^64 / phi. */
+  size_type HomeSlot( const key_type & key ) const
+    {
+    return static_cast< size_type >(
+      ( static_cast< uint64_t >( key ) * 11400714819323198485ULL ) >> m_Shift ) & m_Mask;
+    }
+
+  size_type FindSlot( const key_type & key ) const
+    {
+    if ( m_Size == 0 )
+      {
+      return m_Keys.size();
+      }
+
+    size_type slot = this->HomeSlot( key );
+    while ( m_Keys[slot] != EmptyKey() )
+      {
+      if ( m_Keys[slot] == key )
+        {
+        return slot;
+        }
+      slot = ( slot + 1 ) & m_Mask;
+      }
+    return m_Keys.size();
+    }
+
+  /** Return the slot of key, inserting the key with a default value if
+   *  it is not stored. The boolean is true if the key was inserted. */
+  std::pair< size_type, bool > InsertSlot( const key_type & key )
+    {
+    if ( m_Size + 1 > m_MaxLoadFactor * m_Keys.size() )
+      {
+      this->rehash( 2 * m_Keys.size() );
+      }
+
+    size_type slot = this->HomeSlot( key );
+    while ( m_Keys[slot] != EmptyKey() )
+      {
+      if ( m_Keys[slot] == key )
+        {
+        return std::make_pair( slot, false );
+        }
+      slot = ( slot + 1 ) & m_Mask;
+      }
+
+    m_Keys[slot] = key;
+    m_Values[slot] = mapped_type();
+    ++m_Size;
+    return std::make_pair( slot, true );
+    }
+
+  /** Remove the element of a slot and shift back the elements that
+   *  follow it in the probe sequence. */
+  void EraseSlot( size_type hole )
+    {
+    size_type slot = hole;
+    for (;;)
+      {
+      slot = ( slot + 1 ) & m_Mask;
+      if ( m_Keys[slot] == EmptyKey() )
+        {
+        break;
+        }
+      // The element can move to the hole only if its home slot is not
+      // located cyclically in ( hole, slot ].
+      size_type home = this->HomeSlot( m_Keys[slot] );
+      bool movable = ( hole <= slot ) ? ( home <= hole || home > slot )
+                                      : ( home <= hole && home > slot );
+      if ( movable )
+        {
+        m_Keys[hole] = m_Keys[slot];
+        m_Values[hole] = m_Values[slot];
+        hole = slot;
+        }
+      }
+    m_Keys[hole] = EmptyKey();
+    --m_Size;
+    }
+
+  size_type NextOccupiedSlot( size_type slot ) const
+    {
+    while ( slot < m_Keys.size() && m_Keys[slot] == EmptyKey() )
+      {
+      ++slot;
+      }
+    return slot;
+    }
+
+  std::vector< key_type >     m_Keys;
+  std::vector< mapped_type >  m_Values;
+  size_type                   m_Size;
+  size_type                   m_Mask;
+  unsigned int                m_Shift;
+  float                       m_MaxLoadFactor;
+};
+
+} // end namespace itk
+
+#endif
@@ -29,7 +29,8 @@ namespace itk
  *
  * SparseVectorImageInterpolateImageFunction is the base for all ImageFunctions
  * that interpolates image with sparse vector pixel types. This function outputs
- * a return value of type VariableLengthVector<double>.
+ * a return value of type VariableLengthVector<double>, or Vector<double, N>
+ * for images with a fixed vector length N.
  *
  * This class is templated input image type and the coordinate
  * representation type.
@@ -48,14 +49,16 @@ namespace itk
 template<typename TInputImage, typename TCoordRep = double>
 class ITK_EXPORT SparseVectorImageInterpolateImageFunction :
   public ImageFunction<TInputImage,
-                       VariableLengthVector<typename NumericTraits<typename TInputImage::ValueType>::RealType>,
+                       typename TInputImage::PixelTraits::template Rebind<
+                         typename NumericTraits<typename TInputImage::ValueType>::RealType>::Type,
                        TCoordRep>
 {
 public:
   /** Standard class typedefs. */
   typedef SparseVectorImageInterpolateImageFunction                   Self;
   typedef ImageFunction<TInputImage,
-                        VariableLengthVector<typename NumericTraits<typename TInputImage::ValueType>::RealType>,
+                        typename TInputImage::PixelTraits::template Rebind<
+                          typename NumericTraits<typename TInputImage::ValueType>::RealType>::Type,
                         TCoordRep>                                    Superclass;
   typedef SmartPointer<Self>                                          Pointer;
   typedef SmartPointer<const Self>                                    ConstPointer;
@@ -69,6 +72,7 @@ public:
   /** Input typedefs for the images. */
   typedef typename Superclass::InputImageType                         InputImageType;
   typedef typename InputImageType::PixelType                          PixelType;
+  typedef typename InputImageType::PixelTraits                        PixelTraits;
   typedef typename InputImageType::ValueType                          ValueType;
   typedef typename NumericTraits<ValueType>::RealType                 RealType;
 
@@ -81,7 +85,8 @@ public:
   /** ContinuousIndex typedef support. */
   typedef typename Superclass::ContinuousIndexType                    ContinuousIndexType;
 
-  /** Output type is VariableLengthVector<RealType>. */
+  /** Output type is VariableLengthVector<RealType>, or Vector<RealType, N>
+   * for fixed length pixels. */
   typedef typename Superclass::OutputType                             OutputType;
   
   /** CoordRep typedef support. */
@@ -126,9 +131,10 @@ public:
    * calling the method. */
   virtual OutputType EvaluateAtIndex( const IndexType& index ) const
   {
-    PixelType input = this->GetInputImage()->GetPixel( index );
-    OutputType output( input.GetSize() );
-    for( unsigned int k = 0; k < input.GetSize(); k++ )
+    const PixelType input = this->GetInputImage()->GetPixel( index );
+    OutputType output;
+    PixelTraits::SetLength( output, input.Size() );
+    for( unsigned int k = 0; k < input.Size(); k++ )
     {
       output[k] = static_cast<RealType>( input[k] );
     }
@@ -0,0 +1,195 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Key Encoder
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef __itkSparseVectorImageKeyEncoder_h
+#define __itkSparseVectorImageKeyEncoder_h
+
+#include "itkMacro.h"
+#include "itkIntTypes.h"
+
+namespace itk
+{
+
+/** \class SparseVectorImageRasterKeyEncoder
+ *  \brief Key encoding policy keeping the raster order of the voxels.
+ *
+ *  A key encoding policy maps the raster offset of a voxel, as computed
+ *  by SparseVectorImage::ComputeOffset(), to the key under which the
+ *  voxel is stored, and back. This policy is the identity.
+ *
+ *  \sa SparseVectorImageMortonKeyEncoder, SparseVectorImageEncodedContainer
+ *
+ *  \ingroup ITKSparseVectorImage
+ *
+ */
+class SparseVectorImageRasterKeyEncoder
+{
+public:
+  /** Name of the encoding. */
+  static const char * GetName()
+    { return "Raster"; }
+
+  /** The raster encoding does not depend on the image size. */
+  void SetImageSize(unsigned int, const SizeValueType *, unsigned int) {}
+
+  /** Return true if the encoding is the raster order. */
+  bool IsRaster() const
+    { return true; }
+
+  uint64_t Encode(uint64_t offset) const
+    { return offset; }
+
+  uint64_t Decode(uint64_t key) const
+    { return key; }
+};
+
+
+/** \class SparseVectorImageMortonKeyEncoder
+ *  \brief Key encoding policy ordering the voxels along a Z-order curve.
+ *
+ *  The key of a voxel interleaves the bits of the components of its
+ *  index, e.g. x0 y0 z0 x1 y1 z1 ... from the least significant bit, so
+ *  that voxels which are close in the image have close keys in every
+ *  direction, instead of only along the first axis for the raster
+ *  order. Sorted or ordered storage, e.g. frozen containers, and the
+ *  batched lookups of SparseVectorImage::GetPixels() then access
+ *  neighbourhoods in a few contiguous memory ranges.
+ *
+ *  Each index component uses as many bits as the largest image size
+ *  needs. When the interleaved keys would not fit in the available key
+ *  bits, the encoder falls back to the raster order (see IsRaster()).
+ *
+ *  \sa SparseVectorImageRasterKeyEncoder, SparseVectorImageEncodedContainer
+ *
+ *  \ingroup ITKSparseVectorImage
+ *
+ */
+class SparseVectorImageMortonKeyEncoder
+{
+public:
+  itkStaticConstMacro(MaximumDimension, unsigned int, 8);
+
+  SparseVectorImageMortonKeyEncoder()
+    : m_Dimension(0), m_BitsPerDimension(0), m_Raster(true)
+    {
+    for ( unsigned int d = 0; d < MaximumDimension; d++ )
+      {
+      m_Size[d] = 1;
+      }
+    }
+
+  /** Name of the encoding. */
+  static const char * GetName()
+    { return "Morton"; }
+
+  /** Set the size of the image. The keys must fit in availableBits bits,
+   *  otherwise the raster order is used. */
+  void SetImageSize(unsigned int dimension, const SizeValueType *size,
+                    unsigned int availableBits)
+    {
+    m_Dimension = dimension;
+    m_BitsPerDimension = 0;
+    for ( unsigned int d = 0; d < dimension && d < MaximumDimension; d++ )
+      {
+      m_Size[d] = size[d];
+      while ( ( static_cast< uint64_t >( 1 ) << m_BitsPerDimension ) < size[d] )
+        {
+        m_BitsPerDimension++;
+        }
+      }
+    m_Raster = dimension > MaximumDimension || dimension < 2
+      || m_BitsPerDimension * dimension > availableBits;
+
+    if ( m_Raster )
+      {
+      return;
+      }
+
+    // Spread the 8 bits of a byte at intervals of m_Dimension bits
+    for ( unsigned int byte = 0; byte < 256; byte++ )
+      {
+      uint64_t spread = 0;
+      for ( unsigned int bit = 0; bit < 8; bit++ )
+        {
+        spread |= static_cast< uint64_t >( ( byte >> bit ) & 1 ) << ( bit * m_Dimension );
+        }
+      m_SpreadTable[byte] = spread;
+      }
+    }
+
+  /** Return true if the raster order is used. */
+  bool IsRaster() const
+    { return m_Raster; }
+
+  /** Return the Morton key of the voxel at the given raster offset. */
+  uint64_t Encode(uint64_t offset) const
+    {
+    if ( m_Raster )
+      {
+      return offset;
+      }
+
+    uint64_t key = 0;
+    for ( unsigned int d = 0; d < m_Dimension; d++ )
+      {
+      uint64_t index = offset % m_Size[d];
+      offset /= m_Size[d];
+      for ( unsigned int shift = d; index != 0; shift += 8 * m_Dimension )
+        {
+        key |= m_SpreadTable[index & 0xff] << shift;
+        index >>= 8;
+        }
+      }
+    return key;
+    }
+
+  /** Return the raster offset of the voxel with the given Morton key. */
+  uint64_t Decode(uint64_t key) const
+    {
+    if ( m_Raster )
+      {
+      return key;
+      }
+
+    uint64_t index[MaximumDimension];
+    for ( unsigned int d = 0; d < m_Dimension; d++ )
+      {
+      index[d] = 0;
+      }
+    for ( unsigned int bit = 0; key != 0; bit++ )
+      {
+      for ( unsigned int d = 0; d < m_Dimension; d++, key >>= 1 )
+        {
+        index[d] |= ( key & 1 ) << bit;
+        }
+      }
+
+    uint64_t offset = 0;
+    for ( int d = m_Dimension - 1; d >= 0; d-- )
+      {
+      offset = offset * m_Size[d] + index[d];
+      }
+    return offset;
+    }
+
+private:
+  unsigned int  m_Dimension;
+  unsigned int  m_BitsPerDimension;
+  bool          m_Raster;
+  uint64_t      m_Size[MaximumDimension];
+  uint64_t      m_SpreadTable[256];
+};
+
+} // end namespace itk
+
+#endif
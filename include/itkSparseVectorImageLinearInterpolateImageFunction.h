@@ -68,6 +68,7 @@ public:
   /** Input typedefs for the images. */
   typedef typename Superclass::InputImageType                         InputImageType;
   typedef typename Superclass::PixelType                              PixelType;
+  typedef typename Superclass::PixelTraits                            PixelTraits;
   typedef typename Superclass::ValueType                              ValueType;
   typedef typename Superclass::RealType                               RealType;
 
@@ -98,6 +99,10 @@ protected:
   ~SparseVectorImageLinearInterpolateImageFunction() {}
   void PrintSelf(std::ostream& os, Indent indent) const;
 
+  /** Variable length pixels up to this length are gathered in a buffer
+   *  on the stack. */
+  itkStaticConstMacro(StackLength, unsigned int, 64);
+
 private:
   SparseVectorImageLinearInterpolateImageFunction(const Self&); //purposely not implemented
   void operator=(const Self&);//purposely not implemented
@@ -21,6 +21,7 @@
 #include "itkSparseVectorImageLinearInterpolateImageFunction.h"
 
 #include "vnl/vnl_math.h"
+#include <vector>
 
 namespace itk
 {
@@ -81,17 +82,24 @@ SparseVectorImageLinearInterpolateImageFunction<TInputImage, TCoordRep>
    * neighbors. The weight for each neighbor is the fraction overlap
    * of the neighbor pixel with respect to a pixel centered on point.
    */
-  unsigned int vectorDimension = this->GetInputImage()->GetNumberOfComponentsPerPixel();
-  OutputType output(vectorDimension);
+  // For fixed length pixels the number of components is a compile-time
+  // constant, so that the loop over the components can be unrolled.
+  const unsigned int vectorDimension = PixelTraits::Length ? PixelTraits::Length :
+    this->GetInputImage()->GetNumberOfComponentsPerPixel();
+  OutputType output;
+  PixelTraits::SetLength( output, vectorDimension );
   output.Fill(0.0);
 
-  RealType totalOverlap = NumericTraits<RealType>::Zero;
+  // Indices and overlaps of the neighbors with a non-zero overlap
+  IndexType    neighIndices[1 << ImageDimension];
+  double       overlaps[1 << ImageDimension];
+  unsigned int numberOfNeighbors = 0;
 
   for ( unsigned int counter = 0; counter < m_Neighbors; counter++ )
     {
     double       overlap = 1.0;    // fraction overlap
     unsigned int upper = counter;  // each bit indicates upper/lower neighbour
-    IndexType    neighIndex;
+    IndexType &  neighIndex = neighIndices[numberOfNeighbors];
 
     // get neighbor index and overlap fraction
     for ( dim = 0; dim < ImageDimension; dim++ )
@@ -125,13 +133,40 @@ SparseVectorImageLinearInterpolateImageFunction<TInputImage, TCoordRep>
     // get neighbor value only if overlap is not zero
     if ( overlap )
       {
-      const PixelType input = this->GetInputImage()->GetPixel(neighIndex);
-      for ( unsigned int k = 0; k < vectorDimension; k++ )
-        {
-        output[k] += overlap * static_cast< RealType >( input[k] );
-        }
-      totalOverlap += overlap;
+      overlaps[numberOfNeighbors++] = overlap;
+      }
+    }
+
+  if ( numberOfNeighbors == 0 || vectorDimension == 0 )
+    {
+    return ( output );
+    }
+
+  // Gather the values of all the neighbors in a single call. Fixed
+  // length pixels, and variable length pixels up to StackLength, fit on
+  // the stack; otherwise one buffer is allocated for all the neighbors.
+  const unsigned int stackLength = PixelTraits::Length ? PixelTraits::Length : StackLength;
+  ValueType              stackValues[( 1 << ImageDimension ) * stackLength];
+  std::vector<ValueType> heapValues;
+  ValueType *            values = stackValues;
+  if ( vectorDimension > stackLength )
+    {
+    heapValues.resize( numberOfNeighbors * vectorDimension );
+    values = &heapValues[0];
+    }
+
+  this->GetInputImage()->GetPixels( neighIndices, numberOfNeighbors, values );
+
+  RealType totalOverlap = NumericTraits<RealType>::Zero;
+
+  for ( unsigned int n = 0; n < numberOfNeighbors; n++ )
+    {
+    const ValueType *input = values + n * vectorDimension;
+    for ( unsigned int k = 0; k < vectorDimension; k++ )
+      {
+      output[k] += overlaps[n] * static_cast< RealType >( input[k] );
       }
+    totalOverlap += overlaps[n];
 
     if ( totalOverlap == 1.0 )
       {
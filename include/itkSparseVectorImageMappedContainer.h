@@ -0,0 +1,243 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Mapped Container
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef __itkSparseVectorImageMappedContainer_h
+#define __itkSparseVectorImageMappedContainer_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkSparseVectorImageMappedFile.h"
+#include <algorithm>
+#include <string>
+
+namespace itk
+{
+
+/** \class SparseVectorImageMappedContainer
+ *  \brief A read-only image container for itk::SparseVectorImage whose
+ *  pixels stay in a memory-mapped single-file .spr.
+ *
+ *  SparseVectorImageFileWriter::SingleFileOn() writes the keys of the
+ *  stored components, sorted, and their values as two raw arrays after
+ *  the text header of the .spr file. This container maps the file and
+ *  finds pixels in the mapped arrays by binary search, as a frozen
+ *  SparseVectorImageContainer does in its own arrays: GetPixel() only
+ *  loads the pages it touches, and the pages can be evicted again, so
+ *  that images larger than the memory can be read. Reading such a file
+ *  into an image with this container maps it instead of inserting the
+ *  elements:
+ *
+ *  \code
+ *  typedef itk::SparseVectorImage< float, 3,
+ *    itk::SparseVectorImageMappedContainer< unsigned long, float > > ImageType;
+ *  typedef itk::SparseVectorImageFileReader< ImageType > ReaderType;
+ *  \endcode
+ *
+ *  The container is read-only: SetPixel() and SetElement() throw an
+ *  exception. The file must not be modified while it is mapped, and its
+ *  values must have the byte order of the machine reading it.
+ *
+ *  \sa SparseVectorImageMappedFile, SparseVectorImageFileWriter
+ *
+ *  \ingroup ITKSparseVectorImage
+ *
+ */
+
+template <typename TElementIdentifier, typename TElement>
+class SparseVectorImageMappedContainer:  public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef SparseVectorImageMappedContainer  Self;
+  typedef Object                            Superclass;
+  typedef SmartPointer<Self>                Pointer;
+  typedef SmartPointer<const Self>          ConstPointer;
+
+  /** Save the template parameters. */
+  typedef TElementIdentifier  ElementIdentifier;
+  typedef TElement            Element;
+
+  typedef unsigned int VectorLengthType;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Standard part of every itk Object. */
+  itkTypeMacro(SparseVectorImageMappedContainer, Object);
+
+  /** Map the arrays of a single-file .spr: numberOfElements keys of
+   *  keyWidth bits at keyOffset and as many values at valueOffset, both
+   *  offsets in bytes from the beginning of the file. The vector length
+   *  of the container must be that of the file. */
+  void MapFile(const std::string & fileName, uint64_t keyOffset, unsigned int keyWidth,
+               uint64_t valueOffset, SizeValueType numberOfElements);
+
+  /** Unmap the file. The container is then empty. */
+  void UnmapFile(void);
+
+  /** Return true if a file is mapped. */
+  bool IsMapped(void) const
+    { return m_File.GetData() != NULL; }
+
+  /** Get the name of the mapped file. */
+  const std::string & GetFileName(void) const
+    { return m_FileName; }
+
+  /** Get the number of elements stored in the mapped file. */
+  unsigned long Size(void) const
+    { return (unsigned long) m_NumberOfElements; }
+
+  /** Set/Get the number of components of each pixel. */
+  itkSetMacro(VectorLength, VectorLengthType);
+  itkGetConstMacro(VectorLength, VectorLengthType);
+
+  /** The layout of this container does not depend on the image size.
+   *  This method does nothing. */
+  void SetImageSize(unsigned int, const SizeValueType *) {}
+
+  /** Copy the components of the pixel at the given offset into pixel.
+   *  Components that are not stored take the value of the corresponding
+   *  component of fillValue. Return true if at least one component
+   *  of the pixel is stored. */
+  bool GetPixel(ElementIdentifier offset, const Element *fillValue,
+                Element *pixel) const
+    {
+    const ElementIdentifier first = m_VectorLength * offset;
+    if ( m_KeyWidth == 32 )
+      {
+      return this->GetMappedPixel( static_cast< const uint32_t * >( m_Keys ), first, fillValue, pixel );
+      }
+    return this->GetMappedPixel( static_cast< const uint64_t * >( m_Keys ), first, fillValue, pixel );
+    }
+
+  /** The container is read-only. These methods throw an exception. */
+  void SetPixel(ElementIdentifier, const Element *)
+    { itkExceptionMacro( << "Cannot write to a memory-mapped container" ); }
+  void SetElement(ElementIdentifier, const Element &)
+    { itkExceptionMacro( << "Cannot write to a memory-mapped container" ); }
+
+  /** Call visitor( key, value ) for every stored component, in the order
+   *  of the keys. */
+  template< class TVisitor >
+  void VisitElements(TVisitor & visitor) const
+    {
+    for ( SizeValueType n = 0; n < m_NumberOfElements; n++ )
+      {
+      const ElementIdentifier key = m_KeyWidth == 32 ?
+        static_cast< ElementIdentifier >( static_cast< const uint32_t * >( m_Keys )[n] ) :
+        static_cast< ElementIdentifier >( static_cast< const uint64_t * >( m_Keys )[n] );
+      visitor( key, m_Values[n] );
+      }
+    }
+
+  /** Map the file mapped by source. The pages of the file are shared by
+   *  both containers. */
+  void DeepCopy(const Self *source);
+
+  /** The mapped arrays cannot grow or shrink. These methods do nothing. */
+  void Reserve(SizeValueType) {}
+  void Squeeze(void) {}
+
+  /** Unmap the file. */
+  void Clear(void)
+    { this->UnmapFile(); }
+
+  /** Tell the container to release any of its allocated memory. */
+  void Initialize(void);
+
+  /** See SparseVectorImageContainer::SetContainerManageMemory(). The
+   *  file is unmapped upon destruction in any case. */
+  itkSetMacro(ContainerManageMemory,bool);
+  itkGetMacro(ContainerManageMemory,bool);
+  itkBooleanMacro(ContainerManageMemory);
+
+protected:
+  SparseVectorImageMappedContainer();
+  virtual ~SparseVectorImageMappedContainer();
+
+  void PrintSelf(std::ostream& os, Indent indent) const;
+
+  /** GetPixel() in the mapped arrays, with keys of type TKey: the
+   *  components of a pixel have consecutive keys, hence they are found
+   *  after a single binary search. */
+  template< class TKey >
+  bool GetMappedPixel(const TKey *keys, ElementIdentifier first,
+                      const Element *fillValue, Element *pixel) const
+    {
+    SizeValueType n = std::lower_bound( keys, keys + m_NumberOfElements,
+                                        static_cast< uint64_t >( first ) ) - keys;
+    bool found = false;
+
+    for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
+      {
+      if ( n < m_NumberOfElements && keys[n] == first + i )
+        {
+        pixel[i] = m_Values[n++];
+        found = true;
+        }
+      else
+        {
+        pixel[i] = fillValue[i];
+        }
+      }
+
+    return found;
+    }
+
+private:
+  SparseVectorImageMappedContainer(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  SparseVectorImageMappedFile  m_File;
+  std::string                  m_FileName;
+  VectorLengthType             m_VectorLength;
+  bool                         m_ContainerManageMemory;
+
+  /** The mapped arrays and the offsets they were mapped at. */
+  const void *                 m_Keys;
+  const Element *              m_Values;
+  unsigned int                 m_KeyWidth;
+  uint64_t                     m_KeyOffset;
+  uint64_t                     m_ValueOffset;
+  SizeValueType                m_NumberOfElements;
+};
+
+
+/** Map a single-file .spr into the container of an image. Return false,
+ *  without doing anything, for the containers which cannot map files:
+ *  the reader then inserts the elements instead. */
+template <typename TContainer>
+bool
+MapSparseVectorImageFile(TContainer *, const std::string &, uint64_t, unsigned int,
+                         uint64_t, SizeValueType)
+{
+  return false;
+}
+
+template <typename TElementIdentifier, typename TElement>
+bool
+MapSparseVectorImageFile(SparseVectorImageMappedContainer< TElementIdentifier, TElement > *container,
+                         const std::string & fileName, uint64_t keyOffset, unsigned int keyWidth,
+                         uint64_t valueOffset, SizeValueType numberOfElements)
+{
+  container->MapFile( fileName, keyOffset, keyWidth, valueOffset, numberOfElements );
+  return true;
+}
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkSparseVectorImageMappedContainer.hxx"
+#endif
+
+#endif
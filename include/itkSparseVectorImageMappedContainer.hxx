@@ -0,0 +1,153 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Mapped Container
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef _itkSparseVectorImageMappedContainer_hxx
+#define _itkSparseVectorImageMappedContainer_hxx
+
+#include "itkSparseVectorImageMappedContainer.h"
+
+namespace itk
+{
+
+template <typename TElementIdentifier, typename TElement>
+SparseVectorImageMappedContainer< TElementIdentifier , TElement >
+::SparseVectorImageMappedContainer()
+{
+  m_VectorLength = 1;
+  m_ContainerManageMemory = true;
+  m_Keys = NULL;
+  m_Values = NULL;
+  m_KeyWidth = 64;
+  m_KeyOffset = 0;
+  m_ValueOffset = 0;
+  m_NumberOfElements = 0;
+}
+
+
+template <typename TElementIdentifier, typename TElement>
+SparseVectorImageMappedContainer< TElementIdentifier , TElement >
+::~SparseVectorImageMappedContainer()
+{
+  this->UnmapFile();
+}
+
+
+template <typename TElementIdentifier, typename TElement>
+void
+SparseVectorImageMappedContainer< TElementIdentifier , TElement >
+::MapFile(const std::string & fileName, uint64_t keyOffset, unsigned int keyWidth,
+          uint64_t valueOffset, SizeValueType numberOfElements)
+{
+  if ( keyWidth != 32 && keyWidth != 64 )
+    {
+    itkExceptionMacro( << "Unsupported key width: " << keyWidth );
+    }
+
+  const uint64_t keyBytes = keyWidth / 8;
+  if ( keyOffset % keyBytes != 0 || valueOffset % sizeof( Element ) != 0 )
+    {
+    itkExceptionMacro( << "The arrays of " << fileName << " are not aligned" );
+    }
+
+  this->UnmapFile();
+  m_File.Open( fileName );
+
+  const uint64_t length = m_File.GetLength();
+  if ( numberOfElements > 0
+       && ( keyOffset + keyBytes * numberOfElements > length
+            || valueOffset + sizeof( Element ) * numberOfElements > length ) )
+    {
+    m_File.Close();
+    itkExceptionMacro( << "The file " << fileName << " is shorter than its "
+                       << numberOfElements << " elements" );
+    }
+
+  m_FileName = fileName;
+  m_Keys = m_File.GetData() + keyOffset;
+  m_Values = reinterpret_cast< const Element * >( m_File.GetData() + valueOffset );
+  m_KeyWidth = keyWidth;
+  m_KeyOffset = keyOffset;
+  m_ValueOffset = valueOffset;
+  m_NumberOfElements = numberOfElements;
+  this->Modified();
+}
+
+
+template <typename TElementIdentifier, typename TElement>
+void
+SparseVectorImageMappedContainer< TElementIdentifier , TElement >
+::UnmapFile()
+{
+  m_File.Close();
+  m_FileName = "";
+  m_Keys = NULL;
+  m_Values = NULL;
+  m_NumberOfElements = 0;
+}
+
+
+template <typename TElementIdentifier, typename TElement>
+void
+SparseVectorImageMappedContainer< TElementIdentifier , TElement >
+::DeepCopy(const Self *source)
+{
+  if ( source == this )
+    {
+    return;
+    }
+
+  this->UnmapFile();
+  m_VectorLength = source->m_VectorLength;
+  if ( source->IsMapped() )
+    {
+    this->MapFile( source->m_FileName, source->m_KeyOffset, source->m_KeyWidth,
+                   source->m_ValueOffset, source->m_NumberOfElements );
+    }
+  this->Modified();
+}
+
+
+template <typename TElementIdentifier, typename TElement>
+void
+SparseVectorImageMappedContainer< TElementIdentifier , TElement >
+::Initialize()
+{
+  if ( this->IsMapped() )
+    {
+    if( m_ContainerManageMemory )
+      {
+      this->UnmapFile();
+      }
+    m_ContainerManageMemory = true;
+    this->Modified();
+    }
+}
+
+
+template <typename TElementIdentifier, typename TElement>
+void
+SparseVectorImageMappedContainer< TElementIdentifier , TElement >
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+  os << indent << "File name: " << ( m_FileName.empty() ? "(none)" : m_FileName ) << std::endl;
+  os << indent << "Number of elements: " << m_NumberOfElements << std::endl;
+  os << indent << "Key width: " << m_KeyWidth << std::endl;
+  os << indent << "Vector length: " << m_VectorLength << std::endl;
+  os << indent << "Container manages memory: "
+     << (m_ContainerManageMemory ? "true" : "false") << std::endl;
+}
+
+} // end namespace itk
+
+#endif
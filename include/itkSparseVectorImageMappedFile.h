@@ -0,0 +1,184 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Mapped File
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef __itkSparseVectorImageMappedFile_h
+#define __itkSparseVectorImageMappedFile_h
+
+#include "itkMacro.h"
+#include "itkIntTypes.h"
+#include <string>
+
+#if defined(_WIN32)
+#include "itkWindows.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace itk
+{
+
+/** \class SparseVectorImageMappedFile
+ *  \brief Map a whole file read-only into the address space.
+ *
+ *  The pages of the file are loaded by the operating system when they
+ *  are first touched and can be evicted again under memory pressure,
+ *  so that the memory used by a mapping is bounded by the pages in use
+ *  rather than by the size of the file. Random access is advised, since
+ *  GetPixel() touches a few pages per lookup and read-ahead would load
+ *  pages that are not needed.
+ *
+ *  \sa SparseVectorImageMappedContainer
+ *
+ *  \ingroup ITKSparseVectorImage
+ *
+ */
+class SparseVectorImageMappedFile
+{
+public:
+  SparseVectorImageMappedFile()
+    : m_Data( NULL ), m_Length( 0 )
+#if defined(_WIN32)
+    , m_File( INVALID_HANDLE_VALUE ), m_Mapping( NULL )
+#endif
+    {
+    }
+
+  ~SparseVectorImageMappedFile()
+    { this->Close(); }
+
+  /** Map the file. Throw an exception if it cannot be mapped. */
+  void Open(const std::string & fileName)
+    {
+    this->Close();
+
+#if defined(_WIN32)
+    m_File = CreateFileA( fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                          OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL );
+    if ( m_File == INVALID_HANDLE_VALUE )
+      {
+      itkGenericExceptionMacro( << "Cannot open file: " << fileName );
+      }
+    LARGE_INTEGER size;
+    if ( !GetFileSizeEx( m_File, &size ) )
+      {
+      this->Close();
+      itkGenericExceptionMacro( << "Cannot get the size of file: " << fileName );
+      }
+    m_Length = static_cast< uint64_t >( size.QuadPart );
+    if ( m_Length > 0 )
+      {
+      m_Mapping = CreateFileMappingA( m_File, NULL, PAGE_READONLY, 0, 0, NULL );
+      if ( m_Mapping != NULL )
+        {
+        m_Data = static_cast< const char * >( MapViewOfFile( m_Mapping, FILE_MAP_READ, 0, 0, 0 ) );
+        }
+      if ( m_Data == NULL )
+        {
+        this->Close();
+        itkGenericExceptionMacro( << "Cannot map file: " << fileName );
+        }
+      }
+#else
+    const int descriptor = open( fileName.c_str(), O_RDONLY );
+    if ( descriptor < 0 )
+      {
+      itkGenericExceptionMacro( << "Cannot open file: " << fileName );
+      }
+    struct stat status;
+    if ( fstat( descriptor, &status ) != 0 )
+      {
+      close( descriptor );
+      itkGenericExceptionMacro( << "Cannot get the size of file: " << fileName );
+      }
+    m_Length = static_cast< uint64_t >( status.st_size );
+    if ( m_Length > 0 )
+      {
+      void *data = mmap( NULL, static_cast< size_t >( m_Length ), PROT_READ, MAP_SHARED, descriptor, 0 );
+      if ( data == MAP_FAILED )
+        {
+        close( descriptor );
+        m_Length = 0;
+        itkGenericExceptionMacro( << "Cannot map file: " << fileName );
+        }
+#if defined(MADV_RANDOM)
+      madvise( data, static_cast< size_t >( m_Length ), MADV_RANDOM );
+#endif
+      m_Data = static_cast< const char * >( data );
+      }
+    // The mapping keeps a reference to the file
+    close( descriptor );
+#endif
+    }
+
+  /** Unmap the file, if any. */
+  void Close()
+    {
+#if defined(_WIN32)
+    if ( m_Data )
+      {
+      UnmapViewOfFile( m_Data );
+      }
+    if ( m_Mapping != NULL )
+      {
+      CloseHandle( m_Mapping );
+      m_Mapping = NULL;
+      }
+    if ( m_File != INVALID_HANDLE_VALUE )
+      {
+      CloseHandle( m_File );
+      m_File = INVALID_HANDLE_VALUE;
+      }
+#else
+    if ( m_Data )
+      {
+      munmap( const_cast< char * >( m_Data ), static_cast< size_t >( m_Length ) );
+      }
+#endif
+    m_Data = NULL;
+    m_Length = 0;
+    }
+
+  /** Get the first byte of the file, or NULL if no file is mapped. */
+  const char * GetData() const
+    { return m_Data; }
+
+  /** Get the size of the mapped file in bytes. */
+  uint64_t GetLength() const
+    { return m_Length; }
+
+  /** The key and value arrays of a single-file .spr start at multiples
+   *  of this offset, so that they are aligned for any element type. */
+  itkStaticConstMacro(DataAlignment, unsigned int, 4096);
+
+  /** Round an offset up to the next multiple of DataAlignment. */
+  static uint64_t AlignOffset(uint64_t offset)
+    { return ( offset + DataAlignment - 1 ) / DataAlignment * DataAlignment; }
+
+private:
+  SparseVectorImageMappedFile(const SparseVectorImageMappedFile&); //purposely not implemented
+  void operator=(const SparseVectorImageMappedFile&); //purposely not implemented
+
+  const char * m_Data;
+  uint64_t     m_Length;
+#if defined(_WIN32)
+  HANDLE       m_File;
+  HANDLE       m_Mapping;
+#endif
+};
+
+} // end namespace itk
+
+#endif
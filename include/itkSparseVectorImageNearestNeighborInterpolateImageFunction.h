@@ -69,6 +69,7 @@ public:
   /** Input typedefs for the images. */
   typedef typename Superclass::InputImageType                         InputImageType;
   typedef typename Superclass::PixelType                              PixelType;
+  typedef typename Superclass::PixelTraits                            PixelTraits;
   typedef typename Superclass::ValueType                              ValueType;
   typedef typename Superclass::RealType                               RealType;
 
@@ -98,9 +99,10 @@ public:
 
     this->ConvertContinuousIndexToNearestIndex(index, nindex);
 
-    PixelType input = this->GetInputImage()->GetPixel( nindex );
-    OutputType output( input.GetSize() );
-    for( unsigned int k = 0; k < input.GetSize(); k++ )
+    const PixelType input = this->GetInputImage()->GetPixel( nindex );
+    OutputType output;
+    PixelTraits::SetLength( output, input.Size() );
+    for( unsigned int k = 0; k < input.Size(); k++ )
     {
       output[k] = static_cast<RealType>( input[k] );
     }
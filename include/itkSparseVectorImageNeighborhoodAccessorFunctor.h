@@ -38,9 +38,10 @@ class SparseVectorImageNeighborhoodAccessorFunctor
 public:
   typedef TImage                                           ImageType;
   typedef typename ImageType::PixelType                    PixelType;
+  typedef typename ImageType::PixelTraits                  PixelTraits;
   typedef typename ImageType::InternalPixelType            InternalPixelType;
   typedef typename ImageType::OffsetType                   OffsetType;
-  typedef typename ImageType::PixelContainer::PixelMapType PixelMapType;
+  typedef typename ImageType::PixelContainer               PixelContainerType;
   typedef unsigned int                                     VectorLengthType;
 
   typedef Neighborhood< InternalPixelType *, TImage::ImageDimension>
@@ -49,13 +50,12 @@ public:
   typedef ImageBoundaryCondition< ImageType > const 
                           *ImageBoundaryConditionConstPointerType;
 
-  SparseVectorImageNeighborhoodAccessorFunctor( PixelMapType* map,
-    PixelType fillBufferValue , VectorLengthType length)
-    : m_PixelMap( map ), m_FillBufferValue( fillBufferValue ),
-    m_VectorLength(length) { };
+  SparseVectorImageNeighborhoodAccessorFunctor( PixelContainerType* container,
+    PixelType fillBufferValue , VectorLengthType length, double zeroThreshold = 0.0 )
+    : m_PixelContainer( container ), m_FillBufferValue( fillBufferValue ),
+    m_VectorLength(length), m_ZeroThreshold( zeroThreshold ) { };
   SparseVectorImageNeighborhoodAccessorFunctor()
-    : m_PixelMap( NULL ), m_FillBufferValue( NumericTraits<PixelType>::Zero,
-    m_VectorLength( 0 ) ) {};
+    : m_PixelContainer( NULL ), m_VectorLength( 0 ), m_ZeroThreshold( 0.0 ) {};
 
   /** Set the pointer index to the start of the buffer.
    * This must be set by the iterators to the starting location of the buffer.
@@ -82,39 +82,24 @@ public:
    * is created on the stack and returned.  */
   inline PixelType Get( const InternalPixelType *pixelPointer ) const
     {
-    unsigned long offset = (pixelPointer  - m_Begin) * m_VectorLength; // NOTE: begin is always 0
-    
+    unsigned long offset = pixelPointer - m_Begin; // NOTE: begin is always 0
+
     PixelType pixel;
-    pixel.SetSize(m_VectorLength);
-    
-    for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
-      {
-      typename PixelMapType::const_iterator it =
-        m_PixelMap->find( offset + i );
-      
-      if ( it == m_PixelMap->end() )
-        {
-        pixel[i] = m_FillBufferValue;
-        }
-      else
-        {
-        pixel[i] = m_PixelMap->operator[](offset + i);
-        }
-      }
-    
+    PixelTraits::SetLength( pixel, m_VectorLength );
+
+    m_PixelContainer->GetPixel( offset, m_FillBufferValue.GetDataPointer(),
+                                pixel.GetDataPointer() );
+
     return pixel;
     }
 
   /** Method to set the pixel value at a certain pixel pointer */
   inline void Set( InternalPixelType* &pixelPointer, const PixelType &p ) const
     {
-    unsigned long offset =
-      ( pixelPointer - m_Begin ) * m_VectorLength;
-    
-    for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
-      {
-      m_PixelMap->operator[](offset + i) = p[i];
-      }
+    unsigned long offset = pixelPointer - m_Begin;
+
+    ImageType::AccessorType::SetComponents( m_PixelContainer, offset, p.GetDataPointer(),
+                                            m_VectorLength, m_ZeroThreshold );
     }
 
   inline PixelType BoundaryCondition(
@@ -139,11 +124,12 @@ public:
     }
 
 private:
-  PixelMapType* m_PixelMap;
+  PixelContainerType* m_PixelContainer;
   PixelType m_FillBufferValue;
   InternalPixelType *m_Begin;  // Begin of the buffer, always 0
 
   VectorLengthType m_VectorLength;
+  double m_ZeroThreshold;
 
 };
 
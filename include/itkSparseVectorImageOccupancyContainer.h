@@ -0,0 +1,328 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Occupancy Container
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef __itkSparseVectorImageOccupancyContainer_h
+#define __itkSparseVectorImageOccupancyContainer_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkIntTypes.h"
+#include <algorithm>
+#include <vector>
+
+namespace itk
+{
+
+/** \class SparseVectorImageOccupancyContainer
+ *  \brief Keep a bitmap of the occupied voxels or bricks of another
+ *  container, to answer the lookups of empty voxels without hashing.
+ *
+ *  Most lookups in a sparse image, e.g. during resampling, land in
+ *  empty space, and each of them still probes the hash table of the
+ *  container, once per component for SparseVectorImageContainer. This
+ *  container keeps one bit per brick of 2^VBrickBits voxels along each
+ *  dimension, set when a voxel of the brick is written. GetPixel() tests
+ *  the bit first and copies the fill value without touching the wrapped
+ *  container when it is not set.
+ *
+ *  With VBrickBits = 0 there is one bit per voxel, i.e. 2 MB for a
+ *  256^3 image. Larger bricks use less memory for very large images, at
+ *  the cost of a few divisions per lookup and more false positives.
+ *
+ *  Bits are set by SetPixel() and SetElement(), e.g. when a reader loads
+ *  the image, and only cleared by Clear(). The bitmap is built when
+ *  Allocate() gives the image size; RebuildOccupancy() rebuilds it from
+ *  the wrapped container after it has been modified directly.
+ *
+ *  When CollectStatistics is on, GetPixel() counts the lookups and the
+ *  lookups answered by the bitmap, to measure the hit rate on real data.
+ *  The counters are not protected against concurrent readers, so the
+ *  statistics should only be collected by a single thread.
+ *
+ *  \code
+ *  typedef itk::SparseVectorImageOccupancyContainer<
+ *    itk::SparseVectorImageContainer< unsigned long, float > > ContainerType;
+ *  typedef itk::SparseVectorImage< float, 3, ContainerType > ImageType;
+ *  \endcode
+ *
+ *  \ingroup ITKSparseVectorImage
+ *
+ */
+
+template <typename TContainer, unsigned int VBrickBits = 0>
+class SparseVectorImageOccupancyContainer:  public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef SparseVectorImageOccupancyContainer  Self;
+  typedef Object                               Superclass;
+  typedef SmartPointer<Self>                   Pointer;
+  typedef SmartPointer<const Self>             ConstPointer;
+
+  /** Save the template parameters. */
+  typedef TContainer                                ContainerType;
+  typedef typename ContainerType::Pointer           ContainerPointer;
+  typedef typename ContainerType::ElementIdentifier ElementIdentifier;
+  typedef typename ContainerType::Element           Element;
+
+  typedef unsigned int VectorLengthType;
+
+  /** Largest supported image dimension. */
+  itkStaticConstMacro(MaximumDimension, unsigned int, 8);
+
+  /** Number of voxels along each dimension of a brick. */
+  itkStaticConstMacro(BrickLength, unsigned int, 1 << VBrickBits);
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Standard part of every itk Object. */
+  itkTypeMacro(SparseVectorImageOccupancyContainer, Object);
+
+  /** Get the wrapped container. */
+  ContainerType * GetContainer()
+    { return m_Container.GetPointer(); }
+  const ContainerType * GetContainer() const
+    { return m_Container.GetPointer(); }
+
+  /** Get the number of elements currently stored in the container. */
+  unsigned long Size(void) const
+    { return m_Container->Size(); }
+
+  /** Set the number of components of each pixel. */
+  void SetVectorLength(VectorLengthType length)
+    {
+    m_Container->SetVectorLength( length );
+    this->RebuildOccupancy();
+    this->Modified();
+    }
+  VectorLengthType GetVectorLength() const
+    { return m_Container->GetVectorLength(); }
+
+  /** Set the size of the image and build the bitmap. */
+  void SetImageSize(unsigned int dimension, const SizeValueType *size);
+
+  /** Copy the components of the pixel at the given offset into pixel.
+   *  If the bit of the pixel is not set, fillValue is copied without
+   *  looking up the wrapped container. Return true if the pixel is
+   *  stored. */
+  bool GetPixel(ElementIdentifier offset, const Element *fillValue,
+                Element *pixel) const
+    {
+    if ( m_CollectStatistics )
+      {
+      ++m_NumberOfLookups;
+      }
+
+    if ( !m_Occupancy.empty() && !this->IsOccupied( offset ) )
+      {
+      if ( m_CollectStatistics )
+        {
+        ++m_NumberOfSkippedLookups;
+        }
+      std::copy( fillValue, fillValue + m_Container->GetVectorLength(), pixel );
+      return false;
+      }
+
+    return m_Container->GetPixel( offset, fillValue, pixel );
+    }
+
+  /** Store the pixel at the given offset and set its bit if it has a
+   *  non-zero component. */
+  void SetPixel(ElementIdentifier offset, const Element *pixel)
+    {
+    m_Container->SetPixel( offset, pixel );
+
+    const VectorLengthType length = m_Container->GetVectorLength();
+    for ( VectorLengthType i = 0; i < length; i++ )
+      {
+      if ( pixel[i] != 0 )
+        {
+        this->SetOccupied( offset );
+        break;
+        }
+      }
+    }
+
+  /** Store a single component given its key, i.e.
+   *  VectorLength * offset + component, and set the bit of its voxel. */
+  void SetElement(ElementIdentifier key, const Element & value)
+    {
+    m_Container->SetElement( key, value );
+    this->SetOccupied( key / m_Container->GetVectorLength() );
+    }
+
+  /** Call visitor( key, value ) for every stored component. */
+  template< class TVisitor >
+  void VisitElements(TVisitor & visitor) const
+    { m_Container->VisitElements( visitor ); }
+
+  /** Forwarded to the wrapped container. */
+  void Reserve(SizeValueType size)
+    { m_Container->Reserve( size ); }
+  void Squeeze(void)
+    { m_Container->Squeeze(); }
+
+  /** Prune the wrapped container and rebuild the bitmap, so that the
+   *  removed voxels are answered by the bitmap again. */
+  SizeValueType Prune(double threshold = 0.0)
+    {
+    const SizeValueType bytes = m_Container->Prune( threshold );
+    if ( bytes > 0 )
+      {
+      this->RebuildOccupancy();
+      }
+    return bytes;
+    }
+
+  /** Remove all the stored pixels and clear the bitmap. */
+  void Clear(void)
+    {
+    m_Container->Clear();
+    std::fill( m_Occupancy.begin(), m_Occupancy.end(), 0 );
+    }
+
+  /** Tell the container to release any of its allocated memory. */
+  void Initialize(void)
+    {
+    m_Container->Initialize();
+    std::fill( m_Occupancy.begin(), m_Occupancy.end(), 0 );
+    }
+
+  /** Forwarded to the wrapped container, when it supports freezing. */
+  void Freeze(void)
+    { m_Container->Freeze(); }
+  void Thaw(void)
+    { m_Container->Thaw(); }
+  bool IsFrozen(void) const
+    { return m_Container->IsFrozen(); }
+
+  /** See SparseVectorImageContainer::SetContainerManageMemory(). */
+  void SetContainerManageMemory(bool manage)
+    { m_Container->SetContainerManageMemory( manage ); }
+  bool GetContainerManageMemory()
+    { return m_Container->GetContainerManageMemory(); }
+
+  /** Rebuild the bitmap from the voxels stored in the wrapped container. */
+  void RebuildOccupancy(void);
+
+  /** Get the number of bits of the bitmap, i.e. of bricks. */
+  SizeValueType GetNumberOfBricks(void) const
+    { return m_NumberOfBricks; }
+
+  /** Get the number of bits set in the bitmap. */
+  SizeValueType GetNumberOfOccupiedBricks(void) const;
+
+  /** Turn on/off the counting of the lookups by GetPixel(). */
+  itkSetMacro(CollectStatistics, bool);
+  itkGetConstMacro(CollectStatistics, bool);
+  itkBooleanMacro(CollectStatistics);
+
+  /** Get the number of calls to GetPixel() since the last reset. */
+  SizeValueType GetNumberOfLookups(void) const
+    { return m_NumberOfLookups; }
+
+  /** Get the number of calls to GetPixel() answered by the bitmap
+   *  alone, without looking up the wrapped container. */
+  SizeValueType GetNumberOfSkippedLookups(void) const
+    { return m_NumberOfSkippedLookups; }
+
+  /** Reset the lookup counters. */
+  void ResetStatistics(void)
+    {
+    m_NumberOfLookups = 0;
+    m_NumberOfSkippedLookups = 0;
+    }
+
+protected:
+  SparseVectorImageOccupancyContainer();
+  virtual ~SparseVectorImageOccupancyContainer() {}
+
+  void PrintSelf(std::ostream& os, Indent indent) const;
+
+  /** Index of the bit of the brick containing the voxel at the given
+   *  offset. */
+  SizeValueType ComputeBit(ElementIdentifier offset) const
+    {
+    if ( VBrickBits == 0 )
+      {
+      return static_cast< SizeValueType >( offset );
+      }
+
+    SizeValueType bit = 0;
+    for ( unsigned int d = 0; d < m_Dimension; d++ )
+      {
+      bit += ( ( offset / m_OffsetTable[d] ) % m_Size[d] >> VBrickBits ) * m_BrickOffsetTable[d];
+      }
+    return bit;
+    }
+
+  bool IsOccupied(ElementIdentifier offset) const
+    {
+    const SizeValueType bit = this->ComputeBit( offset );
+    return bit >= m_NumberOfBricks || ( ( m_Occupancy[bit >> 6] >> ( bit & 63 ) ) & 1 );
+    }
+
+  void SetOccupied(ElementIdentifier offset)
+    {
+    if ( m_Occupancy.empty() )
+      {
+      return;
+      }
+    const SizeValueType bit = this->ComputeBit( offset );
+    if ( bit < m_NumberOfBricks )
+      {
+      m_Occupancy[bit >> 6] |= static_cast< uint64_t >( 1 ) << ( bit & 63 );
+      }
+    }
+
+  /** Visitor setting the bits of the stored voxels. */
+  struct OccupancyBuilder
+    {
+    OccupancyBuilder( Self *container, VectorLengthType length )
+      : m_Self( container ), m_Length( length ) {}
+
+    void operator()( ElementIdentifier key, const Element & )
+      {
+      m_Self->SetOccupied( key / m_Length );
+      }
+
+    Self *           m_Self;
+    ElementIdentifier m_Length;
+    };
+
+private:
+  SparseVectorImageOccupancyContainer(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  ContainerPointer          m_Container;
+  std::vector< uint64_t >   m_Occupancy;
+  SizeValueType             m_NumberOfBricks;
+
+  unsigned int              m_Dimension;
+  SizeValueType             m_Size[MaximumDimension];
+  SizeValueType             m_OffsetTable[MaximumDimension];
+  SizeValueType             m_BrickOffsetTable[MaximumDimension];
+
+  bool                      m_CollectStatistics;
+  mutable SizeValueType     m_NumberOfLookups;
+  mutable SizeValueType     m_NumberOfSkippedLookups;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkSparseVectorImageOccupancyContainer.hxx"
+#endif
+
+#endif
@@ -0,0 +1,117 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Occupancy Container
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef _itkSparseVectorImageOccupancyContainer_hxx
+#define _itkSparseVectorImageOccupancyContainer_hxx
+
+#include "itkSparseVectorImageOccupancyContainer.h"
+
+namespace itk
+{
+
+template <typename TContainer, unsigned int VBrickBits>
+SparseVectorImageOccupancyContainer< TContainer, VBrickBits >
+::SparseVectorImageOccupancyContainer()
+{
+  m_Container = ContainerType::New();
+  m_NumberOfBricks = 0;
+  m_Dimension = 0;
+  m_CollectStatistics = false;
+  m_NumberOfLookups = 0;
+  m_NumberOfSkippedLookups = 0;
+}
+
+
+template <typename TContainer, unsigned int VBrickBits>
+void
+SparseVectorImageOccupancyContainer< TContainer, VBrickBits >
+::SetImageSize(unsigned int dimension, const SizeValueType *size)
+{
+  if ( dimension == 0 || dimension > MaximumDimension )
+    {
+    itkExceptionMacro( << "Image dimension " << dimension << " is not supported" );
+    }
+
+  m_Container->SetImageSize( dimension, size );
+
+  m_Dimension = dimension;
+  SizeValueType offset = 1;
+  SizeValueType bricks = 1;
+  for ( unsigned int d = 0; d < dimension; d++ )
+    {
+    m_Size[d] = size[d];
+    m_OffsetTable[d] = offset;
+    m_BrickOffsetTable[d] = bricks;
+    offset *= size[d];
+    bricks *= ( size[d] + BrickLength - 1 ) >> VBrickBits;
+    }
+
+  m_NumberOfBricks = bricks;
+  m_Occupancy.assign( ( bricks + 63 ) / 64, 0 );
+  this->RebuildOccupancy();
+  this->Modified();
+}
+
+
+template <typename TContainer, unsigned int VBrickBits>
+void
+SparseVectorImageOccupancyContainer< TContainer, VBrickBits >
+::RebuildOccupancy(void)
+{
+  std::fill( m_Occupancy.begin(), m_Occupancy.end(), 0 );
+  if ( m_Occupancy.empty() || m_Container->GetVectorLength() == 0 )
+    {
+    return;
+    }
+
+  OccupancyBuilder builder( this, m_Container->GetVectorLength() );
+  m_Container->VisitElements( builder );
+}
+
+
+template <typename TContainer, unsigned int VBrickBits>
+SizeValueType
+SparseVectorImageOccupancyContainer< TContainer, VBrickBits >
+::GetNumberOfOccupiedBricks(void) const
+{
+  SizeValueType count = 0;
+  for ( SizeValueType w = 0; w < m_Occupancy.size(); w++ )
+    {
+    for ( uint64_t word = m_Occupancy[w]; word != 0; word &= word - 1 )
+      {
+      count++;
+      }
+    }
+  return count;
+}
+
+
+template <typename TContainer, unsigned int VBrickBits>
+void
+SparseVectorImageOccupancyContainer< TContainer, VBrickBits >
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+
+  os << indent << "Brick length: " << BrickLength << std::endl;
+  os << indent << "Number of bricks: " << m_NumberOfBricks << std::endl;
+  os << indent << "Number of occupied bricks: " << this->GetNumberOfOccupiedBricks() << std::endl;
+  os << indent << "Number of lookups: " << m_NumberOfLookups
+     << ", skipped: " << m_NumberOfSkippedLookups << std::endl;
+  os << indent << "Container: " << std::endl;
+  m_Container->Print( os, indent.GetNextIndent() );
+}
+
+} // end namespace itk
+
+#endif
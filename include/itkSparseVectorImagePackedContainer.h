@@ -0,0 +1,258 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Packed Container
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef __itkSparseVectorImagePackedContainer_h
+#define __itkSparseVectorImagePackedContainer_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkNumericTraits.h"
+#include "itkIntTypes.h"
+#include <algorithm>
+#include <vector>
+#include <tr1/unordered_map>
+
+namespace itk
+{
+
+/** \class SparseVectorImagePackedContainer
+ *  \brief A voxel-keyed image container storing only the non-zero
+ *  components of each voxel.
+ *
+ *  SparseVectorImageContainer pays a full hash entry for every non-zero
+ *  component, and SparseVectorImageVoxelContainer stores every component
+ *  of a non-empty voxel, including the zero ones. For pixels that are
+ *  partly sparse, e.g. spherical harmonics or ODF coefficients with 30
+ *  to 60% of zeros, this container keeps one hash entry per non-empty
+ *  voxel, mapping the voxel offset to a slot with:
+ *  - a bitmask of the non-zero component positions, one bit per
+ *    component, i.e. ceil( VectorLength / 64 ) 64-bit words,
+ *  - the position in a shared value array of the packed non-zero
+ *    components of the voxel, in component order.
+ *
+ *  GetPixel() expands the packed values into the pixel by walking the
+ *  bitmask: component i is the next packed value when bit i is set and
+ *  zero otherwise. As in SparseVectorImageVoxelContainer, the zero
+ *  components of a stored voxel are returned as zero, not as the fill
+ *  value.
+ *
+ *  SetPixel() writes the voxel as a whole. When a voxel gets more
+ *  non-zero components than its slot can hold, e.g. while the reader
+ *  loads the components one by one with SetElement(), its values are
+ *  moved to the end of the value array with room to grow. Squeeze()
+ *  packs the value array again, and is worth calling after a bulk load.
+ *
+ *  \code
+ *  typedef itk::SparseVectorImage< float, 3,
+ *    itk::SparseVectorImagePackedContainer< unsigned long, float > > ImageType;
+ *  \endcode
+ *
+ *  \sa SparseVectorImageVoxelContainer
+ *
+ *  \ingroup ITKSparseVectorImage
+ *
+ */
+
+template <typename TElementIdentifier, typename TElement,
+          typename TOffsetMap = std::tr1::unordered_map< TElementIdentifier, SizeValueType > >
+class SparseVectorImagePackedContainer:  public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef SparseVectorImagePackedContainer  Self;
+  typedef Object                            Superclass;
+  typedef SmartPointer<Self>                Pointer;
+  typedef SmartPointer<const Self>          ConstPointer;
+
+  /** Save the template parameters. */
+  typedef TElementIdentifier  ElementIdentifier;
+  typedef TElement            Element;
+
+  /** Map from voxel offset to the slot of the voxel. */
+  typedef TOffsetMap OffsetMapType;
+
+  /** Packed non-zero components of all the stored voxels. */
+  typedef std::vector< Element > ValueArrayType;
+
+  /** Word of the component bitmasks. */
+  typedef uint64_t MaskWordType;
+
+  typedef unsigned int VectorLengthType;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Standard part of every itk Object. */
+  itkTypeMacro(SparseVectorImagePackedContainer, Object);
+
+  /** Get the number of non-zero components currently stored. */
+  unsigned long Size(void) const
+    { return (unsigned long) m_NumberOfValues; };
+
+  /** Get the number of voxels currently stored in the container. */
+  unsigned long GetNumberOfVoxels(void) const
+    { return (unsigned long) m_OffsetMap.size(); };
+
+  /** Get the number of entries of the value array, including the room
+   *  left for voxels to grow. Squeeze() brings it down to Size(). */
+  unsigned long GetValueArraySize(void) const
+    { return (unsigned long) m_ValueArray.size(); };
+
+  /** Set the number of components of each pixel. Changing the length
+   *  discards the stored pixels. */
+  void SetVectorLength(VectorLengthType length);
+  itkGetConstMacro(VectorLength, VectorLengthType);
+
+  /** The layout of this container does not depend on the image size.
+   *  This method does nothing. */
+  void SetImageSize(unsigned int, const SizeValueType *) {}
+
+  /** Copy the components of the pixel at the given offset into pixel.
+   *  If the pixel is not stored, fillValue is copied instead. Return
+   *  true if the pixel is stored. */
+  bool GetPixel(ElementIdentifier offset, const Element *fillValue,
+                Element *pixel) const
+    {
+    typename OffsetMapType::const_iterator it = m_OffsetMap.find( offset );
+    if ( it == m_OffsetMap.end() )
+      {
+      std::copy( fillValue, fillValue + m_VectorLength, pixel );
+      return false;
+      }
+
+    const SizeValueType slot = it->second;
+    const MaskWordType *mask = &m_Masks[slot * m_MaskWords];
+    const Element *values = this->GetValues( slot );
+    const Element zero = NumericTraits< Element >::Zero;
+
+    for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
+      {
+      const unsigned int bit = static_cast< unsigned int >( ( mask[i >> 6] >> ( i & 63 ) ) & 1 );
+      pixel[i] = bit ? *values : zero;
+      values += bit;
+      }
+    return true;
+    }
+
+  /** Store the non-zero components of the pixel at the given offset.
+   *  The pixel replaces the components already stored, and is not
+   *  stored at all if it is not stored yet and all its components are
+   *  zero. */
+  void SetPixel(ElementIdentifier offset, const Element *pixel);
+
+  /** Store a single component given its key, i.e.
+   *  VectorLength * offset + component. Storing zero clears the bit of
+   *  the component. */
+  void SetElement(ElementIdentifier key, const Element & value);
+
+  /** Call visitor( key, value ) for every non-zero component of the
+   *  stored voxels. */
+  template< class TVisitor >
+  void VisitElements(TVisitor & visitor) const
+    {
+    for ( typename OffsetMapType::const_iterator it = m_OffsetMap.begin();
+          it != m_OffsetMap.end(); ++it )
+      {
+      const ElementIdentifier first = m_VectorLength * it->first;
+      const MaskWordType *mask = &m_Masks[it->second * m_MaskWords];
+      const Element *values = this->GetValues( it->second );
+      for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
+        {
+        if ( ( mask[i >> 6] >> ( i & 63 ) ) & 1 )
+          {
+          visitor( first + i, *values++ );
+          }
+        }
+      }
+    }
+
+  /** Presize the offset map and the value array for the given number of
+   *  stored elements. */
+  void Reserve(SizeValueType size);
+
+  /** Pack the value array, removing the room left for voxels to grow,
+   *  and shrink the offset map to the current number of voxels. */
+  void Squeeze(void);
+
+  /** Remove all the stored pixels. */
+  void Clear(void);
+
+  /** Tell the container to release any of its allocated memory. */
+  void Initialize(void);
+
+  /** See SparseVectorImageContainer::SetContainerManageMemory(). */
+  itkSetMacro(ContainerManageMemory,bool);
+  itkGetMacro(ContainerManageMemory,bool);
+  itkBooleanMacro(ContainerManageMemory);
+
+  /** Number of bits set in a mask word. */
+  static unsigned int PopCount(MaskWordType word)
+    {
+    word = word - ( ( word >> 1 ) & 0x5555555555555555ULL );
+    word = ( word & 0x3333333333333333ULL ) + ( ( word >> 2 ) & 0x3333333333333333ULL );
+    word = ( word + ( word >> 4 ) ) & 0x0f0f0f0f0f0f0f0fULL;
+    return static_cast< unsigned int >( ( word * 0x0101010101010101ULL ) >> 56 );
+    }
+
+protected:
+  SparseVectorImagePackedContainer();
+  virtual ~SparseVectorImagePackedContainer();
+
+  void PrintSelf(std::ostream& os, Indent indent) const;
+
+  /** Packed values of a slot. */
+  const Element * GetValues(SizeValueType slot) const
+    { return m_ValueArray.empty() ? NULL : &m_ValueArray[0] + m_Starts[slot]; }
+
+  /** Number of non-zero components of a slot. */
+  VectorLengthType CountValues(SizeValueType slot) const
+    {
+    VectorLengthType count = 0;
+    for ( unsigned int w = 0; w < m_MaskWords; w++ )
+      {
+      count += PopCount( m_Masks[slot * m_MaskWords + w] );
+      }
+    return count;
+    }
+
+  /** Return the slot of the voxel at the given offset, creating an empty
+   *  one if the voxel is not stored yet. */
+  SizeValueType GetSlot(ElementIdentifier offset);
+
+  /** Make sure the slot can hold the given number of values, moving
+   *  them to the end of the value array if needed. */
+  void ReserveValues(SizeValueType slot, VectorLengthType count);
+
+private:
+  SparseVectorImagePackedContainer(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  OffsetMapType                      m_OffsetMap;
+  std::vector< MaskWordType >        m_Masks;
+  std::vector< SizeValueType >       m_Starts;
+  std::vector< VectorLengthType >    m_Capacities;
+  ValueArrayType                     m_ValueArray;
+  SizeValueType                      m_NumberOfValues;
+
+  VectorLengthType                   m_VectorLength;
+  unsigned int                       m_MaskWords;
+  bool                               m_ContainerManageMemory;
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkSparseVectorImagePackedContainer.hxx"
+#endif
+
+#endif
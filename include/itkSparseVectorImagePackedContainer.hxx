@@ -0,0 +1,314 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Packed Container
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef _itkSparseVectorImagePackedContainer_hxx
+#define _itkSparseVectorImagePackedContainer_hxx
+
+#include "itkSparseVectorImagePackedContainer.h"
+#include <cmath>
+
+namespace itk
+{
+
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+SparseVectorImagePackedContainer< TElementIdentifier , TElement , TOffsetMap >
+::SparseVectorImagePackedContainer()
+{
+  m_VectorLength = 1;
+  m_MaskWords = 1;
+  m_NumberOfValues = 0;
+  m_ContainerManageMemory = true;
+}
+
+
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+SparseVectorImagePackedContainer< TElementIdentifier , TElement , TOffsetMap >
+::~SparseVectorImagePackedContainer()
+{
+  if( m_ContainerManageMemory )
+    {
+    this->Clear();
+    }
+}
+
+
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+void
+SparseVectorImagePackedContainer< TElementIdentifier , TElement , TOffsetMap >
+::SetVectorLength(VectorLengthType length)
+{
+  if ( length == m_VectorLength )
+    {
+    return;
+    }
+
+  this->Clear();
+  m_VectorLength = length;
+  m_MaskWords = ( length + 63 ) / 64;
+  this->Modified();
+}
+
+
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+void
+SparseVectorImagePackedContainer< TElementIdentifier , TElement , TOffsetMap >
+::SetPixel(ElementIdentifier offset, const Element *pixel)
+{
+  VectorLengthType count = 0;
+  for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
+    {
+    if ( pixel[i] != 0 )
+      {
+      count++;
+      }
+    }
+
+  if ( count == 0 && m_OffsetMap.find( offset ) == m_OffsetMap.end() )
+    {
+    return;
+    }
+
+  const SizeValueType slot = this->GetSlot( offset );
+  m_NumberOfValues -= this->CountValues( slot );
+  this->ReserveValues( slot, count );
+
+  MaskWordType *mask = &m_Masks[slot * m_MaskWords];
+  std::fill( mask, mask + m_MaskWords, 0 );
+  Element *values = count > 0 ? &m_ValueArray[0] + m_Starts[slot] : NULL;
+  for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
+    {
+    if ( pixel[i] != 0 )
+      {
+      mask[i >> 6] |= static_cast< MaskWordType >( 1 ) << ( i & 63 );
+      *values++ = pixel[i];
+      }
+    }
+  m_NumberOfValues += count;
+}
+
+
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+void
+SparseVectorImagePackedContainer< TElementIdentifier , TElement , TOffsetMap >
+::SetElement(ElementIdentifier key, const Element & value)
+{
+  const ElementIdentifier offset = key / m_VectorLength;
+  const VectorLengthType component = static_cast< VectorLengthType >( key % m_VectorLength );
+
+  if ( value == 0 && m_OffsetMap.find( offset ) == m_OffsetMap.end() )
+    {
+    return;
+    }
+
+  const SizeValueType slot = this->GetSlot( offset );
+  const VectorLengthType count = this->CountValues( slot );
+
+  // Position of the component among the packed values of the voxel
+  const MaskWordType bit = static_cast< MaskWordType >( 1 ) << ( component & 63 );
+  const unsigned int word = component >> 6;
+  VectorLengthType rank = PopCount( m_Masks[slot * m_MaskWords + word] & ( bit - 1 ) );
+  for ( unsigned int w = 0; w < word; w++ )
+    {
+    rank += PopCount( m_Masks[slot * m_MaskWords + w] );
+    }
+
+  if ( m_Masks[slot * m_MaskWords + word] & bit )
+    {
+    Element *values = &m_ValueArray[0] + m_Starts[slot];
+    if ( value != 0 )
+      {
+      values[rank] = value;
+      }
+    else
+      {
+      std::copy( values + rank + 1, values + count, values + rank );
+      m_Masks[slot * m_MaskWords + word] &= ~bit;
+      m_NumberOfValues--;
+      }
+    return;
+    }
+
+  if ( value == 0 )
+    {
+    return;
+    }
+
+  this->ReserveValues( slot, count + 1 );
+  Element *values = &m_ValueArray[0] + m_Starts[slot];
+  std::copy_backward( values + rank, values + count, values + count + 1 );
+  values[rank] = value;
+  m_Masks[slot * m_MaskWords + word] |= bit;
+  m_NumberOfValues++;
+}
+
+
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+SizeValueType
+SparseVectorImagePackedContainer< TElementIdentifier , TElement , TOffsetMap >
+::GetSlot(ElementIdentifier offset)
+{
+  std::pair< typename OffsetMapType::iterator, bool > inserted =
+    m_OffsetMap.insert( std::make_pair( offset,
+      static_cast< SizeValueType >( m_Starts.size() ) ) );
+
+  if ( inserted.second )
+    {
+    m_Masks.resize( m_Masks.size() + m_MaskWords, 0 );
+    m_Starts.push_back( m_ValueArray.size() );
+    m_Capacities.push_back( 0 );
+    }
+
+  return inserted.first->second;
+}
+
+
+/**
+ * Move the values of a slot to the end of the value array when they
+ * do not fit anymore. The capacity of the slot is doubled, so that a
+ * voxel loaded component by component is moved a few times only.
+ */
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+void
+SparseVectorImagePackedContainer< TElementIdentifier , TElement , TOffsetMap >
+::ReserveValues(SizeValueType slot, VectorLengthType count)
+{
+  if ( count <= m_Capacities[slot] )
+    {
+    return;
+    }
+
+  const VectorLengthType capacity =
+    std::min( m_VectorLength, std::max( count, 2 * m_Capacities[slot] ) );
+  const SizeValueType start = m_ValueArray.size();
+  m_ValueArray.resize( start + capacity, NumericTraits< Element >::Zero );
+
+  const VectorLengthType stored = this->CountValues( slot );
+  std::copy( m_ValueArray.begin() + m_Starts[slot],
+             m_ValueArray.begin() + m_Starts[slot] + stored,
+             m_ValueArray.begin() + start );
+
+  m_Starts[slot] = start;
+  m_Capacities[slot] = capacity;
+}
+
+
+/**
+ * Tell the container to allocate enough memory to allow at least
+ * as many elements as the size given to be stored.
+ */
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+void
+SparseVectorImagePackedContainer< TElementIdentifier , TElement , TOffsetMap >
+::Reserve(SizeValueType size)
+{
+  if ( m_VectorLength == 0 )
+    {
+    return;
+    }
+
+  const SizeValueType voxels = ( size + m_VectorLength - 1 ) / m_VectorLength;
+  if ( voxels > m_OffsetMap.size() )
+    {
+    m_OffsetMap.rehash( static_cast< SizeValueType >(
+      std::ceil( voxels / m_OffsetMap.max_load_factor() ) ) );
+    }
+  m_Masks.reserve( voxels * m_MaskWords );
+  m_Starts.reserve( voxels );
+  m_Capacities.reserve( voxels );
+  m_ValueArray.reserve( size );
+}
+
+
+/**
+ * Pack the values of the slots, in slot order, without room to grow.
+ */
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+void
+SparseVectorImagePackedContainer< TElementIdentifier , TElement , TOffsetMap >
+::Squeeze(void)
+{
+  ValueArrayType values;
+  values.reserve( m_NumberOfValues );
+  for ( SizeValueType slot = 0; slot < m_Starts.size(); slot++ )
+    {
+    const VectorLengthType count = this->CountValues( slot );
+    const SizeValueType start = values.size();
+    values.insert( values.end(), m_ValueArray.begin() + m_Starts[slot],
+                   m_ValueArray.begin() + m_Starts[slot] + count );
+    m_Starts[slot] = start;
+    m_Capacities[slot] = count;
+    }
+  m_ValueArray.swap( values );
+
+  m_OffsetMap.rehash( 0 );
+  std::vector< MaskWordType >( m_Masks ).swap( m_Masks );
+  std::vector< SizeValueType >( m_Starts ).swap( m_Starts );
+  std::vector< VectorLengthType >( m_Capacities ).swap( m_Capacities );
+}
+
+
+/**
+ * Remove all the stored pixels.
+ */
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+void
+SparseVectorImagePackedContainer< TElementIdentifier , TElement , TOffsetMap >
+::Clear(void)
+{
+  m_OffsetMap.clear();
+  m_Masks.clear();
+  m_Starts.clear();
+  m_Capacities.clear();
+  m_ValueArray.clear();
+  m_NumberOfValues = 0;
+}
+
+
+/**
+ * Tell the container to release any of its allocated memory.
+ */
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+void
+SparseVectorImagePackedContainer< TElementIdentifier , TElement , TOffsetMap >
+::Initialize(void)
+{
+  if ( this->GetNumberOfVoxels() > 0 )
+    {
+    if( m_ContainerManageMemory )
+      {
+      this->Clear();
+      }
+    m_ContainerManageMemory = true;
+    this->Modified();
+    }
+}
+
+
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+void
+SparseVectorImagePackedContainer< TElementIdentifier , TElement , TOffsetMap >
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+
+  os << indent << "VectorLength: " << m_VectorLength << std::endl;
+  os << indent << "Number of stored voxels: " << this->GetNumberOfVoxels() << std::endl;
+  os << indent << "Number of stored values: " << m_NumberOfValues << std::endl;
+  os << indent << "Value array size: " << m_ValueArray.size() << std::endl;
+  os << indent << "Container manages memory: "
+     << (m_ContainerManageMemory ? "true" : "false") << std::endl;
+}
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,131 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Parallel For
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef __itkSparseVectorImageParallelFor_h
+#define __itkSparseVectorImageParallelFor_h
+
+#include "itkMultiThreader.h"
+#include <algorithm>
+#include <vector>
+
+namespace itk
+{
+
+/** \class SparseVectorImageParallelFor
+ *  \brief Split a range of items of a container over the threads of an
+ *  itk::MultiThreader.
+ *
+ *  Run( size, functor ) calls functor( begin, end ) once per thread,
+ *  the ranges [begin, end) covering [0, size) without overlapping, and
+ *  returns when all the threads are done. Ranges of less than Grain
+ *  items are not worth a thread: small containers are processed by the
+ *  calling thread only.
+ *
+ *  The containers use it for their whole-container operations, Prune()
+ *  and DeepCopy(), over their slots, arrays or shards.
+ *
+ *  \ingroup ITKSparseVectorImage
+ *
+ */
+template <typename TFunctor>
+class SparseVectorImageParallelFor
+{
+public:
+  /** Minimum number of items per thread. */
+  itkStaticConstMacro(Grain, SizeValueType, 4096);
+
+  static void Run(SizeValueType size, TFunctor & functor,
+                  SizeValueType grain = Grain)
+    {
+    ThreadIdType numberOfThreads = MultiThreader::GetGlobalDefaultNumberOfThreads();
+    if ( grain > 0 && size / grain < numberOfThreads )
+      {
+      numberOfThreads = static_cast< ThreadIdType >( size / grain );
+      }
+
+    if ( numberOfThreads <= 1 )
+      {
+      functor( 0, size );
+      return;
+      }
+
+    ThreadStruct str;
+    str.m_Functor = &functor;
+    str.m_Size = size;
+
+    MultiThreader::Pointer threader = MultiThreader::New();
+    threader->SetNumberOfThreads( numberOfThreads );
+    threader->SetSingleMethod( ThreaderCallback, &str );
+    threader->SingleMethodExecute();
+    }
+
+private:
+  struct ThreadStruct
+    {
+    TFunctor *     m_Functor;
+    SizeValueType  m_Size;
+    };
+
+  static ITK_THREAD_RETURN_TYPE ThreaderCallback(void *arg)
+    {
+    MultiThreader::ThreadInfoStruct *info =
+      static_cast< MultiThreader::ThreadInfoStruct * >( arg );
+    ThreadStruct *str = static_cast< ThreadStruct * >( info->UserData );
+
+    const SizeValueType threadId = info->ThreadID;
+    const SizeValueType numberOfThreads = info->NumberOfThreads;
+    const SizeValueType begin = str->m_Size * threadId / numberOfThreads;
+    const SizeValueType end = str->m_Size * ( threadId + 1 ) / numberOfThreads;
+
+    if ( begin < end )
+      {
+      ( *str->m_Functor )( begin, end );
+      }
+    return ITK_THREAD_RETURN_VALUE;
+    }
+};
+
+
+/** Copy an array, e.g. the value array of a container, with
+ *  SparseVectorImageParallelFor. */
+template <typename T>
+struct SparseVectorImageArrayCopier
+{
+  void operator()( SizeValueType begin, SizeValueType end )
+    {
+    std::copy( m_Source + begin, m_Source + end, m_Destination + begin );
+    }
+
+  const T * m_Source;
+  T *       m_Destination;
+};
+
+template <typename T>
+void
+SparseVectorImageParallelCopy(const std::vector< T > & source, std::vector< T > & destination)
+{
+  std::vector< T >( source.size() ).swap( destination );
+  if ( source.empty() )
+    {
+    return;
+    }
+
+  SparseVectorImageArrayCopier< T > copier;
+  copier.m_Source = &source[0];
+  copier.m_Destination = &destination[0];
+  SparseVectorImageParallelFor< SparseVectorImageArrayCopier< T > >::Run( source.size(), copier, 1 << 16 );
+}
+
+} // end namespace itk
+
+#endif
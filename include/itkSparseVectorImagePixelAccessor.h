@@ -15,7 +15,10 @@
 #define __itkSparseVectorImagePixelAccessor_h
 
 #include "itkMacro.h"
-#include "itkVariableLengthVector.h"
+#include "itkNumericTraits.h"
+#include "itkSparseVectorImagePixelTraits.h"
+#include <cmath>
+#include <vector>
 
 
 namespace itk
@@ -28,69 +31,83 @@ namespace itk
  * with the same \c DefaultPixelAccessor interface that
  * DefaultPixelAccessor provides to Image.
  *
- * SparseVectorImagePixelAccessor is templated over an internal type and an
- * external type representation. This class encapsulates a
+ * SparseVectorImagePixelAccessor is templated over an internal type, the
+ * container of the image and the pixel traits of the image, which give
+ * the external type. This class encapsulates a
  * customized convertion between the internal and external
  * type representations.
  *
  * \ingroup ITKSparseVectorImage 
  *
  */
-template <class TType, class TPixelMapType>
+template <class TType, class TPixelContainer,
+          class TPixelTraits = SparseVectorImagePixelTraits<TType> >
 class ITK_EXPORT SparseVectorImagePixelAccessor
 {
 public:
 
  /** External typedef. It defines the external aspect
    * that this class will exhibit. */
-  typedef VariableLengthVector<TType> ExternalType;
+  typedef typename TPixelTraits::PixelType ExternalType;
 
   /** Internal typedef. It defines the internal real
    * representation of data. */
 //  typedef VariableLengthVector<TType> InternalType;
   typedef TType InternalType;
 
-  /** Typedef for pixel map. */
-  typedef TPixelMapType PixelMapType;
+  /** Typedef for the pixel container. */
+  typedef TPixelContainer PixelContainerType;
 
   typedef unsigned int VectorLengthType;
 
   /** Set output using the value in input */
   inline void Set(InternalType & output, const ExternalType & input, const unsigned long offset ) const
     {
-    unsigned long trueOffset = m_VectorLength * offset;
-    
-    for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
+    SetComponents( m_PixelContainer, offset, input.GetDataPointer(),
+                   m_VectorLength, m_ZeroThreshold );
+    }
+
+  /** Store the components of a pixel at the given offset of a container.
+   *  The components whose magnitude is at most threshold are written as
+   *  zero, so that the container does not store them, and erases them if
+   *  they were stored. A threshold of 0 writes the components as is. */
+  static void SetComponents( PixelContainerType *container, unsigned long offset,
+                             const InternalType *components, VectorLengthType length,
+                             double threshold )
+    {
+    if ( threshold <= 0 )
+      {
+      container->SetPixel( offset, components );
+      return;
+      }
+
+    InternalType stackComponents[StackLength];
+    std::vector< InternalType > heapComponents;
+    InternalType *thresholded = stackComponents;
+    if ( length > StackLength )
       {
-      if ( input[i] != 0 )
-        {
-        m_PixelMap->operator[](trueOffset + i) = input[i];
-        }
+      heapComponents.resize( length );
+      thresholded = &heapComponents[0];
       }
+
+    for ( VectorLengthType i = 0; i < length; i++ )
+      {
+      thresholded[i] = std::fabs( static_cast< double >( components[i] ) ) <= threshold ?
+        NumericTraits< InternalType >::Zero : components[i];
+      }
+    container->SetPixel( offset, thresholded );
     }
 
-  /** Get the value from input */
+  /** Get the value from input. The container is only read, so that
+   *  concurrent calls are safe while no thread writes to the image. */
   inline ExternalType Get( const InternalType & begin, const unsigned long offset ) const
     {
-    unsigned long trueOffset = m_VectorLength * offset;
-
     ExternalType pixel;
-    pixel.SetSize(m_VectorLength);
-    
-    for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
-      {
-      typename PixelMapType::const_iterator it = m_PixelMap->find( trueOffset + i );
-      
-      if ( it == m_PixelMap->end() )
-        {
-        pixel[i] = m_FillBufferValue[i];
-        }
-      else
-        {
-        pixel[i] = m_PixelMap->operator[](trueOffset + i);
-        }
-      }
-    
+    TPixelTraits::SetLength( pixel, m_VectorLength );
+
+    m_PixelContainer->GetPixel( offset, m_FillBufferValue.GetDataPointer(),
+                                pixel.GetDataPointer() );
+
     return pixel;
     }
 
@@ -103,23 +120,30 @@ public:
   /** Get Vector lengths */
   VectorLengthType GetVectorLength() const { return m_VectorLength; }
   
-  SparseVectorImagePixelAccessor() : m_VectorLength(0) {}
+  SparseVectorImagePixelAccessor() : m_PixelContainer(NULL), m_VectorLength(0), m_ZeroThreshold(0.0) {}
 
-   /** Constructor to initialize slices and image size at construction time */
-   SparseVectorImagePixelAccessor( PixelMapType* pixelMap,
-     ExternalType fillBufferValue, VectorLengthType length)
+   /** Constructor to initialize the container, the fill value and the
+    *  zero threshold of the image at construction time */
+   SparseVectorImagePixelAccessor( PixelContainerType* container,
+     ExternalType fillBufferValue, VectorLengthType length,
+     double zeroThreshold = 0.0 )
      {
-     m_PixelMap = pixelMap;
+     m_PixelContainer = container;
      m_FillBufferValue = fillBufferValue;
      m_VectorLength = length;
+     m_ZeroThreshold = zeroThreshold;
      }
 
   virtual ~SparseVectorImagePixelAccessor() {};
 
+  /** Pixels up to this length are thresholded in a buffer on the stack. */
+  itkStaticConstMacro(StackLength, unsigned int, 64);
+
 private:
-  PixelMapType* m_PixelMap;
+  PixelContainerType* m_PixelContainer;
   ExternalType m_FillBufferValue;
   VectorLengthType m_VectorLength;
+  double m_ZeroThreshold;
 };
 
 } // end namespace itk
@@ -0,0 +1,110 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Pixel Traits
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef __itkSparseVectorImagePixelTraits_h
+#define __itkSparseVectorImagePixelTraits_h
+
+#include "itkVariableLengthVector.h"
+#include "itkFixedArray.h"
+#include "itkVector.h"
+
+namespace itk
+{
+
+/** \class SparseVectorImagePixelTraits
+ * \brief Pixel type of a SparseVectorImage given its template argument.
+ *
+ * By default a SparseVectorImage< TPixel, D > returns pixels of type
+ * VariableLengthVector< TPixel >, whose length is set at run time with
+ * SetVectorLength(). Each returned pixel then allocates its components
+ * on the heap.
+ *
+ * When the image is templated over Vector< T, N > or FixedArray< T, N >,
+ * the vector length is fixed at compile time: the pixels are returned by
+ * value without any allocation, and the loops over the components in the
+ * accessors and interpolators have a constant bound. The components are
+ * still stored as T in the container.
+ *
+ * Length is 0 when the length is only known at run time. Rebind gives
+ * the pixel type with another component type, e.g. the output type of
+ * the interpolators.
+ *
+ * \ingroup ITKSparseVectorImage
+ *
+ */
+template< class TPixel >
+struct SparseVectorImagePixelTraits
+{
+  typedef TPixel                          ValueType;
+  typedef VariableLengthVector< TPixel >  PixelType;
+
+  itkStaticConstMacro( Length, unsigned int, 0 );
+
+  template< class TValue >
+  struct Rebind
+    {
+    typedef VariableLengthVector< TValue > Type;
+    };
+
+  /** Resize the pixel to the given number of components. The
+   *  components are not initialized. */
+  template< class TVector >
+  static void SetLength( TVector & pixel, unsigned int length )
+    {
+    pixel.SetSize( length );
+    }
+};
+
+
+template< class T, unsigned int VLength >
+struct SparseVectorImagePixelTraits< Vector< T, VLength > >
+{
+  typedef T                      ValueType;
+  typedef Vector< T, VLength >   PixelType;
+
+  itkStaticConstMacro( Length, unsigned int, VLength );
+
+  template< class TValue >
+  struct Rebind
+    {
+    typedef Vector< TValue, VLength > Type;
+    };
+
+  /** The length is fixed, this method does nothing. */
+  template< class TVector >
+  static void SetLength( TVector &, unsigned int ) {}
+};
+
+
+template< class T, unsigned int VLength >
+struct SparseVectorImagePixelTraits< FixedArray< T, VLength > >
+{
+  typedef T                          ValueType;
+  typedef FixedArray< T, VLength >   PixelType;
+
+  itkStaticConstMacro( Length, unsigned int, VLength );
+
+  template< class TValue >
+  struct Rebind
+    {
+    typedef FixedArray< TValue, VLength > Type;
+    };
+
+  /** The length is fixed, this method does nothing. */
+  template< class TVector >
+  static void SetLength( TVector &, unsigned int ) {}
+};
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,318 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Pool Allocator
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef __itkSparseVectorImagePoolAllocator_h
+#define __itkSparseVectorImagePoolAllocator_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <new>
+#include <utility>
+#include <vector>
+#include <tr1/unordered_map>
+
+namespace itk
+{
+
+/** \class SparseVectorImageMemoryPool
+ *  \brief A slab pool of small fixed size chunks.
+ *
+ *  Chunks are carved out of slabs of ChunksPerSlab chunks, one series of
+ *  slabs per chunk size, and freed chunks are kept in a free list for
+ *  reuse. Allocating or freeing a chunk never calls malloc or free
+ *  except to get a new slab, and the slabs are only released all
+ *  together, when the pool is destroyed or by Release().
+ *
+ *  The pool is not thread safe. It is meant to be owned by a single map
+ *  through SparseVectorImagePoolAllocator, so that each container, or
+ *  each shard of SparseVectorImageShardedContainer, has its own pool.
+ *  Filters building one container per thread get thread-local pools.
+ *
+ *  \ingroup ITKSparseVectorImage
+ *
+ */
+class SparseVectorImageMemoryPool:  public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef SparseVectorImageMemoryPool  Self;
+  typedef Object                       Superclass;
+  typedef SmartPointer<Self>           Pointer;
+  typedef SmartPointer<const Self>     ConstPointer;
+
+  /** Largest chunk served by the pool, in bytes. */
+  itkStaticConstMacro(MaximumChunkSize, unsigned int, 256);
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Standard part of every itk Object. */
+  itkTypeMacro(SparseVectorImageMemoryPool, Object);
+
+  /** Set/Get the number of chunks of the slabs allocated from now on. */
+  itkSetMacro(ChunksPerSlab, SizeValueType);
+  itkGetConstMacro(ChunksPerSlab, SizeValueType);
+
+  /** Return a chunk of at least size bytes, size being at most
+   *  MaximumChunkSize. */
+  void * Allocate(std::size_t size)
+    {
+    SizeClass & sizeClass = this->GetSizeClass( size );
+
+    if ( sizeClass.m_FreeList )
+      {
+      void *chunk = sizeClass.m_FreeList;
+      sizeClass.m_FreeList = *static_cast< void ** >( chunk );
+      return chunk;
+      }
+
+    if ( sizeClass.m_Next == sizeClass.m_End )
+      {
+      const std::size_t slabSize = sizeClass.m_ChunkSize * m_ChunksPerSlab;
+      sizeClass.m_Next = static_cast< char * >( ::operator new( slabSize ) );
+      sizeClass.m_End = sizeClass.m_Next + slabSize;
+      m_Slabs.push_back( sizeClass.m_Next );
+      m_MemorySize += slabSize;
+      }
+
+    void *chunk = sizeClass.m_Next;
+    sizeClass.m_Next += sizeClass.m_ChunkSize;
+    return chunk;
+    }
+
+  /** Give back a chunk returned by Allocate( size ). */
+  void Deallocate(void *chunk, std::size_t size)
+    {
+    SizeClass & sizeClass = this->GetSizeClass( size );
+    *static_cast< void ** >( chunk ) = sizeClass.m_FreeList;
+    sizeClass.m_FreeList = chunk;
+    }
+
+  /** Free all the slabs at once. The chunks must not be used anymore,
+   *  e.g. the map using the pool must have been cleared. */
+  void Release(void)
+    {
+    for ( std::size_t s = 0; s < m_Slabs.size(); s++ )
+      {
+      ::operator delete( m_Slabs[s] );
+      }
+    std::vector< char * >().swap( m_Slabs );
+    m_SizeClasses.clear();
+    m_MemorySize = 0;
+    }
+
+  /** Get the number of slabs allocated by the pool. */
+  SizeValueType GetNumberOfSlabs(void) const
+    { return static_cast< SizeValueType >( m_Slabs.size() ); }
+
+  /** Get the number of bytes allocated by the pool. */
+  SizeValueType GetMemorySize(void) const
+    { return m_MemorySize; }
+
+protected:
+  SparseVectorImageMemoryPool()
+    {
+    m_ChunksPerSlab = 4096;
+    m_MemorySize = 0;
+    }
+  virtual ~SparseVectorImageMemoryPool()
+    { this->Release(); }
+
+  void PrintSelf(std::ostream& os, Indent indent) const
+    {
+    Superclass::PrintSelf(os,indent);
+    os << indent << "Chunks per slab: " << m_ChunksPerSlab << std::endl;
+    os << indent << "Number of slabs: " << m_Slabs.size() << std::endl;
+    os << indent << "Memory size: " << m_MemorySize << std::endl;
+    }
+
+  /** Chunks of a given size, rounded up to keep them aligned on
+   *  pointers and doubles. */
+  struct SizeClass
+    {
+    std::size_t m_ChunkSize;
+    void *      m_FreeList;
+    char *      m_Next;
+    char *      m_End;
+    };
+
+  SizeClass & GetSizeClass(std::size_t size)
+    {
+    const std::size_t alignment =
+      sizeof( void * ) > sizeof( double ) ? sizeof( void * ) : sizeof( double );
+    const std::size_t chunkSize = ( size + alignment - 1 ) / alignment * alignment;
+
+    // A map only uses one or two chunk sizes, a linear search is enough
+    for ( std::size_t c = 0; c < m_SizeClasses.size(); c++ )
+      {
+      if ( m_SizeClasses[c].m_ChunkSize == chunkSize )
+        {
+        return m_SizeClasses[c];
+        }
+      }
+
+    SizeClass sizeClass;
+    sizeClass.m_ChunkSize = chunkSize;
+    sizeClass.m_FreeList = NULL;
+    sizeClass.m_Next = NULL;
+    sizeClass.m_End = NULL;
+    m_SizeClasses.push_back( sizeClass );
+    return m_SizeClasses.back();
+    }
+
+private:
+  SparseVectorImageMemoryPool(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  std::vector< SizeClass >  m_SizeClasses;
+  std::vector< char * >     m_Slabs;
+  SizeValueType             m_ChunksPerSlab;
+  SizeValueType             m_MemorySize;
+};
+
+
+/** \class SparseVectorImagePoolAllocator
+ *  \brief A standard allocator taking the nodes of a map from a
+ *  SparseVectorImageMemoryPool.
+ *
+ *  Single objects, i.e. the nodes of std::tr1::unordered_map, come from
+ *  the pool, arrays such as the bucket array of the map come from
+ *  operator new. A default constructed allocator creates its own pool,
+ *  and the copies and rebound copies made by the map share it, so that
+ *  each map has its own pool, released with the map. A pool can also be
+ *  given explicitly, e.g. to keep the slabs of a cleared map for the
+ *  next load.
+ *
+ *  Loading an image then costs one malloc per slab instead of one per
+ *  element, and clearing it pushes the nodes onto the free list instead
+ *  of freeing them one by one. SparseVectorImagePoolMap gives the map
+ *  type to use as the TPixelMap template argument of the containers:
+ *
+ *  \code
+ *  typedef itk::SparseVectorImageContainer< unsigned long, float,
+ *    itk::SparseVectorImagePoolMap< unsigned long, float >::Type > ContainerType;
+ *  typedef itk::SparseVectorImage< float, 3, ContainerType > ImageType;
+ *  \endcode
+ *
+ *  \ingroup ITKSparseVectorImage
+ *
+ */
+template <typename T>
+class SparseVectorImagePoolAllocator
+{
+public:
+  /** Typedefs required from a standard allocator. */
+  typedef T                 value_type;
+  typedef T *               pointer;
+  typedef const T *         const_pointer;
+  typedef T &               reference;
+  typedef const T &         const_reference;
+  typedef std::size_t       size_type;
+  typedef std::ptrdiff_t    difference_type;
+
+  template< class U >
+  struct rebind
+    {
+    typedef SparseVectorImagePoolAllocator< U > other;
+    };
+
+  typedef SparseVectorImageMemoryPool PoolType;
+
+  /** Create an allocator with its own pool. */
+  SparseVectorImagePoolAllocator()
+    : m_Pool( PoolType::New() ) {}
+
+  /** Create an allocator using the given pool. */
+  explicit SparseVectorImagePoolAllocator( PoolType *pool )
+    : m_Pool( pool ) {}
+
+  template< class U >
+  SparseVectorImagePoolAllocator( const SparseVectorImagePoolAllocator< U > & other )
+    : m_Pool( other.GetPool() ) {}
+
+  /** Get the pool of the allocator. */
+  PoolType * GetPool() const
+    { return m_Pool.GetPointer(); }
+
+  pointer allocate( size_type n, const void * = 0 )
+    {
+    if ( n == 1 && sizeof( T ) <= PoolType::MaximumChunkSize )
+      {
+      return static_cast< pointer >( m_Pool->Allocate( sizeof( T ) ) );
+      }
+    return static_cast< pointer >( ::operator new( n * sizeof( T ) ) );
+    }
+
+  void deallocate( pointer p, size_type n )
+    {
+    if ( n == 1 && sizeof( T ) <= PoolType::MaximumChunkSize )
+      {
+      m_Pool->Deallocate( p, sizeof( T ) );
+      return;
+      }
+    ::operator delete( p );
+    }
+
+  void construct( pointer p, const T & value )
+    { new( static_cast< void * >( p ) ) T( value ); }
+
+  void destroy( pointer p )
+    { p->~T(); }
+
+  pointer address( reference x ) const
+    { return &x; }
+  const_pointer address( const_reference x ) const
+    { return &x; }
+
+  size_type max_size() const
+    { return std::numeric_limits< size_type >::max() / sizeof( T ); }
+
+private:
+  typename PoolType::Pointer m_Pool;
+};
+
+/** Allocators sharing a pool can free each other's memory. */
+template <typename T, typename U>
+inline bool operator==( const SparseVectorImagePoolAllocator< T > & a,
+                        const SparseVectorImagePoolAllocator< U > & b )
+{
+  return a.GetPool() == b.GetPool();
+}
+
+template <typename T, typename U>
+inline bool operator!=( const SparseVectorImagePoolAllocator< T > & a,
+                        const SparseVectorImagePoolAllocator< U > & b )
+{
+  return a.GetPool() != b.GetPool();
+}
+
+
+/** \class SparseVectorImagePoolMap
+ *  \brief The std::tr1::unordered_map type allocating its nodes with
+ *  SparseVectorImagePoolAllocator.
+ *
+ *  \ingroup ITKSparseVectorImage
+ */
+template <typename TKey, typename TValue>
+struct SparseVectorImagePoolMap
+{
+  typedef std::tr1::unordered_map< TKey, TValue, std::tr1::hash< TKey >, std::equal_to< TKey >,
+    SparseVectorImagePoolAllocator< std::pair< const TKey, TValue > > > Type;
+};
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,330 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Sharded Container
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef __itkSparseVectorImageShardedContainer_h
+#define __itkSparseVectorImageShardedContainer_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkNumericTraits.h"
+#include "itkIntTypes.h"
+#include "itkSimpleFastMutexLock.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <tr1/unordered_map>
+
+namespace itk
+{
+
+/** \class SparseVectorImageShardedContainer
+ *  \brief A voxel-keyed image container supporting concurrent writes.
+ *
+ *  The voxels are distributed over 2^VShardBits shards according to a
+ *  hash of their offset. Each shard is a small voxel-keyed container,
+ *  as SparseVectorImageVoxelContainer, protected by its own mutex, so
+ *  that GetPixel(), SetPixel() and SetElement() can be called from
+ *  several threads at the same time: threads only contend when they
+ *  access the same shard, which, with 64 shards by default, seldom
+ *  happens. Multithreaded filters can therefore write their output
+ *  directly instead of using one intermediate image per thread.
+ *
+ *  The other methods, i.e. VisitElements(), Reserve(), Squeeze(),
+ *  Clear() and the changes of the vector length, must not be called
+ *  while other threads access the container.
+ *
+ *  As for SparseVectorImageVoxelContainer, a pixel is written as a whole
+ *  and pixels whose components are all zero are not stored: writing
+ *  such a pixel over a stored voxel erases it from its shard.
+ *
+ *  \code
+ *  typedef itk::SparseVectorImage< float, 3,
+ *    itk::SparseVectorImageShardedContainer< unsigned long, float > > ImageType;
+ *  \endcode
+ *
+ *  \sa SparseVectorImageVoxelContainer
+ *
+ *  \ingroup ITKSparseVectorImage
+ *
+ */
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VShardBits = 6,
+          typename TOffsetMap = std::tr1::unordered_map< TElementIdentifier, SizeValueType > >
+class SparseVectorImageShardedContainer:  public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef SparseVectorImageShardedContainer  Self;
+  typedef Object                             Superclass;
+  typedef SmartPointer<Self>                 Pointer;
+  typedef SmartPointer<const Self>           ConstPointer;
+
+  /** Save the template parameters. */
+  typedef TElementIdentifier  ElementIdentifier;
+  typedef TElement            Element;
+
+  /** Map from voxel offset to the slot of the voxel within its shard. */
+  typedef TOffsetMap OffsetMapType;
+
+  /** Contiguous storage of the components of a shard, VectorLength per slot. */
+  typedef std::vector< Element > ValueArrayType;
+
+  typedef unsigned int VectorLengthType;
+
+  /** Number of shards. */
+  itkStaticConstMacro(NumberOfShards, SizeValueType, 1 << VShardBits);
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Standard part of every itk Object. */
+  itkTypeMacro(SparseVectorImageShardedContainer, Object);
+
+  /** Get the number of elements currently stored in the container. */
+  unsigned long Size(void) const;
+
+  /** Get the number of voxels currently stored in the container. */
+  unsigned long GetNumberOfVoxels(void) const;
+
+  /** Set the number of components of each pixel. Changing the length
+   *  discards the stored pixels. */
+  void SetVectorLength(VectorLengthType length);
+  itkGetConstMacro(VectorLength, VectorLengthType);
+
+  /** The layout of this container does not depend on the image size.
+   *  This method does nothing. */
+  void SetImageSize(unsigned int, const SizeValueType *) {}
+
+  /** Copy the components of the pixel at the given offset into pixel.
+   *  If the pixel is not stored, fillValue is copied instead. Return
+   *  true if the pixel is stored. This method is thread safe. */
+  bool GetPixel(ElementIdentifier offset, const Element *fillValue,
+                Element *pixel) const
+    {
+    const Shard & shard = m_Shards[this->GetShardIndex( offset )];
+    shard.m_Lock.Lock();
+
+    typename OffsetMapType::const_iterator it = shard.m_OffsetMap.find( offset );
+    const bool found = ( it != shard.m_OffsetMap.end() );
+    const Element *values = found ?
+      &shard.m_ValueArray[it->second * m_VectorLength] : fillValue;
+    std::copy( values, values + m_VectorLength, pixel );
+
+    shard.m_Lock.Unlock();
+    return found;
+    }
+
+  /** Store the pixel at the given offset if it has a non-zero component.
+   *  A stored voxel becoming zero is erased, and the last slot of its
+   *  shard is moved into its slot. This method is thread safe. */
+  void SetPixel(ElementIdentifier offset, const Element *pixel)
+    {
+    VectorLengthType i = 0;
+    while ( i < m_VectorLength && pixel[i] == 0 )
+      {
+      i++;
+      }
+
+    Shard & shard = m_Shards[this->GetShardIndex( offset )];
+    shard.m_Lock.Lock();
+    if ( i < m_VectorLength )
+      {
+      Element *values = this->GetSlot( shard, offset );
+      std::copy( pixel, pixel + m_VectorLength, values );
+      }
+    else
+      {
+      this->EraseVoxel( shard, offset );
+      }
+    shard.m_Lock.Unlock();
+    }
+
+  /** Store a single component given its key, i.e.
+   *  VectorLength * offset + component. This method is thread safe. */
+  void SetElement(ElementIdentifier key, const Element & value)
+    {
+    const ElementIdentifier offset = key / m_VectorLength;
+    Shard & shard = m_Shards[this->GetShardIndex( offset )];
+    shard.m_Lock.Lock();
+    this->GetSlot( shard, offset )[key % m_VectorLength] = value;
+    shard.m_Lock.Unlock();
+    }
+
+  /** Call visitor( key, value ) for every non-zero component of the
+   *  stored voxels, shard by shard. */
+  template< class TVisitor >
+  void VisitElements(TVisitor & visitor) const
+    {
+    for ( SizeValueType s = 0; s < NumberOfShards; s++ )
+      {
+      const Shard & shard = m_Shards[s];
+      for ( typename OffsetMapType::const_iterator it = shard.m_OffsetMap.begin();
+            it != shard.m_OffsetMap.end(); ++it )
+        {
+        const ElementIdentifier first = m_VectorLength * it->first;
+        const Element *values = &shard.m_ValueArray[it->second * m_VectorLength];
+        for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
+          {
+          if ( values[i] != 0 )
+            {
+            visitor( first + i, values[i] );
+            }
+          }
+        }
+      }
+    }
+
+  /** Set to zero the stored components whose magnitude is at most
+   *  threshold, and remove the voxels left without non-zero component,
+   *  see SparseVectorImageVoxelContainer::Prune(). The shards are pruned
+   *  in parallel. Return the number of bytes released, estimated from
+   *  the size of the entries for the offset maps. */
+  SizeValueType Prune(double threshold = 0.0);
+
+  /** Replace the pixels of this container by a copy of the pixels of
+   *  source. The shards are copied in parallel. */
+  void DeepCopy(const Self *source);
+
+  /** Presize the shards for the given number of stored elements, i.e.
+   *  size / VectorLength voxels evenly distributed over the shards. */
+  void Reserve(SizeValueType size);
+
+  /** Shrink the shards to their current number of voxels. */
+  void Squeeze(void);
+
+  /** Remove all the stored pixels. */
+  void Clear(void);
+
+  /** Tell the container to release any of its allocated memory. */
+  void Initialize(void);
+
+  /** See SparseVectorImageContainer::SetContainerManageMemory(). */
+  itkSetMacro(ContainerManageMemory,bool);
+  itkGetMacro(ContainerManageMemory,bool);
+  itkBooleanMacro(ContainerManageMemory);
+
+protected:
+  SparseVectorImageShardedContainer();
+  virtual ~SparseVectorImageShardedContainer();
+
+  void PrintSelf(std::ostream& os, Indent indent) const;
+
+  /** A voxel-keyed container and its mutex. The offset of the voxel of
+   *  each slot is kept so that the last slot can be moved when a voxel
+   *  is erased. The padding keeps the mutexes of neighbouring shards in
+   *  different cache lines. */
+  struct Shard
+    {
+    OffsetMapType                     m_OffsetMap;
+    std::vector< ElementIdentifier >  m_SlotOffsets;
+    ValueArrayType                    m_ValueArray;
+    mutable SimpleFastMutexLock       m_Lock;
+    char                              m_Padding[64];
+    };
+
+  /** Fibonacci hashing of the offset, so that neighbouring voxels,
+   *  written by the same thread, fall into different shards. */
+  static SizeValueType GetShardIndex(ElementIdentifier offset)
+    {
+    return static_cast< SizeValueType >(
+      ( static_cast< uint64_t >( offset ) * 11400714819323198485ULL ) >> ( 64 - VShardBits ) );
+    }
+
+  /** Return the components of the voxel at the given offset, creating
+   *  a zero-filled slot if the voxel is not stored yet. The shard must
+   *  be locked by the caller. */
+  Element * GetSlot(Shard & shard, ElementIdentifier offset)
+    {
+    std::pair< typename OffsetMapType::iterator, bool > inserted =
+      shard.m_OffsetMap.insert( std::make_pair( offset,
+        static_cast< SizeValueType >( shard.m_OffsetMap.size() ) ) );
+
+    if ( inserted.second )
+      {
+      shard.m_SlotOffsets.push_back( offset );
+      shard.m_ValueArray.resize( shard.m_ValueArray.size() + m_VectorLength,
+                                 NumericTraits< Element >::Zero );
+      }
+
+    return &shard.m_ValueArray[inserted.first->second * m_VectorLength];
+    }
+
+  /** Remove the voxel at the given offset from its shard, if it is
+   *  stored. The last slot of the shard is moved into the slot of the
+   *  voxel. The shard must be locked by the caller. */
+  void EraseVoxel(Shard & shard, ElementIdentifier offset);
+
+  /** Prune a shard, returning the number of bytes released. */
+  SizeValueType PruneShard(Shard & shard, double threshold);
+
+  /** Prune a range of shards, see Prune(). */
+  struct PruneFunctor
+    {
+    void operator()( SizeValueType begin, SizeValueType end )
+      {
+      for ( SizeValueType s = begin; s < end; s++ )
+        {
+        m_Bytes[s] = m_Container->PruneShard( m_Container->m_Shards[s], m_Threshold );
+        }
+      }
+
+    Self *           m_Container;
+    SizeValueType *  m_Bytes;
+    double           m_Threshold;
+    };
+  friend struct PruneFunctor;
+
+  /** Copy a range of shards, see DeepCopy(). */
+  struct CopyFunctor
+    {
+    void operator()( SizeValueType begin, SizeValueType end )
+      {
+      for ( SizeValueType s = begin; s < end; s++ )
+        {
+        const Shard & source = m_Source->m_Shards[s];
+        Shard & shard = m_Container->m_Shards[s];
+        shard.m_OffsetMap.rehash( static_cast< SizeValueType >(
+          std::ceil( source.m_OffsetMap.size() / shard.m_OffsetMap.max_load_factor() ) ) );
+        for ( typename OffsetMapType::const_iterator it = source.m_OffsetMap.begin();
+              it != source.m_OffsetMap.end(); ++it )
+          {
+          shard.m_OffsetMap.insert( std::make_pair( it->first, it->second ) );
+          }
+        shard.m_SlotOffsets = source.m_SlotOffsets;
+        shard.m_ValueArray = source.m_ValueArray;
+        }
+      }
+
+    const Self *  m_Source;
+    Self *        m_Container;
+    };
+  friend struct CopyFunctor;
+
+private:
+  SparseVectorImageShardedContainer(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  Shard                m_Shards[1 << VShardBits];
+  VectorLengthType     m_VectorLength;
+  bool                 m_ContainerManageMemory;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkSparseVectorImageShardedContainer.hxx"
+#endif
+
+#endif
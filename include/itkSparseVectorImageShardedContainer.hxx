@@ -0,0 +1,346 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Sharded Container
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef _itkSparseVectorImageShardedContainer_hxx
+#define _itkSparseVectorImageShardedContainer_hxx
+
+#include "itkSparseVectorImageShardedContainer.h"
+#include "itkSparseVectorImageParallelFor.h"
+#include <cmath>
+
+namespace itk
+{
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VShardBits, typename TOffsetMap>
+SparseVectorImageShardedContainer< TElementIdentifier , TElement , VShardBits , TOffsetMap >
+::SparseVectorImageShardedContainer()
+{
+  m_VectorLength = 1;
+  m_ContainerManageMemory = true;
+}
+
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VShardBits, typename TOffsetMap>
+SparseVectorImageShardedContainer< TElementIdentifier , TElement , VShardBits , TOffsetMap >
+::~SparseVectorImageShardedContainer()
+{
+  if( m_ContainerManageMemory )
+    {
+    this->Clear();
+    }
+}
+
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VShardBits, typename TOffsetMap>
+unsigned long
+SparseVectorImageShardedContainer< TElementIdentifier , TElement , VShardBits , TOffsetMap >
+::Size(void) const
+{
+  unsigned long size = 0;
+  for ( SizeValueType s = 0; s < NumberOfShards; s++ )
+    {
+    size += m_Shards[s].m_ValueArray.size();
+    }
+  return size;
+}
+
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VShardBits, typename TOffsetMap>
+unsigned long
+SparseVectorImageShardedContainer< TElementIdentifier , TElement , VShardBits , TOffsetMap >
+::GetNumberOfVoxels(void) const
+{
+  unsigned long voxels = 0;
+  for ( SizeValueType s = 0; s < NumberOfShards; s++ )
+    {
+    voxels += m_Shards[s].m_OffsetMap.size();
+    }
+  return voxels;
+}
+
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VShardBits, typename TOffsetMap>
+void
+SparseVectorImageShardedContainer< TElementIdentifier , TElement , VShardBits , TOffsetMap >
+::SetVectorLength(VectorLengthType length)
+{
+  if ( length == m_VectorLength )
+    {
+    return;
+    }
+
+  this->Clear();
+  m_VectorLength = length;
+  this->Modified();
+}
+
+
+/**
+ * Tell the container to allocate enough memory to allow at least
+ * as many elements as the size given to be stored.
+ */
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VShardBits, typename TOffsetMap>
+void
+SparseVectorImageShardedContainer< TElementIdentifier , TElement , VShardBits , TOffsetMap >
+::Reserve(SizeValueType size)
+{
+  if ( m_VectorLength == 0 )
+    {
+    return;
+    }
+
+  const SizeValueType voxels = ( size + m_VectorLength - 1 ) / m_VectorLength;
+  const SizeValueType voxelsPerShard = ( voxels + NumberOfShards - 1 ) / NumberOfShards;
+
+  for ( SizeValueType s = 0; s < NumberOfShards; s++ )
+    {
+    Shard & shard = m_Shards[s];
+    if ( voxelsPerShard > shard.m_OffsetMap.size() )
+      {
+      shard.m_OffsetMap.rehash( static_cast< SizeValueType >(
+        std::ceil( voxelsPerShard / shard.m_OffsetMap.max_load_factor() ) ) );
+      }
+    shard.m_SlotOffsets.reserve( voxelsPerShard );
+    shard.m_ValueArray.reserve( voxelsPerShard * m_VectorLength );
+    }
+}
+
+
+/**
+ * Tell the container to try to minimize its memory usage for storage of
+ * the current number of elements.
+ */
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VShardBits, typename TOffsetMap>
+void
+SparseVectorImageShardedContainer< TElementIdentifier , TElement , VShardBits , TOffsetMap >
+::Squeeze(void)
+{
+  for ( SizeValueType s = 0; s < NumberOfShards; s++ )
+    {
+    Shard & shard = m_Shards[s];
+    shard.m_OffsetMap.rehash( 0 );
+    std::vector< ElementIdentifier >( shard.m_SlotOffsets ).swap( shard.m_SlotOffsets );
+    ValueArrayType( shard.m_ValueArray ).swap( shard.m_ValueArray );
+    }
+}
+
+
+/**
+ * Remove a voxel from its shard, moving the last slot into its slot.
+ */
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VShardBits, typename TOffsetMap>
+void
+SparseVectorImageShardedContainer< TElementIdentifier , TElement , VShardBits , TOffsetMap >
+::EraseVoxel(Shard & shard, ElementIdentifier offset)
+{
+  typename OffsetMapType::iterator it = shard.m_OffsetMap.find( offset );
+  if ( it == shard.m_OffsetMap.end() )
+    {
+    return;
+    }
+  const SizeValueType slot = it->second;
+  shard.m_OffsetMap.erase( it );
+
+  const SizeValueType last = shard.m_SlotOffsets.size() - 1;
+  if ( slot != last )
+    {
+    std::copy( shard.m_ValueArray.begin() + last * m_VectorLength,
+               shard.m_ValueArray.begin() + ( last + 1 ) * m_VectorLength,
+               shard.m_ValueArray.begin() + slot * m_VectorLength );
+    shard.m_SlotOffsets[slot] = shard.m_SlotOffsets[last];
+    shard.m_OffsetMap.find( shard.m_SlotOffsets[slot] )->second = slot;
+    }
+  shard.m_SlotOffsets.pop_back();
+  shard.m_ValueArray.resize( last * m_VectorLength );
+}
+
+
+/**
+ * Zero the small components and remove the empty voxels, shard by shard.
+ */
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VShardBits, typename TOffsetMap>
+SizeValueType
+SparseVectorImageShardedContainer< TElementIdentifier , TElement , VShardBits , TOffsetMap >
+::Prune(double threshold)
+{
+  std::vector< SizeValueType > bytes( NumberOfShards, 0 );
+  PruneFunctor functor;
+  functor.m_Container = this;
+  functor.m_Bytes = &bytes[0];
+  functor.m_Threshold = threshold;
+  SparseVectorImageParallelFor< PruneFunctor >::Run( NumberOfShards, functor, 1 );
+  this->Modified();
+
+  SizeValueType total = 0;
+  for ( SizeValueType s = 0; s < NumberOfShards; s++ )
+    {
+    total += bytes[s];
+    }
+  return total;
+}
+
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VShardBits, typename TOffsetMap>
+SizeValueType
+SparseVectorImageShardedContainer< TElementIdentifier , TElement , VShardBits , TOffsetMap >
+::PruneShard(Shard & shard, double threshold)
+{
+  const SizeValueType numberOfSlots = shard.m_OffsetMap.size();
+
+  // Zero the small components and move the kept voxels down
+  SizeValueType bytes = 0;
+  SizeValueType kept = 0;
+  for ( SizeValueType slot = 0; slot < numberOfSlots; slot++ )
+    {
+    Element *values = &shard.m_ValueArray[slot * m_VectorLength];
+    bool empty = true;
+    for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
+      {
+      if ( std::fabs( static_cast< double >( values[i] ) ) <= threshold )
+        {
+        values[i] = NumericTraits< Element >::Zero;
+        }
+      else
+        {
+        empty = false;
+        }
+      }
+
+    const ElementIdentifier offset = shard.m_SlotOffsets[slot];
+    if ( empty )
+      {
+      shard.m_OffsetMap.erase( offset );
+      bytes += sizeof( typename OffsetMapType::value_type ) + sizeof( void * );
+      continue;
+      }
+    if ( kept != slot )
+      {
+      std::copy( values, values + m_VectorLength,
+                 &shard.m_ValueArray[kept * m_VectorLength] );
+      shard.m_SlotOffsets[kept] = offset;
+      shard.m_OffsetMap.find( offset )->second = kept;
+      }
+    kept++;
+    }
+  if ( kept == numberOfSlots )
+    {
+    return 0;
+    }
+
+  bytes += shard.m_SlotOffsets.capacity() * sizeof( ElementIdentifier );
+  shard.m_SlotOffsets.resize( kept );
+  std::vector< ElementIdentifier >( shard.m_SlotOffsets ).swap( shard.m_SlotOffsets );
+  bytes -= shard.m_SlotOffsets.capacity() * sizeof( ElementIdentifier );
+
+  bytes += shard.m_ValueArray.capacity() * sizeof( Element );
+  shard.m_ValueArray.resize( kept * m_VectorLength );
+  ValueArrayType( shard.m_ValueArray ).swap( shard.m_ValueArray );
+  bytes -= shard.m_ValueArray.capacity() * sizeof( Element );
+
+  return bytes;
+}
+
+
+/**
+ * Copy the pixels of another container, shard by shard.
+ */
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VShardBits, typename TOffsetMap>
+void
+SparseVectorImageShardedContainer< TElementIdentifier , TElement , VShardBits , TOffsetMap >
+::DeepCopy(const Self *source)
+{
+  if ( source == this )
+    {
+    return;
+    }
+
+  this->Clear();
+  m_VectorLength = source->m_VectorLength;
+
+  CopyFunctor functor;
+  functor.m_Source = source;
+  functor.m_Container = this;
+  SparseVectorImageParallelFor< CopyFunctor >::Run( NumberOfShards, functor, 1 );
+
+  this->Modified();
+}
+
+
+/**
+ * Remove all the stored pixels.
+ */
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VShardBits, typename TOffsetMap>
+void
+SparseVectorImageShardedContainer< TElementIdentifier , TElement , VShardBits , TOffsetMap >
+::Clear(void)
+{
+  for ( SizeValueType s = 0; s < NumberOfShards; s++ )
+    {
+    m_Shards[s].m_OffsetMap.clear();
+    m_Shards[s].m_SlotOffsets.clear();
+    m_Shards[s].m_ValueArray.clear();
+    }
+}
+
+
+/**
+ * Tell the container to release any of its allocated memory.
+ */
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VShardBits, typename TOffsetMap>
+void
+SparseVectorImageShardedContainer< TElementIdentifier , TElement , VShardBits , TOffsetMap >
+::Initialize(void)
+{
+  if ( this->GetNumberOfVoxels() > 0 )
+    {
+    if( m_ContainerManageMemory )
+      {
+      this->Clear();
+      }
+    m_ContainerManageMemory = true;
+    this->Modified();
+    }
+}
+
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VShardBits, typename TOffsetMap>
+void
+SparseVectorImageShardedContainer< TElementIdentifier , TElement , VShardBits , TOffsetMap >
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+
+  os << indent << "VectorLength: " << m_VectorLength << std::endl;
+  os << indent << "Number of shards: " << NumberOfShards << std::endl;
+  os << indent << "Number of stored voxels: " << this->GetNumberOfVoxels() << std::endl;
+  os << indent << "Container manages memory: "
+     << (m_ContainerManageMemory ? "true" : "false") << std::endl;
+}
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,404 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Tree Container
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef __itkSparseVectorImageTreeContainer_h
+#define __itkSparseVectorImageTreeContainer_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkNumericTraits.h"
+#include "itkIntTypes.h"
+#include <algorithm>
+#include <vector>
+#include <tr1/unordered_map>
+
+namespace itk
+{
+
+/** \class SparseVectorImageTreeContainer
+ *  \brief A fixed-depth tree container for itk::SparseVectorImage.
+ *
+ *  The container is a shallow tree in the spirit of OpenVDB, suited to
+ *  very large sparse volumes:
+ *
+ *  - the root is a hash table mapping the coordinates of the internal
+ *    nodes to their slot;
+ *  - an internal node covers 2^VInternalBits leaves along each dimension,
+ *    and holds a bitmask of its allocated children together with a dense
+ *    table of their slots;
+ *  - a leaf is a dense brick of 2^VLeafBits voxels along each dimension,
+ *    with a bitmask of the stored voxels.
+ *
+ *  With the default 8^3 leaves and 16^3 internal nodes, a root entry
+ *  covers 128^3 voxels, so that the root of a 2000^3 image holds at most
+ *  a few thousand entries. A random access costs one hash lookup and two
+ *  bit tests. Iterating over the stored voxels only visits the allocated
+ *  leaves, and IsRegionEmpty() only descends into the nodes overlapping
+ *  the region.
+ *
+ *  The container receives the raster offsets computed by
+ *  SparseVectorImage::ComputeOffset() and uses the image size set by
+ *  SetImageSize() to recover the voxel index, so it can be used through
+ *  SparseVectorImagePixelAccessor and
+ *  SparseVectorImageNeighborhoodAccessorFunctor as any other container.
+ *  As for SparseVectorImageVoxelContainer, a pixel is written as a whole
+ *  and pixels whose components are all zero are not stored.
+ *
+ *  \code
+ *  typedef itk::SparseVectorImage< float, 3,
+ *    itk::SparseVectorImageTreeContainer< unsigned long, float > > ImageType;
+ *  \endcode
+ *
+ *  \sa SparseVectorImageBrickContainer
+ *
+ *  \ingroup ITKSparseVectorImage
+ *
+ */
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VLeafBits = 3, unsigned int VInternalBits = 4,
+          typename TRootMap = std::tr1::unordered_map< TElementIdentifier, SizeValueType > >
+class SparseVectorImageTreeContainer:  public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef SparseVectorImageTreeContainer  Self;
+  typedef Object                          Superclass;
+  typedef SmartPointer<Self>              Pointer;
+  typedef SmartPointer<const Self>        ConstPointer;
+
+  /** Save the template parameters. */
+  typedef TElementIdentifier  ElementIdentifier;
+  typedef TElement            Element;
+
+  /** Map from the coordinates of an internal node to its slot. */
+  typedef TRootMap RootMapType;
+
+  typedef unsigned int VectorLengthType;
+
+  /** Number of voxels of a leaf, and of leaves of an internal node,
+   *  along each dimension. */
+  itkStaticConstMacro(LeafBits, unsigned int, VLeafBits);
+  itkStaticConstMacro(InternalBits, unsigned int, VInternalBits);
+
+  /** Maximum image dimension supported by the container. */
+  itkStaticConstMacro(MaximumDimension, unsigned int, 8);
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Standard part of every itk Object. */
+  itkTypeMacro(SparseVectorImageTreeContainer, Object);
+
+  /** Get the number of elements currently stored in the container,
+   *  i.e. VectorLength times the number of stored voxels. */
+  unsigned long Size(void) const
+    { return (unsigned long) m_NumberOfVoxels * m_VectorLength; };
+
+  /** Get the number of voxels currently stored in the container. */
+  unsigned long GetNumberOfVoxels(void) const
+    { return (unsigned long) m_NumberOfVoxels; };
+
+  /** Get the number of allocated leaves and internal nodes. */
+  unsigned long GetNumberOfLeaves(void) const
+    { return (unsigned long) m_LeafMasks.size() / m_LeafWords; };
+  unsigned long GetNumberOfInternalNodes(void) const
+    { return (unsigned long) m_ChildMasks.size() / m_ChildWords; };
+
+  /** Set the number of components of each pixel. Changing the length
+   *  discards the stored pixels. */
+  void SetVectorLength(VectorLengthType length);
+  itkGetConstMacro(VectorLength, VectorLengthType);
+
+  /** Set the size of the image, used to recover the voxel index from
+   *  its offset. Changing the size discards the stored pixels. */
+  void SetImageSize(unsigned int dimension, const SizeValueType *size);
+
+  /** Copy the components of the pixel at the given offset into pixel.
+   *  If the pixel is not stored, fillValue is copied instead. Return
+   *  true if the pixel is stored. */
+  bool GetPixel(ElementIdentifier offset, const Element *fillValue,
+                Element *pixel) const
+    {
+    const Element *values = this->FindVoxelValues( offset );
+    if ( !values )
+      {
+      std::copy( fillValue, fillValue + m_VectorLength, pixel );
+      return false;
+      }
+
+    std::copy( values, values + m_VectorLength, pixel );
+    return true;
+    }
+
+  /** Store the pixel at the given offset if it has a non-zero component.
+   *  A stored voxel becoming zero is erased, and its leaf and internal
+   *  node are released once they are empty. */
+  void SetPixel(ElementIdentifier offset, const Element *pixel)
+    {
+    VectorLengthType i = 0;
+    while ( i < m_VectorLength && pixel[i] == 0 )
+      {
+      i++;
+      }
+    if ( i == m_VectorLength )
+      {
+      this->EraseVoxel( offset );
+      return;
+      }
+
+    Element *values = this->GetVoxelValues( offset );
+    std::copy( pixel, pixel + m_VectorLength, values );
+    }
+
+  /** Store a single component given its key, i.e.
+   *  VectorLength * offset + component. */
+  void SetElement(ElementIdentifier key, const Element & value)
+    {
+    this->GetVoxelValues( key / m_VectorLength )[key % m_VectorLength] = value;
+    }
+
+  /** Call visitor( key, value ) for every non-zero component of the
+   *  stored voxels. Only the allocated leaves are visited. */
+  template< class TVisitor >
+  void VisitElements(TVisitor & visitor) const
+    {
+    const SizeValueType numberOfLeaves = this->GetNumberOfLeaves();
+    for ( SizeValueType leaf = 0; leaf < numberOfLeaves; leaf++ )
+      {
+      const uint64_t *mask = &m_LeafMasks[leaf * m_LeafWords];
+      const ElementIdentifier *origin = &m_LeafOrigins[leaf * m_Dimension];
+
+      for ( SizeValueType word = 0; word < m_LeafWords; word++ )
+        {
+        for ( uint64_t bits = mask[word]; bits != 0; bits &= bits - 1 )
+          {
+          const SizeValueType voxel = word * 64 + LowestBit( bits );
+          const ElementIdentifier first = m_VectorLength
+            * this->ComputeLeafOffset( origin, voxel );
+          const Element *values = &m_LeafValues[( leaf * m_LeafSize + voxel ) * m_VectorLength];
+          for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
+            {
+            if ( values[i] != 0 )
+              {
+              visitor( first + i, values[i] );
+              }
+            }
+          }
+        }
+      }
+    }
+
+  /** Return true if no voxel of the region defined by its start index
+   *  and size is stored. Indices outside the image are considered empty.
+   *  Only the internal nodes overlapping the region are looked up, or
+   *  every allocated node when they are fewer. */
+  bool IsRegionEmpty(const IndexValueType *index, const SizeValueType *size) const;
+
+  /** The number of leaves can not be derived from the number of stored
+   *  elements, since leaves are allocated on demand. This method does
+   *  nothing. */
+  void Reserve(SizeValueType) {}
+
+  /** Release the memory reserved beyond the allocated leaves. */
+  void Squeeze(void);
+
+  /** Remove all the stored pixels. */
+  void Clear(void);
+
+  /** Tell the container to release any of its allocated memory. */
+  void Initialize(void);
+
+  /** See SparseVectorImageContainer::SetContainerManageMemory(). */
+  itkSetMacro(ContainerManageMemory,bool);
+  itkGetMacro(ContainerManageMemory,bool);
+  itkBooleanMacro(ContainerManageMemory);
+
+protected:
+  SparseVectorImageTreeContainer();
+  virtual ~SparseVectorImageTreeContainer();
+
+  void PrintSelf(std::ostream& os, Indent indent) const;
+
+  static bool IsBitSet(const uint64_t *mask, SizeValueType bit)
+    { return ( mask[bit >> 6] >> ( bit & 63 ) ) & 1; }
+
+  static void SetBit(uint64_t *mask, SizeValueType bit)
+    { mask[bit >> 6] |= static_cast< uint64_t >( 1 ) << ( bit & 63 ); }
+
+  static void ClearBit(uint64_t *mask, SizeValueType bit)
+    { mask[bit >> 6] &= ~( static_cast< uint64_t >( 1 ) << ( bit & 63 ) ); }
+
+  static bool IsMaskEmpty(const uint64_t *mask, SizeValueType words)
+    {
+    for ( SizeValueType word = 0; word < words; word++ )
+      {
+      if ( mask[word] != 0 )
+        {
+        return false;
+        }
+      }
+    return true;
+    }
+
+  /** Position of the lowest set bit of a non-zero word. */
+  static SizeValueType LowestBit(uint64_t bits)
+    {
+    SizeValueType n = 0;
+    while ( !( bits & 1 ) )
+      {
+      bits >>= 1;
+      ++n;
+      }
+    return n;
+    }
+
+  /** Recover the index of a voxel from its raster offset. */
+  void ComputeIndex(ElementIdentifier offset, ElementIdentifier *index) const
+    {
+    for ( unsigned int d = m_Dimension - 1; d > 0; d-- )
+      {
+      index[d] = offset / m_OffsetTable[d];
+      offset -= index[d] * m_OffsetTable[d];
+      }
+    index[0] = offset;
+    }
+
+  /** Key of the internal node containing the voxel. */
+  ElementIdentifier GetRootKey(const ElementIdentifier *index) const
+    {
+    ElementIdentifier key = 0;
+    for ( unsigned int d = 0; d < m_Dimension; d++ )
+      {
+      key += ( index[d] >> ( VLeafBits + VInternalBits ) ) * m_RootOffsetTable[d];
+      }
+    return key;
+    }
+
+  /** Position of the leaf containing the voxel within its internal node. */
+  SizeValueType GetChild(const ElementIdentifier *index) const
+    {
+    SizeValueType child = 0;
+    for ( unsigned int d = 0; d < m_Dimension; d++ )
+      {
+      child |= static_cast< SizeValueType >(
+        ( index[d] >> VLeafBits ) & ( ( 1 << VInternalBits ) - 1 ) ) << ( VInternalBits * d );
+      }
+    return child;
+    }
+
+  /** Position of the voxel within its leaf. */
+  SizeValueType GetVoxel(const ElementIdentifier *index) const
+    {
+    SizeValueType voxel = 0;
+    for ( unsigned int d = 0; d < m_Dimension; d++ )
+      {
+      voxel |= static_cast< SizeValueType >(
+        index[d] & ( ( 1 << VLeafBits ) - 1 ) ) << ( VLeafBits * d );
+      }
+    return voxel;
+    }
+
+  /** Raster offset of a voxel of a leaf given the origin of the leaf. */
+  ElementIdentifier ComputeLeafOffset(const ElementIdentifier *origin,
+                                      SizeValueType voxel) const
+    {
+    ElementIdentifier offset = 0;
+    for ( unsigned int d = 0; d < m_Dimension; d++ )
+      {
+      offset += ( origin[d] + ( ( voxel >> ( VLeafBits * d ) ) & ( ( 1 << VLeafBits ) - 1 ) ) )
+        * m_OffsetTable[d];
+      }
+    return offset;
+    }
+
+  /** Return the components of the voxel at the given offset, allocating
+   *  the internal node and the leaf of the voxel if needed. */
+  Element * GetVoxelValues(ElementIdentifier offset);
+
+  /** Return true if no voxel of the internal node lies between the
+   *  lower and upper indices, both included. */
+  bool IsNodeRegionEmpty(SizeValueType node, const ElementIdentifier *lower,
+                         const ElementIdentifier *upper) const;
+
+  /** Remove the voxel at the given offset if it is stored. A leaf left
+   *  without voxels, and then an internal node left without leaves, is
+   *  released and the last one of the arrays is moved into its slot. */
+  void EraseVoxel(ElementIdentifier offset);
+
+  /** Return the components of the voxel at the given offset, or NULL if
+   *  the voxel is not stored. */
+  const Element * FindVoxelValues(ElementIdentifier offset) const
+    {
+    ElementIdentifier index[MaximumDimension];
+    this->ComputeIndex( offset, index );
+
+    typename RootMapType::const_iterator it = m_RootMap.find( this->GetRootKey( index ) );
+    if ( it == m_RootMap.end() )
+      {
+      return NULL;
+      }
+
+    const SizeValueType child = this->GetChild( index );
+    if ( !IsBitSet( &m_ChildMasks[it->second * m_ChildWords], child ) )
+      {
+      return NULL;
+      }
+
+    const SizeValueType leaf = m_ChildTable[it->second * m_ChildCount + child];
+    const SizeValueType voxel = this->GetVoxel( index );
+    if ( !IsBitSet( &m_LeafMasks[leaf * m_LeafWords], voxel ) )
+      {
+      return NULL;
+      }
+    return &m_LeafValues[( leaf * m_LeafSize + voxel ) * m_VectorLength];
+    }
+
+private:
+  SparseVectorImageTreeContainer(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  /** Root and internal nodes. */
+  RootMapType                       m_RootMap;
+  std::vector< ElementIdentifier >  m_InternalOrigins;
+  std::vector< uint64_t >           m_ChildMasks;
+  std::vector< SizeValueType >      m_ChildTable;
+
+  /** Leaves. */
+  std::vector< ElementIdentifier >  m_LeafOrigins;
+  std::vector< uint64_t >           m_LeafMasks;
+  std::vector< Element >            m_LeafValues;
+
+  SizeValueType                     m_NumberOfVoxels;
+  VectorLengthType                  m_VectorLength;
+  bool                              m_ContainerManageMemory;
+
+  /** Geometry of the image and of the nodes. */
+  unsigned int                      m_Dimension;
+  SizeValueType                     m_Size[MaximumDimension];
+  ElementIdentifier                 m_OffsetTable[MaximumDimension];
+  ElementIdentifier                 m_RootOffsetTable[MaximumDimension];
+  SizeValueType                     m_LeafSize;
+  SizeValueType                     m_LeafWords;
+  SizeValueType                     m_ChildCount;
+  SizeValueType                     m_ChildWords;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkSparseVectorImageTreeContainer.hxx"
+#endif
+
+#endif
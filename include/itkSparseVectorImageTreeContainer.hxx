@@ -0,0 +1,489 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Tree Container
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef _itkSparseVectorImageTreeContainer_hxx
+#define _itkSparseVectorImageTreeContainer_hxx
+
+#include "itkSparseVectorImageTreeContainer.h"
+
+namespace itk
+{
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VLeafBits, unsigned int VInternalBits, typename TRootMap>
+SparseVectorImageTreeContainer< TElementIdentifier , TElement , VLeafBits , VInternalBits , TRootMap >
+::SparseVectorImageTreeContainer()
+{
+  m_NumberOfVoxels = 0;
+  m_VectorLength = 1;
+  m_ContainerManageMemory = true;
+
+  // Until SetImageSize() is called, offsets are used as 1D indices
+  m_Dimension = 1;
+  m_Size[0] = static_cast< SizeValueType >( NumericTraits< IndexValueType >::max() );
+  m_OffsetTable[0] = 1;
+  m_RootOffsetTable[0] = 1;
+  m_LeafSize = 1 << VLeafBits;
+  m_LeafWords = ( m_LeafSize + 63 ) / 64;
+  m_ChildCount = 1 << VInternalBits;
+  m_ChildWords = ( m_ChildCount + 63 ) / 64;
+}
+
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VLeafBits, unsigned int VInternalBits, typename TRootMap>
+SparseVectorImageTreeContainer< TElementIdentifier , TElement , VLeafBits , VInternalBits , TRootMap >
+::~SparseVectorImageTreeContainer()
+{
+  if( m_ContainerManageMemory )
+    {
+    this->Clear();
+    }
+}
+
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VLeafBits, unsigned int VInternalBits, typename TRootMap>
+void
+SparseVectorImageTreeContainer< TElementIdentifier , TElement , VLeafBits , VInternalBits , TRootMap >
+::SetVectorLength(VectorLengthType length)
+{
+  if ( length == m_VectorLength )
+    {
+    return;
+    }
+
+  this->Clear();
+  m_VectorLength = length;
+  this->Modified();
+}
+
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VLeafBits, unsigned int VInternalBits, typename TRootMap>
+void
+SparseVectorImageTreeContainer< TElementIdentifier , TElement , VLeafBits , VInternalBits , TRootMap >
+::SetImageSize(unsigned int dimension, const SizeValueType *size)
+{
+  if ( dimension == 0 || dimension > MaximumDimension )
+    {
+    itkExceptionMacro( << "Image dimension " << dimension << " is not supported" );
+    }
+  if ( VLeafBits * dimension > 24 || VInternalBits * dimension > 24 )
+    {
+    itkExceptionMacro( << "Nodes of " << ( 1 << VLeafBits ) << " and "
+                       << ( 1 << VInternalBits ) << " elements along "
+                       << dimension << " dimensions are too large" );
+    }
+
+  bool changed = ( dimension != m_Dimension );
+  for ( unsigned int d = 0; d < dimension && !changed; d++ )
+    {
+    changed = ( size[d] != m_Size[d] );
+    }
+  if ( !changed )
+    {
+    return;
+    }
+
+  this->Clear();
+  m_Dimension = dimension;
+  m_OffsetTable[0] = 1;
+  m_RootOffsetTable[0] = 1;
+  for ( unsigned int d = 0; d < dimension; d++ )
+    {
+    m_Size[d] = size[d];
+    if ( d > 0 )
+      {
+      m_OffsetTable[d] = m_OffsetTable[d-1] * size[d-1];
+      m_RootOffsetTable[d] = m_RootOffsetTable[d-1]
+        * ( ( ( size[d-1] - 1 ) >> ( VLeafBits + VInternalBits ) ) + 1 );
+      }
+    }
+  m_LeafSize = static_cast< SizeValueType >( 1 ) << ( VLeafBits * dimension );
+  m_LeafWords = ( m_LeafSize + 63 ) / 64;
+  m_ChildCount = static_cast< SizeValueType >( 1 ) << ( VInternalBits * dimension );
+  m_ChildWords = ( m_ChildCount + 63 ) / 64;
+  this->Modified();
+}
+
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VLeafBits, unsigned int VInternalBits, typename TRootMap>
+typename SparseVectorImageTreeContainer< TElementIdentifier , TElement , VLeafBits , VInternalBits , TRootMap >::Element *
+SparseVectorImageTreeContainer< TElementIdentifier , TElement , VLeafBits , VInternalBits , TRootMap >
+::GetVoxelValues(ElementIdentifier offset)
+{
+  ElementIdentifier index[MaximumDimension];
+  this->ComputeIndex( offset, index );
+
+  // Internal node
+  std::pair< typename RootMapType::iterator, bool > inserted =
+    m_RootMap.insert( std::make_pair( this->GetRootKey( index ),
+      static_cast< SizeValueType >( this->GetNumberOfInternalNodes() ) ) );
+  const SizeValueType node = inserted.first->second;
+
+  if ( inserted.second )
+    {
+    for ( unsigned int d = 0; d < m_Dimension; d++ )
+      {
+      m_InternalOrigins.push_back(
+        ( index[d] >> ( VLeafBits + VInternalBits ) ) << ( VLeafBits + VInternalBits ) );
+      }
+    m_ChildMasks.resize( m_ChildMasks.size() + m_ChildWords, 0 );
+    m_ChildTable.resize( m_ChildTable.size() + m_ChildCount, 0 );
+    }
+
+  // Leaf
+  const SizeValueType child = this->GetChild( index );
+  if ( !IsBitSet( &m_ChildMasks[node * m_ChildWords], child ) )
+    {
+    SetBit( &m_ChildMasks[node * m_ChildWords], child );
+    m_ChildTable[node * m_ChildCount + child] = this->GetNumberOfLeaves();
+
+    for ( unsigned int d = 0; d < m_Dimension; d++ )
+      {
+      m_LeafOrigins.push_back( ( index[d] >> VLeafBits ) << VLeafBits );
+      }
+    m_LeafMasks.resize( m_LeafMasks.size() + m_LeafWords, 0 );
+    m_LeafValues.resize( m_LeafValues.size() + m_LeafSize * m_VectorLength,
+                         NumericTraits< Element >::Zero );
+    }
+  const SizeValueType leaf = m_ChildTable[node * m_ChildCount + child];
+
+  // Voxel
+  const SizeValueType voxel = this->GetVoxel( index );
+  if ( !IsBitSet( &m_LeafMasks[leaf * m_LeafWords], voxel ) )
+    {
+    SetBit( &m_LeafMasks[leaf * m_LeafWords], voxel );
+    ++m_NumberOfVoxels;
+    }
+
+  return &m_LeafValues[( leaf * m_LeafSize + voxel ) * m_VectorLength];
+}
+
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VLeafBits, unsigned int VInternalBits, typename TRootMap>
+void
+SparseVectorImageTreeContainer< TElementIdentifier , TElement , VLeafBits , VInternalBits , TRootMap >
+::EraseVoxel(ElementIdentifier offset)
+{
+  ElementIdentifier index[MaximumDimension];
+  this->ComputeIndex( offset, index );
+
+  typename RootMapType::iterator it = m_RootMap.find( this->GetRootKey( index ) );
+  if ( it == m_RootMap.end() )
+    {
+    return;
+    }
+  const SizeValueType node = it->second;
+  uint64_t *childMask = &m_ChildMasks[node * m_ChildWords];
+
+  const SizeValueType child = this->GetChild( index );
+  if ( !IsBitSet( childMask, child ) )
+    {
+    return;
+    }
+  const SizeValueType leaf = m_ChildTable[node * m_ChildCount + child];
+  uint64_t *leafMask = &m_LeafMasks[leaf * m_LeafWords];
+
+  // Voxel: its components are reset, since a voxel stored again in the
+  // leaf is expected to start from zero
+  const SizeValueType voxel = this->GetVoxel( index );
+  if ( !IsBitSet( leafMask, voxel ) )
+    {
+    return;
+    }
+  ClearBit( leafMask, voxel );
+  --m_NumberOfVoxels;
+  Element *values = &m_LeafValues[( leaf * m_LeafSize + voxel ) * m_VectorLength];
+  std::fill( values, values + m_VectorLength, NumericTraits< Element >::Zero );
+
+  if ( !IsMaskEmpty( leafMask, m_LeafWords ) )
+    {
+    return;
+    }
+
+  // Leaf: the last leaf takes its slot, and the entry of its parent is
+  // updated
+  ClearBit( childMask, child );
+  const SizeValueType lastLeaf = this->GetNumberOfLeaves() - 1;
+  if ( leaf != lastLeaf )
+    {
+    const ElementIdentifier *lastOrigin = &m_LeafOrigins[lastLeaf * m_Dimension];
+    const SizeValueType lastParent = m_RootMap.find( this->GetRootKey( lastOrigin ) )->second;
+    m_ChildTable[lastParent * m_ChildCount + this->GetChild( lastOrigin )] = leaf;
+
+    std::copy( lastOrigin, lastOrigin + m_Dimension, &m_LeafOrigins[leaf * m_Dimension] );
+    std::copy( &m_LeafMasks[lastLeaf * m_LeafWords], &m_LeafMasks[lastLeaf * m_LeafWords] + m_LeafWords,
+               leafMask );
+    std::copy( &m_LeafValues[lastLeaf * m_LeafSize * m_VectorLength],
+               &m_LeafValues[lastLeaf * m_LeafSize * m_VectorLength] + m_LeafSize * m_VectorLength,
+               &m_LeafValues[leaf * m_LeafSize * m_VectorLength] );
+    }
+  m_LeafOrigins.resize( lastLeaf * m_Dimension );
+  m_LeafMasks.resize( lastLeaf * m_LeafWords );
+  m_LeafValues.resize( lastLeaf * m_LeafSize * m_VectorLength );
+
+  if ( !IsMaskEmpty( childMask, m_ChildWords ) )
+    {
+    return;
+    }
+
+  // Internal node: the last node takes its slot, and its root map entry
+  // is updated
+  m_RootMap.erase( it );
+  const SizeValueType lastNode = this->GetNumberOfInternalNodes() - 1;
+  if ( node != lastNode )
+    {
+    const ElementIdentifier *lastOrigin = &m_InternalOrigins[lastNode * m_Dimension];
+    m_RootMap.find( this->GetRootKey( lastOrigin ) )->second = node;
+
+    std::copy( lastOrigin, lastOrigin + m_Dimension, &m_InternalOrigins[node * m_Dimension] );
+    std::copy( &m_ChildMasks[lastNode * m_ChildWords], &m_ChildMasks[lastNode * m_ChildWords] + m_ChildWords,
+               childMask );
+    std::copy( &m_ChildTable[lastNode * m_ChildCount], &m_ChildTable[lastNode * m_ChildCount] + m_ChildCount,
+               &m_ChildTable[node * m_ChildCount] );
+    }
+  m_InternalOrigins.resize( lastNode * m_Dimension );
+  m_ChildMasks.resize( lastNode * m_ChildWords );
+  m_ChildTable.resize( lastNode * m_ChildCount );
+}
+
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VLeafBits, unsigned int VInternalBits, typename TRootMap>
+bool
+SparseVectorImageTreeContainer< TElementIdentifier , TElement , VLeafBits , VInternalBits , TRootMap >
+::IsRegionEmpty(const IndexValueType *index, const SizeValueType *size) const
+{
+  // Clip the region to the image
+  ElementIdentifier lower[MaximumDimension];
+  ElementIdentifier upper[MaximumDimension];
+  for ( unsigned int d = 0; d < m_Dimension; d++ )
+    {
+    const IndexValueType end = index[d] + static_cast< IndexValueType >( size[d] );
+    if ( size[d] == 0 || end <= 0 || index[d] >= static_cast< IndexValueType >( m_Size[d] ) )
+      {
+      return true;
+      }
+    lower[d] = std::max< IndexValueType >( index[d], 0 );
+    upper[d] = std::min< IndexValueType >( end, m_Size[d] ) - 1;
+    }
+
+  // Range of the internal nodes overlapping the region, and number of
+  // their root keys, saturated at the number of allocated nodes
+  const SizeValueType numberOfNodes = this->GetNumberOfInternalNodes();
+  ElementIdentifier first[MaximumDimension];
+  ElementIdentifier last[MaximumDimension];
+  SizeValueType numberOfKeys = 1;
+  for ( unsigned int d = 0; d < m_Dimension; d++ )
+    {
+    first[d] = lower[d] >> ( VLeafBits + VInternalBits );
+    last[d] = upper[d] >> ( VLeafBits + VInternalBits );
+    const SizeValueType length = static_cast< SizeValueType >( last[d] - first[d] ) + 1;
+    numberOfKeys = ( numberOfKeys > numberOfNodes / length ) ?
+      numberOfNodes + 1 : numberOfKeys * length;
+    }
+
+  // A large region with few allocated nodes: test every node
+  if ( numberOfKeys > numberOfNodes )
+    {
+    const ElementIdentifier nodeLength = static_cast< ElementIdentifier >( 1 ) << ( VLeafBits + VInternalBits );
+    for ( SizeValueType node = 0; node < numberOfNodes; node++ )
+      {
+      const ElementIdentifier *nodeOrigin = &m_InternalOrigins[node * m_Dimension];
+      bool overlaps = true;
+      for ( unsigned int d = 0; d < m_Dimension && overlaps; d++ )
+        {
+        overlaps = nodeOrigin[d] <= upper[d] && nodeOrigin[d] + nodeLength > lower[d];
+        }
+      if ( overlaps && !this->IsNodeRegionEmpty( node, lower, upper ) )
+        {
+        return false;
+        }
+      }
+    return true;
+    }
+
+  // Otherwise look up the root keys of the overlapping nodes only
+  ElementIdentifier coordinates[MaximumDimension];
+  std::copy( first, first + m_Dimension, coordinates );
+  for (;;)
+    {
+    ElementIdentifier key = 0;
+    for ( unsigned int d = 0; d < m_Dimension; d++ )
+      {
+      key += coordinates[d] * m_RootOffsetTable[d];
+      }
+    typename RootMapType::const_iterator it = m_RootMap.find( key );
+    if ( it != m_RootMap.end() && !this->IsNodeRegionEmpty( it->second, lower, upper ) )
+      {
+      return false;
+      }
+
+    unsigned int d = 0;
+    while ( d < m_Dimension && coordinates[d] == last[d] )
+      {
+      coordinates[d] = first[d];
+      ++d;
+      }
+    if ( d == m_Dimension )
+      {
+      return true;
+      }
+    ++coordinates[d];
+    }
+}
+
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VLeafBits, unsigned int VInternalBits, typename TRootMap>
+bool
+SparseVectorImageTreeContainer< TElementIdentifier , TElement , VLeafBits , VInternalBits , TRootMap >
+::IsNodeRegionEmpty(SizeValueType node, const ElementIdentifier *lower,
+                    const ElementIdentifier *upper) const
+{
+  const ElementIdentifier leafLength = 1 << VLeafBits;
+  const uint64_t *childMask = &m_ChildMasks[node * m_ChildWords];
+  for ( SizeValueType word = 0; word < m_ChildWords; word++ )
+    {
+    for ( uint64_t bits = childMask[word]; bits != 0; bits &= bits - 1 )
+      {
+      const SizeValueType leaf = m_ChildTable[node * m_ChildCount + word * 64 + LowestBit( bits )];
+      const ElementIdentifier *leafOrigin = &m_LeafOrigins[leaf * m_Dimension];
+
+      bool inside = true;
+      bool overlaps = true;
+      for ( unsigned int d = 0; d < m_Dimension && overlaps; d++ )
+        {
+        overlaps = leafOrigin[d] <= upper[d] && leafOrigin[d] + leafLength > lower[d];
+        inside = inside && leafOrigin[d] >= lower[d] && leafOrigin[d] + leafLength - 1 <= upper[d];
+        }
+      if ( !overlaps )
+        {
+        continue;
+        }
+      if ( inside )
+        {
+        // An allocated leaf stores at least one voxel
+        return false;
+        }
+
+      const uint64_t *leafMask = &m_LeafMasks[leaf * m_LeafWords];
+      for ( SizeValueType leafWord = 0; leafWord < m_LeafWords; leafWord++ )
+        {
+        for ( uint64_t voxelBits = leafMask[leafWord]; voxelBits != 0; voxelBits &= voxelBits - 1 )
+          {
+          const SizeValueType voxel = leafWord * 64 + LowestBit( voxelBits );
+          inside = true;
+          for ( unsigned int d = 0; d < m_Dimension && inside; d++ )
+            {
+            const ElementIdentifier i = leafOrigin[d]
+              + ( ( voxel >> ( VLeafBits * d ) ) & ( leafLength - 1 ) );
+            inside = i >= lower[d] && i <= upper[d];
+            }
+          if ( inside )
+            {
+            return false;
+            }
+          }
+        }
+      }
+    }
+  return true;
+}
+
+
+/**
+ * Tell the container to try to minimize its memory usage for storage of
+ * the current number of elements.
+ */
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VLeafBits, unsigned int VInternalBits, typename TRootMap>
+void
+SparseVectorImageTreeContainer< TElementIdentifier , TElement , VLeafBits , VInternalBits , TRootMap >
+::Squeeze(void)
+{
+  m_RootMap.rehash( 0 );
+  std::vector< ElementIdentifier >( m_InternalOrigins ).swap( m_InternalOrigins );
+  std::vector< uint64_t >( m_ChildMasks ).swap( m_ChildMasks );
+  std::vector< SizeValueType >( m_ChildTable ).swap( m_ChildTable );
+  std::vector< ElementIdentifier >( m_LeafOrigins ).swap( m_LeafOrigins );
+  std::vector< uint64_t >( m_LeafMasks ).swap( m_LeafMasks );
+  std::vector< Element >( m_LeafValues ).swap( m_LeafValues );
+}
+
+
+/**
+ * Remove all the stored pixels.
+ */
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VLeafBits, unsigned int VInternalBits, typename TRootMap>
+void
+SparseVectorImageTreeContainer< TElementIdentifier , TElement , VLeafBits , VInternalBits , TRootMap >
+::Clear(void)
+{
+  m_RootMap.clear();
+  m_InternalOrigins.clear();
+  m_ChildMasks.clear();
+  m_ChildTable.clear();
+  m_LeafOrigins.clear();
+  m_LeafMasks.clear();
+  m_LeafValues.clear();
+  m_NumberOfVoxels = 0;
+}
+
+
+/**
+ * Tell the container to release any of its allocated memory.
+ */
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VLeafBits, unsigned int VInternalBits, typename TRootMap>
+void
+SparseVectorImageTreeContainer< TElementIdentifier , TElement , VLeafBits , VInternalBits , TRootMap >
+::Initialize(void)
+{
+  if ( m_RootMap.size() > 0 )
+    {
+    if( m_ContainerManageMemory )
+      {
+      this->Clear();
+      }
+    m_ContainerManageMemory = true;
+    this->Modified();
+    }
+}
+
+
+template <typename TElementIdentifier, typename TElement,
+          unsigned int VLeafBits, unsigned int VInternalBits, typename TRootMap>
+void
+SparseVectorImageTreeContainer< TElementIdentifier , TElement , VLeafBits , VInternalBits , TRootMap >
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+
+  os << indent << "VectorLength: " << m_VectorLength << std::endl;
+  os << indent << "Leaf size: " << m_LeafSize << " voxels" << std::endl;
+  os << indent << "Number of internal nodes: " << this->GetNumberOfInternalNodes() << std::endl;
+  os << indent << "Number of leaves: " << this->GetNumberOfLeaves() << std::endl;
+  os << indent << "Number of stored voxels: " << m_NumberOfVoxels << std::endl;
+  os << indent << "Container manages memory: "
+     << (m_ContainerManageMemory ? "true" : "false") << std::endl;
+}
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,268 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Value Codec
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef __itkSparseVectorImageValueCodec_h
+#define __itkSparseVectorImageValueCodec_h
+
+#include "itkMacro.h"
+#include "itkIntTypes.h"
+#include "itkNumericTraits.h"
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace itk
+{
+
+/** \class SparseVectorImageHalfCodec
+ *  \brief Value codec policy storing the components as IEEE 754 half
+ *  precision floats.
+ *
+ *  A value codec policy converts the components of the pixels to the
+ *  type stored by a container (Encode) and back (Decode), given the
+ *  index of the component. Zero must be encoded as zero, so that the
+ *  containers keep skipping the zero components.
+ *
+ *  Half floats have 11 bits of mantissa and range up to 65504. Values
+ *  are rounded to the nearest half float, ties to even; magnitudes below
+ *  2^-25 become zero and are not stored.
+ *
+ *  \sa SparseVectorImageLinearCodec, SparseVectorImageCodecContainer
+ *
+ *  \ingroup ITKSparseVectorImage
+ *
+ */
+template <typename TValue = float>
+class SparseVectorImageHalfCodec
+{
+public:
+  typedef TValue   ValueType;
+  typedef uint16_t StorageType;
+
+  /** Name of the codec, recorded in the .spr header. */
+  static const char * GetName()
+    { return "half"; }
+
+  /** The half codec has no per-component parameters. */
+  void SetVectorLength(unsigned int) {}
+  std::string GetParameters() const
+    { return ""; }
+  void SetParameters(const std::string &) {}
+
+  StorageType Encode(const ValueType & value, unsigned int) const
+    { return FloatToHalf( static_cast< float >( value ) ); }
+
+  ValueType Decode(StorageType code, unsigned int) const
+    { return static_cast< ValueType >( HalfToFloat( code ) ); }
+
+  static uint16_t FloatToHalf(float value)
+    {
+    uint32_t bits;
+    std::memcpy( &bits, &value, sizeof( bits ) );
+
+    const uint16_t sign = static_cast< uint16_t >( ( bits >> 16 ) & 0x8000 );
+    const int exponent = static_cast< int >( ( bits >> 23 ) & 0xff ) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if ( ( ( bits >> 23 ) & 0xff ) == 0xff )
+      {
+      // Infinity or NaN
+      return static_cast< uint16_t >( sign | 0x7c00 | ( mantissa ? 0x200 : 0 ) );
+      }
+    if ( exponent >= 31 )
+      {
+      return static_cast< uint16_t >( sign | 0x7c00 );
+      }
+
+    uint32_t half;
+    uint32_t remainder;
+    uint32_t halfway;
+    if ( exponent <= 0 )
+      {
+      // Subnormal half, or zero
+      if ( exponent < -10 )
+        {
+        return sign;
+        }
+      mantissa |= 0x800000;
+      const unsigned int shift = 14 - exponent;
+      half = mantissa >> shift;
+      remainder = mantissa & ( ( 1u << shift ) - 1 );
+      halfway = 1u << ( shift - 1 );
+      }
+    else
+      {
+      half = ( static_cast< uint32_t >( exponent ) << 10 ) | ( mantissa >> 13 );
+      remainder = mantissa & 0x1fff;
+      halfway = 0x1000;
+      }
+
+    // Round to nearest, ties to even; a carry moves to the next exponent
+    if ( remainder > halfway || ( remainder == halfway && ( half & 1 ) ) )
+      {
+      half++;
+      }
+    return static_cast< uint16_t >( sign | half );
+    }
+
+  static float HalfToFloat(uint16_t half)
+    {
+    const uint32_t sign = static_cast< uint32_t >( half & 0x8000 ) << 16;
+    const uint32_t exponent = ( half >> 10 ) & 0x1f;
+    const uint32_t mantissa = half & 0x3ff;
+
+    uint32_t bits;
+    if ( exponent == 0 )
+      {
+      const float value = std::ldexp( static_cast< float >( mantissa ), -24 );
+      return sign ? -value : value;
+      }
+    else if ( exponent == 31 )
+      {
+      bits = sign | 0x7f800000 | ( mantissa << 13 );
+      }
+    else
+      {
+      bits = sign | ( ( exponent - 15 + 127 ) << 23 ) | ( mantissa << 13 );
+      }
+
+    float value;
+    std::memcpy( &value, &bits, sizeof( value ) );
+    return value;
+    }
+};
+
+
+/** \class SparseVectorImageLinearCodec
+ *  \brief Value codec policy quantizing the components linearly to 8 or
+ *  16-bit integers, with a scale and an offset per component.
+ *
+ *  Code 0 is reserved for zero, so that zero components are still not
+ *  stored. A non-zero value v of component c is stored as the nearest
+ *  code q in [1, max] of Offset[c] + Scale[c] * q. SetRange() sets the
+ *  scale and offset mapping the codes 1 and max to the bounds of the
+ *  range of a component; values outside the range are clamped.
+ *
+ *  The parameters default to a scale of 1 and an offset of 0, i.e. the
+ *  codes are the rounded values. They must be set before storing
+ *  values, since changing them changes the meaning of the stored codes.
+ *
+ *  \sa SparseVectorImageHalfCodec, SparseVectorImageCodecContainer
+ *
+ *  \ingroup ITKSparseVectorImage
+ *
+ */
+template <typename TValue, typename TStorage = uint8_t>
+class SparseVectorImageLinearCodec
+{
+public:
+  typedef TValue   ValueType;
+  typedef TStorage StorageType;
+
+  /** Name of the codec, recorded in the .spr header. */
+  static const char * GetName()
+    { return sizeof( StorageType ) == 1 ? "linear8" : "linear16"; }
+
+  /** Resize the parameters, new components get a scale of 1 and an
+   *  offset of 0. */
+  void SetVectorLength(unsigned int length)
+    {
+    m_Scales.resize( length, 1.0 );
+    m_Offsets.resize( length, 0.0 );
+    }
+
+  /** Set the range of the values of a component. */
+  void SetRange(unsigned int component, double minimum, double maximum)
+    {
+    const double codes = static_cast< double >( NumericTraits< StorageType >::max() ) - 1;
+    double scale = ( maximum - minimum ) / codes;
+    if ( scale <= 0 )
+      {
+      scale = 1.0;
+      }
+    m_Scales[component] = scale;
+    m_Offsets[component] = minimum - scale;
+    }
+
+  /** Set the range of the values of every component. */
+  void SetRange(double minimum, double maximum)
+    {
+    for ( unsigned int c = 0; c < m_Scales.size(); c++ )
+      {
+      this->SetRange( c, minimum, maximum );
+      }
+    }
+
+  double GetScale(unsigned int component) const
+    { return m_Scales[component]; }
+  double GetOffset(unsigned int component) const
+    { return m_Offsets[component]; }
+
+  /** Get/Set the scales and offsets as "scale offset" pairs, as recorded
+   *  in the .spr header. */
+  std::string GetParameters() const
+    {
+    std::ostringstream parameters;
+    parameters << std::setprecision( 17 );
+    for ( unsigned int c = 0; c < m_Scales.size(); c++ )
+      {
+      parameters << m_Scales[c] << " " << m_Offsets[c] << " ";
+      }
+    return parameters.str();
+    }
+
+  void SetParameters(const std::string & parameterString)
+    {
+    std::istringstream parameters( parameterString );
+    for ( unsigned int c = 0; c < m_Scales.size(); c++ )
+      {
+      if ( !( parameters >> m_Scales[c] >> m_Offsets[c] ) )
+        {
+        itkGenericExceptionMacro( << "Missing " << GetName()
+                                  << " codec parameters for component " << c );
+        }
+      }
+    }
+
+  StorageType Encode(const ValueType & value, unsigned int component) const
+    {
+    if ( value == 0 )
+      {
+      return 0;
+      }
+    const double maximum = NumericTraits< StorageType >::max();
+    double code = std::floor( ( value - m_Offsets[component] ) / m_Scales[component] + 0.5 );
+    code = code < 1 ? 1 : ( code > maximum ? maximum : code );
+    return static_cast< StorageType >( code );
+    }
+
+  ValueType Decode(StorageType code, unsigned int component) const
+    {
+    if ( code == 0 )
+      {
+      return NumericTraits< ValueType >::Zero;
+      }
+    return static_cast< ValueType >( m_Offsets[component] + m_Scales[component] * code );
+    }
+
+private:
+  std::vector< double > m_Scales;
+  std::vector< double > m_Offsets;
+};
+
+} // end namespace itk
+
+#endif
@@ -0,0 +1,345 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Voxel Container
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef __itkSparseVectorImageVoxelContainer_h
+#define __itkSparseVectorImageVoxelContainer_h
+
+#include "itkObject.h"
+#include "itkObjectFactory.h"
+#include "itkNumericTraits.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <tr1/unordered_map>
+
+namespace itk
+{
+
+/** \class SparseVectorImageVoxelContainer
+ *  \brief A voxel-keyed image container for itk::SparseVectorImage.
+ *
+ *  Unlike SparseVectorImageContainer, which keeps one hash entry per
+ *  component, this container keeps one hash entry per non-empty voxel.
+ *  The entry maps the voxel offset to a slot of a contiguous value
+ *  array holding the VectorLength components of the voxel, so that a
+ *  whole pixel is retrieved with a single lookup. The map is a
+ *  std::tr1::unordered_map by default, and can be replaced by
+ *  SparseVectorImageFlatHashMap< TElementIdentifier, SizeValueType >.
+ *
+ *  A pixel is written as a whole: SetPixel() stores all its components,
+ *  including the zero ones, as soon as one of them is non-zero. Pixels
+ *  whose components are all zero are not stored, and writing such a
+ *  pixel over a stored voxel erases it.
+ *
+ *  The container can be selected through the TPixelContainer template
+ *  argument of SparseVectorImage:
+ *
+ *  \code
+ *  typedef itk::SparseVectorImage< float, 3,
+ *    itk::SparseVectorImageVoxelContainer< unsigned long, float > > ImageType;
+ *  \endcode
+ *
+ *  \sa SparseVectorImageContainer
+ *
+ *  \ingroup ITKSparseVectorImage
+ *
+ */
+
+template <typename TElementIdentifier, typename TElement,
+          typename TOffsetMap = std::tr1::unordered_map< TElementIdentifier, SizeValueType > >
+class SparseVectorImageVoxelContainer:  public Object
+{
+public:
+  /** Standard class typedefs. */
+  typedef SparseVectorImageVoxelContainer  Self;
+  typedef Object                           Superclass;
+  typedef SmartPointer<Self>               Pointer;
+  typedef SmartPointer<const Self>         ConstPointer;
+
+  /** Save the template parameters. */
+  typedef TElementIdentifier  ElementIdentifier;
+  typedef TElement            Element;
+
+  /** Map from voxel offset to the slot holding the voxel components. */
+  typedef TOffsetMap OffsetMapType;
+
+  /** Contiguous storage of the components, VectorLength per slot. */
+  typedef std::vector< Element > ValueArrayType;
+
+  typedef unsigned int VectorLengthType;
+
+  /** Method for creation through the object factory. */
+  itkNewMacro(Self);
+
+  /** Standard part of every itk Object. */
+  itkTypeMacro(SparseVectorImageVoxelContainer, Object);
+
+  /** Get the map from voxel offsets to slots. */
+  OffsetMapType* GetOffsetMap()
+    { return &m_OffsetMap; }
+
+  /** Get the array containing the components of the stored voxels. */
+  ValueArrayType* GetValueArray()
+    { return &m_ValueArray; }
+
+  /** Get the number of elements currently stored in the container. */
+  unsigned long Size(void) const
+    { return (unsigned long) m_ValueArray.size(); };
+
+  /** Get the number of voxels currently stored in the container. */
+  unsigned long GetNumberOfVoxels(void) const
+    { return (unsigned long) m_SlotOffsets.size(); };
+
+  /** Set the number of components of each pixel. Changing the length
+   *  discards the stored pixels. */
+  void SetVectorLength(VectorLengthType length);
+  itkGetConstMacro(VectorLength, VectorLengthType);
+
+  /** The layout of this container does not depend on the image size.
+   *  This method does nothing. */
+  void SetImageSize(unsigned int, const SizeValueType *) {}
+
+  /** Copy the components of the pixel at the given offset into pixel.
+   *  If the pixel is not stored, fillValue is copied instead. Return
+   *  true if the pixel is stored. */
+  bool GetPixel(ElementIdentifier offset, const Element *fillValue,
+                Element *pixel) const
+    {
+    SizeValueType slot;
+
+    if ( m_Frozen )
+      {
+      typename std::vector< ElementIdentifier >::const_iterator it =
+        std::lower_bound( m_SlotOffsets.begin(), m_SlotOffsets.end(), offset );
+      if ( it == m_SlotOffsets.end() || *it != offset )
+        {
+        std::copy( fillValue, fillValue + m_VectorLength, pixel );
+        return false;
+        }
+      slot = it - m_SlotOffsets.begin();
+      }
+    else
+      {
+      typename OffsetMapType::const_iterator it = m_OffsetMap.find( offset );
+      if ( it == m_OffsetMap.end() )
+        {
+        std::copy( fillValue, fillValue + m_VectorLength, pixel );
+        return false;
+        }
+      slot = it->second;
+      }
+
+    const Element *values = &m_ValueArray[slot * m_VectorLength];
+    std::copy( values, values + m_VectorLength, pixel );
+    return true;
+    }
+
+  /** Store the pixel at the given offset if it has a non-zero component.
+   *  A stored voxel becoming zero is erased, and the last slot is moved
+   *  into its slot. */
+  void SetPixel(ElementIdentifier offset, const Element *pixel)
+    {
+    VectorLengthType i = 0;
+    while ( i < m_VectorLength && pixel[i] == 0 )
+      {
+      i++;
+      }
+    if ( i == m_VectorLength && !m_Frozen )
+      {
+      this->EraseVoxel( offset );
+      return;
+      }
+
+    Element *values = this->GetSlot( offset );
+    std::copy( pixel, pixel + m_VectorLength, values );
+    }
+
+  /** Store a single component given its key, i.e.
+   *  VectorLength * offset + component. */
+  void SetElement(ElementIdentifier key, const Element & value)
+    {
+    this->GetSlot( key / m_VectorLength )[key % m_VectorLength] = value;
+    }
+
+  /** Call visitor( key, value ) for every non-zero component of the
+   *  stored voxels. */
+  template< class TVisitor >
+  void VisitElements(TVisitor & visitor) const
+    {
+    if ( m_Frozen )
+      {
+      for ( SizeValueType slot = 0; slot < m_SlotOffsets.size(); slot++ )
+        {
+        this->VisitVoxel( visitor, m_SlotOffsets[slot], slot );
+        }
+      return;
+      }
+
+    for ( typename OffsetMapType::const_iterator it = m_OffsetMap.begin();
+          it != m_OffsetMap.end(); ++it )
+      {
+      this->VisitVoxel( visitor, it->first, it->second );
+      }
+    }
+
+  /** Set to zero the stored components whose magnitude is at most
+   *  threshold, and remove the voxels left without non-zero component.
+   *  The slots are scanned in parallel, then the value array is
+   *  compacted. This also works on a frozen container. Return the number
+   *  of bytes released, estimated from the size of the entries for the
+   *  offset map. */
+  SizeValueType Prune(double threshold = 0.0);
+
+  /** Replace the pixels of this container by a copy of the pixels of
+   *  source, frozen if source is frozen. The value array and the slot
+   *  offsets are copied in parallel; the entries of
+   *  the offset map are inserted by the calling thread. */
+  void DeepCopy(const Self *source);
+
+  /** Presize the offset map and the value array for the given number of
+   *  stored elements, i.e. size / VectorLength voxels. */
+  void Reserve(SizeValueType size);
+
+  /** Shrink the offset map and the value array to the current number
+   *  of voxels. */
+  void Squeeze(void);
+
+  /** Remove all the stored pixels. This also thaws a frozen container. */
+  void Clear(void);
+
+  /** Replace the offset map by an array of voxel offsets sorted in
+   *  increasing order, and reorder the value array accordingly.
+   *  A frozen container is read-only: pixels are found by binary search
+   *  and writing throws an exception until Thaw() is called.
+   *  \sa SparseVectorImageContainer::Freeze() */
+  void Freeze(void);
+
+  /** Rebuild the offset map of a frozen container. */
+  void Thaw(void);
+
+  /** Return true if the container is frozen. */
+  bool IsFrozen(void) const
+    { return m_Frozen; }
+
+  /** Tell the container to release any of its allocated memory. */
+  void Initialize(void);
+
+  /** See SparseVectorImageContainer::SetContainerManageMemory(). */
+  itkSetMacro(ContainerManageMemory,bool);
+  itkGetMacro(ContainerManageMemory,bool);
+  itkBooleanMacro(ContainerManageMemory);
+
+protected:
+  SparseVectorImageVoxelContainer();
+  virtual ~SparseVectorImageVoxelContainer();
+
+  void PrintSelf(std::ostream& os, Indent indent) const;
+
+  /** Return the components of the voxel at the given offset, creating
+   *  a zero-filled slot if the voxel is not stored yet. */
+  Element * GetSlot(ElementIdentifier offset)
+    {
+    if ( m_Frozen )
+      {
+      itkExceptionMacro( << "Cannot write to a frozen container, call Thaw() first" );
+      }
+
+    std::pair< typename OffsetMapType::iterator, bool > inserted =
+      m_OffsetMap.insert( std::make_pair( offset,
+        static_cast< SizeValueType >( m_OffsetMap.size() ) ) );
+
+    if ( inserted.second )
+      {
+      m_SlotOffsets.push_back( offset );
+      m_ValueArray.resize( m_ValueArray.size() + m_VectorLength,
+                           NumericTraits< Element >::Zero );
+      }
+
+    return &m_ValueArray[inserted.first->second * m_VectorLength];
+    }
+
+  /** Remove the voxel at the given offset from a writable container, if
+   *  it is stored. The last slot is moved into the slot of the voxel. */
+  void EraseVoxel(ElementIdentifier offset);
+
+  /** Call visitor( key, value ) for the non-zero components of a slot. */
+  template< class TVisitor >
+  void VisitVoxel(TVisitor & visitor, ElementIdentifier offset,
+                  SizeValueType slot) const
+    {
+    const ElementIdentifier first = m_VectorLength * offset;
+    const Element *values = &m_ValueArray[slot * m_VectorLength];
+    for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
+      {
+      if ( values[i] != 0 )
+        {
+        visitor( first + i, values[i] );
+        }
+      }
+    }
+
+  /** Zero the small components of a range of slots and flag the slots
+   *  left empty, see Prune(). */
+  struct PruneFunctor
+    {
+    void operator()( SizeValueType begin, SizeValueType end )
+      {
+      for ( SizeValueType slot = begin; slot < end; slot++ )
+        {
+        Element *values = m_Values + slot * m_VectorLength;
+        bool empty = true;
+        for ( VectorLengthType i = 0; i < m_VectorLength; i++ )
+          {
+          if ( std::fabs( static_cast< double >( values[i] ) ) <= m_Threshold )
+            {
+            values[i] = NumericTraits< Element >::Zero;
+            }
+          else
+            {
+            empty = false;
+            }
+          }
+        m_Removed[slot] = empty;
+        }
+      }
+
+    Element *         m_Values;
+    unsigned char *   m_Removed;
+    VectorLengthType  m_VectorLength;
+    double            m_Threshold;
+    };
+
+private:
+  SparseVectorImageVoxelContainer(const Self&); //purposely not implemented
+  void operator=(const Self&); //purposely not implemented
+
+  OffsetMapType        m_OffsetMap;
+  ValueArrayType       m_ValueArray;
+  VectorLengthType     m_VectorLength;
+  bool                 m_ContainerManageMemory;
+
+  /** Offset of the voxel of each slot, so that the last slot can be
+   *  moved when a voxel is erased. The offsets of a frozen container are
+   *  sorted, and the slot of a voxel is found by binary search. */
+  bool                               m_Frozen;
+  std::vector< ElementIdentifier >   m_SlotOffsets;
+
+};
+
+} // end namespace itk
+
+#ifndef ITK_MANUAL_INSTANTIATION
+#include "itkSparseVectorImageVoxelContainer.hxx"
+#endif
+
+#endif
@@ -0,0 +1,354 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Voxel Container
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef _itkSparseVectorImageVoxelContainer_hxx
+#define _itkSparseVectorImageVoxelContainer_hxx
+
+#include "itkSparseVectorImageVoxelContainer.h"
+#include "itkSparseVectorImageParallelFor.h"
+#include <cmath>
+
+namespace itk
+{
+
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+SparseVectorImageVoxelContainer< TElementIdentifier , TElement , TOffsetMap >
+::SparseVectorImageVoxelContainer()
+{
+  m_VectorLength = 1;
+  m_ContainerManageMemory = true;
+  m_Frozen = false;
+}
+
+
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+SparseVectorImageVoxelContainer< TElementIdentifier , TElement , TOffsetMap >
+::~SparseVectorImageVoxelContainer()
+{
+  if( m_ContainerManageMemory )
+    {
+    this->Clear();
+    }
+}
+
+
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+void
+SparseVectorImageVoxelContainer< TElementIdentifier , TElement , TOffsetMap >
+::SetVectorLength(VectorLengthType length)
+{
+  if ( length == m_VectorLength )
+    {
+    return;
+    }
+
+  this->Clear();
+  m_VectorLength = length;
+  this->Modified();
+}
+
+
+/**
+ * Tell the container to allocate enough memory to allow at least
+ * as many elements as the size given to be stored.
+ */
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+void
+SparseVectorImageVoxelContainer< TElementIdentifier , TElement , TOffsetMap >
+::Reserve(SizeValueType size)
+{
+  if ( m_Frozen || m_VectorLength == 0 )
+    {
+    return;
+    }
+
+  const SizeValueType voxels = ( size + m_VectorLength - 1 ) / m_VectorLength;
+  if ( voxels > m_OffsetMap.size() )
+    {
+    m_OffsetMap.rehash( static_cast< SizeValueType >(
+      std::ceil( voxels / m_OffsetMap.max_load_factor() ) ) );
+    }
+  m_SlotOffsets.reserve( voxels );
+  m_ValueArray.reserve( voxels * m_VectorLength );
+}
+
+
+/**
+ * Tell the container to try to minimize its memory usage for storage of
+ * the current number of elements.
+ */
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+void
+SparseVectorImageVoxelContainer< TElementIdentifier , TElement , TOffsetMap >
+::Squeeze(void)
+{
+  if ( !m_Frozen )
+    {
+    m_OffsetMap.rehash( 0 );
+    }
+  std::vector< ElementIdentifier >( m_SlotOffsets ).swap( m_SlotOffsets );
+  ValueArrayType( m_ValueArray ).swap( m_ValueArray );
+}
+
+
+/**
+ * Remove a voxel, moving the last slot into its slot.
+ */
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+void
+SparseVectorImageVoxelContainer< TElementIdentifier , TElement , TOffsetMap >
+::EraseVoxel(ElementIdentifier offset)
+{
+  typename OffsetMapType::iterator it = m_OffsetMap.find( offset );
+  if ( it == m_OffsetMap.end() )
+    {
+    return;
+    }
+  const SizeValueType slot = it->second;
+  m_OffsetMap.erase( it );
+
+  const SizeValueType last = m_SlotOffsets.size() - 1;
+  if ( slot != last )
+    {
+    std::copy( m_ValueArray.begin() + last * m_VectorLength,
+               m_ValueArray.begin() + ( last + 1 ) * m_VectorLength,
+               m_ValueArray.begin() + slot * m_VectorLength );
+    m_SlotOffsets[slot] = m_SlotOffsets[last];
+    m_OffsetMap.find( m_SlotOffsets[slot] )->second = slot;
+    }
+  m_SlotOffsets.pop_back();
+  m_ValueArray.resize( last * m_VectorLength );
+  this->Modified();
+}
+
+
+/**
+ * Zero the small components and remove the empty voxels.
+ */
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+SizeValueType
+SparseVectorImageVoxelContainer< TElementIdentifier , TElement , TOffsetMap >
+::Prune(double threshold)
+{
+  const SizeValueType numberOfSlots = this->GetNumberOfVoxels();
+  if ( numberOfSlots == 0 || m_VectorLength == 0 )
+    {
+    return 0;
+    }
+
+  std::vector< unsigned char > removed( numberOfSlots );
+  PruneFunctor functor;
+  functor.m_Values = &m_ValueArray[0];
+  functor.m_Removed = &removed[0];
+  functor.m_VectorLength = m_VectorLength;
+  functor.m_Threshold = threshold;
+  SparseVectorImageParallelFor< PruneFunctor >::Run( numberOfSlots, functor );
+  this->Modified();
+
+  // Move the kept voxels down, keeping their order
+  SizeValueType bytes = 0;
+  SizeValueType kept = 0;
+  for ( SizeValueType slot = 0; slot < numberOfSlots; slot++ )
+    {
+    const ElementIdentifier offset = m_SlotOffsets[slot];
+    if ( removed[slot] )
+      {
+      if ( !m_Frozen )
+        {
+        m_OffsetMap.erase( offset );
+        bytes += sizeof( typename OffsetMapType::value_type ) + sizeof( void * );
+        }
+      continue;
+      }
+    if ( kept != slot )
+      {
+      std::copy( m_ValueArray.begin() + slot * m_VectorLength,
+                 m_ValueArray.begin() + ( slot + 1 ) * m_VectorLength,
+                 m_ValueArray.begin() + kept * m_VectorLength );
+      m_SlotOffsets[kept] = offset;
+      if ( !m_Frozen )
+        {
+        m_OffsetMap.find( offset )->second = kept;
+        }
+      }
+    kept++;
+    }
+  if ( kept == numberOfSlots )
+    {
+    return 0;
+    }
+
+  bytes += m_SlotOffsets.capacity() * sizeof( ElementIdentifier );
+  m_SlotOffsets.resize( kept );
+  std::vector< ElementIdentifier >( m_SlotOffsets ).swap( m_SlotOffsets );
+  bytes -= m_SlotOffsets.capacity() * sizeof( ElementIdentifier );
+
+  bytes += m_ValueArray.capacity() * sizeof( Element );
+  m_ValueArray.resize( kept * m_VectorLength );
+  ValueArrayType( m_ValueArray ).swap( m_ValueArray );
+  bytes -= m_ValueArray.capacity() * sizeof( Element );
+
+  return bytes;
+}
+
+
+/**
+ * Copy the pixels of another container.
+ */
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+void
+SparseVectorImageVoxelContainer< TElementIdentifier , TElement , TOffsetMap >
+::DeepCopy(const Self *source)
+{
+  if ( source == this )
+    {
+    return;
+    }
+
+  this->Clear();
+  m_VectorLength = source->m_VectorLength;
+
+  if ( source->m_Frozen )
+    {
+    OffsetMapType().swap( m_OffsetMap );
+    m_Frozen = true;
+    }
+  else
+    {
+    m_OffsetMap.rehash( static_cast< SizeValueType >(
+      std::ceil( source->m_OffsetMap.size() / m_OffsetMap.max_load_factor() ) ) );
+    for ( typename OffsetMapType::const_iterator it = source->m_OffsetMap.begin();
+          it != source->m_OffsetMap.end(); ++it )
+      {
+      m_OffsetMap.insert( std::make_pair( it->first, it->second ) );
+      }
+    }
+  SparseVectorImageParallelCopy( source->m_SlotOffsets, m_SlotOffsets );
+  SparseVectorImageParallelCopy( source->m_ValueArray, m_ValueArray );
+
+  this->Modified();
+}
+
+
+/**
+ * Remove all the stored pixels.
+ */
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+void
+SparseVectorImageVoxelContainer< TElementIdentifier , TElement , TOffsetMap >
+::Clear(void)
+{
+  m_OffsetMap.clear();
+  m_SlotOffsets.clear();
+  m_ValueArray.clear();
+  m_Frozen = false;
+}
+
+
+/**
+ * Replace the offset map by sorted offsets.
+ */
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+void
+SparseVectorImageVoxelContainer< TElementIdentifier , TElement , TOffsetMap >
+::Freeze(void)
+{
+  if ( m_Frozen )
+    {
+    return;
+    }
+
+  typedef std::pair< ElementIdentifier, SizeValueType > VoxelType;
+  std::vector< VoxelType > voxels( m_SlotOffsets.size() );
+  for ( SizeValueType slot = 0; slot < m_SlotOffsets.size(); slot++ )
+    {
+    voxels[slot] = VoxelType( m_SlotOffsets[slot], slot );
+    }
+  OffsetMapType().swap( m_OffsetMap );
+
+  std::sort( voxels.begin(), voxels.end() );
+
+  ValueArrayType values( m_ValueArray.size() );
+  for ( SizeValueType slot = 0; slot < voxels.size(); slot++ )
+    {
+    m_SlotOffsets[slot] = voxels[slot].first;
+    const Element *src = &m_ValueArray[voxels[slot].second * m_VectorLength];
+    std::copy( src, src + m_VectorLength, &values[slot * m_VectorLength] );
+    }
+  m_ValueArray.swap( values );
+
+  m_Frozen = true;
+  this->Modified();
+}
+
+
+/**
+ * Rebuild the offset map from the slot offsets.
+ */
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+void
+SparseVectorImageVoxelContainer< TElementIdentifier , TElement , TOffsetMap >
+::Thaw(void)
+{
+  if ( !m_Frozen )
+    {
+    return;
+    }
+
+  for ( SizeValueType slot = 0; slot < m_SlotOffsets.size(); slot++ )
+    {
+    m_OffsetMap.insert( std::make_pair( m_SlotOffsets[slot], slot ) );
+    }
+  m_Frozen = false;
+
+  this->Modified();
+}
+
+
+/**
+ * Tell the container to release any of its allocated memory.
+ */
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+void
+SparseVectorImageVoxelContainer< TElementIdentifier , TElement , TOffsetMap >
+::Initialize(void)
+{
+  if ( this->GetNumberOfVoxels() > 0 )
+    {
+    if( m_ContainerManageMemory )
+      {
+      this->Clear();
+      }
+    m_ContainerManageMemory = true;
+    this->Modified();
+    }
+}
+
+
+template <typename TElementIdentifier, typename TElement, typename TOffsetMap>
+void
+SparseVectorImageVoxelContainer< TElementIdentifier , TElement , TOffsetMap >
+::PrintSelf(std::ostream& os, Indent indent) const
+{
+  Superclass::PrintSelf(os,indent);
+
+  os << indent << "VectorLength: " << m_VectorLength << std::endl;
+  os << indent << "Number of stored voxels: " << this->GetNumberOfVoxels() << std::endl;
+  os << indent << "Frozen: " << (m_Frozen ? "true" : "false") << std::endl;
+  os << indent << "Container manages memory: "
+     << (m_ContainerManageMemory ? "true" : "false") << std::endl;
+}
+
+} // end namespace itk
+
+#endif
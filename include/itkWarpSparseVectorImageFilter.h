@@ -23,6 +23,8 @@
 #include "itkDefaultConvertPixelTraits.h"
 #include "itkTransform.h"
 #include "itkAffineTransform.h"
+#include <algorithm>
+#include <vector>
 
 namespace itk
 {
@@ -71,7 +73,15 @@ namespace itk
  * The input image is set via SetInput. The input displacement field
  * is set via SetDisplacementField.
  *
- * This filter is implemented as a multithreaded filter.
+ * This filter is implemented as a multithreaded filter. As in
+ * ResampleSparseVectorImageFilter, each thread appends the non-zero
+ * pixels of its region to a buffer of its own, and the buffers are
+ * inserted into the output container after the threads.
+ *
+ * The input requested region is the bounding box of the input pixels
+ * read for the output requested region when the displacements are
+ * bounded, so that the filter can be streamed: see
+ * SetMaximumDisplacement().
  *
  * \warning This filter assumes that the input type, output type
  * and displacement field type all have the same number of dimensions.
@@ -120,6 +130,7 @@ public:
   typedef typename OutputImageType::IndexValueType    IndexValueType;
   typedef typename OutputImageType::SizeType          SizeType;
   typedef typename OutputImageType::PixelType         PixelType;
+  typedef typename OutputImageType::InternalPixelType OutputInternalPixelType;
   typedef typename OutputImageType::SpacingType       SpacingType;
 
   typedef DefaultConvertPixelTraits<PixelType>        PixelConvertType;
@@ -220,6 +231,16 @@ public:
   /** Get the edge padding value */
   itkGetConstMacro(EdgePaddingValue, PixelType);
 
+  /** Set/Get a bound on the magnitude of every component of the
+   * displacements, in physical units. When it is not negative and the
+   * bulk transform is linear, the input requested region is restricted
+   * to the input pixels reachable from the output requested region. The
+   * default, -1, computes the bound from the displacement field when the
+   * field is not the output of a filter, and requests the whole input
+   * otherwise. */
+  itkSetMacro(MaximumDisplacement, double);
+  itkGetConstMacro(MaximumDisplacement, double);
+
   /** Typedef of the bulk transform. */
   typedef Transform<double, ImageDimension, ImageDimension> TransformType;
   typedef typename TransformType::Pointer TransformPointer;
@@ -239,9 +260,10 @@ public:
    * and the displacement field's LargestPossibleRegion. */
   virtual void GenerateOutputInformation();
 
-  /** It is difficult to compute in advance the input image region
-   * required to compute the requested output region. Thus the safest
-   * thing to do is to request for the whole input image.
+  /** For bounded displacements, a linear bulk transform and the sparse
+   * linear or nearest neighbor interpolator, the input requested region
+   * is the bounding box of the input pixels read for the output
+   * requested region. The whole input image is requested otherwise.
    *
    * For the displacement field, the input requested region
    * set to be the same as that of the output requested region. */
@@ -293,6 +315,48 @@ protected:
    */
   virtual void VerifyInputInformation() {}
 
+  /** Compute the bounding box of the input pixels read by the
+   *  interpolator for the pixels of an output region, cropped by the
+   *  input largest possible region, when the interpolator is a sparse
+   *  linear or nearest neighbor one. Return false if the region cannot
+   *  be computed. */
+  bool ComputeInputRequestedRegion(const OutputImageRegionType & outputRegion,
+                                   typename InputImageType::RegionType & inputRegion);
+
+  /** Output pixels computed by a thread: the offsets of the non-zero
+   *  pixels and their components, VectorLength per offset. */
+  struct ThreadBuffer
+    {
+    std::vector< OffsetValueType >          m_Offsets;
+    std::vector< OutputInternalPixelType >  m_Values;
+    };
+
+  /** Append a pixel to the buffer of a thread, unless all its components
+   *  are zero: the output container does not store these pixels. */
+  void AppendPixel(ThreadBuffer & buffer, OffsetValueType offset,
+                   const PixelType & pixel, unsigned int length) const
+    {
+    const unsigned int nComponents =
+      std::min( length, PixelConvertType::GetNumberOfComponents( pixel ) );
+    unsigned int n = 0;
+    while ( n < nComponents && PixelConvertType::GetNthComponent( n, pixel ) == 0 )
+      {
+      ++n;
+      }
+    if ( n == nComponents )
+      {
+      return;
+      }
+
+    buffer.m_Offsets.push_back( offset );
+    for ( n = 0; n < length; n++ )
+      {
+      buffer.m_Values.push_back( n < nComponents ?
+        static_cast< OutputInternalPixelType >( PixelConvertType::GetNthComponent( n, pixel ) ) :
+        NumericTraits< OutputInternalPixelType >::Zero );
+      }
+    }
+
 private:
   WarpSparseVectorImageFilter(const Self &); //purposely not implemented
   void operator=(const Self &);  //purposely not implemented
@@ -317,9 +381,16 @@ private:
   /** The bulk transform. */
   TransformPointer m_Transform;
 
-  std::vector<OutputImagePointer> m_IntermediateImages;
-                                               // Store intermediate result
-  std::vector<OutputImageRegionType> m_SplitRegions;
+  /** Bound on the components of the displacements, negative if unknown. */
+  double m_MaximumDisplacement;
+
+  /** Bound computed from the displacement field, and the modification
+   *  time of the field it was computed for. */
+  double           m_DisplacementBound;
+  ModifiedTimeType m_DisplacementBoundTime;
+
+  std::vector<ThreadBuffer> m_ThreadBuffers;   // Pixels computed by
+                                               // each thread
 };
 } // end namespace itk
 
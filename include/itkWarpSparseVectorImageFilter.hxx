@@ -20,11 +20,14 @@
 #include "itkWarpSparseVectorImageFilter.h"
 
 #include "itkImageRegionIterator.h"
-#include "itkImageRegionIteratorWithIndex.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
 #include "itkNumericTraits.h"
 #include "itkProgressReporter.h"
 #include "itkContinuousIndex.h"
+#include "itkSparseVectorImageNearestNeighborInterpolateImageFunction.h"
 #include "vnl/vnl_math.h"
+#include <cmath>
 namespace itk
 {
 /**
@@ -45,6 +48,9 @@ WarpSparseVectorImageFilter< TInputImage, TOutputImage, TDisplacementField >
   m_EdgePaddingValue
     = NumericTraits<PixelType>::ZeroValue( m_EdgePaddingValue );
   m_OutputStartIndex.Fill(0);
+  m_MaximumDisplacement = -1.0;
+  m_DisplacementBound = 0.0;
+  m_DisplacementBoundTime = 0;
   // Setup default interpolator
   typename DefaultInterpolatorType::Pointer interp =
     DefaultInterpolatorType::New();
@@ -75,6 +81,7 @@ WarpSparseVectorImageFilter< TInputImage, TOutputImage, TDisplacementField >
      << std::endl;
   os << indent << "Interpolator: " << m_Interpolator.GetPointer() << std::endl;
   os << indent << "Transform: " << m_Transform.GetPointer() << std::endl;
+  os << indent << "MaximumDisplacement: " << m_MaximumDisplacement << std::endl;
 }
 
 /**
@@ -187,16 +194,8 @@ WarpSparseVectorImageFilter< TInputImage, TOutputImage, TDisplacementField >
       }
     }
 
-  unsigned int nbOfThreads = this->GetNumberOfThreads();
-  if ( !m_IntermediateImages.empty() )
-    m_IntermediateImages.clear();
-  m_IntermediateImages.resize( nbOfThreads );
-  for ( unsigned int i = 0; i < nbOfThreads; ++i )
-    m_IntermediateImages[i] = NULL;
-
-  if ( !m_SplitRegions.empty() )
-    m_SplitRegions.clear();
-  m_SplitRegions.resize( nbOfThreads );
+  m_ThreadBuffers.clear();
+  m_ThreadBuffers.resize( this->GetNumberOfThreads() );
 }
 
 /**
@@ -212,25 +211,32 @@ WarpSparseVectorImageFilter< TInputImage, TOutputImage, TDisplacementField >
 
   // Get output pointer
   OutputImagePointer outputPtr = this->GetOutput();
+  typename TOutputImage::PixelContainer *container = outputPtr->GetPixelContainer();
+  const unsigned int length = outputPtr->GetNumberOfComponentsPerPixel();
+  const double zeroThreshold = outputPtr->GetZeroThreshold();
 
-  // Stack the intermediate images to form the output image
-  for ( unsigned int threadId = 0; threadId < m_IntermediateImages.size(); ++threadId )
+  // Presize the container for the pixels of all the threads
+  SizeValueType numberOfPixels = 0;
+  for ( unsigned int threadId = 0; threadId < m_ThreadBuffers.size(); ++threadId )
     {
-    if ( m_IntermediateImages[threadId] )
-      {
-      typedef ImageRegionIteratorWithIndex< TOutputImage > OutputIterator;
-
-      OutputIterator tmpIt(m_IntermediateImages[threadId], m_SplitRegions[threadId]);
-      OutputIterator outIt(outputPtr, m_SplitRegions[threadId]);
+    numberOfPixels += m_ThreadBuffers[threadId].m_Offsets.size();
+    }
+  container->Reserve( numberOfPixels * length );
 
-      while( !outIt.IsAtEnd() )
-        {
-        outIt.Set( tmpIt.Get() );
-        ++tmpIt;
-        ++outIt;
-        }
+  // Insert the pixels of each thread and release its buffer
+  for ( unsigned int threadId = 0; threadId < m_ThreadBuffers.size(); ++threadId )
+    {
+    ThreadBuffer & buffer = m_ThreadBuffers[threadId];
+    for ( SizeValueType n = 0; n < buffer.m_Offsets.size(); n++ )
+      {
+      TOutputImage::AccessorType::SetComponents( container, buffer.m_Offsets[n],
+                                                 &buffer.m_Values[n * length],
+                                                 length, zeroThreshold );
       }
+    std::vector< OffsetValueType >().swap( buffer.m_Offsets );
+    std::vector< OutputInternalPixelType >().swap( buffer.m_Values );
     }
+  m_ThreadBuffers.clear();
 }
 
 template< class TInputImage, class TOutputImage, class TDisplacementField >
@@ -338,8 +344,10 @@ WarpSparseVectorImageFilter< TInputImage, TOutputImage, TDisplacementField >
   ThreadIdType threadId)
 {
   InputImageConstPointer  inputPtr = this->GetInput();
-  OutputImagePointer      outputPtr = m_IntermediateImages[threadId];
+  OutputImagePointer      outputPtr = this->GetOutput();
   DisplacementFieldPointer fieldPtr = this->GetDisplacementField();
+  ThreadBuffer & buffer = m_ThreadBuffers[threadId];
+  const unsigned int length = outputPtr->GetNumberOfComponentsPerPixel();
 
   AffineTransformPointer bulkTransform =
       dynamic_cast<AffineTransformType *>( m_Transform.GetPointer() );
@@ -347,8 +355,8 @@ WarpSparseVectorImageFilter< TInputImage, TOutputImage, TDisplacementField >
   // support progress methods/callbacks
   ProgressReporter progress( this, threadId, outputRegionForThread.GetNumberOfPixels() );
 
-  // iterator for the output image
-  ImageRegionIteratorWithIndex< OutputImageType > outputIt(
+  // iterator for the output image, only used to compute indices
+  ImageRegionConstIteratorWithIndex< OutputImageType > outputIt(
     outputPtr, outputRegionForThread);
   IndexType        index;
   PointType        point;
@@ -382,11 +390,11 @@ WarpSparseVectorImageFilter< TInputImage, TOutputImage, TDisplacementField >
         {
         PixelType value =
           static_cast< PixelType >( m_Interpolator->Evaluate(point) );
-        outputIt.Set(value);
+        this->AppendPixel( buffer, outputPtr->ComputeOffset(index), value, length );
         }
       else
         {
-        outputIt.Set(m_EdgePaddingValue);
+        this->AppendPixel( buffer, outputPtr->ComputeOffset(index), m_EdgePaddingValue, length );
         }
       ++outputIt;
       ++fieldIt;
@@ -416,11 +424,11 @@ WarpSparseVectorImageFilter< TInputImage, TOutputImage, TDisplacementField >
         {
         PixelType value =
           static_cast< PixelType >( m_Interpolator->Evaluate(point) );
-        outputIt.Set(value);
+        this->AppendPixel( buffer, outputPtr->ComputeOffset(index), value, length );
         }
       else
         {
-        outputIt.Set(m_EdgePaddingValue);
+        this->AppendPixel( buffer, outputPtr->ComputeOffset(index), m_EdgePaddingValue, length );
         }
       ++outputIt;
       progress.CompletedPixel();
@@ -438,17 +446,6 @@ WarpSparseVectorImageFilter< TInputImage, TOutputImage, TDisplacementField >
   const OutputImageRegionType & outputRegionForThread,
   ThreadIdType threadId)
 {
-  m_SplitRegions[threadId] = outputRegionForThread;
-
-  // Clone the output image
-  OutputImagePointer outputPtr = this->GetOutput();
-
-  m_IntermediateImages[threadId] = OutputImageType::New();
-  m_IntermediateImages[threadId]->CopyInformation( outputPtr );
-  m_IntermediateImages[threadId]->SetRequestedRegion( outputPtr->GetRequestedRegion() );
-  m_IntermediateImages[threadId]->SetBufferedRegion( outputPtr->GetBufferedRegion() );
-  m_IntermediateImages[threadId]->Allocate();
-
   this->NonlinearThreadedGenerateData(outputRegionForThread, threadId);
 }
 
@@ -460,19 +457,29 @@ WarpSparseVectorImageFilter< TInputImage, TOutputImage, TDisplacementField >
   // call the superclass's implementation
   Superclass::GenerateInputRequestedRegion();
 
-  // request the largest possible region for the input image
+  // request the input pixels read for the output requested region if
+  // they can be bounded, and the largest possible region otherwise
   InputImagePointer inputPtr =
     const_cast< InputImageType * >( this->GetInput() );
+  OutputImagePointer      outputPtr = this->GetOutput();
 
   if ( inputPtr )
     {
-    inputPtr->SetRequestedRegionToLargestPossibleRegion();
+    typename InputImageType::RegionType inputRequestedRegion;
+    if ( this->ComputeInputRequestedRegion( outputPtr->GetRequestedRegion(),
+                                            inputRequestedRegion ) )
+      {
+      inputPtr->SetRequestedRegion( inputRequestedRegion );
+      }
+    else
+      {
+      inputPtr->SetRequestedRegionToLargestPossibleRegion();
+      }
     }
 
   // just propagate up the output requested region for the
   // deformation field.
   DisplacementFieldPointer fieldPtr = this->GetDisplacementField();
-  OutputImagePointer      outputPtr = this->GetOutput();
   if ( fieldPtr.IsNotNull() )
     {
     fieldPtr->SetRequestedRegion( outputPtr->GetRequestedRegion() );
@@ -483,6 +490,142 @@ WarpSparseVectorImageFilter< TInputImage, TOutputImage, TDisplacementField >
     }
 }
 
+template< class TInputImage, class TOutputImage, class TDisplacementField >
+bool
+WarpSparseVectorImageFilter< TInputImage, TOutputImage, TDisplacementField >
+::ComputeInputRequestedRegion(const OutputImageRegionType & outputRegion,
+                              typename InputImageType::RegionType & inputRegion)
+{
+  typedef SparseVectorImageNearestNeighborInterpolateImageFunction< InputImageType, CoordRepType >
+                                                                    NearestNeighborInterpolatorType;
+
+  const InputImageType *inputPtr = this->GetInput();
+  const OutputImageType *outputPtr = this->GetOutput();
+  DisplacementFieldPointer fieldPtr = this->GetDisplacementField();
+  const typename InputImageType::RegionType & largestRegion = inputPtr->GetLargestPossibleRegion();
+
+  // The padding below covers the neighbourhood read by the sparse
+  // linear and nearest neighbor interpolators only
+  if ( !m_Transform || !m_Transform->IsLinear() || fieldPtr.IsNull()
+       || ( !dynamic_cast< const DefaultInterpolatorType * >( m_Interpolator.GetPointer() )
+            && !dynamic_cast< const NearestNeighborInterpolatorType * >( m_Interpolator.GetPointer() ) )
+       || outputRegion.GetNumberOfPixels() == 0
+       || largestRegion.GetNumberOfPixels() == 0 )
+    {
+    return false;
+    }
+
+  // The displacements of a field which is not generated by a filter are
+  // already known, and bounded by their largest component. The bound is
+  // kept until the field is modified, since the requested region is
+  // computed again for every piece of a streamed output
+  double maximumDisplacement = m_MaximumDisplacement;
+  if ( maximumDisplacement < 0 )
+    {
+    if ( fieldPtr->GetSource() || fieldPtr->GetBufferedRegion().GetNumberOfPixels() == 0 )
+      {
+      return false;
+      }
+    if ( m_DisplacementBoundTime != fieldPtr->GetMTime() )
+      {
+      m_DisplacementBound = 0;
+      for ( ImageRegionConstIterator< DisplacementFieldType > fieldIt( fieldPtr, fieldPtr->GetBufferedRegion() );
+            !fieldIt.IsAtEnd(); ++fieldIt )
+        {
+        const DisplacementType displacement = fieldIt.Get();
+        for ( unsigned int j = 0; j < ImageDimension; j++ )
+          {
+          m_DisplacementBound = std::max( m_DisplacementBound,
+                                          std::fabs( static_cast< double >( displacement[j] ) ) );
+          }
+        }
+      m_DisplacementBoundTime = fieldPtr->GetMTime();
+      }
+    maximumDisplacement = m_DisplacementBound;
+    }
+
+  // Bounding box of the displaced output points, in physical space
+  double lower[ImageDimension];
+  double upper[ImageDimension];
+  for ( unsigned int j = 0; j < ImageDimension; j++ )
+    {
+    lower[j] = NumericTraits< double >::max();
+    upper[j] = NumericTraits< double >::NonpositiveMin();
+    }
+
+  IndexType index;
+  PointType point;
+  for ( unsigned int n = 0; n < ( 1u << ImageDimension ); n++ )
+    {
+    for ( unsigned int j = 0; j < ImageDimension; j++ )
+      {
+      index[j] = outputRegion.GetIndex()[j];
+      if ( n & ( 1u << j ) )
+        {
+        index[j] += static_cast< IndexValueType >( outputRegion.GetSize()[j] ) - 1;
+        }
+      }
+    outputPtr->TransformIndexToPhysicalPoint( index, point );
+    for ( unsigned int j = 0; j < ImageDimension; j++ )
+      {
+      lower[j] = std::min( lower[j], point[j] - maximumDisplacement );
+      upper[j] = std::max( upper[j], point[j] + maximumDisplacement );
+      }
+    }
+
+  // The linear bulk transform maps the box into the bounding box of the
+  // images of its corners
+  double first[ImageDimension];
+  double last[ImageDimension];
+  for ( unsigned int j = 0; j < ImageDimension; j++ )
+    {
+    first[j] = NumericTraits< double >::max();
+    last[j] = NumericTraits< double >::NonpositiveMin();
+    }
+
+  ContinuousIndex< double, ImageDimension > inputIndex;
+  for ( unsigned int n = 0; n < ( 1u << ImageDimension ); n++ )
+    {
+    for ( unsigned int j = 0; j < ImageDimension; j++ )
+      {
+      point[j] = ( n & ( 1u << j ) ) ? upper[j] : lower[j];
+      }
+    inputPtr->TransformPhysicalPointToContinuousIndex( m_Transform->TransformPoint( point ), inputIndex );
+    for ( unsigned int j = 0; j < ImageDimension; j++ )
+      {
+      first[j] = std::min( first[j], static_cast< double >( inputIndex[j] ) );
+      last[j] = std::max( last[j], static_cast< double >( inputIndex[j] ) );
+      }
+    }
+
+  // The interpolators of sparse images read the pixels at the floor of
+  // the continuous index and the next one, plus one pixel on each side
+  // for rounding
+  const typename InputImageType::IndexType & largestIndex = largestRegion.GetIndex();
+  for ( unsigned int j = 0; j < ImageDimension; j++ )
+    {
+    const double start = std::floor( first[j] ) - 1;
+    const double end = std::floor( last[j] ) + 2;
+    const double largestStart = static_cast< double >( largestIndex[j] );
+    const double largestEnd = largestStart + static_cast< double >( largestRegion.GetSize()[j] ) - 1;
+    if ( !( end >= largestStart ) || !( start <= largestEnd ) )
+      {
+      // No output pixel maps into the input: request a single pixel
+      typename InputImageType::SizeType size;
+      size.Fill( 1 );
+      inputRegion.SetIndex( largestIndex );
+      inputRegion.SetSize( size );
+      return true;
+      }
+    const IndexValueType startIndex = static_cast< IndexValueType >( std::max( start, largestStart ) );
+    const IndexValueType endIndex = static_cast< IndexValueType >( std::min( end, largestEnd ) );
+    inputRegion.SetIndex( j, startIndex );
+    inputRegion.SetSize( j, static_cast< SizeValueType >( endIndex - startIndex + 1 ) );
+    }
+
+  return true;
+}
+
 template< class TInputImage, class TOutputImage, class TDisplacementField >
 void
 WarpSparseVectorImageFilter< TInputImage, TOutputImage, TDisplacementField >
@@ -0,0 +1,230 @@
+#include "itkSparseVectorImage.h"
+#include "itkResampleSparseVectorImageFilter.h"
+#include "itkSparseVectorImageLinearInterpolateImageFunction.h"
+#include "itkAffineTransform.h"
+#include "itkEuler3DTransform.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkTimeProbe.h"
+#include "itkSparseVectorImageTestHelper.h"
+#include <cmath>
+
+
+namespace
+{
+
+typedef float PixelType;
+const unsigned int Dimension = 3;
+const unsigned int VectorLength = 6;
+
+typedef itk::SparseVectorImage<PixelType, Dimension> ImageType;
+typedef itk::ResampleSparseVectorImageFilter<ImageType, ImageType> FilterType;
+typedef itk::SparseVectorImageLinearInterpolateImageFunction<ImageType, double> InterpolatorType;
+typedef itk::AffineTransform<double, Dimension> TransformType;
+typedef itk::Euler3DTransform<double> RigidTransformType;
+
+// Compare the output of the filter with the interpolator evaluated at
+// the transformed index of every output pixel. The scanline path of
+// linear transforms computes the indices incrementally, hence the
+// tolerance. The pixels skipped with the input support must be zero.
+int
+CheckResample( const ImageType *input, const FilterType::TransformType *transform, const char *name,
+               bool useLinearFastPath, bool useInputSupport )
+{
+  FilterType::Pointer filter = FilterType::New();
+  filter->SetInput( input );
+  filter->SetTransform( transform );
+  filter->SetUseLinearFastPath( useLinearFastPath );
+  filter->SetUseInputSupport( useInputSupport );
+  filter->SetSize( input->GetLargestPossibleRegion().GetSize() );
+  filter->SetOutputSpacing( input->GetSpacing() );
+  filter->SetOutputOrigin( input->GetOrigin() );
+  filter->SetOutputDirection( input->GetDirection() );
+
+  itk::TimeProbe probe;
+  probe.Start();
+  filter->Update();
+  probe.Stop();
+
+  const ImageType *output = filter->GetOutput();
+  std::cout << name << ( useLinearFastPath ? ", scanline path" : ", per-pixel path" )
+            << ( useInputSupport ? ", input support: " : ": " )
+            << output->GetPixelContainer()->Size()
+            << " elements in " << probe.GetMean() << " s" << std::endl;
+
+  InterpolatorType::Pointer interpolator = InterpolatorType::New();
+  interpolator->SetInputImage( input );
+
+  ImageType::PixelType zero( VectorLength );
+  zero.Fill( 0 );
+
+  for ( itk::ImageRegionConstIteratorWithIndex<ImageType> it(output, output->GetLargestPossibleRegion());
+        !it.IsAtEnd(); ++it )
+    {
+    ImageType::PointType point;
+    output->TransformIndexToPhysicalPoint( it.GetIndex(), point );
+    InterpolatorType::ContinuousIndexType index;
+    input->TransformPhysicalPointToContinuousIndex( transform->TransformPoint( point ), index );
+
+    ImageType::PixelType expected = zero;
+    if ( interpolator->IsInsideBuffer( index ) )
+      {
+      const InterpolatorType::OutputType value = interpolator->EvaluateAtContinuousIndex( index );
+      for ( unsigned int k = 0; k < VectorLength; k++ )
+        {
+        expected[k] = static_cast<PixelType>( value[k] );
+        }
+      }
+
+    const ImageType::PixelType resampled = it.Get();
+    bool same = true;
+    for ( unsigned int k = 0; k < VectorLength; k++ )
+      {
+      same = same && std::fabs( resampled[k] - expected[k] ) <= 1e-5;
+      }
+    if ( !same )
+      {
+      std::cerr << name << ": output differs at " << it.GetIndex() << ": "
+                << resampled << " instead of " << expected << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
+
+// Compare the output of the filter with and without the remapping of
+// the keys, which must be identical
+int
+CheckRemapping( const ImageType *input, const FilterType::TransformType *transform, const char *name )
+{
+  ImageType::Pointer outputs[2];
+  for ( unsigned int i = 0; i < 2; i++ )
+    {
+    FilterType::Pointer filter = FilterType::New();
+    filter->SetInput( input );
+    filter->SetTransform( transform );
+    filter->SetUseKeyRemapping( i == 0 );
+    filter->SetSize( input->GetLargestPossibleRegion().GetSize() );
+    filter->SetOutputSpacing( input->GetSpacing() );
+    filter->SetOutputOrigin( input->GetOrigin() );
+    filter->SetOutputDirection( input->GetDirection() );
+
+    itk::TimeProbe probe;
+    probe.Start();
+    filter->Update();
+    probe.Stop();
+
+    outputs[i] = filter->GetOutput();
+    std::cout << name << ( i == 0 ? ", remapped keys: " : ", interpolated: " )
+              << outputs[i]->GetPixelContainer()->Size()
+              << " elements in " << probe.GetMean() << " s" << std::endl;
+    }
+
+  if ( outputs[0]->GetPixelContainer()->Size() != outputs[1]->GetPixelContainer()->Size() )
+    {
+    std::cerr << name << ": the remapped output has a different number of elements" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  for ( itk::ImageRegionConstIteratorWithIndex<ImageType> it(outputs[1], outputs[1]->GetLargestPossibleRegion());
+        !it.IsAtEnd(); ++it )
+    {
+    if ( outputs[0]->GetPixel( it.GetIndex() ) != it.Get() )
+      {
+      std::cerr << name << ": remapped output differs at " << it.GetIndex() << ": "
+                << outputs[0]->GetPixel( it.GetIndex() ) << " instead of " << it.Get() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
+
+}
+
+
+int
+itkResampleSparseVectorImageFilterTest(int, char *[])
+{
+  ImageType::Pointer image = SparseVectorImageTest::CreateImage<ImageType>( 48, VectorLength );
+
+  SparseVectorImageTest::GeneratorType::Pointer generator = SparseVectorImageTest::GeneratorType::New();
+  generator->Initialize(1234);
+
+  // A sparse blob in the middle of the image
+  ImageType::IndexType blobIndex;
+  blobIndex[0] = 12;
+  blobIndex[1] = 14;
+  blobIndex[2] = 8;
+  ImageType::SizeType blobSize;
+  blobSize[0] = 24;
+  blobSize[1] = 20;
+  blobSize[2] = 32;
+  const ImageType::RegionType blob( blobIndex, blobSize );
+  const SparseVectorImageTest::IntegerComponents components = { 4 };
+  SparseVectorImageTest::FillRandom<ImageType>( image, blob, 0.3, components, generator );
+
+  TransformType::Pointer identity = TransformType::New();
+
+  TransformType::InputPointType center;
+  center.Fill(23.5);
+
+  RigidTransformType::Pointer rigid = RigidTransformType::New();
+  rigid->SetCenter( center );
+  rigid->SetRotation( 0.1, -0.2, 0.3 );
+  RigidTransformType::OutputVectorType rigidTranslation;
+  rigidTranslation.Fill( -0.75 );
+  rigid->SetTranslation( rigidTranslation );
+
+  TransformType::Pointer affine = TransformType::New();
+  affine->SetCenter( center );
+  affine->Rotate( 0, 1, 0.3 );
+  TransformType::OutputVectorType scale;
+  scale.Fill( 0.9 );
+  affine->Scale( scale );
+  TransformType::OutputVectorType translation;
+  translation.Fill( 1.25 );
+  affine->Translate( translation );
+
+  // An integer translation, and a rotation by a quarter turn about the
+  // center of the image, i.e. an axis permutation with a flip, map the
+  // output pixels exactly onto input pixels
+  TransformType::Pointer shift = TransformType::New();
+  TransformType::OutputVectorType shiftTranslation;
+  shiftTranslation[0] = 3;
+  shiftTranslation[1] = -2;
+  shiftTranslation[2] = 5;
+  shift->Translate( shiftTranslation );
+
+  TransformType::Pointer permutation = TransformType::New();
+  permutation->SetCenter( center );
+  TransformType::MatrixType matrix;
+  matrix.Fill( 0 );
+  matrix[0][1] = 1;
+  matrix[1][0] = -1;
+  matrix[2][2] = 1;
+  permutation->SetMatrix( matrix );
+
+  if ( CheckRemapping( image, identity, "Identity" ) != EXIT_SUCCESS
+       || CheckRemapping( image, shift, "Integer translation" ) != EXIT_SUCCESS
+       || CheckRemapping( image, permutation, "Permutation" ) != EXIT_SUCCESS
+       || CheckResample( image, permutation, "Permutation", true, true ) != EXIT_SUCCESS )
+    {
+    return EXIT_FAILURE;
+    }
+
+  // All the paths, so that their timings can be compared
+  for ( unsigned int path = 0; path < 4; path++ )
+    {
+    const bool useLinearFastPath = ( path % 2 == 0 );
+    const bool useInputSupport = ( path < 2 );
+    if ( CheckResample( image, identity, "Identity", useLinearFastPath, useInputSupport ) != EXIT_SUCCESS
+         || CheckResample( image, rigid, "Rigid", useLinearFastPath, useInputSupport ) != EXIT_SUCCESS
+         || CheckResample( image, affine, "Affine", useLinearFastPath, useInputSupport ) != EXIT_SUCCESS )
+      {
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
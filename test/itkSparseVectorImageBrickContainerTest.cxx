@@ -0,0 +1,176 @@
+#include "itkImageFileReader.h"
+#include "itkImageFileWriter.h"
+#include "itkVectorImage.h"
+#include "itkSparseVectorImage.h"
+#include "itkSparseVectorImageBrickContainer.h"
+#include "itkSparseVectorImageFileReader.h"
+#include "itkSparseVectorImageFileWriter.h"
+#include "itkSparseVectorImageLinearInterpolateImageFunction.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+
+inline void
+PrintHelpInfo ( char* str )
+{
+  std::cout << str << ": convert a VectorImage to a brick-based SparseVectorImage, compare its interpolation with the default container, write it, read it back and convert it to a VectorImage" << std::endl << std::flush;
+  std::cout << str << " inputImage sparseImage outputImage" << std::endl << std::flush;
+}
+
+int
+itkSparseVectorImageBrickContainerTest(int argc, char *argv[])
+{
+  if (argc!=4)
+    {
+    std::cerr << "No input or No output!" << std::endl;
+    PrintHelpInfo(argv[0]);
+    return EXIT_FAILURE;
+    }
+
+  std::string _InputFile(argv[1]);
+  std::string _SparseFile(argv[2]);
+  std::string _OutputFile(argv[3]);
+
+  // Define Variables
+  typedef float PixelType;
+  typedef itk::VectorImage<PixelType, 3> VectorImageType;
+  typedef itk::SparseVectorImageBrickContainer<unsigned long, PixelType> ContainerType;
+  typedef itk::SparseVectorImage<PixelType, 3, ContainerType> SparseVectorImageType;
+  typedef itk::SparseVectorImage<PixelType, 3> ReferenceImageType;
+  typedef itk::ImageFileReader<VectorImageType> ReaderType;
+  typedef itk::SparseVectorImageFileReader<SparseVectorImageType> SparseReaderType;
+  typedef itk::SparseVectorImageFileWriter<SparseVectorImageType> SparseWriterType;
+
+  VectorImageType::Pointer inputImage;
+  VectorImageType::Pointer outputImage = VectorImageType::New();
+  SparseVectorImageType::Pointer sparseImage = SparseVectorImageType::New();
+  ReferenceImageType::Pointer referenceImage = ReferenceImageType::New();
+  ReaderType::Pointer reader = ReaderType::New();
+
+  // Read input image
+  reader->SetFileName(_InputFile);
+  try
+    {
+    std::cout << "Reading file: " << _InputFile << std::endl;
+    reader->Update();
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    std::cerr << "ExceptionObject caught!" << std::endl;
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  inputImage = reader->GetOutput();
+
+  // Allocate sparse images
+  sparseImage->CopyInformation(inputImage);
+  sparseImage->SetRegions(inputImage->GetLargestPossibleRegion());
+  sparseImage->Allocate();
+
+  referenceImage->CopyInformation(inputImage);
+  referenceImage->SetRegions(inputImage->GetLargestPossibleRegion());
+  referenceImage->Allocate();
+
+  // Transfer data
+  itk::ImageRegionConstIterator<VectorImageType> inputIt(inputImage, inputImage->GetLargestPossibleRegion() );
+  itk::ImageRegionIterator<SparseVectorImageType> sparseIt(sparseImage, sparseImage->GetLargestPossibleRegion() );
+  itk::ImageRegionIterator<ReferenceImageType> referenceIt(referenceImage, referenceImage->GetLargestPossibleRegion() );
+
+  for ( inputIt.GoToBegin(), sparseIt.GoToBegin(), referenceIt.GoToBegin();
+        !inputIt.IsAtEnd(); ++inputIt, ++sparseIt, ++referenceIt )
+    {
+    sparseIt.Set(inputIt.Get());
+    referenceIt.Set(inputIt.Get());
+    }
+
+  std::cout << "Number of stored voxels: "
+            << sparseImage->GetPixelContainer()->GetNumberOfVoxels()
+            << " in " << sparseImage->GetPixelContainer()->GetNumberOfBricks()
+            << " bricks" << std::endl;
+
+  // Linear interpolation gives the same values with both containers
+  typedef itk::SparseVectorImageLinearInterpolateImageFunction<SparseVectorImageType> InterpolatorType;
+  typedef itk::SparseVectorImageLinearInterpolateImageFunction<ReferenceImageType> ReferenceInterpolatorType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator GeneratorType;
+
+  InterpolatorType::Pointer interpolator = InterpolatorType::New();
+  interpolator->SetInputImage(sparseImage);
+  ReferenceInterpolatorType::Pointer referenceInterpolator = ReferenceInterpolatorType::New();
+  referenceInterpolator->SetInputImage(referenceImage);
+
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(1234);
+
+  const SparseVectorImageType::SizeType size = sparseImage->GetLargestPossibleRegion().GetSize();
+  for ( unsigned int n = 0; n < 10000; n++ )
+    {
+    InterpolatorType::ContinuousIndexType index;
+    for ( unsigned int d = 0; d < 3; d++ )
+      {
+      index[d] = generator->GetUniformVariate( 0, size[d] - 1 );
+      }
+    if ( interpolator->EvaluateAtContinuousIndex(index)
+         != referenceInterpolator->EvaluateAtContinuousIndex(index) )
+      {
+      std::cerr << "Interpolation differs at " << index << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  // Write and read back the sparse image
+  SparseWriterType::Pointer sparseWriter = SparseWriterType::New();
+  SparseReaderType::Pointer sparseReader = SparseReaderType::New();
+  try
+    {
+    std::cout << "Writing file: " << _SparseFile << std::endl;
+    sparseWriter->SetFileName( _SparseFile );
+    sparseWriter->SetInput( sparseImage );
+    sparseWriter->Update();
+
+    std::cout << "Reading file: " << _SparseFile << std::endl;
+    sparseReader->SetFileName( _SparseFile );
+    sparseReader->Update();
+    }
+  catch ( itk::ExceptionObject & err )
+    {
+    std::cerr << "ExceptionObject caught!" << std::endl;
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  SparseVectorImageType::Pointer readImage = sparseReader->GetOutput();
+
+  // Transfer SparseVectorImage to VectorImage
+  outputImage->CopyInformation(inputImage);
+  outputImage->SetRegions(inputImage->GetLargestPossibleRegion());
+  outputImage->Allocate();
+
+  itk::ImageRegionConstIterator<SparseVectorImageType> readIt(readImage, readImage->GetLargestPossibleRegion() );
+  itk::ImageRegionIterator<VectorImageType> outputIt(outputImage, outputImage->GetLargestPossibleRegion() );
+
+  for ( readIt.GoToBegin(), outputIt.GoToBegin(); !outputIt.IsAtEnd(); ++readIt, ++outputIt )
+    {
+    outputIt.Set(readIt.Get());
+    }
+
+  // Write Output
+  try
+    {
+    typedef itk::ImageFileWriter<VectorImageType> OutputImageWriterType;
+    OutputImageWriterType::Pointer writer = OutputImageWriterType::New();
+    std::cout << "Writing file: " << _OutputFile << std::endl;
+    writer->SetFileName( _OutputFile );
+    writer->SetInput( outputImage );
+    writer->Update();
+    }
+  catch ( itk::ExceptionObject & err )
+    {
+    std::cerr << "ExceptionObject caught!" << std::endl;
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,179 @@
+#include "itkSparseVectorImage.h"
+#include "itkSparseVectorImageFlatHashMap.h"
+#include "itkSparseVectorImageVoxelContainer.h"
+#include "itkMultiThreader.h"
+#include "itkTimeProbe.h"
+#include "itkSparseVectorImageTestHelper.h"
+
+
+namespace
+{
+
+typedef float PixelType;
+const unsigned int Dimension = 3;
+const unsigned int VectorLength = 16;
+
+// Deterministic content: one voxel out of 13 is stored, with a few zero
+// components, so that the threads can check the values they read.
+const SparseVectorImageTest::PeriodicPattern Pattern = { 13, 97, 5 };
+
+template< class TImage >
+struct ThreadData
+{
+  const TImage         *Image;
+  bool                  Legacy;
+  std::vector<unsigned long> Mismatches;
+};
+
+// Read path of the original code: a find followed by operator[] on the
+// pixel map of the default container, for every component.
+template< class TImage >
+void
+LegacyGetPixel( const TImage *image, unsigned long offset, typename TImage::PixelType & pixel )
+{
+  typedef typename TImage::PixelContainer::PixelMapType PixelMapType;
+  PixelMapType *map = const_cast<TImage *>( image )->GetPixelContainer()->GetPixelMap();
+  for ( unsigned int k = 0; k < VectorLength; k++ )
+    {
+    const unsigned long key = offset * VectorLength + k;
+    typename PixelMapType::const_iterator it = map->find(key);
+    pixel[k] = ( it == map->end() ) ? 0 : ( *map )[key];
+    }
+}
+
+// Each thread reads its own set of slices and checks the values
+template< class TImage >
+ITK_THREAD_RETURN_TYPE
+ReadVoxels( void *arg )
+{
+  itk::MultiThreader::ThreadInfoStruct *info =
+    static_cast<itk::MultiThreader::ThreadInfoStruct *>( arg );
+  ThreadData<TImage> *data = static_cast<ThreadData<TImage> *>( info->UserData );
+  const TImage *image = data->Image;
+
+  const typename TImage::SizeType size = image->GetLargestPossibleRegion().GetSize();
+  typename TImage::PixelType pixel(VectorLength);
+  unsigned long mismatches = 0;
+
+  typename TImage::IndexType index;
+  for ( index[2] = info->ThreadID; index[2] < static_cast<itk::IndexValueType>( size[2] );
+        index[2] += info->NumberOfThreads )
+    {
+    for ( index[1] = 0; index[1] < static_cast<itk::IndexValueType>( size[1] ); index[1]++ )
+      {
+      for ( index[0] = 0; index[0] < static_cast<itk::IndexValueType>( size[0] ); index[0]++ )
+        {
+        const unsigned long offset = image->ComputeOffset(index);
+        if ( data->Legacy )
+          {
+          LegacyGetPixel( image, offset, pixel );
+          }
+        else
+          {
+          pixel = image->GetPixel(index);
+          }
+        for ( unsigned int k = 0; k < VectorLength; k++ )
+          {
+          if ( pixel[k] != Pattern.ExpectedValue(offset, k) )
+            {
+            ++mismatches;
+            }
+          }
+        }
+      }
+    }
+
+  data->Mismatches[info->ThreadID] = mismatches;
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+// Read the whole image with 1, 2, 4, ... threads, print the timings and
+// return the number of wrong values.
+template< class TImage >
+unsigned long
+ConcurrentRead( const TImage *image, const char *name, bool legacy = false )
+{
+  const itk::ThreadIdType maximumThreads = itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+  unsigned long mismatches = 0;
+
+  std::cout << name << ":";
+  for ( itk::ThreadIdType numberOfThreads = 1; numberOfThreads <= maximumThreads;
+        numberOfThreads *= 2 )
+    {
+    ThreadData<TImage> data;
+    data.Image = image;
+    data.Legacy = legacy;
+    data.Mismatches.resize(numberOfThreads, 0);
+
+    itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+    threader->SetNumberOfThreads(numberOfThreads);
+    threader->SetSingleMethod(ReadVoxels<TImage>, &data);
+
+    itk::TimeProbe probe;
+    probe.Start();
+    threader->SingleMethodExecute();
+    probe.Stop();
+
+    std::cout << " " << numberOfThreads << " threads " << probe.GetMean() << " s;";
+    for ( itk::ThreadIdType t = 0; t < numberOfThreads; t++ )
+      {
+      mismatches += data.Mismatches[t];
+      }
+    }
+  std::cout << std::endl;
+
+  return mismatches;
+}
+
+template< class TImage >
+typename TImage::Pointer
+CreateImage()
+{
+  typename TImage::Pointer image = SparseVectorImageTest::CreateImage<TImage>( 64, VectorLength );
+  SparseVectorImageTest::FillImage<TImage>( image, Pattern );
+  return image;
+}
+
+}
+
+
+int
+itkSparseVectorImageConcurrentReadTest(int, char *[])
+{
+  typedef itk::SparseVectorImage<PixelType, Dimension> DefaultImageType;
+  typedef itk::SparseVectorImage<PixelType, Dimension,
+    itk::SparseVectorImageContainer<unsigned long, PixelType,
+      itk::SparseVectorImageFlatHashMap<unsigned long, PixelType> > > FlatImageType;
+  typedef itk::SparseVectorImage<PixelType, Dimension,
+    itk::SparseVectorImageVoxelContainer<unsigned long, PixelType> > VoxelImageType;
+
+  DefaultImageType::Pointer defaultImage = CreateImage<DefaultImageType>();
+  FlatImageType::Pointer flatImage = CreateImage<FlatImageType>();
+  VoxelImageType::Pointer voxelImage = CreateImage<VoxelImageType>();
+
+  const unsigned long sizeBefore = defaultImage->GetPixelContainer()->Size();
+
+  unsigned long mismatches = 0;
+  mismatches += ConcurrentRead<DefaultImageType>( defaultImage, "find + operator[] (original)", true );
+  mismatches += ConcurrentRead<DefaultImageType>( defaultImage, "SparseVectorImageContainer" );
+  mismatches += ConcurrentRead<FlatImageType>( flatImage, "SparseVectorImageFlatHashMap" );
+  mismatches += ConcurrentRead<VoxelImageType>( voxelImage, "SparseVectorImageVoxelContainer" );
+
+  defaultImage->Freeze();
+  mismatches += ConcurrentRead<DefaultImageType>( defaultImage, "Frozen SparseVectorImageContainer" );
+
+  if ( mismatches > 0 )
+    {
+    std::cerr << mismatches << " wrong values read" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Reading never inserts into the container
+  if ( defaultImage->GetPixelContainer()->Size() != sizeBefore )
+    {
+    std::cerr << "The container was modified by the readers" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+#include "itkSparseVectorImage.h"
+#include "itkSparseVectorImageCopyOnWriteContainer.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkTimeProbe.h"
+#include "itkSparseVectorImageTestHelper.h"
+
+
+namespace
+{
+
+typedef float PixelType;
+const unsigned int Dimension = 3;
+const unsigned int VectorLength = 16;
+
+typedef itk::SparseVectorImageContainer<unsigned long, PixelType> BaseContainerType;
+typedef itk::SparseVectorImage<PixelType, Dimension, BaseContainerType> ImageType;
+typedef itk::SparseVectorImage<PixelType, Dimension,
+  itk::SparseVectorImageCopyOnWriteContainer<BaseContainerType> > BranchImageType;
+
+// Compare the pixels of two images, except at the given index
+template< class TImage, class TOtherImage >
+bool
+SamePixels( const TImage *image, const TOtherImage *other, const typename TImage::IndexType & except )
+{
+  for ( itk::ImageRegionConstIteratorWithIndex<TImage> it(image, image->GetLargestPossibleRegion());
+        !it.IsAtEnd(); ++it )
+    {
+    if ( it.GetIndex() != except && it.Get() != other->GetPixel( it.GetIndex() ) )
+      {
+      std::cerr << "Pixel differs at " << it.GetIndex() << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+}
+
+
+int
+itkSparseVectorImageCopyOnWriteTest(int, char *[])
+{
+  ImageType::Pointer image = SparseVectorImageTest::CreateImage<ImageType>( 64, VectorLength );
+  const SparseVectorImageTest::IntegerComponents components = { 4 };
+  SparseVectorImageTest::FillRandom<ImageType>( image, 0.33, components );
+
+  const ImageType::RegionType region = image->GetLargestPossibleRegion();
+  ImageType::PixelType pixel(VectorLength);
+  ImageType::IndexType modified;
+  modified.Fill(10);
+  pixel.Fill(7);
+
+  // A deep copy can be modified without changing the original
+  ImageType::Pointer copy = ImageType::New();
+  itk::TimeProbe copyProbe;
+  copyProbe.Start();
+  copy->DeepCopy(image);
+  copyProbe.Stop();
+
+  copy->SetPixel(modified, pixel);
+  if ( image->GetPixel(modified) == pixel || copy->GetPixel(modified) != pixel
+       || !SamePixels<ImageType, ImageType>(image, copy, modified) )
+    {
+    std::cerr << "The deep copy is not independent of the original" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A branch shares the pixels of the original and keeps its own writes
+  BranchImageType::Pointer branch = BranchImageType::New();
+  itk::TimeProbe branchProbe;
+  branchProbe.Start();
+  branch->CopyInformation(image);
+  branch->SetRegions(region);
+  branch->SetVectorLength(VectorLength);
+  branch->Allocate();
+  branch->GetPixelContainer()->SetBase( image->GetPixelContainer() );
+  branchProbe.Stop();
+
+  std::cout << image->GetPixelContainer()->Size() << " elements: deep copy "
+            << copyProbe.GetMean() << " s, branch " << branchProbe.GetMean() << " s" << std::endl;
+
+  branch->SetPixel(modified, pixel);
+  if ( image->GetPixel(modified) == pixel || branch->GetPixel(modified) != pixel
+       || !SamePixels<ImageType, BranchImageType>(image, branch, modified) )
+    {
+    std::cerr << "The branch is not independent of the original" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if ( branch->GetPixelContainer()->GetNumberOfWrittenVoxels() != 1
+       || branch->GetPixelContainer()->GetDelta()->Size() != VectorLength )
+    {
+    std::cerr << "The branch copied more than the written voxel" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
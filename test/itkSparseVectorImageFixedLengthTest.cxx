@@ -0,0 +1,168 @@
+#include "itkSparseVectorImage.h"
+#include "itkSparseVectorImageFileReader.h"
+#include "itkSparseVectorImageFileWriter.h"
+#include "itkSparseVectorImageLinearInterpolateImageFunction.h"
+#include "itkImageRegionConstIterator.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTimeProbe.h"
+#include "itkSparseVectorImageTestHelper.h"
+
+
+namespace
+{
+
+typedef float ComponentType;
+const unsigned int Dimension = 3;
+const unsigned int VectorLength = 6;
+
+// Values of the components, one voxel out of 11 being stored
+const SparseVectorImageTest::PeriodicPattern Pattern = { 11, 89, 0 };
+
+template< class TImage >
+typename TImage::Pointer
+CreateImage()
+{
+  typename TImage::Pointer image = SparseVectorImageTest::CreateImage<TImage>( 64, VectorLength );
+  SparseVectorImageTest::FillImage<TImage>( image, Pattern );
+  return image;
+}
+
+// Read every pixel with an iterator, return the time taken and the
+// number of wrong values in mismatches
+template< class TImage >
+double
+ReadImage( const TImage *image, unsigned long & mismatches )
+{
+  itk::ImageRegionConstIterator<TImage> it( image, image->GetLargestPossibleRegion() );
+
+  itk::TimeProbe probe;
+  probe.Start();
+  unsigned long offset = 0;
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it, ++offset )
+    {
+    const typename TImage::PixelType pixel = it.Get();
+    for ( unsigned int k = 0; k < VectorLength; k++ )
+      {
+      if ( pixel[k] != Pattern.ExpectedValue(offset, k) )
+        {
+        ++mismatches;
+        }
+      }
+    }
+  probe.Stop();
+
+  return probe.GetMean();
+}
+
+}
+
+
+int
+itkSparseVectorImageFixedLengthTest(int argc, char *argv[])
+{
+  if ( argc != 2 )
+    {
+    std::cerr << "Usage: " << argv[0] << " sparseImage" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  typedef itk::SparseVectorImage<ComponentType, Dimension> VariableImageType;
+  typedef itk::SparseVectorImage<itk::Vector<ComponentType, VectorLength>, Dimension> FixedImageType;
+
+  VariableImageType::Pointer variableImage = CreateImage<VariableImageType>();
+  FixedImageType::Pointer fixedImage = CreateImage<FixedImageType>();
+
+  // The vector length of the fixed image cannot be changed
+  bool caught = false;
+  try
+    {
+    fixedImage->SetVectorLength(VectorLength + 1);
+    }
+  catch ( itk::ExceptionObject & )
+    {
+    caught = true;
+    }
+  if ( !caught || fixedImage->GetVectorLength() != VectorLength )
+    {
+    std::cerr << "The vector length of the fixed image was changed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  unsigned long mismatches = 0;
+  const double variableTime = ReadImage<VariableImageType>( variableImage, mismatches );
+  const double fixedTime = ReadImage<FixedImageType>( fixedImage, mismatches );
+  std::cout << "Iterating over VariableLengthVector pixels: " << variableTime << " s" << std::endl;
+  std::cout << "Iterating over Vector pixels: " << fixedTime << " s" << std::endl;
+
+  if ( mismatches > 0 )
+    {
+    std::cerr << mismatches << " wrong values read" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Linear interpolation gives the same values for both images
+  typedef itk::SparseVectorImageLinearInterpolateImageFunction<VariableImageType> VariableInterpolatorType;
+  typedef itk::SparseVectorImageLinearInterpolateImageFunction<FixedImageType> FixedInterpolatorType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator GeneratorType;
+
+  VariableInterpolatorType::Pointer variableInterpolator = VariableInterpolatorType::New();
+  variableInterpolator->SetInputImage(variableImage);
+  FixedInterpolatorType::Pointer fixedInterpolator = FixedInterpolatorType::New();
+  fixedInterpolator->SetInputImage(fixedImage);
+
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(1234);
+
+  const FixedImageType::SizeType size = fixedImage->GetLargestPossibleRegion().GetSize();
+  for ( unsigned int n = 0; n < 10000; n++ )
+    {
+    FixedInterpolatorType::ContinuousIndexType index;
+    for ( unsigned int d = 0; d < Dimension; d++ )
+      {
+      index[d] = generator->GetUniformVariate( 0, size[d] - 1 );
+      }
+    const VariableInterpolatorType::OutputType expected =
+      variableInterpolator->EvaluateAtContinuousIndex(index);
+    const FixedInterpolatorType::OutputType value =
+      fixedInterpolator->EvaluateAtContinuousIndex(index);
+    for ( unsigned int k = 0; k < VectorLength; k++ )
+      {
+      if ( value[k] != expected[k] )
+        {
+        std::cerr << "Interpolation differs at " << index << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  // Write and read back the fixed image
+  typedef itk::SparseVectorImageFileWriter<FixedImageType> WriterType;
+  typedef itk::SparseVectorImageFileReader<FixedImageType> ReaderType;
+
+  WriterType::Pointer writer = WriterType::New();
+  ReaderType::Pointer reader = ReaderType::New();
+  try
+    {
+    writer->SetFileName( argv[1] );
+    writer->SetInput( fixedImage );
+    writer->Update();
+
+    reader->SetFileName( argv[1] );
+    reader->Update();
+    }
+  catch ( itk::ExceptionObject & err )
+    {
+    std::cerr << "ExceptionObject caught!" << std::endl;
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  ReadImage<FixedImageType>( reader->GetOutput(), mismatches );
+  if ( mismatches > 0 )
+    {
+    std::cerr << mismatches << " wrong values read back" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+#include "itkSparseVectorImage.h"
+#include "itkSparseVectorImageFlatHashMap.h"
+#include "itkSparseVectorImageVoxelContainer.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include <map>
+#include <set>
+
+
+int
+itkSparseVectorImageFlatHashMapTest(int, char *[])
+{
+  typedef unsigned long KeyType;
+  typedef float PixelType;
+  typedef itk::SparseVectorImageFlatHashMap<KeyType, PixelType> MapType;
+  typedef std::map<KeyType, PixelType> ReferenceMapType;
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator GeneratorType;
+
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(1234);
+
+  // Random insertions, lookups and removals against std::map
+  MapType map;
+  ReferenceMapType reference;
+
+  for ( unsigned int n = 0; n < 100000; n++ )
+    {
+    KeyType key = generator->GetIntegerVariate(10000);
+    PixelType value = static_cast<PixelType>( n );
+
+    switch ( generator->GetIntegerVariate(2) )
+      {
+      case 0:
+        map[key] = value;
+        reference[key] = value;
+        break;
+      case 1:
+        if ( map.erase(key) != reference.erase(key) )
+          {
+          std::cerr << "Erase failed for key " << key << std::endl;
+          return EXIT_FAILURE;
+          }
+        break;
+      default:
+        if ( ( map.find(key) == map.end() ) != ( reference.find(key) == reference.end() ) )
+          {
+          std::cerr << "Find failed for key " << key << std::endl;
+          return EXIT_FAILURE;
+          }
+      }
+    }
+
+  if ( map.size() != reference.size() )
+    {
+    std::cerr << "Size mismatch: " << map.size() << " != " << reference.size() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  unsigned long count = 0;
+  for ( MapType::const_iterator it = map.begin(); it != map.end(); ++it, ++count )
+    {
+    if ( reference[it->first] != it->second )
+      {
+      std::cerr << "Value mismatch for key " << it->first << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+  if ( count != reference.size() )
+    {
+    std::cerr << "Iteration visited " << count << " elements instead of "
+              << reference.size() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The flat map used as the map of the image containers
+  const unsigned int Dimension = 3;
+  typedef itk::SparseVectorImage<PixelType, Dimension> ReferenceImageType;
+  typedef itk::SparseVectorImage<PixelType, Dimension,
+    itk::SparseVectorImageContainer<KeyType, PixelType, MapType> > ComponentImageType;
+  typedef itk::SparseVectorImage<PixelType, Dimension,
+    itk::SparseVectorImageVoxelContainer<KeyType, PixelType,
+      itk::SparseVectorImageFlatHashMap<KeyType, itk::SizeValueType> > > VoxelImageType;
+
+  ReferenceImageType::SizeType size;
+  size.Fill(20);
+  const unsigned int vectorLength = 6;
+
+  ReferenceImageType::Pointer referenceImage = ReferenceImageType::New();
+  ComponentImageType::Pointer componentImage = ComponentImageType::New();
+  VoxelImageType::Pointer voxelImage = VoxelImageType::New();
+
+  referenceImage->SetRegions(size);
+  referenceImage->SetNumberOfComponentsPerPixel(vectorLength);
+  referenceImage->Allocate();
+  componentImage->SetRegions(size);
+  componentImage->SetNumberOfComponentsPerPixel(vectorLength);
+  componentImage->Allocate();
+  voxelImage->SetRegions(size);
+  voxelImage->SetNumberOfComponentsPerPixel(vectorLength);
+  voxelImage->Allocate();
+
+  // Each pixel is written once: the component-keyed container keeps the
+  // previous value of the zero components, the voxel container does not.
+  std::set<itk::OffsetValueType> written;
+  ReferenceImageType::PixelType pixel(vectorLength);
+  for ( unsigned int n = 0; n < 1000; n++ )
+    {
+    ReferenceImageType::IndexType index;
+    for ( unsigned int d = 0; d < Dimension; d++ )
+      {
+      index[d] = generator->GetIntegerVariate( size[d] - 1 );
+      }
+    if ( !written.insert( referenceImage->ComputeOffset(index) ).second )
+      {
+      continue;
+      }
+    for ( unsigned int i = 0; i < vectorLength; i++ )
+      {
+      pixel[i] = generator->GetIntegerVariate(3) == 0 ? 0 : generator->GetVariate();
+      }
+    referenceImage->SetPixel(index, pixel);
+    componentImage->SetPixel(index, pixel);
+    voxelImage->SetPixel(index, pixel);
+    }
+
+  typedef itk::ImageRegionConstIteratorWithIndex<ReferenceImageType> IteratorType;
+  for ( IteratorType it( referenceImage, referenceImage->GetLargestPossibleRegion() );
+        !it.IsAtEnd(); ++it )
+    {
+    if ( it.Get() != componentImage->GetPixel( it.GetIndex() )
+         || it.Get() != voxelImage->GetPixel( it.GetIndex() ) )
+      {
+      std::cerr << "Pixel mismatch at " << it.GetIndex() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  std::cout << "Stored components: " << componentImage->GetPixelContainer()->Size()
+            << ", stored voxels: " << voxelImage->GetPixelContainer()->GetNumberOfVoxels()
+            << std::endl;
+
+  return EXIT_SUCCESS;
+}
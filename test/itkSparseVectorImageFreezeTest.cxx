@@ -0,0 +1,136 @@
+#include "itkSparseVectorImage.h"
+#include "itkSparseVectorImageVoxelContainer.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkTimeProbe.h"
+#include "itkSparseVectorImageTestHelper.h"
+
+
+// Fill a random sparse image, then compare the pixels and the lookup
+// time before and after freezing the container.
+template< class TImage >
+int
+FreezeTest(const char *name)
+{
+  typedef TImage                          ImageType;
+  typedef typename ImageType::PixelType   PixelType;
+  typedef typename ImageType::IndexType   IndexType;
+  typedef itk::ImageRegionConstIteratorWithIndex<ImageType> IteratorType;
+
+  const unsigned int vectorLength = 28;
+
+  typename ImageType::Pointer image = SparseVectorImageTest::CreateImage<ImageType>( 64, vectorLength );
+  const typename ImageType::RegionType region = image->GetLargestPossibleRegion();
+
+  // About 5% of the voxels, with a few zero components each
+  const SparseVectorImageTest::SparseComponents components = { 1.0 / 3, 0 };
+  SparseVectorImageTest::FillRandom<ImageType>( image, 0.05, components );
+
+  const unsigned long sizeBefore = image->GetPixelContainer()->Size();
+
+  // Reference pixels and lookup time of the writable container
+  std::vector<PixelType> reference;
+  reference.reserve( region.GetNumberOfPixels() );
+
+  itk::TimeProbe hashProbe;
+  hashProbe.Start();
+  for ( IteratorType it(image, region); !it.IsAtEnd(); ++it )
+    {
+    reference.push_back( it.Get() );
+    }
+  hashProbe.Stop();
+
+  image->Freeze();
+  if ( !image->IsFrozen() || image->GetPixelContainer()->Size() != sizeBefore )
+    {
+    std::cerr << name << ": freezing changed the number of stored elements" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  itk::TimeProbe frozenProbe;
+  frozenProbe.Start();
+  unsigned long n = 0;
+  unsigned long mismatches = 0;
+  for ( IteratorType it(image, region); !it.IsAtEnd(); ++it, ++n )
+    {
+    if ( it.Get() != reference[n] )
+      {
+      ++mismatches;
+      }
+    }
+  frozenProbe.Stop();
+
+  if ( mismatches > 0 )
+    {
+    std::cerr << name << ": " << mismatches << " pixels differ after freezing" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::cout << name << ": " << sizeBefore << " elements, full scan "
+            << hashProbe.GetMean() << " s (hash) vs "
+            << frozenProbe.GetMean() << " s (frozen)" << std::endl;
+
+  // Writing to a frozen image throws
+  IndexType origin;
+  origin.Fill(0);
+  PixelType pixel(vectorLength);
+  pixel.Fill(1);
+  bool caught = false;
+  try
+    {
+    image->SetPixel(origin, pixel);
+    }
+  catch ( itk::ExceptionObject & )
+    {
+    caught = true;
+    }
+  if ( !caught )
+    {
+    std::cerr << name << ": writing to a frozen image did not throw" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Thawing restores a writable container with the same pixels
+  image->Thaw();
+  image->SetPixel(origin, pixel);
+  if ( image->GetPixel(origin) != pixel )
+    {
+    std::cerr << name << ": writing after thawing failed" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  n = 0;
+  for ( IteratorType it(image, region); !it.IsAtEnd(); ++it, ++n )
+    {
+    if ( n > 0 && it.Get() != reference[n] )
+      {
+      std::cerr << name << ": pixel " << it.GetIndex() << " differs after thawing" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
+
+
+int
+itkSparseVectorImageFreezeTest(int, char *[])
+{
+  typedef float PixelType;
+  const unsigned int Dimension = 3;
+
+  typedef itk::SparseVectorImage<PixelType, Dimension> ComponentImageType;
+  typedef itk::SparseVectorImage<PixelType, Dimension,
+    itk::SparseVectorImageVoxelContainer<unsigned long, PixelType> > VoxelImageType;
+
+  if ( FreezeTest<ComponentImageType>("SparseVectorImageContainer") == EXIT_FAILURE )
+    {
+    return EXIT_FAILURE;
+    }
+
+  if ( FreezeTest<VoxelImageType>("SparseVectorImageVoxelContainer") == EXIT_FAILURE )
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
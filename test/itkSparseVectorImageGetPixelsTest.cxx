@@ -0,0 +1,158 @@
+#include "itkSparseVectorImage.h"
+#include "itkSparseVectorImageVoxelContainer.h"
+#include "itkSparseVectorImageLinearInterpolateImageFunction.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTimeProbe.h"
+#include "itkSparseVectorImageTestHelper.h"
+#include <cmath>
+
+
+namespace
+{
+
+typedef float PixelType;
+const unsigned int Dimension = 3;
+const unsigned int VectorLength = 12;
+const unsigned int NumberOfIndices = 1000;
+
+// One voxel out of 3 is stored
+const SparseVectorImageTest::PeriodicPattern Pattern = { 3, 101, 0 };
+
+template< class TImage >
+typename TImage::Pointer
+CreateImage()
+{
+  typename TImage::Pointer image = SparseVectorImageTest::CreateImage<TImage>( 64, VectorLength );
+
+  // Non-zero fill value, so that the pixels which are not stored can be
+  // told apart from the stored ones
+  typename TImage::PixelType pixel(VectorLength);
+  pixel.Fill(-1);
+  image->FillBuffer(pixel);
+
+  SparseVectorImageTest::FillImage<TImage>( image, Pattern );
+  return image;
+}
+
+// Compare GetPixels() and GetPixelInto() with GetPixel() on random
+// indices, some of them repeated, and return the number of errors
+template< class TImage >
+unsigned int
+CheckGetPixels( const TImage *image )
+{
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator GeneratorType;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(1234);
+
+  const typename TImage::SizeType size = image->GetLargestPossibleRegion().GetSize();
+  std::vector<typename TImage::IndexType> indices(NumberOfIndices);
+  for ( unsigned int n = 0; n < NumberOfIndices; n++ )
+    {
+    if ( n % 10 == 9 )
+      {
+      indices[n] = indices[n / 2];
+      continue;
+      }
+    for ( unsigned int d = 0; d < Dimension; d++ )
+      {
+      indices[n][d] = generator->GetIntegerVariate( size[d] - 1 );
+      }
+    }
+
+  std::vector<PixelType> pixels(NumberOfIndices * VectorLength);
+  bool hits[NumberOfIndices];
+  const itk::SizeValueType numberOfHits =
+    image->GetPixels( &indices[0], NumberOfIndices, &pixels[0], hits );
+
+  unsigned int errors = 0;
+  itk::SizeValueType expectedHits = 0;
+  std::vector<PixelType> pixel(VectorLength);
+  for ( unsigned int n = 0; n < NumberOfIndices; n++ )
+    {
+    const typename TImage::PixelType expected = image->GetPixel(indices[n]);
+    const bool stored = Pattern.IsStored( image->ComputeOffset(indices[n]) );
+    expectedHits += stored;
+
+    if ( image->GetPixelInto(indices[n], &pixel[0]) != stored || hits[n] != stored )
+      {
+      ++errors;
+      }
+    for ( unsigned int k = 0; k < VectorLength; k++ )
+      {
+      if ( pixels[n * VectorLength + k] != expected[k] || pixel[k] != expected[k] )
+        {
+        ++errors;
+        }
+      }
+    }
+
+  if ( numberOfHits != expectedHits )
+    {
+    ++errors;
+    }
+
+  return errors;
+}
+
+}
+
+
+int
+itkSparseVectorImageGetPixelsTest(int, char *[])
+{
+  typedef itk::SparseVectorImage<PixelType, Dimension> DefaultImageType;
+  typedef itk::SparseVectorImage<PixelType, Dimension,
+    itk::SparseVectorImageVoxelContainer<unsigned long, PixelType> > VoxelImageType;
+
+  DefaultImageType::Pointer defaultImage = CreateImage<DefaultImageType>();
+  VoxelImageType::Pointer voxelImage = CreateImage<VoxelImageType>();
+
+  unsigned int errors = CheckGetPixels<DefaultImageType>( defaultImage );
+  errors += CheckGetPixels<VoxelImageType>( voxelImage );
+  if ( errors > 0 )
+    {
+    std::cerr << errors << " errors in GetPixels()" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The interpolator gathers its corners with GetPixels()
+  typedef itk::SparseVectorImageLinearInterpolateImageFunction<VoxelImageType> InterpolatorType;
+  InterpolatorType::Pointer interpolator = InterpolatorType::New();
+  interpolator->SetInputImage(voxelImage);
+
+  InterpolatorType::ContinuousIndexType index;
+  index.Fill(10.5);
+  InterpolatorType::OutputType value;
+
+  itk::TimeProbe probe;
+  probe.Start();
+  for ( unsigned int n = 0; n < 100000; n++ )
+    {
+    index[0] = 10.5 + ( n % 40 );
+    value = interpolator->EvaluateAtContinuousIndex(index);
+    }
+  probe.Stop();
+  std::cout << "100000 interpolations: " << probe.GetMean() << " s" << std::endl;
+
+  // At the center of a cube of 8 voxels, the interpolated value is the
+  // mean of the corners
+  index.Fill(10.5);
+  value = interpolator->EvaluateAtContinuousIndex(index);
+  double expected = 0;
+  VoxelImageType::IndexType corner;
+  for ( unsigned int c = 0; c < 8; c++ )
+    {
+    for ( unsigned int d = 0; d < Dimension; d++ )
+      {
+      corner[d] = 10 + ( ( c >> d ) & 1 );
+      }
+    expected += voxelImage->GetPixel(corner)[0] / 8.0;
+    }
+  if ( std::abs( value[0] - expected ) > 1e-6 )
+    {
+    std::cerr << "Interpolated " << value[0] << " instead of " << expected << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,190 @@
+#include "itkSparseVectorImage.h"
+#include "itkSparseVectorImageEncodedContainer.h"
+#include "itkSparseVectorImageFileReader.h"
+#include "itkSparseVectorImageFileWriter.h"
+#include "itkSparseVectorImageLinearInterpolateImageFunction.h"
+#include "itkConstNeighborhoodIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTimeProbe.h"
+#include "itkSparseVectorImageTestHelper.h"
+
+
+namespace
+{
+
+typedef float PixelType;
+const unsigned int Dimension = 3;
+const unsigned int VectorLength = 16;
+
+typedef itk::SparseVectorImageContainer<unsigned long, PixelType> ComponentContainerType;
+
+typedef itk::SparseVectorImage<PixelType, Dimension> RasterImageType;
+typedef itk::SparseVectorImage<PixelType, Dimension,
+  itk::SparseVectorImageEncodedContainer<ComponentContainerType> > MortonImageType;
+
+// Fill a thick spherical shell, as a white matter mask would be, and
+// freeze the container so that it is sorted by key
+template< class TImage >
+typename TImage::Pointer
+CreateShellImage()
+{
+  typename TImage::Pointer image = SparseVectorImageTest::CreateImage<TImage>( 128, VectorLength );
+  const typename TImage::RegionType region = image->GetLargestPossibleRegion();
+
+  typename TImage::PixelType pixel(VectorLength);
+  for ( itk::ImageRegionConstIteratorWithIndex<TImage> it(image, region); !it.IsAtEnd(); ++it )
+    {
+    const typename TImage::IndexType index = it.GetIndex();
+    double radius2 = 0;
+    for ( unsigned int d = 0; d < Dimension; d++ )
+      {
+      radius2 += ( index[d] - 64.0 ) * ( index[d] - 64.0 );
+      }
+    if ( radius2 < 40 * 40 || radius2 > 55 * 55 )
+      {
+      continue;
+      }
+    for ( unsigned int k = 0; k < VectorLength; k++ )
+      {
+      pixel[k] = static_cast<PixelType>( ( index[0] + 3 * index[1] + 7 * index[2] + k ) % 17 );
+      }
+    image->SetPixel(index, pixel);
+    }
+
+  image->Freeze();
+  return image;
+}
+
+// Interpolate at random positions near the shell, return the time taken
+// and accumulate the values in sum
+template< class TImage >
+double
+Interpolate( const TImage *image, double & sum )
+{
+  typedef itk::SparseVectorImageLinearInterpolateImageFunction<TImage> InterpolatorType;
+  typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
+  interpolator->SetInputImage(image);
+
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator GeneratorType;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(1234);
+
+  itk::TimeProbe probe;
+  probe.Start();
+  typename InterpolatorType::ContinuousIndexType index;
+  for ( unsigned int n = 0; n < 200000; n++ )
+    {
+    for ( unsigned int d = 0; d < Dimension; d++ )
+      {
+      index[d] = generator->GetUniformVariate( 10, 117 );
+      }
+    sum += interpolator->EvaluateAtContinuousIndex(index)[n % VectorLength];
+    }
+  probe.Stop();
+  return probe.GetMean();
+}
+
+// Visit the 3x3x3 neighbourhoods of a slab, return the time taken and
+// accumulate the values in sum
+template< class TImage >
+double
+VisitNeighborhoods( const TImage *image, double & sum )
+{
+  typename TImage::RegionType region;
+  typename TImage::IndexType index;
+  typename TImage::SizeType size;
+  index.Fill(10);
+  size.Fill(108);
+  size[2] = 16;
+  region.SetIndex(index);
+  region.SetSize(size);
+
+  typename itk::ConstNeighborhoodIterator<TImage>::RadiusType radius;
+  radius.Fill(1);
+  itk::ConstNeighborhoodIterator<TImage> it(radius, image, region);
+
+  itk::TimeProbe probe;
+  probe.Start();
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    for ( unsigned int n = 0; n < it.Size(); n++ )
+      {
+      sum += it.GetPixel(n)[n % VectorLength];
+      }
+    }
+  probe.Stop();
+  return probe.GetMean();
+}
+
+}
+
+
+int
+itkSparseVectorImageKeyEncodingTest(int argc, char *argv[])
+{
+  if ( argc != 2 )
+    {
+    std::cerr << "Usage: " << argv[0] << " sparseImage" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  RasterImageType::Pointer rasterImage = CreateShellImage<RasterImageType>();
+  MortonImageType::Pointer mortonImage = CreateShellImage<MortonImageType>();
+
+  if ( mortonImage->GetPixelContainer()->GetKeyEncoder().IsRaster() )
+    {
+    std::cerr << "The Morton encoder fell back to the raster order" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Both encodings give the same values, the timings show the locality
+  double rasterSum = 0;
+  double mortonSum = 0;
+  std::cout << "Interpolation: raster " << Interpolate<RasterImageType>( rasterImage, rasterSum )
+            << " s, Morton " << Interpolate<MortonImageType>( mortonImage, mortonSum ) << " s" << std::endl;
+  std::cout << "Neighborhoods: raster " << VisitNeighborhoods<RasterImageType>( rasterImage, rasterSum )
+            << " s, Morton " << VisitNeighborhoods<MortonImageType>( mortonImage, mortonSum ) << " s" << std::endl;
+
+  if ( rasterSum != mortonSum )
+    {
+    std::cerr << "Sums differ: raster " << rasterSum << ", Morton " << mortonSum << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The key files use raster keys, so that an encoded image can be read
+  // into an image with another container
+  typedef itk::SparseVectorImageFileWriter<MortonImageType> WriterType;
+  typedef itk::SparseVectorImageFileReader<RasterImageType> ReaderType;
+
+  WriterType::Pointer writer = WriterType::New();
+  ReaderType::Pointer reader = ReaderType::New();
+  try
+    {
+    writer->SetFileName( argv[1] );
+    writer->SetInput( mortonImage );
+    writer->Update();
+
+    reader->SetFileName( argv[1] );
+    reader->Update();
+    }
+  catch ( itk::ExceptionObject & err )
+    {
+    std::cerr << "ExceptionObject caught!" << std::endl;
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  RasterImageType::Pointer readImage = reader->GetOutput();
+  itk::ImageRegionConstIteratorWithIndex<RasterImageType> it(rasterImage, rasterImage->GetLargestPossibleRegion());
+  for ( ; !it.IsAtEnd(); ++it )
+    {
+    if ( it.Get() != readImage->GetPixel( it.GetIndex() ) )
+      {
+      std::cerr << "Read value differs at " << it.GetIndex() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,150 @@
+#include "itkSparseVectorImage.h"
+#include "itkSparseVectorImageFileReader.h"
+#include "itkSparseVectorImageFileWriter.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include <fstream>
+
+
+namespace
+{
+
+typedef float PixelType;
+const unsigned int Dimension = 3;
+const unsigned int VectorLength = 6;
+
+typedef itk::SparseVectorImage<PixelType, Dimension> LongKeyImageType;
+typedef itk::SparseVectorImage<PixelType, Dimension,
+  itk::SparseVectorImageContainer<itk::uint32_t, PixelType> > ShortKeyImageType;
+
+// Return the key element type recorded in the header
+std::string
+ReadKeyElementType( const char *fileName )
+{
+  std::ifstream header( fileName );
+  std::string line;
+  while ( std::getline( header, line ) )
+    {
+    if ( line.find( "KeyElementType = " ) == 0 )
+      {
+      return line.substr( 17 );
+      }
+    }
+  return "";
+}
+
+// Write the image with the given key width, read it back into an image
+// of type TImage and compare it with the original one
+template< class TImage >
+int
+CheckKeyWidth( const ShortKeyImageType *image, const char *fileName,
+               unsigned int keyWidth, const std::string & expectedType )
+{
+  typedef itk::SparseVectorImageFileWriter<ShortKeyImageType> WriterType;
+  typedef itk::SparseVectorImageFileReader<TImage> ReaderType;
+
+  typename WriterType::Pointer writer = WriterType::New();
+  typename ReaderType::Pointer reader = ReaderType::New();
+  try
+    {
+    writer->SetFileName( fileName );
+    writer->SetInput( image );
+    writer->SetKeyWidth( keyWidth );
+    writer->Update();
+
+    reader->SetFileName( fileName );
+    reader->Update();
+    }
+  catch ( itk::ExceptionObject & err )
+    {
+    std::cerr << "ExceptionObject caught!" << std::endl;
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if ( ReadKeyElementType( fileName ) != expectedType )
+    {
+    std::cerr << "Key width " << keyWidth << ": expected " << expectedType
+              << ", header has " << ReadKeyElementType( fileName ) << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  typename TImage::Pointer readImage = reader->GetOutput();
+  itk::ImageRegionConstIteratorWithIndex<ShortKeyImageType> it(image, image->GetLargestPossibleRegion());
+  for ( ; !it.IsAtEnd(); ++it )
+    {
+    if ( it.Get() != readImage->GetPixel( it.GetIndex() ) )
+      {
+      std::cerr << "Key width " << keyWidth << ": read value differs at " << it.GetIndex() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
+
+}
+
+
+int
+itkSparseVectorImageKeyWidthTest(int argc, char *argv[])
+{
+  if ( argc != 2 )
+    {
+    std::cerr << "Usage: " << argv[0] << " sparseImage" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  ShortKeyImageType::SizeType size;
+  size.Fill(40);
+  ShortKeyImageType::RegionType region;
+  region.SetSize(size);
+
+  ShortKeyImageType::Pointer image = ShortKeyImageType::New();
+  image->SetRegions(region);
+  image->SetVectorLength(VectorLength);
+  image->Allocate();
+
+  ShortKeyImageType::PixelType pixel(VectorLength);
+  for ( itk::ImageRegionConstIteratorWithIndex<ShortKeyImageType> it(image, region); !it.IsAtEnd(); ++it )
+    {
+    const ShortKeyImageType::IndexType index = it.GetIndex();
+    if ( ( index[0] + index[1] + index[2] ) % 5 != 0 )
+      {
+      continue;
+      }
+    for ( unsigned int k = 0; k < VectorLength; k++ )
+      {
+      pixel[k] = static_cast<PixelType>( ( index[0] * k + index[2] ) % 3 );
+      }
+    image->SetPixel(index, pixel);
+    }
+
+  // 32-bit keys are picked automatically, 64-bit keys can be forced, and
+  // both can be read into images with either key type
+  if ( CheckKeyWidth<LongKeyImageType>( image, argv[1], 0, "MET_UINT" ) != EXIT_SUCCESS
+       || CheckKeyWidth<ShortKeyImageType>( image, argv[1], 0, "MET_UINT" ) != EXIT_SUCCESS
+       || CheckKeyWidth<LongKeyImageType>( image, argv[1], 64, "MET_ULONG_LONG" ) != EXIT_SUCCESS
+       || CheckKeyWidth<ShortKeyImageType>( image, argv[1], 64, "MET_ULONG_LONG" ) != EXIT_SUCCESS )
+    {
+    return EXIT_FAILURE;
+    }
+
+  // The keys of a 2048^3 image do not fit in 32 bits
+  ShortKeyImageType::Pointer largeImage = ShortKeyImageType::New();
+  size.Fill(2048);
+  region.SetSize(size);
+  largeImage->SetRegions(region);
+  largeImage->SetVectorLength(VectorLength);
+  try
+    {
+    largeImage->Allocate();
+    std::cerr << "Allocating an image whose keys do not fit should throw" << std::endl;
+    return EXIT_FAILURE;
+    }
+  catch ( itk::ExceptionObject & err )
+    {
+    std::cout << "Expected exception: " << err.GetDescription() << std::endl;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,140 @@
+#include "itkSparseVectorImage.h"
+#include "itkSparseVectorImageMappedContainer.h"
+#include "itkSparseVectorImageFileReader.h"
+#include "itkSparseVectorImageFileWriter.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkTimeProbe.h"
+#include "itkSparseVectorImageTestHelper.h"
+
+
+namespace
+{
+
+typedef float PixelType;
+const unsigned int Dimension = 3;
+const unsigned int VectorLength = 8;
+
+typedef itk::SparseVectorImage<PixelType, Dimension> ImageType;
+typedef itk::SparseVectorImage<PixelType, Dimension,
+  itk::SparseVectorImageMappedContainer<unsigned long, PixelType> > MappedImageType;
+
+// Read the file into an image of type TImage and compare it with the
+// original one
+template< class TImage >
+int
+CheckRead( const ImageType *image, const char *fileName, const char *name,
+           typename TImage::Pointer & readImage )
+{
+  typedef itk::SparseVectorImageFileReader<TImage> ReaderType;
+  typename ReaderType::Pointer reader = ReaderType::New();
+
+  itk::TimeProbe probe;
+  try
+    {
+    reader->SetFileName( fileName );
+    probe.Start();
+    reader->Update();
+    probe.Stop();
+    }
+  catch ( itk::ExceptionObject & err )
+    {
+    std::cerr << "ExceptionObject caught!" << std::endl;
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  readImage = reader->GetOutput();
+  std::cout << name << ": read " << readImage->GetPixelContainer()->Size()
+            << " elements in " << probe.GetMean() << " s" << std::endl;
+
+  itk::ImageRegionConstIteratorWithIndex<ImageType> it(image, image->GetLargestPossibleRegion());
+  for ( ; !it.IsAtEnd(); ++it )
+    {
+    if ( it.Get() != readImage->GetPixel( it.GetIndex() ) )
+      {
+      std::cerr << name << ": read value differs at " << it.GetIndex() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
+
+}
+
+
+int
+itkSparseVectorImageMappedContainerTest(int argc, char *argv[])
+{
+  if ( argc != 2 )
+    {
+    std::cerr << "Usage: " << argv[0] << " sparseImage" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  ImageType::Pointer image = SparseVectorImageTest::CreateImage<ImageType>( 48, VectorLength );
+  const SparseVectorImageTest::IntegerComponents components = { 3 };
+  SparseVectorImageTest::FillRandom<ImageType>( image, 0.2, components );
+
+  typedef itk::SparseVectorImageFileWriter<ImageType> WriterType;
+  WriterType::Pointer writer = WriterType::New();
+  try
+    {
+    writer->SetFileName( argv[1] );
+    writer->SetInput( image );
+    writer->SingleFileOn();
+    writer->Update();
+    }
+  catch ( itk::ExceptionObject & err )
+    {
+    std::cerr << "ExceptionObject caught!" << std::endl;
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A single-file .spr is read into any container, and mapped into a
+  // SparseVectorImageMappedContainer
+  ImageType::Pointer readImage;
+  MappedImageType::Pointer mappedImage;
+  if ( CheckRead<ImageType>( image, argv[1], "SparseVectorImageContainer", readImage ) != EXIT_SUCCESS
+       || CheckRead<MappedImageType>( image, argv[1], "SparseVectorImageMappedContainer", mappedImage ) != EXIT_SUCCESS )
+    {
+    return EXIT_FAILURE;
+    }
+
+  if ( !mappedImage->GetPixelContainer()->IsMapped()
+       || mappedImage->GetPixelContainer()->Size() != image->GetPixelContainer()->Size() )
+    {
+    std::cerr << "The file was not mapped" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The mapped image is read-only
+  ImageType::IndexType index;
+  index.Fill(0);
+  ImageType::PixelType pixel(VectorLength);
+  pixel.Fill(1);
+  try
+    {
+    mappedImage->SetPixel(index, pixel);
+    std::cerr << "Writing to a mapped image should throw" << std::endl;
+    return EXIT_FAILURE;
+    }
+  catch ( itk::ExceptionObject & err )
+    {
+    std::cout << "Expected exception: " << err.GetDescription() << std::endl;
+    }
+
+  // A copy of the mapped image maps the same file
+  MappedImageType::Pointer copy = MappedImageType::New();
+  copy->DeepCopy(mappedImage);
+  mappedImage = NULL;
+  index.Fill(24);
+  if ( copy->GetPixel(index) != image->GetPixel(index) )
+    {
+    std::cerr << "The copy of the mapped image differs" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,178 @@
+#include "itkSparseVectorImage.h"
+#include "itkSparseVectorImageOccupancyContainer.h"
+#include "itkSparseVectorImageFileReader.h"
+#include "itkSparseVectorImageFileWriter.h"
+#include "itkSparseVectorImageLinearInterpolateImageFunction.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include "itkTimeProbe.h"
+
+
+namespace
+{
+
+typedef float PixelType;
+const unsigned int Dimension = 3;
+const unsigned int VectorLength = 16;
+
+typedef itk::SparseVectorImageContainer<unsigned long, PixelType> ComponentContainerType;
+
+typedef itk::SparseVectorImage<PixelType, Dimension> PlainImageType;
+typedef itk::SparseVectorImage<PixelType, Dimension,
+  itk::SparseVectorImageOccupancyContainer<ComponentContainerType> > VoxelOccupancyImageType;
+typedef itk::SparseVectorImage<PixelType, Dimension,
+  itk::SparseVectorImageOccupancyContainer<ComponentContainerType, 3> > BrickOccupancyImageType;
+
+// Interpolate at random positions, return the time taken and the values
+template< class TImage >
+double
+Interpolate( const TImage *image, std::vector<double> & values )
+{
+  typedef itk::SparseVectorImageLinearInterpolateImageFunction<TImage> InterpolatorType;
+  typename InterpolatorType::Pointer interpolator = InterpolatorType::New();
+  interpolator->SetInputImage(image);
+
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator GeneratorType;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(1234);
+
+  const typename TImage::SizeType size = image->GetLargestPossibleRegion().GetSize();
+  values.clear();
+
+  itk::TimeProbe probe;
+  probe.Start();
+  typename InterpolatorType::ContinuousIndexType index;
+  for ( unsigned int n = 0; n < 100000; n++ )
+    {
+    for ( unsigned int d = 0; d < Dimension; d++ )
+      {
+      index[d] = generator->GetUniformVariate( 0, size[d] - 1 );
+      }
+    values.push_back( interpolator->EvaluateAtContinuousIndex(index)[n % VectorLength] );
+    }
+  probe.Stop();
+  return probe.GetMean();
+}
+
+// Read the image written by the writer and compare its interpolation
+// with the one of the original image
+template< class TImage >
+int
+CheckOccupancy( const char *fileName, const std::vector<double> & expected, const char *name )
+{
+  typedef itk::SparseVectorImageFileReader<TImage> ReaderType;
+  typename ReaderType::Pointer reader = ReaderType::New();
+  reader->SetFileName( fileName );
+  try
+    {
+    reader->Update();
+    }
+  catch ( itk::ExceptionObject & err )
+    {
+    std::cerr << "ExceptionObject caught!" << std::endl;
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  typename TImage::Pointer image = reader->GetOutput();
+  typename TImage::PixelContainer *container = image->GetPixelContainer();
+  container->CollectStatisticsOn();
+
+  std::vector<double> values;
+  const double time = Interpolate<TImage>( image, values );
+
+  std::cout << name << ": " << time << " s, "
+            << container->GetNumberOfSkippedLookups() << " of "
+            << container->GetNumberOfLookups() << " lookups answered by the bitmap, "
+            << container->GetNumberOfOccupiedBricks() << " of "
+            << container->GetNumberOfBricks() << " bits set" << std::endl;
+
+  if ( values != expected )
+    {
+    std::cerr << name << ": interpolated values differ" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if ( container->GetNumberOfSkippedLookups() == 0 )
+    {
+    std::cerr << name << ": no lookup was answered by the bitmap" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+}
+
+
+int
+itkSparseVectorImageOccupancyContainerTest(int argc, char *argv[])
+{
+  if ( argc != 2 )
+    {
+    std::cerr << "Usage: " << argv[0] << " sparseImage" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // A few small blobs in a large image
+  PlainImageType::SizeType size;
+  size.Fill(256);
+  PlainImageType::RegionType region;
+  region.SetSize(size);
+
+  PlainImageType::Pointer image = PlainImageType::New();
+  image->SetRegions(region);
+  image->SetVectorLength(VectorLength);
+  image->Allocate();
+
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator GeneratorType;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(4321);
+
+  PlainImageType::SizeType blobSize;
+  blobSize.Fill(10);
+  PlainImageType::PixelType pixel(VectorLength);
+  for ( unsigned int b = 0; b < 30; b++ )
+    {
+    PlainImageType::IndexType start;
+    for ( unsigned int d = 0; d < Dimension; d++ )
+      {
+      start[d] = generator->GetIntegerVariate( size[d] - blobSize[d] - 1 );
+      }
+    PlainImageType::RegionType blob(start, blobSize);
+    for ( itk::ImageRegionConstIteratorWithIndex<PlainImageType> it(image, blob); !it.IsAtEnd(); ++it )
+      {
+      for ( unsigned int k = 0; k < VectorLength; k++ )
+        {
+        pixel[k] = static_cast<PixelType>( generator->GetVariateWithClosedRange() );
+        }
+      image->SetPixel(it.GetIndex(), pixel);
+      }
+    }
+
+  std::vector<double> expected;
+  std::cout << "Without bitmap: " << Interpolate<PlainImageType>( image, expected ) << " s" << std::endl;
+
+  // The occupancy images are loaded by the reader, element by element
+  typedef itk::SparseVectorImageFileWriter<PlainImageType> WriterType;
+  WriterType::Pointer writer = WriterType::New();
+  try
+    {
+    writer->SetFileName( argv[1] );
+    writer->SetInput( image );
+    writer->Update();
+    }
+  catch ( itk::ExceptionObject & err )
+    {
+    std::cerr << "ExceptionObject caught!" << std::endl;
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if ( CheckOccupancy<VoxelOccupancyImageType>( argv[1], expected, "One bit per voxel" ) != EXIT_SUCCESS
+       || CheckOccupancy<BrickOccupancyImageType>( argv[1], expected, "One bit per 8x8x8 brick" ) != EXIT_SUCCESS )
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+#include "itkSparseVectorImage.h"
+#include "itkSparseVectorImagePackedContainer.h"
+#include "itkSparseVectorImageFileReader.h"
+#include "itkSparseVectorImageFileWriter.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkSparseVectorImageTestHelper.h"
+
+
+namespace
+{
+
+typedef float PixelType;
+const unsigned int Dimension = 3;
+const unsigned int VectorLength = 45;
+
+typedef itk::SparseVectorImage<PixelType, Dimension> PlainImageType;
+typedef itk::SparseVectorImage<PixelType, Dimension,
+  itk::SparseVectorImagePackedContainer<unsigned long, PixelType> > PackedImageType;
+
+// Compare every pixel of the two images
+template< class TImage >
+bool
+SameImages( const PlainImageType *expected, const TImage *image )
+{
+  itk::ImageRegionConstIteratorWithIndex<PlainImageType> it(expected, expected->GetLargestPossibleRegion());
+  for ( ; !it.IsAtEnd(); ++it )
+    {
+    if ( it.Get() != image->GetPixel( it.GetIndex() ) )
+      {
+      std::cerr << "Pixel differs at " << it.GetIndex() << std::endl;
+      return false;
+      }
+    }
+  return true;
+}
+
+}
+
+
+int
+itkSparseVectorImagePackedContainerTest(int argc, char *argv[])
+{
+  if ( argc != 2 )
+    {
+    std::cerr << "Usage: " << argv[0] << " sparseImage" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  PlainImageType::Pointer plainImage =
+    SparseVectorImageTest::CreateImage<PlainImageType>( 32, VectorLength );
+  PackedImageType::Pointer packedImage =
+    SparseVectorImageTest::CreateImage<PackedImageType>( 32, VectorLength );
+
+  // Half of the voxels are stored, with about 45% of zero components.
+  // Both images are filled from the same seed, hence alike.
+  const SparseVectorImageTest::SparseComponents components = { 0.45, 0.1 };
+  SparseVectorImageTest::FillRandom<PlainImageType>( plainImage, 0.5, components );
+  const unsigned long storedVoxels =
+    SparseVectorImageTest::FillRandom<PackedImageType>( packedImage, 0.5, components );
+
+  PackedImageType::PixelContainer *container = packedImage->GetPixelContainer();
+  std::cout << "Stored voxels: " << storedVoxels
+            << ", dense values: " << storedVoxels * VectorLength
+            << ", component keys: " << plainImage->GetPixelContainer()->Size()
+            << ", packed values: " << container->Size() << std::endl;
+
+  if ( container->GetNumberOfVoxels() != storedVoxels
+       || container->Size() != plainImage->GetPixelContainer()->Size()
+       || !SameImages<PackedImageType>( plainImage, packedImage ) )
+    {
+    std::cerr << "The packed image differs from the component keyed one" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The reader loads the packed image component by component
+  typedef itk::SparseVectorImageFileWriter<PlainImageType> WriterType;
+  typedef itk::SparseVectorImageFileReader<PackedImageType> ReaderType;
+
+  WriterType::Pointer writer = WriterType::New();
+  ReaderType::Pointer reader = ReaderType::New();
+  try
+    {
+    writer->SetFileName( argv[1] );
+    writer->SetInput( plainImage );
+    writer->Update();
+
+    reader->SetFileName( argv[1] );
+    reader->Update();
+    }
+  catch ( itk::ExceptionObject & err )
+    {
+    std::cerr << "ExceptionObject caught!" << std::endl;
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  PackedImageType::Pointer readImage = reader->GetOutput();
+  PackedImageType::PixelContainer *readContainer = readImage->GetPixelContainer();
+  std::cout << "Value array after reading: " << readContainer->GetValueArraySize();
+  readContainer->Squeeze();
+  std::cout << ", after Squeeze(): " << readContainer->GetValueArraySize() << std::endl;
+
+  if ( readContainer->GetValueArraySize() != readContainer->Size()
+       || !SameImages<PackedImageType>( plainImage, readImage ) )
+    {
+    std::cerr << "The read packed image differs from the written one" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
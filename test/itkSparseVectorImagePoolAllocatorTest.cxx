@@ -0,0 +1,96 @@
+#include "itkSparseVectorImage.h"
+#include "itkSparseVectorImagePoolAllocator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkTimeProbe.h"
+#include "itkSparseVectorImageTestHelper.h"
+
+
+namespace
+{
+
+typedef float PixelType;
+const unsigned int Dimension = 3;
+const unsigned int VectorLength = 16;
+
+typedef itk::SparseVectorImage<PixelType, Dimension> PlainImageType;
+typedef itk::SparseVectorImage<PixelType, Dimension,
+  itk::SparseVectorImageContainer<unsigned long, PixelType,
+    itk::SparseVectorImagePoolMap<unsigned long, PixelType>::Type> > PoolImageType;
+
+// Fill a third of the voxels, return the time taken
+template< class TImage >
+double
+Fill( TImage *image )
+{
+  const SparseVectorImageTest::IntegerComponents components = { 4 };
+
+  itk::TimeProbe probe;
+  probe.Start();
+  SparseVectorImageTest::FillRandom<TImage>( image, 0.33, components );
+  probe.Stop();
+  return probe.GetMean();
+}
+
+// Release the pixels of the image, return the time taken
+template< class TImage >
+double
+Release( TImage *image )
+{
+  itk::TimeProbe probe;
+  probe.Start();
+  image->Initialize();
+  probe.Stop();
+  return probe.GetMean();
+}
+
+}
+
+
+int
+itkSparseVectorImagePoolAllocatorTest(int, char *[])
+{
+  PlainImageType::Pointer plainImage =
+    SparseVectorImageTest::CreateImage<PlainImageType>( 64, VectorLength );
+  PoolImageType::Pointer poolImage =
+    SparseVectorImageTest::CreateImage<PoolImageType>( 64, VectorLength );
+
+  std::cout << "Fill: default allocator " << Fill<PlainImageType>( plainImage )
+            << " s, pool " << Fill<PoolImageType>( poolImage ) << " s" << std::endl;
+
+  if ( plainImage->GetPixelContainer()->Size() != poolImage->GetPixelContainer()->Size() )
+    {
+    std::cerr << "The images do not have the same number of elements" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  itk::ImageRegionConstIteratorWithIndex<PlainImageType> it(plainImage, plainImage->GetLargestPossibleRegion());
+  for ( ; !it.IsAtEnd(); ++it )
+    {
+    if ( it.Get() != poolImage->GetPixel( it.GetIndex() ) )
+      {
+      std::cerr << "Pixel differs at " << it.GetIndex() << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  const itk::SparseVectorImageMemoryPool *pool =
+    poolImage->GetPixelContainer()->GetPixelMap()->get_allocator().GetPool();
+  std::cout << "Pool: " << pool->GetNumberOfSlabs() << " slabs, "
+            << pool->GetMemorySize() << " bytes" << std::endl;
+  if ( pool->GetNumberOfSlabs() == 0 )
+    {
+    std::cerr << "The nodes were not allocated from the pool" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  std::cout << "Initialize: default allocator " << Release<PlainImageType>( plainImage )
+            << " s, pool " << Release<PoolImageType>( poolImage ) << " s" << std::endl;
+
+  if ( poolImage->GetPixelContainer()->Size() != 0 )
+    {
+    std::cerr << "The pool image was not released" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,182 @@
+#include "itkSparseVectorImage.h"
+#include "itkSparseVectorImageVoxelContainer.h"
+#include "itkSparseVectorImageShardedContainer.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkTimeProbe.h"
+#include "itkSparseVectorImageTestHelper.h"
+#include <cmath>
+
+
+namespace
+{
+
+typedef float PixelType;
+const unsigned int Dimension = 3;
+const unsigned int VectorLength = 8;
+const double Threshold = 0.01;
+
+typedef itk::SparseVectorImage<PixelType, Dimension> ComponentImageType;
+typedef itk::SparseVectorImage<PixelType, Dimension,
+  itk::SparseVectorImageVoxelContainer<unsigned long, PixelType> > VoxelImageType;
+typedef itk::SparseVectorImage<PixelType, Dimension,
+  itk::SparseVectorImageShardedContainer<unsigned long, PixelType> > ShardedImageType;
+
+// Components of the pruned images: 0.001 with probability 0.33,
+// otherwise 1 + k
+struct SmallComponents
+{
+  double operator()( SparseVectorImageTest::GeneratorType *generator, unsigned int k ) const
+    {
+    return generator->GetVariateWithClosedRange() < 0.33 ? 0.001 : 1 + k;
+    }
+};
+
+template< class TImage >
+int
+PruneTest( const char *name )
+{
+  typename TImage::Pointer image = SparseVectorImageTest::CreateImage<TImage>( 48, VectorLength );
+  const typename TImage::RegionType region = image->GetLargestPossibleRegion();
+
+  // A third of the voxels, with a third of their components below the
+  // threshold
+  SmallComponents components;
+  SparseVectorImageTest::FillRandom<TImage>( image, 0.33, components );
+
+  typename TImage::PixelType pixel(VectorLength);
+  typename TImage::PixelType zero(VectorLength);
+  zero.Fill(0);
+
+  // Writing zero over a stored voxel must not leave its old values
+  typename TImage::IndexType origin;
+  origin.Fill(0);
+  pixel.Fill(1);
+  image->SetPixel(origin, pixel);
+  image->SetPixel(origin, zero);
+  if ( image->GetPixel(origin) != zero )
+    {
+    std::cerr << name << ": writing zero did not erase the stored pixel" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const unsigned long sizeBefore = image->GetPixelContainer()->Size();
+  image->SetZeroThreshold(Threshold);
+
+  itk::TimeProbe probe;
+  probe.Start();
+  const itk::SizeValueType bytes = image->Prune();
+  probe.Stop();
+
+  std::cout << name << ": " << sizeBefore << " elements before, "
+            << image->GetPixelContainer()->Size() << " after, "
+            << bytes << " bytes released in " << probe.GetMean() << " s" << std::endl;
+
+  if ( bytes == 0 )
+    {
+    std::cerr << name << ": Prune() did not release any memory" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // No component at or below the threshold is left
+  for ( itk::ImageRegionConstIteratorWithIndex<TImage> it(image, region); !it.IsAtEnd(); ++it )
+    {
+    const typename TImage::PixelType value = it.Get();
+    for ( unsigned int k = 0; k < VectorLength; k++ )
+      {
+      if ( value[k] != 0 && std::fabs( value[k] ) <= Threshold )
+        {
+        std::cerr << name << ": component " << k << " of " << it.GetIndex()
+                  << " was not pruned" << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  // Small components written with a threshold are not stored
+  pixel.Fill( static_cast<PixelType>( 0.001 ) );
+  pixel[0] = 1;
+  image->SetPixel(origin, pixel);
+  if ( image->GetPixel(origin)[0] != 1 || image->GetPixel(origin)[1] != 0 )
+    {
+    std::cerr << name << ": the zero threshold was not applied by SetPixel()" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
+
+// Writing zero over stored voxels releases them without Prune()
+template< class TImage >
+int
+EraseTest( const char *name )
+{
+  typename TImage::Pointer image = SparseVectorImageTest::CreateImage<TImage>( 16, VectorLength );
+  const typename TImage::RegionType region = image->GetLargestPossibleRegion();
+  const typename TImage::SizeType size = region.GetSize();
+
+  typename TImage::PixelType pixel(VectorLength);
+  typename TImage::PixelType zero(VectorLength);
+  pixel.Fill(1);
+  zero.Fill(0);
+  for ( itk::ImageRegionConstIteratorWithIndex<TImage> it(image, region); !it.IsAtEnd(); ++it )
+    {
+    image->SetPixel(it.GetIndex(), pixel);
+    }
+
+  // Zero the first half of the slices
+  typename TImage::RegionType erased = region;
+  erased.SetSize(Dimension - 1, size[Dimension - 1] / 2);
+  for ( itk::ImageRegionConstIteratorWithIndex<TImage> it(image, erased); !it.IsAtEnd(); ++it )
+    {
+    image->SetPixel(it.GetIndex(), zero);
+    }
+
+  const unsigned long voxels = image->GetPixelContainer()->GetNumberOfVoxels();
+  if ( voxels != region.GetNumberOfPixels() - erased.GetNumberOfPixels() )
+    {
+    std::cerr << name << ": " << voxels << " voxels stored after writing zeros, expected "
+              << region.GetNumberOfPixels() - erased.GetNumberOfPixels() << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  for ( itk::ImageRegionConstIteratorWithIndex<TImage> it(image, region); !it.IsAtEnd(); ++it )
+    {
+    if ( it.Get() != ( erased.IsInside( it.GetIndex() ) ? zero : pixel ) )
+      {
+      std::cerr << name << ": wrong pixel at " << it.GetIndex() << " after erasing" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
+
+}
+
+
+int
+itkSparseVectorImagePruneTest(int, char *[])
+{
+  if ( PruneTest<ComponentImageType>("SparseVectorImageContainer") == EXIT_FAILURE )
+    {
+    return EXIT_FAILURE;
+    }
+
+  if ( PruneTest<VoxelImageType>("SparseVectorImageVoxelContainer") == EXIT_FAILURE )
+    {
+    return EXIT_FAILURE;
+    }
+
+  if ( PruneTest<ShardedImageType>("SparseVectorImageShardedContainer") == EXIT_FAILURE )
+    {
+    return EXIT_FAILURE;
+    }
+
+  if ( EraseTest<VoxelImageType>("SparseVectorImageVoxelContainer") == EXIT_FAILURE
+       || EraseTest<ShardedImageType>("SparseVectorImageShardedContainer") == EXIT_FAILURE )
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
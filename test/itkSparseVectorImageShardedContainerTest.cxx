@@ -0,0 +1,132 @@
+#include "itkSparseVectorImage.h"
+#include "itkSparseVectorImageShardedContainer.h"
+#include "itkMultiThreader.h"
+#include "itkTimeProbe.h"
+
+
+namespace
+{
+
+typedef float PixelType;
+const unsigned int Dimension = 3;
+typedef itk::SparseVectorImage<PixelType, Dimension,
+  itk::SparseVectorImageShardedContainer<unsigned long, PixelType> > ImageType;
+
+const unsigned int VectorLength = 8;
+const unsigned long Stride = 7;
+
+// Value of the first component of the voxel written at a given offset
+PixelType
+ExpectedValue( unsigned long offset )
+{
+  return static_cast<PixelType>( offset % 1000 + 1 );
+}
+
+struct ThreadData
+{
+  ImageType::Pointer Image;
+};
+
+// Each thread writes every Stride-th voxel of its own set of slices,
+// and reads back the previous voxel
+ITK_THREAD_RETURN_TYPE
+InsertVoxels( void *arg )
+{
+  itk::MultiThreader::ThreadInfoStruct *info =
+    static_cast<itk::MultiThreader::ThreadInfoStruct *>( arg );
+  ThreadData *data = static_cast<ThreadData *>( info->UserData );
+  ImageType *image = data->Image;
+
+  const ImageType::SizeType size = image->GetLargestPossibleRegion().GetSize();
+  ImageType::PixelType pixel(VectorLength);
+  pixel.Fill(1);
+
+  ImageType::IndexType index;
+  for ( index[2] = info->ThreadID; index[2] < static_cast<itk::IndexValueType>( size[2] );
+        index[2] += info->NumberOfThreads )
+    {
+    for ( index[1] = 0; index[1] < static_cast<itk::IndexValueType>( size[1] ); index[1]++ )
+      {
+      for ( index[0] = 0; index[0] < static_cast<itk::IndexValueType>( size[0] ); index[0]++ )
+        {
+        const unsigned long offset = image->ComputeOffset(index);
+        if ( offset % Stride == 0 )
+          {
+          pixel[0] = ExpectedValue(offset);
+          image->SetPixel(index, pixel);
+          }
+        else if ( offset % Stride == 1 )
+          {
+          image->GetPixel(index);
+          }
+        }
+      }
+    }
+
+  return ITK_THREAD_RETURN_VALUE;
+}
+
+}
+
+
+int
+itkSparseVectorImageShardedContainerTest(int, char *[])
+{
+  ImageType::SizeType size;
+  size.Fill(128);
+  ImageType::RegionType region;
+  region.SetSize(size);
+
+  const unsigned long expectedVoxels = ( region.GetNumberOfPixels() + Stride - 1 ) / Stride;
+  const itk::ThreadIdType maximumThreads = itk::MultiThreader::GetGlobalDefaultNumberOfThreads();
+  double singleThreadTime = 0.0;
+
+  for ( itk::ThreadIdType numberOfThreads = 1; numberOfThreads <= maximumThreads;
+        numberOfThreads *= 2 )
+    {
+    ThreadData data;
+    data.Image = ImageType::New();
+    data.Image->SetRegions(region);
+    data.Image->SetVectorLength(VectorLength);
+    data.Image->Allocate();
+
+    itk::MultiThreader::Pointer threader = itk::MultiThreader::New();
+    threader->SetNumberOfThreads(numberOfThreads);
+    threader->SetSingleMethod(InsertVoxels, &data);
+
+    itk::TimeProbe probe;
+    probe.Start();
+    threader->SingleMethodExecute();
+    probe.Stop();
+
+    if ( numberOfThreads == 1 )
+      {
+      singleThreadTime = probe.GetMean();
+      }
+    std::cout << numberOfThreads << " threads: "
+              << expectedVoxels / probe.GetMean() << " inserts/s, speedup "
+              << singleThreadTime / probe.GetMean() << std::endl;
+
+    // Every voxel written by the threads is stored
+    if ( data.Image->GetPixelContainer()->GetNumberOfVoxels() != expectedVoxels )
+      {
+      std::cerr << "Stored " << data.Image->GetPixelContainer()->GetNumberOfVoxels()
+                << " voxels instead of " << expectedVoxels << std::endl;
+      return EXIT_FAILURE;
+      }
+
+    for ( unsigned long offset = 0; offset < region.GetNumberOfPixels(); offset += Stride )
+      {
+      const ImageType::IndexType index = data.Image->ComputeIndex(offset);
+      const ImageType::PixelType pixel = data.Image->GetPixel(index);
+      if ( pixel[0] != ExpectedValue(offset) || pixel[VectorLength-1] != 1 )
+        {
+        std::cerr << "Wrong value at " << index << " with "
+                  << numberOfThreads << " threads" << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  return EXIT_SUCCESS;
+}
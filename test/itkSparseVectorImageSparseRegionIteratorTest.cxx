@@ -0,0 +1,188 @@
+#include "itkSparseVectorImage.h"
+#include "itkSparseVectorImageVoxelContainer.h"
+#include "itkImageSparseRegionIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkTimeProbe.h"
+#include "itkSparseVectorImageTestHelper.h"
+
+
+namespace
+{
+
+typedef float PixelType;
+const unsigned int Dimension = 3;
+const unsigned int VectorLength = 8;
+
+// One voxel out of 97 is stored, some with zero components
+const SparseVectorImageTest::PeriodicPattern Pattern = { 97, 31, 3 };
+
+template< class TImage >
+typename TImage::Pointer
+CreateImage( const typename TImage::IndexType & start )
+{
+  typename TImage::SizeType size;
+  size.Fill(128);
+  typename TImage::RegionType region( start, size );
+
+  typename TImage::Pointer image = SparseVectorImageTest::CreateImage<TImage>( region, VectorLength );
+  SparseVectorImageTest::FillImage<TImage>( image, Pattern );
+  return image;
+}
+
+// Compare the sparse iterator with a dense iterator on a region, return
+// the number of errors
+template< class TImage >
+unsigned int
+CheckSparseIterator( TImage *image, const typename TImage::RegionType & region )
+{
+  typedef itk::ImageRegionConstIteratorWithIndex<TImage> DenseIteratorType;
+  typedef itk::ImageSparseRegionConstIterator<TImage>    SparseIteratorType;
+  typedef itk::ImageSparseRegionIterator<TImage>         IteratorType;
+
+  unsigned int errors = 0;
+
+  // Dense iteration over all the voxels of the region
+  itk::TimeProbe denseProbe;
+  denseProbe.Start();
+  double denseSum = 0;
+  unsigned long denseCount = 0;
+  std::vector<typename TImage::IndexType> denseIndices;
+  DenseIteratorType denseIt( image, region );
+  for ( denseIt.GoToBegin(); !denseIt.IsAtEnd(); ++denseIt )
+    {
+    const typename TImage::PixelType pixel = denseIt.Get();
+    bool empty = true;
+    for ( unsigned int k = 0; k < VectorLength; k++ )
+      {
+      denseSum += pixel[k];
+      empty = empty && pixel[k] == 0;
+      }
+    if ( !empty )
+      {
+      ++denseCount;
+      denseIndices.push_back( denseIt.GetIndex() );
+      }
+    }
+  denseProbe.Stop();
+
+  // Sparse iteration, in the same order
+  itk::TimeProbe sparseProbe;
+  sparseProbe.Start();
+  double sparseSum = 0;
+  SparseIteratorType sparseIt( image, region );
+  for ( sparseIt.GoToBegin(); !sparseIt.IsAtEnd(); ++sparseIt )
+    {
+    const PixelType *components = sparseIt.GetComponents();
+    for ( unsigned int k = 0; k < VectorLength; k++ )
+      {
+      sparseSum += components[k];
+      }
+    }
+  sparseProbe.Stop();
+
+  std::cout << "  " << region.GetNumberOfPixels() << " voxels, "
+            << sparseIt.GetNumberOfPixels() << " stored: dense "
+            << denseProbe.GetMean() << " s, sparse " << sparseProbe.GetMean() << " s" << std::endl;
+
+  if ( sparseIt.GetNumberOfPixels() != denseCount || sparseSum != denseSum )
+    {
+    std::cerr << "Visited " << sparseIt.GetNumberOfPixels() << " voxels instead of "
+              << denseCount << ", sum " << sparseSum << " instead of " << denseSum << std::endl;
+    ++errors;
+    }
+
+  unsigned long n = 0;
+  for ( sparseIt.GoToBegin(); !sparseIt.IsAtEnd() && n < denseIndices.size(); ++sparseIt, ++n )
+    {
+    if ( sparseIt.GetIndex() != denseIndices[n]
+         || sparseIt.GetOffset() != image->ComputeOffset( denseIndices[n] )
+         || sparseIt.Get() != image->GetPixel( denseIndices[n] ) )
+      {
+      ++errors;
+      }
+    }
+
+  // Double the stored values of the region
+  IteratorType it( image, region );
+  for ( it.GoToBegin(); !it.IsAtEnd(); ++it )
+    {
+    typename TImage::PixelType pixel = it.Get();
+    for ( unsigned int k = 0; k < VectorLength; k++ )
+      {
+      pixel[k] *= 2;
+      }
+    it.Set( pixel );
+    }
+
+  double doubledSum = 0;
+  for ( sparseIt.GoToBegin(); !sparseIt.IsAtEnd(); ++sparseIt )
+    {
+    for ( unsigned int k = 0; k < VectorLength; k++ )
+      {
+      doubledSum += sparseIt.Get()[k];
+      }
+    }
+  if ( doubledSum != 2 * denseSum )
+    {
+    std::cerr << "Sum after doubling " << doubledSum << " instead of " << 2 * denseSum << std::endl;
+    ++errors;
+    }
+
+  return errors;
+}
+
+template< class TImage >
+unsigned int
+CheckImage( const char *name )
+{
+  typename TImage::IndexType start;
+  start.Fill(0);
+  typename TImage::Pointer image = CreateImage<TImage>( start );
+
+  typename TImage::RegionType region;
+  typename TImage::IndexType index;
+  typename TImage::SizeType size;
+  index[0] = 5;  index[1] = 17;  index[2] = 30;
+  size[0] = 100; size[1] = 50;   size[2] = 64;
+  region.SetIndex(index);
+  region.SetSize(size);
+
+  std::cout << name << std::endl;
+  unsigned int errors = CheckSparseIterator<TImage>( image, image->GetLargestPossibleRegion() )
+    + CheckSparseIterator<TImage>( image, region );
+
+  // The indices of an image whose regions do not start at zero
+  start[0] = 3;  start[1] = 10;  start[2] = 20;
+  image = CreateImage<TImage>( start );
+  for ( unsigned int d = 0; d < Dimension; d++ )
+    {
+    index[d] += start[d];
+    }
+  region.SetIndex(index);
+
+  std::cout << name << ", start index " << start << std::endl;
+  return errors + CheckSparseIterator<TImage>( image, image->GetLargestPossibleRegion() )
+    + CheckSparseIterator<TImage>( image, region );
+}
+
+}
+
+
+int
+itkSparseVectorImageSparseRegionIteratorTest(int, char *[])
+{
+  typedef itk::SparseVectorImage<PixelType, Dimension> DefaultImageType;
+  typedef itk::SparseVectorImage<PixelType, Dimension,
+    itk::SparseVectorImageVoxelContainer<unsigned long, PixelType> > VoxelImageType;
+
+  unsigned int errors = CheckImage<DefaultImageType>( "SparseVectorImageContainer" );
+  errors += CheckImage<VoxelImageType>( "SparseVectorImageVoxelContainer" );
+
+  if ( errors > 0 )
+    {
+    std::cerr << errors << " errors" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
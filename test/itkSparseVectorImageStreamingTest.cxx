@@ -0,0 +1,168 @@
+#include "itkSparseVectorImage.h"
+#include "itkResampleSparseVectorImageFilter.h"
+#include "itkWarpSparseVectorImageFilter.h"
+#include "itkAffineTransform.h"
+#include "itkStreamingImageFilter.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkSparseVectorImageTestHelper.h"
+#include <cmath>
+
+
+namespace
+{
+
+typedef float PixelType;
+const unsigned int Dimension = 3;
+const unsigned int VectorLength = 4;
+
+typedef itk::SparseVectorImage<PixelType, Dimension> ImageType;
+typedef itk::ResampleSparseVectorImageFilter<ImageType, ImageType> ResampleFilterType;
+typedef itk::Vector<float, Dimension> DisplacementType;
+typedef itk::Image<DisplacementType, Dimension> DisplacementFieldType;
+typedef itk::WarpSparseVectorImageFilter<ImageType, ImageType, DisplacementFieldType> WarpFilterType;
+typedef itk::AffineTransform<double, Dimension> TransformType;
+typedef itk::StreamingImageFilter<ImageType, ImageType> StreamingFilterType;
+
+// Compare two images over the largest possible region of the first one
+int
+CheckSame( const ImageType *image, const ImageType *expected, const char *name, double tolerance )
+{
+  for ( itk::ImageRegionConstIteratorWithIndex<ImageType> it(expected, expected->GetLargestPossibleRegion());
+        !it.IsAtEnd(); ++it )
+    {
+    const ImageType::PixelType pixel = image->GetPixel( it.GetIndex() );
+    const ImageType::PixelType expectedPixel = it.Get();
+    for ( unsigned int k = 0; k < VectorLength; k++ )
+      {
+      if ( std::fabs( pixel[k] - expectedPixel[k] ) > tolerance )
+        {
+        std::cerr << name << ": streamed output differs at " << it.GetIndex() << ": "
+                  << pixel << " instead of " << expectedPixel << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+  std::cout << name << ": " << image->GetPixelContainer()->Size() << " elements" << std::endl;
+  return EXIT_SUCCESS;
+}
+
+// Check that the input requested region is smaller than the input
+bool
+IsRequestedRegionBounded( const ImageType *input, const char *name )
+{
+  const ImageType::RegionType & requestedRegion = input->GetRequestedRegion();
+  std::cout << name << ": input requested region " << requestedRegion.GetIndex()
+            << " " << requestedRegion.GetSize() << std::endl;
+  return requestedRegion.GetNumberOfPixels() < input->GetLargestPossibleRegion().GetNumberOfPixels();
+}
+
+}
+
+
+int
+itkSparseVectorImageStreamingTest(int, char *[])
+{
+  ImageType::Pointer image = SparseVectorImageTest::CreateImage<ImageType>( 40, VectorLength );
+  const ImageType::SizeType size = image->GetLargestPossibleRegion().GetSize();
+
+  SparseVectorImageTest::GeneratorType::Pointer generator = SparseVectorImageTest::GeneratorType::New();
+  generator->Initialize(1234);
+
+  const SparseVectorImageTest::IntegerComponents components = { 4 };
+  SparseVectorImageTest::FillRandom<ImageType>( image, image->GetLargestPossibleRegion(), 0.1,
+                                                components, generator );
+
+  TransformType::Pointer affine = TransformType::New();
+  TransformType::InputPointType center;
+  center.Fill(19.5);
+  affine->SetCenter( center );
+  affine->Rotate( 0, 2, 0.2 );
+  TransformType::OutputVectorType translation;
+  translation.Fill( 2.5 );
+  affine->Translate( translation );
+
+  // Resample the center of the input, in one piece and by slabs. The
+  // output of the second filter is resampled again, so that the first
+  // filter is updated for every slab.
+  ImageType::SizeType outputSize;
+  outputSize.Fill(20);
+  ImageType::PointType outputOrigin;
+  outputOrigin.Fill(10);
+
+  ResampleFilterType::Pointer resample = ResampleFilterType::New();
+  resample->SetInput( image );
+  resample->SetTransform( affine );
+  resample->SetSize( size );
+
+  ResampleFilterType::Pointer crop = ResampleFilterType::New();
+  crop->SetInput( resample->GetOutput() );
+  crop->SetSize( outputSize );
+  crop->SetOutputOrigin( outputOrigin );
+  crop->Update();
+
+  ImageType::Pointer expected = crop->GetOutput();
+  expected->DisconnectPipeline();
+
+  if ( !IsRequestedRegionBounded( resample->GetOutput(), "Resample" ) )
+    {
+    std::cerr << "Resample: the whole input was requested" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  resample->Modified();
+  StreamingFilterType::Pointer streamer = StreamingFilterType::New();
+  streamer->SetInput( crop->GetOutput() );
+  streamer->SetNumberOfStreamDivisions( 4 );
+  streamer->Update();
+
+  // The scanlines of the linear path start at the thread regions, which
+  // differ between the slabs, hence the tolerance
+  if ( CheckSame( streamer->GetOutput(), expected, "Streamed resample", 1e-5 ) != EXIT_SUCCESS )
+    {
+    return EXIT_FAILURE;
+    }
+
+  // Warp the center of the input with a bounded displacement field, in
+  // one piece and by slabs
+  DisplacementFieldType::Pointer field = DisplacementFieldType::New();
+  DisplacementFieldType::RegionType fieldRegion;
+  fieldRegion.SetSize( outputSize );
+  field->SetRegions( fieldRegion );
+  field->SetOrigin( outputOrigin );
+  field->Allocate();
+  for ( itk::ImageRegionIterator<DisplacementFieldType> it(field, fieldRegion); !it.IsAtEnd(); ++it )
+    {
+    DisplacementType displacement;
+    for ( unsigned int j = 0; j < Dimension; j++ )
+      {
+      displacement[j] = static_cast<float>( 3 * generator->GetVariateWithClosedRange() - 1.5 );
+      }
+    it.Set( displacement );
+    }
+
+  WarpFilterType::Pointer warp = WarpFilterType::New();
+  warp->SetInput( image );
+  warp->SetDisplacementField( field );
+  warp->SetOutputOrigin( outputOrigin );
+  warp->Update();
+
+  expected = warp->GetOutput();
+  expected->DisconnectPipeline();
+
+  if ( !IsRequestedRegionBounded( image, "Warp" ) )
+    {
+    std::cerr << "Warp: the whole input was requested" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  warp->Modified();
+  streamer->SetInput( warp->GetOutput() );
+  streamer->Update();
+
+  if ( CheckSame( streamer->GetOutput(), expected, "Streamed warp", 0 ) != EXIT_SUCCESS )
+    {
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
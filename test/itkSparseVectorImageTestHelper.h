@@ -0,0 +1,172 @@
+/*=========================================================================
+
+ Program:   Sparse Vector Image Test Helper
+
+ Copyright (c) Pew-Thian Yap. All rights reserved.
+ See http://www.unc.edu/~ptyap/ for details.
+
+ This software is distributed WITHOUT ANY WARRANTY; without even
+ the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ PURPOSE.  See the above copyright notices for more information.
+
+ =========================================================================*/
+
+#ifndef __itkSparseVectorImageTestHelper_h
+#define __itkSparseVectorImageTestHelper_h
+
+#include "itkImageRegion.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+
+
+/** Helpers shared by the tests of the sparse vector images. */
+namespace SparseVectorImageTest
+{
+
+/** Deterministic content of a test image: one voxel out of Step is
+ *  stored, and its components cycle with the offset modulo Modulus.
+ *  The components whose offset plus component index is a multiple of
+ *  ZeroPeriod are zero, unless ZeroPeriod is 0. Offsets are counted from
+ *  the start of the largest possible region. */
+struct PeriodicPattern
+{
+  unsigned long Step;
+  unsigned long Modulus;
+  unsigned long ZeroPeriod;
+
+  bool IsStored( unsigned long offset ) const
+    {
+    return offset % Step == 0;
+    }
+
+  double ExpectedValue( unsigned long offset, unsigned int component ) const
+    {
+    if ( !this->IsStored(offset) || ( ZeroPeriod != 0 && ( offset + component ) % ZeroPeriod == 0 ) )
+      {
+      return 0;
+      }
+    return static_cast<double>( offset % Modulus + component + 1 );
+    }
+};
+
+/** Allocate an empty image over a region. */
+template< class TImage >
+typename TImage::Pointer
+CreateImage( const typename TImage::RegionType & region, unsigned int vectorLength )
+{
+  typename TImage::Pointer image = TImage::New();
+  image->SetRegions(region);
+  image->SetVectorLength(vectorLength);
+  image->Allocate();
+  return image;
+}
+
+/** Allocate a cube of the given size, starting at index zero. */
+template< class TImage >
+typename TImage::Pointer
+CreateImage( itk::SizeValueType size, unsigned int vectorLength )
+{
+  typename TImage::SizeType regionSize;
+  regionSize.Fill(size);
+  typename TImage::RegionType region;
+  region.SetSize(regionSize);
+  return CreateImage<TImage>( region, vectorLength );
+}
+
+/** Store the voxels of a pattern in an image. */
+template< class TImage >
+void
+FillImage( TImage *image, const PeriodicPattern & pattern )
+{
+  typedef typename TImage::InternalPixelType ValueType;
+
+  const typename TImage::RegionType region = image->GetLargestPossibleRegion();
+  const unsigned int vectorLength = image->GetNumberOfComponentsPerPixel();
+
+  // Copy of a pixel, with the length of the pixels of the image
+  typename TImage::PixelType pixel = image->GetPixel( region.GetIndex() );
+  for ( unsigned long offset = 0; offset < region.GetNumberOfPixels(); offset += pattern.Step )
+    {
+    for ( unsigned int k = 0; k < vectorLength; k++ )
+      {
+      pixel[k] = static_cast<ValueType>( pattern.ExpectedValue(offset, k) );
+      }
+    image->SetPixel(image->ComputeIndex(offset), pixel);
+    }
+}
+
+typedef itk::Statistics::MersenneTwisterRandomVariateGenerator GeneratorType;
+
+/** Random components of FillRandom(): integers in [0, Maximum]. */
+struct IntegerComponents
+{
+  unsigned int Maximum;
+
+  double operator()( GeneratorType *generator, unsigned int ) const
+    {
+    return generator->GetIntegerVariate( Maximum );
+    }
+};
+
+/** Random components of FillRandom(): zero with probability
+ *  ZeroProbability, otherwise Offset plus a value in [0, 1]. */
+struct SparseComponents
+{
+  double ZeroProbability;
+  double Offset;
+
+  double operator()( GeneratorType *generator, unsigned int ) const
+    {
+    if ( generator->GetVariateWithClosedRange() < ZeroProbability )
+      {
+      return 0;
+      }
+    return Offset + generator->GetVariateWithClosedRange();
+    }
+};
+
+/** Store random pixels in a fraction density of the voxels of a region.
+ *  The components of a pixel are drawn by components( generator, k ).
+ *  Return the number of pixels written. */
+template< class TImage, class TComponents >
+unsigned long
+FillRandom( TImage *image, const typename TImage::RegionType & region, double density,
+            const TComponents & components, GeneratorType *generator )
+{
+  typedef typename TImage::InternalPixelType ValueType;
+
+  const unsigned int vectorLength = image->GetNumberOfComponentsPerPixel();
+  typename TImage::PixelType pixel = image->GetPixel( region.GetIndex() );
+
+  unsigned long written = 0;
+  for ( itk::ImageRegionConstIteratorWithIndex<TImage> it(image, region); !it.IsAtEnd(); ++it )
+    {
+    if ( generator->GetVariateWithClosedRange() > density )
+      {
+      continue;
+      }
+    for ( unsigned int k = 0; k < vectorLength; k++ )
+      {
+      pixel[k] = static_cast<ValueType>( components(generator, k) );
+      }
+    image->SetPixel(it.GetIndex(), pixel);
+    written++;
+    }
+  return written;
+}
+
+/** Store random pixels over the whole image, with a generator seeded by
+ *  1234, so that images filled alike have the same content. */
+template< class TImage, class TComponents >
+unsigned long
+FillRandom( TImage *image, double density, const TComponents & components )
+{
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(1234);
+  return FillRandom( image, image->GetLargestPossibleRegion(), density,
+                     components, generator.GetPointer() );
+}
+
+}
+
+#endif
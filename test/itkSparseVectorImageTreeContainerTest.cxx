@@ -0,0 +1,182 @@
+#include "itkSparseVectorImage.h"
+#include "itkSparseVectorImageTreeContainer.h"
+#include "itkSparseVectorImageVoxelContainer.h"
+#include "itkConstNeighborhoodIterator.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkSparseVectorImageTestHelper.h"
+
+
+int
+itkSparseVectorImageTreeContainerTest(int, char *[])
+{
+  typedef float PixelType;
+  const unsigned int Dimension = 3;
+  typedef itk::SparseVectorImage<PixelType, Dimension,
+    itk::SparseVectorImageTreeContainer<unsigned long, PixelType> > TreeImageType;
+  typedef itk::SparseVectorImage<PixelType, Dimension,
+    itk::SparseVectorImageVoxelContainer<unsigned long, PixelType> > ReferenceImageType;
+  typedef TreeImageType::PixelType VectorPixelType;
+
+  // A very large grid with a few small blobs
+  const unsigned int vectorLength = 4;
+  TreeImageType::Pointer tree = SparseVectorImageTest::CreateImage<TreeImageType>( 2000, vectorLength );
+  ReferenceImageType::Pointer reference =
+    SparseVectorImageTest::CreateImage<ReferenceImageType>( 2000, vectorLength );
+  const TreeImageType::RegionType region = tree->GetLargestPossibleRegion();
+  const TreeImageType::SizeType size = region.GetSize();
+
+  SparseVectorImageTest::GeneratorType::Pointer generator = SparseVectorImageTest::GeneratorType::New();
+  generator->Initialize(1234);
+
+  TreeImageType::SizeType blobSize;
+  blobSize.Fill(12);
+  std::vector<TreeImageType::RegionType> blobs;
+  const SparseVectorImageTest::SparseComponents components = { 0.5, 0 };
+
+  for ( unsigned int b = 0; b < 20; b++ )
+    {
+    TreeImageType::IndexType start;
+    for ( unsigned int d = 0; d < Dimension; d++ )
+      {
+      start[d] = generator->GetIntegerVariate( size[d] - blobSize[d] - 1 );
+      }
+    TreeImageType::RegionType blob(start, blobSize);
+    blobs.push_back(blob);
+
+    SparseVectorImageTest::FillRandom<TreeImageType>( tree, blob, 1.0, components, generator );
+    for ( itk::ImageRegionConstIteratorWithIndex<TreeImageType> it(tree, blob); !it.IsAtEnd(); ++it )
+      {
+      reference->SetPixel(it.GetIndex(), it.Get());
+      }
+    }
+
+  std::cout << "Stored voxels: " << tree->GetPixelContainer()->GetNumberOfVoxels()
+            << ", leaves: " << tree->GetPixelContainer()->GetNumberOfLeaves()
+            << ", internal nodes: " << tree->GetPixelContainer()->GetNumberOfInternalNodes()
+            << std::endl;
+
+  if ( tree->GetPixelContainer()->GetNumberOfVoxels()
+       != reference->GetPixelContainer()->GetNumberOfVoxels() )
+    {
+    std::cerr << "Number of stored voxels differs" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Neighbourhoods around the blobs, through the neighborhood accessor
+  typedef itk::ConstNeighborhoodIterator<TreeImageType> TreeNeighborhoodIteratorType;
+  typedef itk::ConstNeighborhoodIterator<ReferenceImageType> ReferenceNeighborhoodIteratorType;
+  TreeNeighborhoodIteratorType::RadiusType radius;
+  radius.Fill(1);
+
+  for ( unsigned int b = 0; b < blobs.size(); b++ )
+    {
+    TreeImageType::RegionType neighborhoodRegion = blobs[b];
+    neighborhoodRegion.PadByRadius(2);
+    neighborhoodRegion.Crop(region);
+
+    TreeNeighborhoodIteratorType treeIt(radius, tree, neighborhoodRegion);
+    ReferenceNeighborhoodIteratorType referenceIt(radius, reference, neighborhoodRegion);
+    for ( ; !treeIt.IsAtEnd(); ++treeIt, ++referenceIt )
+      {
+      for ( unsigned int n = 0; n < treeIt.Size(); n++ )
+        {
+        if ( treeIt.GetPixel(n) != referenceIt.GetPixel(n) )
+          {
+          std::cerr << "Neighborhood differs at " << treeIt.GetIndex() << std::endl;
+          return EXIT_FAILURE;
+          }
+        }
+      }
+    }
+
+  // Region emptiness
+  for ( unsigned int b = 0; b < blobs.size(); b++ )
+    {
+    TreeImageType::RegionType inside = blobs[b];
+    if ( tree->GetPixelContainer()->IsRegionEmpty( inside.GetIndex().GetIndex(),
+                                                   inside.GetSize().GetSize() ) )
+      {
+      std::cerr << "Blob " << b << " reported empty" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  TreeImageType::IndexType corner;
+  corner.Fill(0);
+  TreeImageType::SizeType cornerSize;
+  cornerSize.Fill(1);
+  bool cornerEmpty = true;
+  for ( unsigned int b = 0; b < blobs.size(); b++ )
+    {
+    if ( blobs[b].IsInside(corner) )
+      {
+      cornerEmpty = false;
+      }
+    }
+  if ( cornerEmpty != tree->GetPixelContainer()->IsRegionEmpty( corner.GetIndex(),
+                                                                 cornerSize.GetSize() ) )
+    {
+    std::cerr << "Wrong emptiness of the corner voxel" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  if ( tree->GetPixelContainer()->IsRegionEmpty( region.GetIndex().GetIndex(),
+                                                 region.GetSize().GetSize() ) )
+    {
+    std::cerr << "Whole image reported empty" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Zeroing the neighbourhood of a blob erases its voxels and releases
+  // the leaves holding them
+  const unsigned long leavesBefore = tree->GetPixelContainer()->GetNumberOfLeaves();
+  TreeImageType::RegionType erased = blobs[0];
+  erased.PadByRadius(8);
+  erased.Crop(region);
+  VectorPixelType pixel(vectorLength);
+  pixel.Fill(0);
+  for ( itk::ImageRegionConstIteratorWithIndex<TreeImageType> it(tree, erased); !it.IsAtEnd(); ++it )
+    {
+    tree->SetPixel(it.GetIndex(), pixel);
+    reference->SetPixel(it.GetIndex(), pixel);
+    }
+
+  if ( tree->GetPixelContainer()->GetNumberOfVoxels()
+       != reference->GetPixelContainer()->GetNumberOfVoxels()
+       || tree->GetPixelContainer()->GetNumberOfLeaves() >= leavesBefore )
+    {
+    std::cerr << "Zeroed voxels not erased" << std::endl;
+    return EXIT_FAILURE;
+    }
+  if ( !tree->GetPixelContainer()->IsRegionEmpty( erased.GetIndex().GetIndex(),
+                                                  erased.GetSize().GetSize() ) )
+    {
+    std::cerr << "Erased region reported not empty" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  for ( unsigned int b = 1; b < blobs.size(); b++ )
+    {
+    itk::ImageRegionConstIteratorWithIndex<ReferenceImageType> referenceIt(reference, blobs[b]);
+    for ( ; !referenceIt.IsAtEnd(); ++referenceIt )
+      {
+      if ( tree->GetPixel(referenceIt.GetIndex()) != referenceIt.Get() )
+        {
+        std::cerr << "Blob " << b << " differs after erasing at " << referenceIt.GetIndex() << std::endl;
+        return EXIT_FAILURE;
+        }
+      }
+    }
+
+  // Filling the buffer removes all the nodes
+  pixel.Fill(0);
+  tree->FillBuffer(pixel);
+  if ( !tree->GetPixelContainer()->IsRegionEmpty( region.GetIndex().GetIndex(),
+                                                  region.GetSize().GetSize() ) )
+    {
+    std::cerr << "Image not empty after FillBuffer()" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,160 @@
+#include "itkSparseVectorImage.h"
+#include "itkSparseVectorImageVoxelContainer.h"
+#include "itkSparseVectorImageCodecContainer.h"
+#include "itkSparseVectorImageFileReader.h"
+#include "itkSparseVectorImageFileWriter.h"
+#include "itkImageRegionConstIteratorWithIndex.h"
+#include "itkMersenneTwisterRandomVariateGenerator.h"
+#include <algorithm>
+#include <cmath>
+
+
+namespace
+{
+
+typedef float PixelType;
+const unsigned int Dimension = 3;
+const unsigned int VectorLength = 15;
+
+typedef itk::SparseVectorImage<PixelType, Dimension,
+  itk::SparseVectorImageVoxelContainer<unsigned long, PixelType> > FullImageType;
+typedef itk::SparseVectorImage<PixelType, Dimension,
+  itk::SparseVectorImageCodecContainer<
+    itk::SparseVectorImageVoxelContainer<unsigned long, itk::uint16_t>,
+    itk::SparseVectorImageHalfCodec<PixelType> > > HalfImageType;
+typedef itk::SparseVectorImage<PixelType, Dimension,
+  itk::SparseVectorImageCodecContainer<
+    itk::SparseVectorImageVoxelContainer<unsigned long, itk::uint8_t>,
+    itk::SparseVectorImageLinearCodec<PixelType, itk::uint8_t> > > LinearImageType;
+
+template< class TImage >
+typename TImage::Pointer
+CreateImage( const typename TImage::RegionType & region )
+{
+  typename TImage::Pointer image = TImage::New();
+  image->SetRegions(region);
+  image->SetVectorLength(VectorLength);
+  image->Allocate();
+  return image;
+}
+
+// Return the largest difference between the components of two images
+template< class TImage, class TOtherImage >
+double
+MaximumError( const TImage *image, const TOtherImage *other )
+{
+  double error = 0;
+  itk::ImageRegionConstIteratorWithIndex<TImage> it(image, image->GetLargestPossibleRegion());
+  for ( ; !it.IsAtEnd(); ++it )
+    {
+    const typename TImage::PixelType pixel = it.Get();
+    const typename TOtherImage::PixelType otherPixel = other->GetPixel( it.GetIndex() );
+    for ( unsigned int k = 0; k < VectorLength; k++ )
+      {
+      error = std::max( error, static_cast<double>( std::fabs( pixel[k] - otherPixel[k] ) ) );
+      }
+    }
+  return error;
+}
+
+}
+
+
+int
+itkSparseVectorImageValueCodecTest(int argc, char *argv[])
+{
+  if ( argc != 2 )
+    {
+    std::cerr << "Usage: " << argv[0] << " sparseImage" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  FullImageType::SizeType size;
+  size.Fill(24);
+  FullImageType::RegionType region;
+  region.SetSize(size);
+
+  FullImageType::Pointer fullImage = CreateImage<FullImageType>( region );
+  HalfImageType::Pointer halfImage = CreateImage<HalfImageType>( region );
+  LinearImageType::Pointer linearImage = CreateImage<LinearImageType>( region );
+  linearImage->GetPixelContainer()->GetCodec().SetRange( -1.0, 1.0 );
+
+  typedef itk::Statistics::MersenneTwisterRandomVariateGenerator GeneratorType;
+  GeneratorType::Pointer generator = GeneratorType::New();
+  generator->Initialize(1234);
+
+  FullImageType::PixelType pixel(VectorLength);
+  for ( itk::ImageRegionConstIteratorWithIndex<FullImageType> it(fullImage, region); !it.IsAtEnd(); ++it )
+    {
+    if ( generator->GetVariateWithClosedRange() < 0.7 )
+      {
+      continue;
+      }
+    for ( unsigned int k = 0; k < VectorLength; k++ )
+      {
+      pixel[k] = static_cast<PixelType>( generator->GetUniformVariate( -1.0, 1.0 ) );
+      }
+    fullImage->SetPixel(it.GetIndex(), pixel);
+    halfImage->SetPixel(it.GetIndex(), pixel);
+    linearImage->SetPixel(it.GetIndex(), pixel);
+    }
+
+  // Half floats keep 11 bits of mantissa, 8-bit codes cover [-1, 1] in
+  // 254 steps
+  const double halfError = MaximumError<FullImageType, HalfImageType>( fullImage, halfImage );
+  const double linearError = MaximumError<FullImageType, LinearImageType>( fullImage, linearImage );
+  std::cout << "Maximum error: half " << halfError << ", 8-bit " << linearError << std::endl;
+  if ( halfError > 1.0 / 2048 || linearError > 1.0 / 254 )
+    {
+    std::cerr << "The reduced precision values are too far from the original ones" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // The header records the codec parameters, so that reading the file
+  // with the same codec gives the same codes
+  typedef itk::SparseVectorImageFileWriter<LinearImageType> WriterType;
+  typedef itk::SparseVectorImageFileReader<LinearImageType> ReaderType;
+  typedef itk::SparseVectorImageFileReader<FullImageType> FullReaderType;
+
+  WriterType::Pointer writer = WriterType::New();
+  ReaderType::Pointer reader = ReaderType::New();
+  FullReaderType::Pointer fullReader = FullReaderType::New();
+  try
+    {
+    writer->SetFileName( argv[1] );
+    writer->SetInput( linearImage );
+    writer->Update();
+
+    reader->SetFileName( argv[1] );
+    reader->Update();
+
+    fullReader->SetFileName( argv[1] );
+    fullReader->Update();
+    }
+  catch ( itk::ExceptionObject & err )
+    {
+    std::cerr << "ExceptionObject caught!" << std::endl;
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  const LinearImageType::PixelContainer::CodecType & codec = linearImage->GetPixelContainer()->GetCodec();
+  const LinearImageType::PixelContainer::CodecType & readCodec = reader->GetOutput()->GetPixelContainer()->GetCodec();
+  for ( unsigned int k = 0; k < VectorLength; k++ )
+    {
+    if ( codec.GetScale(k) != readCodec.GetScale(k) || codec.GetOffset(k) != readCodec.GetOffset(k) )
+      {
+      std::cerr << "The codec parameters of component " << k << " were not restored" << std::endl;
+      return EXIT_FAILURE;
+      }
+    }
+
+  if ( MaximumError<LinearImageType, LinearImageType>( linearImage, reader->GetOutput() ) != 0
+       || MaximumError<LinearImageType, FullImageType>( linearImage, fullReader->GetOutput() ) != 0 )
+    {
+    std::cerr << "The read values differ from the written ones" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;
+}
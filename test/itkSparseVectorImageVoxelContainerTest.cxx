@@ -0,0 +1,141 @@
+#include "itkImageFileReader.h"
+#include "itkImageFileWriter.h"
+#include "itkVectorImage.h"
+#include "itkSparseVectorImage.h"
+#include "itkSparseVectorImageVoxelContainer.h"
+#include "itkSparseVectorImageFileReader.h"
+#include "itkSparseVectorImageFileWriter.h"
+#include "itkImageRegionIterator.h"
+#include "itkImageRegionConstIterator.h"
+
+
+inline void 
+PrintHelpInfo ( char* str )
+{
+  std::cout << str << ": convert a VectorImage to a voxel-keyed SparseVectorImage, write it, read it back and convert it to a VectorImage" << std::endl << std::flush;
+  std::cout << str << " inputImage sparseImage outputImage" << std::endl << std::flush;
+}
+
+int
+itkSparseVectorImageVoxelContainerTest(int argc, char *argv[])
+{
+  if (argc!=4)
+    {
+    std::cerr << "No input or No output!" << std::endl;
+    PrintHelpInfo(argv[0]);
+    return EXIT_FAILURE;
+    }
+
+  std::string _InputFile(argv[1]);
+  std::string _SparseFile(argv[2]);
+  std::string _OutputFile(argv[3]);
+
+  // Define Variables
+  typedef float PixelType;
+  typedef itk::VectorImage<PixelType, 3> VectorImageType;
+  typedef itk::SparseVectorImageVoxelContainer<unsigned long, PixelType> ContainerType;
+  typedef itk::SparseVectorImage<PixelType, 3, ContainerType> SparseVectorImageType;
+  typedef itk::ImageFileReader<VectorImageType> ReaderType;
+  typedef itk::SparseVectorImageFileReader<SparseVectorImageType> SparseReaderType;
+  typedef itk::SparseVectorImageFileWriter<SparseVectorImageType> SparseWriterType;
+
+  VectorImageType::Pointer inputImage;
+  VectorImageType::Pointer outputImage = VectorImageType::New();
+  SparseVectorImageType::Pointer sparseImage = SparseVectorImageType::New();
+  ReaderType::Pointer reader = ReaderType::New();
+  
+  // Read input image
+  reader->SetFileName(_InputFile);
+  try
+    {
+    std::cout << "Reading file: " << _InputFile << std::endl;
+    reader->Update();
+    }
+  catch (itk::ExceptionObject & err)
+    {
+    std::cerr << "ExceptionObject caught!" << std::endl;
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  inputImage = reader->GetOutput();
+  
+  // Allocate sparse image
+  sparseImage->CopyInformation(inputImage);
+  sparseImage->SetRegions(inputImage->GetLargestPossibleRegion());
+  sparseImage->Allocate();
+
+  // Transfer data
+  itk::ImageRegionConstIterator<VectorImageType> inputIt(inputImage, inputImage->GetLargestPossibleRegion() );
+  itk::ImageRegionIterator<SparseVectorImageType> sparseIt(sparseImage, sparseImage->GetLargestPossibleRegion() );
+
+  for ( inputIt.GoToBegin(), sparseIt.GoToBegin(); !inputIt.IsAtEnd(); ++inputIt, ++sparseIt )
+    {
+    sparseIt.Set(inputIt.Get());
+    }
+
+  std::cout << "Number of stored voxels: "
+            << sparseImage->GetPixelContainer()->GetNumberOfVoxels() << std::endl;
+
+  // Write and read back the sparse image
+  SparseWriterType::Pointer sparseWriter = SparseWriterType::New();
+  SparseReaderType::Pointer sparseReader = SparseReaderType::New();
+  try
+    {
+    std::cout << "Writing file: " << _SparseFile << std::endl;
+    sparseWriter->SetFileName( _SparseFile );
+    sparseWriter->SetInput( sparseImage );
+    sparseWriter->Update();
+
+    std::cout << "Reading file: " << _SparseFile << std::endl;
+    sparseReader->SetFileName( _SparseFile );
+    sparseReader->Update();
+    }
+  catch ( itk::ExceptionObject & err )
+    {
+    std::cerr << "ExceptionObject caught!" << std::endl;
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  SparseVectorImageType::Pointer readImage = sparseReader->GetOutput();
+
+  if ( readImage->GetPixelContainer()->GetNumberOfVoxels()
+       != sparseImage->GetPixelContainer()->GetNumberOfVoxels() )
+    {
+    std::cerr << "Number of voxels differs after reading!" << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  // Transfer SparseVectorImage to VectorImage
+  outputImage->CopyInformation(inputImage);
+  outputImage->SetRegions(inputImage->GetLargestPossibleRegion());
+  outputImage->Allocate();
+
+  itk::ImageRegionConstIterator<SparseVectorImageType> readIt(readImage, readImage->GetLargestPossibleRegion() );
+  itk::ImageRegionIterator<VectorImageType> outputIt(outputImage, outputImage->GetLargestPossibleRegion() );
+
+  for ( readIt.GoToBegin(), outputIt.GoToBegin(); !outputIt.IsAtEnd(); ++readIt, ++outputIt )
+    {
+    outputIt.Set(readIt.Get());
+    }
+
+  // Write Output
+  try
+    {
+    typedef itk::ImageFileWriter<VectorImageType> OutputImageWriterType;
+    OutputImageWriterType::Pointer writer = OutputImageWriterType::New(); 
+    std::cout << "Writing file: " << _OutputFile << std::endl;
+    writer->SetFileName( _OutputFile );
+    writer->SetInput( outputImage );
+    writer->Update();
+    }
+  catch ( itk::ExceptionObject & err )
+    {
+    std::cerr << "ExceptionObject caught!" << std::endl;
+    std::cerr << err << std::endl;
+    return EXIT_FAILURE;
+    }
+
+  return EXIT_SUCCESS;  
+}
@@ -59,6 +59,22 @@ itkVectorAndSparseVectorImageConvertorTest(int argc, char *argv[])
   sparseImage->SetRegions(inputImage->GetLargestPossibleRegion());
   sparseImage->Allocate();
 
+  // Presize the container for the non-zero components of the input
+  itk::SizeValueType numberOfElements = 0;
+  for ( itk::ImageRegionConstIterator<VectorImageType> countIt(inputImage, inputImage->GetLargestPossibleRegion() );
+        !countIt.IsAtEnd(); ++countIt )
+    {
+    const VectorImageType::PixelType value = countIt.Get();
+    for ( unsigned int k = 0; k < value.GetSize(); k++ )
+      {
+      if ( value[k] != 0 )
+        {
+        ++numberOfElements;
+        }
+      }
+    }
+  sparseImage->GetPixelContainer()->Reserve(numberOfElements);
+
   // Iterator for the input image
   itk::ImageRegionConstIterator<VectorImageType> inputIt(inputImage, inputImage->GetLargestPossibleRegion() );
   